@@ -0,0 +1,15 @@
+uniform lowp vec4 materialColor;
+
+VARYING_ lowp vec4 varColor;
+
+VARYING_ highp vec3 eyeVec;
+
+void main(void)
+{
+	gl_Position = mWorldViewProj * inVertexPosition;
+
+	// The vertex colors are daylight colors, scaled by the current brightness
+	varColor = inVertexColor * materialColor;
+
+	eyeVec = -(mWorldView * inVertexPosition).xyz;
+}
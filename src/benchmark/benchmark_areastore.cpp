@@ -0,0 +1,73 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "util/areastore.h"
+#include <random>
+
+TEST_CASE("benchmark_areastore")
+{
+	std::mt19937 rng(42);
+	auto random = [&rng] (s16 min, s16 max) -> s16 {
+		return min + rng() % (max - min + 1);
+	};
+	auto random_pos = [&random] () {
+		return v3s16(random(-5000, 5000), random(-100, 100), random(-5000, 5000));
+	};
+	auto random_area = [&] () {
+		v3s16 minedge = random_pos();
+		return Area(minedge, minedge + v3s16(random(0, 50), random(0, 50), random(0, 50)));
+	};
+
+	BvhAreaStore store;
+	store.setCacheParams(false, 16, 20);
+	for (int i = 0; i < 50000; i++) {
+		Area a = random_area();
+		store.insertArea(&a);
+	}
+
+	std::vector<v3s16> positions;
+	for (int i = 0; i < 1000; i++)
+		positions.push_back(random_pos());
+
+	BENCHMARK("query_1000") {
+		std::vector<Area *> result;
+		for (v3s16 pos : positions)
+			store.getAreasForPos(&result, pos);
+		return result.size();
+	};
+
+	// Areas added since the tree was built
+	for (int i = 0; i < 5000; i++) {
+		Area a = random_area();
+		store.insertArea(&a);
+	}
+
+	BENCHMARK("query_1000_after_insert_5000") {
+		std::vector<Area *> result;
+		for (v3s16 pos : positions)
+			store.getAreasForPos(&result, pos);
+		return result.size();
+	};
+
+	// Like protection mods: areas come and go while the server queries.
+	// The IDs are given as getNextId() would dominate otherwise.
+	u32 next_id = 1000000;
+	BENCHMARK("insert_query_remove_1000") {
+		std::vector<Area *> result;
+		std::vector<u32> ids;
+		for (size_t i = 0; i < positions.size(); i++) {
+			if (i % 4 == 0) {
+				Area a = random_area();
+				a.id = next_id++;
+				store.insertArea(&a);
+				ids.push_back(a.id);
+			}
+			store.getAreasForPos(&result, positions[i]);
+		}
+		for (u32 id : ids)
+			store.removeArea(id);
+		return result.size();
+	};
+}
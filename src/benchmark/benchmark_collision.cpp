@@ -0,0 +1,105 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "collision.h"
+#include "dummygamedef.h"
+#include "dummymap.h"
+#include "environment.h"
+#include "nodedef.h"
+#include <random>
+
+namespace {
+
+class BenchEnvironment : public Environment
+{
+public:
+	BenchEnvironment(IGameDef *gamedef, v3s16 bpmin, v3s16 bpmax) :
+		Environment(gamedef), m_map(gamedef, bpmin, bpmax)
+	{}
+
+	void step(f32 dtime) override {}
+
+	Map &getMap() override { return m_map; }
+
+	void getSelectedActiveObjects(const core::line3d<f32> &shootline_on_map,
+		std::vector<PointedThing> &objects,
+		const std::optional<Pointabilities> &pointabilities) override {}
+
+private:
+	DummyMap m_map;
+};
+
+struct Entity {
+	v3f pos, speed;
+};
+
+}
+
+TEST_CASE("benchmark_collision")
+{
+	DummyGameDef gamedef;
+	NodeDefManager *ndef = gamedef.getWritableNodeDefManager();
+
+	content_t content_stone, content_slab;
+	{
+		ContentFeatures f;
+		f.name = "stone";
+		content_stone = ndef->set(f.name, f);
+	}
+	{
+		ContentFeatures f;
+		f.name = "slab";
+		f.drawtype = NDT_NODEBOX;
+		f.node_box.type = NODEBOX_FIXED;
+		f.node_box.fixed.emplace_back(-0.5f * BS, -0.5f * BS, -0.5f * BS,
+				0.5f * BS, 0, 0.5f * BS);
+		content_slab = ndef->set(f.name, f);
+	}
+
+	const v3s16 bpmin(-2, 0, -2), bpmax(2, 1, 2);
+	BenchEnvironment env(&gamedef, bpmin, bpmax);
+	Map &map = env.getMap();
+	static_cast<DummyMap &>(map).fill(bpmin, bpmax, MapNode(CONTENT_AIR));
+
+	// Hilly ground with slabs, walled in
+	for (s16 z = -32; z < 48; z++)
+	for (s16 x = -32; x < 48; x++) {
+		const u32 h = ((u32)x * 73856093U) ^ ((u32)z * 19349663U);
+		const s16 height = x == -32 || x == 47 || z == -32 || z == 47 ?
+				20 : 4 + h % 3;
+		for (s16 y = 0; y < height; y++)
+			map.setNode(v3s16(x, y, z), MapNode(content_stone));
+		if (h % 5 == 0)
+			map.setNode(v3s16(x, height, z), MapNode(content_slab));
+	}
+
+	std::mt19937 rng(42);
+	auto random = [&] (f32 min, f32 max) {
+		return min + (max - min) * (rng() % 1000) / 1000.0f;
+	};
+	std::vector<Entity> entities(500);
+	for (Entity &entity : entities) {
+		entity.pos = v3f(random(-30, 45), 8, random(-30, 45)) * BS;
+		entity.speed = v3f(random(-4, 4), 0, random(-4, 4)) * BS;
+	}
+
+	const aabb3f box(v3f(-0.3f, -0.5f, -0.3f) * BS, v3f(0.3f, 1.2f, 0.3f) * BS);
+	const v3f gravity(0, -9.81f * BS, 0);
+
+	BENCHMARK("collision_move_500", i) {
+		size_t collisions = 0;
+		for (Entity &entity : entities) {
+			auto result = collisionMoveSimple(&env, &gamedef, box, 0.6f * BS,
+					0.05f, &entity.pos, &entity.speed, gravity, nullptr, false);
+			collisions += result.collisions.size();
+			// keep walking
+			if (entity.speed.X == 0)
+				entity.speed.X = random(-4, 4) * BS;
+			if (entity.speed.Z == 0)
+				entity.speed.Z = random(-4, 4) * BS;
+		}
+		return collisions;
+	};
+}
@@ -0,0 +1,155 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "craftdef.h"
+#include "dummygamedef.h"
+#include "inventory.h"
+#include "itemdef.h"
+#include "util/string.h"
+#include <random>
+
+namespace {
+
+constexpr u32 ITEM_COUNT = 2000;
+constexpr u32 GROUP_COUNT = 100;
+
+std::string item_name(u32 i)
+{
+	return "bench:item" + std::to_string(i);
+}
+
+// Every item is in two groups
+std::string item_group(u32 i, u32 which)
+{
+	return "bench_group" + std::to_string((i * 7 + which * 13) % GROUP_COUNT);
+}
+
+class CraftBench
+{
+public:
+	CraftBench(u32 recipe_count) : m_rng(42)
+	{
+		auto *idef = static_cast<IWritableItemDefManager *>(m_gamedef.idef());
+		for (u32 i = 0; i < ITEM_COUNT; i++) {
+			ItemDefinition def;
+			def.type = ITEM_CRAFT;
+			def.name = item_name(i);
+			def.groups[item_group(i, 0)] = 1;
+			def.groups[item_group(i, 1)] = 1;
+			idef->registerItem(def);
+		}
+
+		auto *cdef = static_cast<IWritableCraftDefManager *>(m_gamedef.getCraftDefManager());
+		for (u32 i = 0; i < recipe_count; i++) {
+			const std::string output = item_name(random(ITEM_COUNT));
+			const u32 kind = i % 4;
+			std::vector<std::string> slots;
+			if (kind == 3) {
+				// shapeless, a mix of items and groups
+				for (u32 j = 0, n = 2 + random(4); j < n; j++)
+					slots.push_back(randomSlot());
+				cdef->registerCraft(new CraftDefinitionShapeless(
+					output, slots, CraftReplacements()), &m_gamedef);
+				continue;
+			}
+			// shaped, mostly using groups
+			const u32 width = 1 + random(3), height = 1 + random(3);
+			for (u32 j = 0; j < width * height; j++)
+				slots.push_back(random(5) == 0 ? "" : randomSlot());
+			slots[0] = randomSlot();
+			cdef->registerCraft(new CraftDefinitionShaped(
+				output, width, slots, CraftReplacements()), &m_gamedef);
+			m_shaped.emplace_back(width, slots);
+		}
+		cdef->initHashes(&m_gamedef);
+	}
+
+	// An input that matches one of the shaped recipes
+	CraftInput matchingInput()
+	{
+		const auto &recipe = m_shaped[random(m_shaped.size())];
+		std::vector<ItemStack> items(9);
+		for (size_t i = 0; i < recipe.second.size(); i++) {
+			const std::string &slot = recipe.second[i];
+			std::string name = slot;
+			if (str_starts_with(slot, "group:")) {
+				// any item of that group
+				const std::string group = slot.substr(6);
+				do {
+					name = item_name(random(ITEM_COUNT));
+				} while (!hasGroup(name, group));
+			}
+			items[(i / recipe.first) * 3 + i % recipe.first] = ItemStack(name, 1, 0, m_gamedef.idef());
+		}
+		return CraftInput(CRAFT_METHOD_NORMAL, 3, items);
+	}
+
+	// A full grid of random items, which usually matches nothing
+	CraftInput randomInput()
+	{
+		std::vector<ItemStack> items;
+		for (u32 i = 0; i < 9; i++)
+			items.emplace_back(item_name(random(ITEM_COUNT)), 1, 0, m_gamedef.idef());
+		return CraftInput(CRAFT_METHOD_NORMAL, 3, items);
+	}
+
+	bool craft(CraftInput input)
+	{
+		CraftOutput output;
+		std::vector<ItemStack> replacements;
+		return m_gamedef.getCraftDefManager()->getCraftResult(
+			input, output, replacements, false, &m_gamedef);
+	}
+
+private:
+	u32 random(u32 max) { return m_rng() % max; }
+
+	std::string randomSlot()
+	{
+		if (random(3) == 0)
+			return item_name(random(ITEM_COUNT));
+		return "group:bench_group" + std::to_string(random(GROUP_COUNT));
+	}
+
+	bool hasGroup(const std::string &name, const std::string &group)
+	{
+		return itemgroup_get(m_gamedef.idef()->get(name).groups, group) != 0;
+	}
+
+	DummyGameDef m_gamedef;
+	std::mt19937 m_rng;
+	std::vector<std::pair<u32, std::vector<std::string>>> m_shaped;
+};
+
+}
+
+TEST_CASE("benchmark_craft")
+{
+	CraftBench bench(20000);
+
+	std::vector<CraftInput> matching, random;
+	for (int i = 0; i < 64; i++) {
+		matching.push_back(bench.matchingInput());
+		random.push_back(bench.randomInput());
+	}
+
+	// Sanity check, the inputs are made from recipes
+	for (const CraftInput &input : matching)
+		REQUIRE(bench.craft(input));
+
+	BENCHMARK_ADVANCED("craft_match_20k")(Catch::Benchmark::Chronometer meter) {
+		size_t i = 0;
+		meter.measure([&] {
+			return bench.craft(matching[i++ % matching.size()]);
+		});
+	};
+
+	BENCHMARK_ADVANCED("craft_random_20k")(Catch::Benchmark::Chronometer meter) {
+		size_t i = 0;
+		meter.measure([&] {
+			return bench.craft(random[i++ % random.size()]);
+		});
+	};
+}
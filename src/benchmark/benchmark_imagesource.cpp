@@ -0,0 +1,331 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "client/imagesource.h"
+#include "filesys.h"
+#include "noise.h"
+
+#include "irr_ptr.h"
+#include "irrlicht.h"
+#include "IVideoDriver.h"
+#include <cmath>
+
+/*
+	The texture modifiers as they were before they accessed the pixels of
+	ECF_A8R8G8B8 images directly, for comparison.
+*/
+namespace old {
+
+void apply_colorize(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		const video::SColor color, int ratio, bool keep_alpha)
+{
+	u32 alpha = color.getAlpha();
+	video::SColor dst_c;
+	if ((ratio == -1 && alpha == 255) || ratio == 255) { // full replacement of color
+		if (keep_alpha) { // replace the color with alpha = dest alpha * color alpha
+			dst_c = color;
+			for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
+			for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
+				u32 dst_alpha = dst->getPixel(x, y).getAlpha();
+				if (dst_alpha > 0) {
+					dst_c.setAlpha(dst_alpha * alpha / 255);
+					dst->setPixel(x, y, dst_c);
+				}
+			}
+		} else { // replace the color including the alpha
+			for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
+			for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++)
+				if (dst->getPixel(x, y).getAlpha() > 0)
+					dst->setPixel(x, y, color);
+		}
+	} else {  // interpolate between the color and destination
+		float interp = (ratio == -1 ? color.getAlpha() / 255.0f : ratio / 255.0f);
+		for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
+		for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
+			dst_c = dst->getPixel(x, y);
+			if (dst_c.getAlpha() > 0) {
+				dst_c = color.getInterpolated(dst_c, interp);
+				dst->setPixel(x, y, dst_c);
+			}
+		}
+	}
+}
+
+void apply_multiplication(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		const video::SColor color)
+{
+	video::SColor dst_c;
+
+	for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
+	for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
+		dst_c = dst->getPixel(x, y);
+		dst_c.set(
+				dst_c.getAlpha(),
+				(dst_c.getRed() * color.getRed()) / 255,
+				(dst_c.getGreen() * color.getGreen()) / 255,
+				(dst_c.getBlue() * color.getBlue()) / 255
+				);
+		dst->setPixel(x, y, dst_c);
+	}
+}
+
+void apply_screen(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		const video::SColor color)
+{
+	video::SColor dst_c;
+
+	for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
+	for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
+		dst_c = dst->getPixel(x, y);
+		dst_c.set(
+			dst_c.getAlpha(),
+			255 - ((255 - dst_c.getRed())   * (255 - color.getRed()))   / 255,
+			255 - ((255 - dst_c.getGreen()) * (255 - color.getGreen())) / 255,
+			255 - ((255 - dst_c.getBlue())  * (255 - color.getBlue()))  / 255
+		);
+		dst->setPixel(x, y, dst_c);
+	}
+}
+
+void apply_overlay(video::IImage *blend, video::IImage *dst,
+	v2s32 blend_pos, v2s32 dst_pos, v2u32 size, bool hardlight)
+{
+	video::IImage *blend_layer = hardlight ? dst : blend;
+	video::IImage *base_layer  = hardlight ? blend : dst;
+	v2s32 blend_layer_pos = hardlight ? dst_pos : blend_pos;
+	v2s32 base_layer_pos  = hardlight ? blend_pos : dst_pos;
+
+	for (u32 y = 0; y < size.Y; y++)
+	for (u32 x = 0; x < size.X; x++) {
+		s32 base_x = x + base_layer_pos.X;
+		s32 base_y = y + base_layer_pos.Y;
+
+		video::SColor blend_c =
+			blend_layer->getPixel(x + blend_layer_pos.X, y + blend_layer_pos.Y);
+		video::SColor base_c = base_layer->getPixel(base_x, base_y);
+		f32 blend_r = blend_c.getRed()   / 255.0f;
+		f32 blend_g = blend_c.getGreen() / 255.0f;
+		f32 blend_b = blend_c.getBlue()  / 255.0f;
+		f32 base_r = base_c.getRed()   / 255.0f;
+		f32 base_g = base_c.getGreen() / 255.0f;
+		f32 base_b = base_c.getBlue()  / 255.0f;
+
+		base_c.set(
+			base_c.getAlpha(),
+			// Do a Multiply blend if less that 0.5, otherwise do a Screen blend
+			(u32)((base_r < 0.5f ? 2 * base_r * blend_r : 1 - 2 * (1 - base_r) * (1 - blend_r)) * 255),
+			(u32)((base_g < 0.5f ? 2 * base_g * blend_g : 1 - 2 * (1 - base_g) * (1 - blend_g)) * 255),
+			(u32)((base_b < 0.5f ? 2 * base_b * blend_b : 1 - 2 * (1 - base_b) * (1 - blend_b)) * 255)
+		);
+		dst->setPixel(base_x, base_y, base_c);
+	}
+}
+
+void apply_brightness_contrast(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+	s32 brightness, s32 contrast)
+{
+	f32 norm_c = core::clamp(contrast,   -127, 127) / 128.0f;
+	f32 norm_b = core::clamp(brightness, -127, 127) / 127.0f;
+	f32 scaled_b = brightness * 127.5f / 127;
+	f32 slope = 1 - std::fabs(norm_b);
+
+	f32 angle = std::atan(slope);
+	angle += norm_c <= 0
+		? norm_c * angle
+		: norm_c * (M_PI_2 - angle);
+	slope = std::tan(angle);
+
+	f32 c = slope <= 1
+		? -slope * 127.5f + 127.5f + scaled_b
+		: -slope * (127.5f - scaled_b) + 127.5f;
+	c += 0.5f;
+
+	video::SColor dst_c;
+	for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
+	for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
+		dst_c = dst->getPixel(x, y);
+
+		dst_c.set(
+			dst_c.getAlpha(),
+			core::clamp((int)(slope * dst_c.getRed()   + c), 0, 255),
+			core::clamp((int)(slope * dst_c.getGreen() + c), 0, 255),
+			core::clamp((int)(slope * dst_c.getBlue()  + c), 0, 255)
+		);
+		dst->setPixel(x, y, dst_c);
+	}
+}
+
+void apply_mask(video::IImage *mask, video::IImage *dst,
+		v2s32 mask_pos, v2s32 dst_pos, v2u32 size)
+{
+	for (u32 y0 = 0; y0 < size.Y; y0++) {
+		for (u32 x0 = 0; x0 < size.X; x0++) {
+			s32 mask_x = x0 + mask_pos.X;
+			s32 mask_y = y0 + mask_pos.Y;
+			s32 dst_x = x0 + dst_pos.X;
+			s32 dst_y = y0 + dst_pos.Y;
+			video::SColor mask_c = mask->getPixel(mask_x, mask_y);
+			video::SColor dst_c = dst->getPixel(dst_x, dst_y);
+			dst_c.color &= mask_c.color;
+			dst->setPixel(dst_x, dst_y, dst_c);
+		}
+	}
+}
+
+} // namespace old
+
+namespace {
+
+// Random pixels, a quarter of them fully transparent
+void fillRandom(video::IImage *img, s32 seed)
+{
+	PcgRandom pr(seed);
+	const core::dimension2du dim = img->getDimension();
+	for (u32 y = 0; y < dim.Height; y++)
+	for (u32 x = 0; x < dim.Width; x++) {
+		u32 alpha = pr.range(0, 3) == 0 ? 0 : pr.range(1, 255);
+		img->setPixel(x, y, video::SColor(alpha,
+				pr.range(0, 255), pr.range(0, 255), pr.range(0, 255)));
+	}
+}
+
+class NullDriverPersistentCache : public PersistentImageCache {
+public:
+	NullDriverPersistentCache(const std::string &dir, video::IVideoDriver *driver) :
+		PersistentImageCache(dir, ""), m_driver(driver)
+	{}
+
+protected:
+	video::IImage *createImage(core::dimension2du dim) override
+	{
+		return m_driver->createImage(video::ECF_A8R8G8B8, dim);
+	}
+
+private:
+	video::IVideoDriver *m_driver;
+};
+
+}
+
+TEST_CASE("benchmark_imagesource")
+{
+	SIrrlichtCreationParameters p;
+	p.DriverType = video::EDT_NULL;
+	auto *device = createDeviceEx(p);
+	REQUIRE(device);
+	video::IVideoDriver *driver = device->getVideoDriver();
+
+	// A large texture, the kernels are applied to all of it
+	const core::dimension2du dim(256, 256);
+	irr_ptr<video::IImage> dst(driver->createImage(video::ECF_A8R8G8B8, dim));
+	irr_ptr<video::IImage> top(driver->createImage(video::ECF_A8R8G8B8, dim));
+	fillRandom(dst.get(), 1);
+	fillRandom(top.get(), 2);
+	const v2u32 size(dim.Width, dim.Height);
+	const video::SColor color(200, 30, 140, 250);
+
+	BENCHMARK("colorize_old") {
+		old::apply_colorize(dst.get(), {0, 0}, size, color, 100, false);
+	};
+	BENCHMARK("colorize") {
+		apply_colorize(dst.get(), {0, 0}, size, color, 100, false);
+	};
+
+	BENCHMARK("multiply_old") {
+		old::apply_multiplication(dst.get(), {0, 0}, size, color);
+	};
+	BENCHMARK("multiply") {
+		apply_multiplication(dst.get(), {0, 0}, size, color);
+	};
+
+	BENCHMARK("screen_old") {
+		old::apply_screen(dst.get(), {0, 0}, size, color);
+	};
+	BENCHMARK("screen") {
+		apply_screen(dst.get(), {0, 0}, size, color);
+	};
+
+	BENCHMARK("brightness_contrast_old") {
+		old::apply_brightness_contrast(dst.get(), {0, 0}, size, 20, 40);
+	};
+	BENCHMARK("brightness_contrast") {
+		apply_brightness_contrast(dst.get(), {0, 0}, size, 20, 40);
+	};
+
+	BENCHMARK("overlay_old") {
+		old::apply_overlay(top.get(), dst.get(), {0, 0}, {0, 0}, size, false);
+	};
+	BENCHMARK("overlay") {
+		apply_overlay(top.get(), dst.get(), {0, 0}, {0, 0}, size, false);
+	};
+
+	BENCHMARK("mask_old") {
+		old::apply_mask(top.get(), dst.get(), {0, 0}, {0, 0}, size);
+	};
+	BENCHMARK("mask") {
+		apply_mask(top.get(), dst.get(), {0, 0}, {0, 0}, size);
+	};
+
+	dst.reset();
+	top.reset();
+	device->drop();
+}
+
+TEST_CASE("benchmark_persistent_image_cache")
+{
+	SIrrlichtCreationParameters p;
+	p.DriverType = video::EDT_NULL;
+	auto *device = createDeviceEx(p);
+	REQUIRE(device);
+	video::IVideoDriver *driver = device->getVideoDriver();
+
+	irr_ptr<video::IImage> source(driver->createImage(video::ECF_A8R8G8B8, {16, 16}));
+	fillRandom(source.get(), 1);
+	const std::set<std::string> source_names{"a.png"};
+
+	const std::string dir = fs::CreateTempDir();
+	REQUIRE(!dir.empty());
+	{
+		SourceImageCache sources;
+		NullDriverPersistentCache cache(dir, driver);
+
+		// Hashing a source image, once per session
+		BENCHMARK("source_hash_pixels") {
+			sources.insert("a.png", source.get(), false);
+			return sources.getContentHash("a.png").size();
+		};
+		BENCHMARK("source_hash_file") {
+			sources.insert("a.png", source.get(), false, "hash");
+			return sources.getContentHash("a.png").size();
+		};
+
+		// The sizes of inventory cubes made from 16 and 64 px textures,
+		// and of a texture scaled up with [resize
+		for (u32 size : {144, 576, 256}) {
+			irr_ptr<video::IImage> img(driver->createImage(video::ECF_A8R8G8B8, {size, size}));
+			fillRandom(img.get(), 2);
+			const std::string name = std::to_string(size);
+			cache.insert(name, img.get(), sources, source_names);
+
+			BENCHMARK("persistent_get_" + name) {
+				std::set<std::string> names;
+				video::IImage *cached = cache.get(name, sources, names);
+				if (cached)
+					cached->drop();
+				return cached != nullptr;
+			};
+		}
+
+		BENCHMARK("resize_16_to_256") {
+			video::IImage *img = driver->createImage(video::ECF_A8R8G8B8, {256, 256});
+			source->copyToScaling(img);
+			img->drop();
+		};
+	}
+	fs::RecursiveDelete(dir);
+
+	source.reset();
+	device->drop();
+}
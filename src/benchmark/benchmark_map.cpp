@@ -6,6 +6,7 @@
 #include "dummygamedef.h"
 #include "map.h"
 #include "mapsector.h"
+#include "util/directiontables.h"
 
 namespace {
 class TestMap : public Map {
@@ -88,6 +89,24 @@ static int readYColumn(Map &map, s16 n)
 	return result;
 }
 
+// Coherent access, like the neighbor lookups of lighting or meshing
+static int readNeighbors(Map &map, s16 n)
+{
+	int result = 0;
+	for(s16 z=0; z<n; z++)
+	for(s16 y=0; y<n; y++)
+	for(s16 x=0; x<n; x++) {
+		v3s16 p(x,y,z);
+		for (const v3s16 &dir : g_6dirs) {
+			MapBlock *block = map.getBlockNoCreateNoEx(p + dir);
+			if (block) {
+				result++;
+			}
+		}
+	}
+	return result;
+}
+
 static int readNodes(Map &map, s16 n)
 {
 	int result = 0;
@@ -156,6 +175,14 @@ static int readNodes(Map &map, s16 n)
 			return readRandomBlocks(map, _count); \
 		}); \
 	}; \
+	BENCHMARK_ADVANCED("readFilledNeighbors_" #_count)(Catch::Benchmark::Chronometer meter) { \
+		DummyGameDef gamedef; \
+		TestMap map(&gamedef); \
+		fillMap(map, _count); \
+		meter.measure([&] { \
+			return readNeighbors(map, _count); \
+		}); \
+	}; \
 	BENCHMARK_ADVANCED("readEmptyNodes_" #_count)(Catch::Benchmark::Chronometer meter) { \
 		DummyGameDef gamedef; \
 		TestMap map(&gamedef); \
@@ -3,7 +3,9 @@
 // Copyright (C) 2023 Minetest Authors
 
 #include "catch.h"
+#include "dummygamedef.h"
 #include "mapblock.h"
+#include "voxel.h"
 #include <vector>
 
 typedef std::vector<MapBlock*> MBContainer;
@@ -170,3 +172,85 @@ TEST_CASE("benchmark_mapblock") {
 	BENCH1(2200)
 	BENCH1(7500) // <- default client_mapblock_limit
 }
+
+// Blocks of layered terrain with a few ores and light levels, as found
+// around the surface
+static void allocateTerrain(MBContainer &vec, u32 n, IGameDef *gamedef)
+{
+	VoxelManipulator vm;
+	vec.reserve(vec.size() + n);
+	for (u32 i = 0; i < n; i++) {
+		auto *mb = new MapBlock(v3s16(i & 0xff, 0, (i >> 8) & S16_MAX), gamedef);
+		const v3s16 p0 = mb->getPosRelative();
+		vm.clear();
+		vm.addArea(VoxelArea(p0, p0 + v3s16(MAP_BLOCKSIZE - 1)));
+		for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+		for (s16 x = 0; x < MAP_BLOCKSIZE; x++) {
+			const s16 height = 6 + (x * 7 + z * 3 + i) % 5;
+			for (s16 y = 0; y < MAP_BLOCKSIZE; y++) {
+				MapNode n(CONTENT_AIR, y > height ? 15 : 0, 0);
+				if (y < height - 3)
+					n = MapNode((x ^ y ^ z) % 23 == 0 ? 20 : 21);
+				else if (y < height)
+					n = MapNode(22);
+				else if (y == height)
+					n = MapNode(23, 0, 0);
+				vm.setNode(p0 + v3s16(x, y, z), n);
+			}
+		}
+		mb->copyFrom(vm);
+		vec.push_back(mb);
+	}
+}
+
+static size_t nodeMemoryUsage(const MBContainer &vec)
+{
+	size_t bytes = 0;
+	for (const MapBlock *block : vec)
+		bytes += block->getNodeMemoryUsage();
+	return bytes;
+}
+
+static u32 copyAllTo(const MBContainer &vec)
+{
+	VoxelManipulator vm;
+	u32 foo = 0;
+	for (MapBlock *block : vec) {
+		const v3s16 p0 = block->getPosRelative();
+		vm.clear();
+		vm.addArea(VoxelArea(p0, p0 + v3s16(MAP_BLOCKSIZE - 1)));
+		block->copyTo(vm);
+		foo += vm.getNodeNoExNoEmerge(p0 + v3s16(7)).getContent();
+	}
+	return foo;
+}
+
+#define BENCH_PALETTE(_label, _enabled, _count) \
+	BENCHMARK_ADVANCED("readNodes_" _label "_" #_count)(Catch::Benchmark::Chronometer meter) { \
+		MapBlock::setPaletteCompression(_enabled); \
+		MBContainer vec; \
+		allocateTerrain(vec, _count, &gamedef); \
+		WARN(_label << ": " << nodeMemoryUsage(vec) / 1024 << " KiB of nodes in " \
+			<< _count << " blocks"); \
+		meter.measure([&] { \
+			return workOnNodes(vec); \
+		}); \
+		freeAll(vec); \
+		MapBlock::setPaletteCompression(false); \
+	}; \
+	BENCHMARK_ADVANCED("copyTo_" _label "_" #_count)(Catch::Benchmark::Chronometer meter) { \
+		MapBlock::setPaletteCompression(_enabled); \
+		MBContainer vec; \
+		allocateTerrain(vec, _count, &gamedef); \
+		meter.measure([&] { \
+			return copyAllTo(vec); \
+		}); \
+		freeAll(vec); \
+		MapBlock::setPaletteCompression(false); \
+	};
+
+TEST_CASE("benchmark_mapblock_palette") {
+	DummyGameDef gamedef;
+	BENCH_PALETTE("full", false, 2200)
+	BENCH_PALETTE("paletted", true, 2200)
+}
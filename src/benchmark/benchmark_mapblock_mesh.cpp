@@ -0,0 +1,95 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "dummygamedef.h"
+#include "client/content_mapblock.h"
+#include "client/mapblock_mesh.h"
+#include "client/meshgen/collector.h"
+#include <cmath>
+
+namespace {
+class MeshGameDef : public DummyGameDef {
+public:
+	content_t addSolidNode(const std::string &name, u32 texture)
+	{
+		NodeDefManager *mgr = getWritableNodeDefManager();
+		ContentFeatures f;
+		f.name = name;
+		f.drawtype = NDT_NORMAL;
+		f.alpha = ALPHAMODE_OPAQUE;
+		content_t id = mgr->set(f.name, f);
+
+		auto visuals = constructNodeVisuals(&f);
+		visuals->solidness = 2;
+		for (TileSpec &tile : visuals->tiles)
+			tile.layers[0].texture_id = texture;
+		setNodeVisuals(const_cast<ContentFeatures &>(mgr->get(id)), std::move(visuals));
+		return id;
+	}
+
+	void finalize()
+	{
+		getWritableNodeDefManager()->resolveCrossrefs();
+		getWritableNodeDefManager()->applyFunction([] (ContentFeatures &f) {
+			if (!f.visuals)
+				setNodeVisuals(f);
+		});
+	}
+};
+}
+
+// Rolling hills, with dirt on top of stone and sunlight above the surface
+static void fillTerrain(MeshMakeData &data, content_t c_stone, content_t c_dirt)
+{
+	const s16 side = data.m_side_length;
+	VoxelArea area = data.m_vmanip.m_area;
+	for (s16 z = area.MinEdge.Z; z <= area.MaxEdge.Z; z++)
+	for (s16 x = area.MinEdge.X; x <= area.MaxEdge.X; x++) {
+		s16 height = side / 2 + std::round(2 * std::sin(x / 5.0f) + 2 * std::cos(z / 7.0f));
+		for (s16 y = area.MinEdge.Y; y <= area.MaxEdge.Y; y++) {
+			MapNode n(CONTENT_AIR, LIGHT_SUN, 0);
+			if (y < height - 2)
+				n = MapNode(c_stone);
+			else if (y < height)
+				n = MapNode(c_dirt);
+			data.m_vmanip.setNodeNoEmerge(v3s16(x, y, z), n);
+		}
+	}
+}
+
+static u32 generateMesh(MeshMakeData &data)
+{
+	MeshCollector collector({});
+	MapblockMeshGenerator(&data, &collector).generate();
+	u32 vertices = 0;
+	for (auto &prebuffers : collector.prebuffers)
+	for (auto &p : prebuffers)
+		vertices += p.vertices.size();
+	return vertices;
+}
+
+#define BENCH_MESHGEN(_label, _smooth, _greedy) \
+	data.m_smooth_lighting = _smooth; \
+	data.m_greedy_meshing = _greedy; \
+	WARN(_label << ": " << generateMesh(data) << " vertices per block"); \
+	BENCHMARK_ADVANCED(_label)(Catch::Benchmark::Chronometer meter) { \
+		meter.measure([&] { return generateMesh(data); }); \
+	};
+
+TEST_CASE("benchmark_mapblock_mesh") {
+	MeshGameDef gamedef;
+	content_t c_stone = gamedef.addSolidNode("stone", 1);
+	content_t c_dirt = gamedef.addSolidNode("dirt", 2);
+	gamedef.finalize();
+
+	MeshMakeData data(gamedef.getNodeDefManager(), MAP_BLOCKSIZE, MeshGrid{1});
+	data.fillBlockDataBegin(v3s16(0, 0, 0));
+	fillTerrain(data, c_stone, c_dirt);
+
+	BENCH_MESHGEN("generate_flat", false, false);
+	BENCH_MESHGEN("generate_flat_greedy", false, true);
+	BENCH_MESHGEN("generate_smooth", true, false);
+	BENCH_MESHGEN("generate_smooth_greedy", true, true);
+}
@@ -0,0 +1,83 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "dummygamedef.h"
+#include "dummymap.h"
+#include "client/particles.h"
+#include "collision.h"
+#include "nodedef.h"
+#include "noise.h"
+
+namespace {
+struct SimParticle {
+	v3f pos, vel;
+};
+
+// Falling particles above stone ground, spread over 5x5 blocks
+class ParticleSim {
+public:
+	ParticleSim(IGameDef *gamedef, size_t count) :
+		map(gamedef, {-2, -1, -2}, {2, 1, 2}),
+		nodes(&map, gamedef->ndef())
+	{
+		map.fill({-2, -1, -2}, {2, 1, 2}, MapNode(CONTENT_AIR));
+		content_t c_stone = gamedef->ndef()->getId("stone");
+		map.fill({-2, -1, -2}, {2, -1, 2}, MapNode(c_stone));
+
+		PcgRandom r(42);
+		auto random = [&r] (f32 min, f32 max) {
+			return min + (max - min) * (r.next() / (f32)PcgRandom::RANDOM_MAX);
+		};
+		particles.resize(count);
+		for (auto &p : particles) {
+			p.pos = v3f(random(-30, 30), random(0, 20), random(-30, 30));
+			p.vel = v3f(random(-2, 2), random(0, 3), random(-2, 2));
+		}
+	}
+
+	// One frame, like ParticleManager::stepParticles
+	u32 step(f32 dtime)
+	{
+		const aabb3f box(v3f(-0.05f * BS), v3f(0.05f * BS));
+		const v3f accel(0, -9.81f * BS, 0);
+		u32 in_air = 0;
+		nodes.clear();
+		for (auto &p : particles) {
+			FreeMovement free;
+			if (getFreeMovement(box, dtime, p.pos * BS, p.vel * BS, accel, free) &&
+					nodes.isFree(free.area_min, free.area_max)) {
+				p.pos = free.pos / BS;
+				p.vel = free.speed / BS;
+			} else {
+				// landed, would go through collisionMoveSimple
+				p.vel = v3f();
+			}
+
+			bool pos_ok;
+			MapNode n = nodes.getNode(floatToInt(p.pos, 1.0f), &pos_ok);
+			// stands in for the light lookup
+			in_air += pos_ok && n.getContent() == CONTENT_AIR;
+		}
+		return in_air;
+	}
+
+	DummyMap map;
+	ParticleNodeCache nodes;
+	std::vector<SimParticle> particles;
+};
+}
+
+TEST_CASE("benchmark_particles") {
+	DummyGameDef gamedef;
+	ContentFeatures f;
+	f.name = "stone";
+	f.walkable = true;
+	gamedef.getWritableNodeDefManager()->set(f.name, f);
+
+	ParticleSim sim(&gamedef, 100000);
+	BENCHMARK("step_100k") {
+		return sim.step(1 / 60.0f);
+	};
+}
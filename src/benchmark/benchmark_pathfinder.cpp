@@ -0,0 +1,69 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "dummygamedef.h"
+#include "dummymap.h"
+#include "nodedef.h"
+#include "pathfinder.h"
+#include <random>
+
+TEST_CASE("benchmark_pathfinder")
+{
+	DummyGameDef gamedef;
+	NodeDefManager *ndef = gamedef.getWritableNodeDefManager();
+
+	content_t content_stone;
+	{
+		ContentFeatures f;
+		f.name = "stone";
+		content_stone = ndef->set(f.name, f);
+	}
+
+	const v3s16 bpmin(-3, 0, -3), bpmax(3, 1, 3);
+	DummyMap map(&gamedef, bpmin, bpmax);
+	map.fill(bpmin, bpmax, MapNode(CONTENT_AIR));
+
+	// Uneven ground with some pillars in the way
+	std::mt19937 rng(42);
+	auto height = [] (s16 x, s16 z) -> s16 {
+		u32 h = ((u32)x * 73856093U) ^ ((u32)z * 19349663U);
+		return h % 10 == 0 ? 5 : 1 + (h % 7 == 0);
+	};
+	for (s16 z = -48; z < 64; z++)
+	for (s16 x = -48; x < 64; x++) {
+		for (s16 y = 0; y < height(x, z); y++)
+			map.setNode(v3s16(x, y, z), MapNode(content_stone));
+	}
+
+	std::vector<std::pair<v3s16, v3s16>> requests;
+	while (requests.size() < 32) {
+		s16 x1 = rng() % 64 - 32, z1 = rng() % 64 - 32;
+		s16 x2 = x1 + rng() % 40 - 20, z2 = z1 + rng() % 40 - 20;
+		if (height(x1, z1) == 5 || height(x2, z2) == 5)
+			continue;
+		requests.emplace_back(v3s16(x1, height(x1, z1), z1),
+				v3s16(x2, height(x2, z2), z2));
+	}
+
+	auto run = [&] (PathfinderCache *cache) {
+		size_t found = 0;
+		for (const auto &request : requests) {
+			found += !get_path(&map, ndef, request.first, request.second,
+					16, 1, 8, PA_PLAIN_NP, cache).empty();
+		}
+		return found;
+	};
+
+	PathfinderCache cache(&map, ndef);
+	REQUIRE(run(nullptr) == run(&cache));
+
+	BENCHMARK("find_path_32", i) {
+		return run(nullptr);
+	};
+
+	BENCHMARK("find_path_32_cached", i) {
+		return run(&cache);
+	};
+}
@@ -0,0 +1,48 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "catch.h"
+#include "profiler.h"
+
+TEST_CASE("benchmark_profiler")
+{
+	Profiler profiler;
+	const ProfilerMetric metric("benchmark: metric");
+
+	BENCHMARK("avg_metric_1000", i) {
+		for (int j = 0; j < 1000; j++)
+			profiler.avg(metric, i + j);
+		return profiler.getElapsedMs();
+	};
+
+	BENCHMARK("avg_call_site_1000", i) {
+		for (int j = 0; j < 1000; j++)
+			profiler.avg(PROFILER_METRIC("benchmark: call site"), i + j);
+		return profiler.getElapsedMs();
+	};
+
+	BENCHMARK("avg_string_1000", i) {
+		for (int j = 0; j < 1000; j++)
+			profiler.avg("benchmark: string", i + j);
+		return profiler.getElapsedMs();
+	};
+
+	const ProfilerMetric timed("benchmark: scope", PRECISION_MICRO);
+	BENCHMARK("scope_metric_1000") {
+		for (int j = 0; j < 1000; j++)
+			ScopeProfiler sp(&profiler, timed, SPT_AVG);
+	};
+
+	BENCHMARK("scope_call_site_1000") {
+		for (int j = 0; j < 1000; j++) {
+			ScopeProfiler sp(&profiler,
+					PROFILER_METRIC("benchmark: scope call site", PRECISION_MICRO), SPT_AVG);
+		}
+	};
+
+	BENCHMARK("scope_string_1000") {
+		for (int j = 0; j < 1000; j++)
+			ScopeProfiler sp(&profiler, "benchmark: scope string", SPT_AVG, PRECISION_MICRO);
+	};
+}
@@ -29,7 +29,7 @@ void ActiveObjectMgr::step(
 		count++;
 		f(ao_it.second.get());
 	}
-	g_profiler->avg("ActiveObjectMgr: CAO count [#]", count);
+	g_profiler->avg(PROFILER_METRIC("ActiveObjectMgr: CAO count [#]"), count);
 }
 
 bool ActiveObjectMgr::registerObject(std::unique_ptr<ClientActiveObject> obj)
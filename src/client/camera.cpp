@@ -36,7 +36,7 @@ static constexpr f32 CAMERA_OFFSET_STEP = 200;
 
 static const char *setting_names[] = {
 	"view_bobbing_amount", "fov", "arm_inertia",
-	"show_nametag_backgrounds",
+	"show_nametag_backgrounds", "lod_range",
 };
 
 Camera::Camera(MapDrawControl &draw_control, Client *client, RenderingEngine *rendering_engine):
@@ -86,6 +86,7 @@ void Camera::readSettings()
 	m_cache_fov                 = g_settings->getFloat("fov", 45.0f, 160.0f);
 	m_arm_inertia               = g_settings->getBool("arm_inertia");
 	m_show_nametag_backgrounds  = g_settings->getBool("show_nametag_backgrounds");
+	m_cache_lod_range           = g_settings->getU16("lod_range");
 }
 
 Camera::~Camera()
@@ -586,7 +587,11 @@ void Camera::updateViewingRange()
 		m_cameranode->setFarValue(100000.0);
 		return;
 	}
-	m_cameranode->setFarValue(std::fmax(2000, m_draw_control.wanted_range) * BS);
+	f32 far_value = std::fmax(2000, m_draw_control.wanted_range);
+	// Distant terrain is drawn up to the LOD range
+	if (m_cache_lod_range > m_draw_control.wanted_range)
+		far_value = std::fmax(far_value, m_cache_lod_range);
+	m_cameranode->setFarValue(far_value * BS);
 }
 
 void Camera::setDigging(s32 button)
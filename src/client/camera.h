@@ -253,6 +253,7 @@ class Camera
 	CameraMode m_camera_mode;
 
 	f32 m_cache_view_bobbing_amount;
+	u16 m_cache_lod_range;
 	bool m_arm_inertia;
 
 	std::vector<Nametag*> m_nametags;
@@ -30,6 +30,8 @@
 #include "mapnode.h"
 #include "mapsector.h"
 #include "minimap.h"
+#include "client/lod_terrain.h"
+#include "client/meshgen/geometry_cache.h"
 #include "node_visuals.h"
 #include "profiler.h"
 #include "shader.h"
@@ -652,6 +654,7 @@ void Client::step(float dtime)
 			num_processed_meshes++;
 
 			std::vector<MinimapMapblock*> minimap_mapblocks;
+			std::vector<std::unique_ptr<LodSummary>> lod_summaries;
 			bool do_mapper_update = true;
 
 			ClientMap &map = m_env.getClientMap();
@@ -665,7 +668,16 @@ void Client::step(float dtime)
 			if (!block && r.mesh)
 				block = sector->createBlankBlock(r.p.Y);
 
-			if (block) {
+			if (r.unchanged_geometry) {
+				// Keep the current mesh, unless it was replaced in the meantime
+				do_mapper_update = false;
+				if (!block || !block->mesh ||
+						block->mesh->getGeometryCache() != r.unchanged_geometry)
+					addUpdateMeshTask(r.p, false, r.urgent);
+			} else if (block) {
+				// Map content changed
+				map.invalidateOcclusionCache();
+
 				// Delete the old mesh
 				if (block->mesh)
 					map.invalidateMapBlockMesh(block->mesh);
@@ -677,6 +689,7 @@ void Client::step(float dtime)
 					minimap_mapblocks = r.mesh->moveMinimapMapblocks();
 					if (minimap_mapblocks.empty())
 						do_mapper_update = false;
+					lod_summaries = r.mesh->moveLodSummaries();
 
 					if (r.mesh->isEmpty()) {
 						delete r.mesh;
@@ -704,6 +717,17 @@ void Client::step(float dtime)
 				}
 			}
 
+			if (!lod_summaries.empty()) {
+				v3s16 ofs;
+				for (ofs.Z = 0; ofs.Z < m_mesh_grid.cell_size; ofs.Z++)
+				for (ofs.Y = 0; ofs.Y < m_mesh_grid.cell_size; ofs.Y++)
+				for (ofs.X = 0; ofs.X < m_mesh_grid.cell_size; ofs.X++) {
+					size_t i = m_mesh_grid.getOffsetIndex(ofs);
+					if (i < lod_summaries.size() && lod_summaries[i])
+						map.addLodBlock(r.p + ofs, std::move(lod_summaries[i]));
+				}
+			}
+
 			for (auto p : r.ack_list) {
 				if (blocks_to_ack.size() == 255) {
 					sendGotBlocks(blocks_to_ack);
@@ -848,40 +872,59 @@ void Client::step(float dtime)
 	}
 }
 
-bool Client::loadMedia(const std::string &data, const std::string &filename,
-	bool from_media_push)
+static const char *image_ext[] = {
+	".png", ".jpg", ".tga",
+	NULL
+};
+
+bool Client::isImageMedia(const std::string &filename)
 {
-	std::string name;
+	return !removeStringEnd(filename, image_ext).empty();
+}
 
-	const char *image_ext[] = {
-		".png", ".jpg", ".tga",
-		NULL
-	};
-	name = removeStringEnd(filename, image_ext);
-	if (!name.empty()) {
-		TRACESTREAM(<< "Client: Attempting to load image "
-			<< "file \"" << filename << "\"" << std::endl);
+video::IImage *Client::decodeImageMedia(const std::string &data,
+	const std::string &filename)
+{
+	TRACESTREAM(<< "Client: Attempting to load image "
+		<< "file \"" << filename << "\"" << std::endl);
 
-		io::IFileSystem *irrfs = m_rendering_engine->get_filesystem();
-		video::IVideoDriver *vdrv = m_rendering_engine->get_video_driver();
+	// Image loaders keep no state, so this is fine to do on any thread
+	io::IFileSystem *irrfs = m_rendering_engine->get_filesystem();
+	video::IVideoDriver *vdrv = m_rendering_engine->get_video_driver();
+
+	io::IReadFile *rfile = irrfs->createMemoryReadFile(
+			data.c_str(), data.size(), filename.c_str());
 
-		io::IReadFile *rfile = irrfs->createMemoryReadFile(
-				data.c_str(), data.size(), filename.c_str());
+	FATAL_ERROR_IF(!rfile, "Could not create irrlicht memory file.");
 
-		FATAL_ERROR_IF(!rfile, "Could not create irrlicht memory file.");
+	// Read image
+	video::IImage *img = vdrv->createImageFromFile(rfile);
+	if (!img) {
+		errorstream<<"Client: Cannot create image from data of "
+				<<"file \""<<filename<<"\""<<std::endl;
+	}
+	rfile->drop();
+	return img;
+}
 
-		// Read image
-		video::IImage *img = vdrv->createImageFromFile(rfile);
-		if (!img) {
-			errorstream<<"Client: Cannot create image from data of "
-					<<"file \""<<filename<<"\""<<std::endl;
-			rfile->drop();
+void Client::loadImageMedia(const std::string &filename, video::IImage *img,
+	const std::string &sha1)
+{
+	m_tsrc->insertSourceImage(filename, img, sha1);
+}
+
+bool Client::loadMedia(const std::string &data, const std::string &filename,
+	const std::string &sha1, bool from_media_push)
+{
+	std::string name;
+
+	if (isImageMedia(filename)) {
+		video::IImage *img = decodeImageMedia(data, filename);
+		if (!img)
 			return false;
-		}
 
-		m_tsrc->insertSourceImage(filename, img);
+		loadImageMedia(filename, img, sha1);
 		img->drop();
-		rfile->drop();
 		return true;
 	}
 
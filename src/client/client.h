@@ -61,6 +61,10 @@ namespace scene {
 class IAnimatedMesh;
 }
 
+namespace video {
+class IImage;
+}
+
 namespace con {
 class IConnection;
 }
@@ -385,9 +389,19 @@ class Client : public con::PeerHandler, public InventoryManager, public IGameDef
 	void migrateModStorage();
 
 	// The following set of functions is used by ClientMediaDownloader
-	// Insert a media file appropriately into the appropriate manager
+	// Insert a media file appropriately into the appropriate manager.
+	// sha1 is the raw SHA1 hash of data.
 	bool loadMedia(const std::string &data, const std::string &filename,
-		bool from_media_push = false);
+		const std::string &sha1, bool from_media_push = false);
+
+	// Images can be decoded ahead of time, e.g. on another thread
+	static bool isImageMedia(const std::string &filename);
+	// Decode an image media file, returns nullptr on error. Thread-safe.
+	video::IImage *decodeImageMedia(const std::string &data,
+		const std::string &filename);
+	// Insert an image returned by decodeImageMedia()
+	void loadImageMedia(const std::string &filename, video::IImage *img,
+		const std::string &sha1);
 
 	// Send a request for conventional media transfer
 	void request_media(const std::vector<std::string> &file_requests);
@@ -5,6 +5,10 @@
 #include "clientmap.h"
 #include "client.h"
 #include "client/mesh.h"
+#include "client/lod_terrain.h"
+#include "client/occlusion_raster.h"
+#include "client/shader.h"
+#include "light.h"
 #include "mapblock_mesh.h"
 #include <IMaterialRenderer.h>
 #include <ISceneManager.h>
@@ -154,6 +158,8 @@ static const std::string ClientMap_settings[] = {
 	"transparency_sorting_distance",
 	"occlusion_culler",
 	"enable_raytraced_culling",
+	"enable_raster_culling",
+	"lod_range",
 };
 
 ClientMap::ClientMap(
@@ -167,8 +173,7 @@ ClientMap::ClientMap(
 		rendering_engine->get_scene_manager(), id),
 	m_client(client),
 	m_rendering_engine(rendering_engine),
-	m_control(control),
-	m_drawlist(MapBlockComparer(v3s16(0,0,0)))
+	m_control(control)
 {
 
 	/*
@@ -201,6 +206,10 @@ void ClientMap::onSettingChanged(std::string_view name, bool all)
 		m_loops_occlusion_culler = g_settings->get("occlusion_culler") == "loops";
 	if (all || name == "enable_raytraced_culling")
 		m_enable_raytraced_culling = g_settings->getBool("enable_raytraced_culling");
+	if (all || name == "enable_raster_culling")
+		m_enable_raster_culling = g_settings->getBool("enable_raster_culling");
+	if (all || name == "lod_range")
+		m_cache_lod_range = g_settings->getU16("lod_range");
 }
 
 ClientMap::~ClientMap()
@@ -217,6 +226,78 @@ ClientMap::~ClientMap()
 		it.second.drop();
 }
 
+bool ClientMap::isMeshOccludedCached(MapBlock *mesh_block, u16 mesh_size, v3s16 cam_pos_nodes)
+{
+	// the cache is reset in updateDrawList() when the camera node changes
+	assert(cam_pos_nodes == m_occlusion_cache_camera);
+	auto it = m_occlusion_cache.find(mesh_block->getPos());
+	if (it != m_occlusion_cache.end())
+		return it->second;
+
+	bool occluded = isMeshOccluded(mesh_block, mesh_size, cam_pos_nodes);
+	m_occlusion_cache.emplace(mesh_block->getPos(), occluded);
+	return occluded;
+}
+
+void ClientMap::rasterizeOccluders(v3s16 cam_pos_nodes, const MeshGrid &mesh_grid)
+{
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("CM::rasterizeOccluders()", PRECISION_MILLI), SPT_AVG);
+
+	// Resolution of the depth buffer
+	constexpr u16 raster_size = 128;
+	// Distance in meshes up to which occluders are drawn
+	constexpr s16 occluder_range = 4;
+
+	if (!m_occlusion_raster)
+		m_occlusion_raster = std::make_unique<OcclusionRaster>(raster_size);
+
+	// Occlusion does not depend on the view direction, but only what is
+	// inside the raster can be tested. Make it a bit wider than the screen
+	// so the view can turn until the next update.
+	f32 fov = std::min(m_camera_fov * 1.2f, 160.0f * core::DEGTORAD);
+	m_occlusion_raster->begin(m_camera_position, m_camera_direction, fov);
+
+	const s16 cell_size = mesh_grid.cell_size;
+	const v3s16 camera_mesh = mesh_grid.getMeshPos(
+			getContainerPos(cam_pos_nodes, MAP_BLOCKSIZE));
+	const v3f size(cell_size * MAP_BLOCKSIZE * BS);
+	u32 occluders = 0;
+
+	v3s16 p;
+	for (p.Z = -occluder_range; p.Z <= occluder_range; p.Z++)
+	for (p.Y = -occluder_range; p.Y <= occluder_range; p.Y++)
+	for (p.X = -occluder_range; p.X <= occluder_range; p.X++) {
+		MapBlock *block = getBlockNoCreateNoEx(camera_mesh + p * cell_size);
+		if (!block || !block->solid_sides)
+			continue;
+
+		v3f min_edge = intToFloat(block->getPosRelative(), BS) - 0.5f * BS;
+		aabb3f box(min_edge, min_edge + size);
+		occluders++;
+		if (block->solid_sides == 0x3F) {
+			m_occlusion_raster->addOccluder(box);
+			continue;
+		}
+
+		// solid sides are +Z-Z+Y-Y+X-X
+		for (u8 k = 0; k < 6; k++) {
+			if (!(block->solid_sides & (1 << k)))
+				continue;
+			aabb3f side = box;
+			const u8 axis = k / 2;
+			if (k & 1)
+				side.MinEdge[axis] = side.MaxEdge[axis];
+			else
+				side.MaxEdge[axis] = side.MinEdge[axis];
+			m_occlusion_raster->addOccluder(side);
+		}
+	}
+
+	m_occlusion_raster->finish();
+	g_profiler->avg(PROFILER_METRIC("MapBlocks occluders drawn [#]"), occluders);
+}
+
 void ClientMap::updateCamera(v3f pos, v3f dir, f32 fov, v3s16 offset, video::SColor light_color)
 {
 	v3s16 previous_camera_offset = m_camera_offset;
@@ -366,6 +447,7 @@ void ClientMap::clearDrawList()
 		MapBlock *block = i.second;
 		block->refDrop();
 	}
+	// keeps the allocation for the next update
 	m_drawlist.clear();
 
 	for (auto &block : m_keeplist)
@@ -377,7 +459,8 @@ void ClientMap::clearDrawList()
 
 void ClientMap::updateDrawList()
 {
-	ScopeProfiler sp(g_profiler, "CM::updateDrawList()", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("CM::updateDrawList()", PRECISION_MILLI), SPT_AVG);
 
 	clearDrawList();
 
@@ -398,30 +481,51 @@ void ClientMap::updateDrawList()
 
 	// No occlusion culling when free_move is on and camera is inside ground
 	// No occlusion culling for chunk sizes of 4 and above
-	//   because the current occlusion culling test is highly inefficient at these sizes
-	bool occlusion_culling_enabled = mesh_grid.cell_size < 4;
+	//   because the raytraced occlusion culling test is highly inefficient at these sizes
+	bool occlusion_culling_enabled = mesh_grid.cell_size < 4 || m_enable_raster_culling;
 	if (m_control.allow_noclip) {
 		MapNode n = getNode(cam_pos_nodes);
 		if (n.getContent() == CONTENT_IGNORE || m_nodedef->get(n).visuals->solidness == 2)
 			occlusion_culling_enabled = false;
 	}
+	const bool raster_culling = occlusion_culling_enabled && m_enable_raster_culling;
+	const bool raytraced_culling = occlusion_culling_enabled && !raster_culling &&
+			m_enable_raytraced_culling;
 
 	const v3s16 camera_block = getContainerPos(cam_pos_nodes, MAP_BLOCKSIZE);
 	assert(m_drawlist.empty());
-	m_drawlist = decltype(m_drawlist)(MapBlockComparer(camera_block));
+
+	// Occlusion results only hold for the camera node they were computed for
+	if (cam_pos_nodes != m_occlusion_cache_camera) {
+		m_occlusion_cache.clear();
+		m_occlusion_cache_camera = cam_pos_nodes;
+	}
 
 	auto is_frustum_culled = m_client->getCamera()->getFrustumCuller();
 
+	if (raster_culling)
+		rasterizeOccluders(cam_pos_nodes, mesh_grid);
+
+	const auto &is_mesh_occluded = [&] (MapBlock *block) {
+		if (raster_culling) {
+			v3f min_edge = intToFloat(block->getPosRelative(), BS) - 0.5f * BS;
+			v3f size(mesh_grid.cell_size * MAP_BLOCKSIZE * BS);
+			return m_occlusion_raster->isOccluded(aabb3f(min_edge, min_edge + size));
+		}
+		if (raytraced_culling)
+			return isMeshOccludedCached(block, mesh_grid.cell_size, cam_pos_nodes);
+		return false;
+	};
+
 	// Uncomment to debug occluded blocks in the wireframe mode
 	// TODO: Include this as a flag for an extended debugging setting
 	// if (occlusion_culling_enabled && m_control.show_wireframe)
 	// 	occlusion_culling_enabled = porting::getTimeS() & 1;
 
+	// Blocks are collected unsorted and sorted once at the end
 	const auto &add_to_drawlist = [this] (MapBlock *block) {
 		block->refGrab();
-		auto res = m_drawlist.emplace(block->getPos(), block);
-		(void)res;
-		assert(res.second); // must not already exist
+		m_drawlist.emplace_back(block->getPos(), block);
 	};
 
 	// Set of mesh holding blocks, will be transferred to m_drawlist
@@ -494,9 +598,7 @@ void ClientMap::updateDrawList()
 				}
 
 				// Raytraced occlusion culling - send rays from the camera to the block's corners
-				if (!m_control.range_all && occlusion_culling_enabled && m_enable_raytraced_culling &&
-						block &&
-						isMeshOccluded(block, mesh_grid.cell_size, cam_pos_nodes)) {
+				if (!m_control.range_all && block && is_mesh_occluded(block)) {
 					blocks_occlusion_culled++;
 					continue;
 				}
@@ -523,8 +625,8 @@ void ClientMap::updateDrawList()
 			}
 		}
 
-		g_profiler->avg("MapBlocks in range [#]", blocks_in_range);
-		g_profiler->avg("MapBlocks loaded [#]", blocks_loaded);
+		g_profiler->avg(PROFILER_METRIC("MapBlocks in range [#]"), blocks_in_range);
+		g_profiler->avg(PROFILER_METRIC("MapBlocks loaded [#]"), blocks_loaded);
 	} else {
 		// Blocks visited by the algorithm
 		u32 blocks_visited = 0;
@@ -603,9 +705,7 @@ void ClientMap::updateDrawList()
 			u8 visible_outer_sides = flags & 0x07;
 
 			// Raytraced occlusion culling - send rays from the camera to the block's corners
-			if (occlusion_culling_enabled && m_enable_raytraced_culling &&
-					block && visible_outer_sides != 0x07 &&
-					isMeshOccluded(block, mesh_grid.cell_size, cam_pos_nodes)) {
+			if (block && visible_outer_sides != 0x07 && is_mesh_occluded(block)) {
 				blocks_occlusion_culled++;
 				continue;
 			}
@@ -714,8 +814,8 @@ void ClientMap::updateDrawList()
 					traverse_far_side(+mesh_grid.cell_size);
 			}
 		}
-		g_profiler->avg("MapBlock sides skipped [#]", sides_skipped);
-		g_profiler->avg("MapBlocks examined [#]", blocks_visited);
+		g_profiler->avg(PROFILER_METRIC("MapBlock sides skipped [#]"), sides_skipped);
+		g_profiler->avg(PROFILER_METRIC("MapBlocks examined [#]"), blocks_visited);
 	}
 
 	// must populate either only to avoid duplicates
@@ -726,9 +826,43 @@ void ClientMap::updateDrawList()
 			add_to_drawlist(block);
 	}
 
-	g_profiler->avg("MapBlocks occlusion culled [#]", blocks_occlusion_culled);
-	g_profiler->avg("MapBlocks frustum culled [#]", blocks_frustum_culled);
-	g_profiler->avg("MapBlocks drawn [#]", m_drawlist.size());
+	MapBlockComparer comparer(camera_block);
+	std::sort(m_drawlist.begin(), m_drawlist.end(),
+			[&] (const auto &left, const auto &right) {
+				return comparer(left.first, right.first);
+			});
+
+	g_profiler->avg(PROFILER_METRIC("MapBlocks occlusion culled [#]"),
+			blocks_occlusion_culled);
+	g_profiler->avg(PROFILER_METRIC("MapBlocks frustum culled [#]"), blocks_frustum_culled);
+	g_profiler->avg(PROFILER_METRIC("MapBlocks drawn [#]"), m_drawlist.size());
+
+	/*
+		Distant terrain beyond the viewing range
+	*/
+	m_lod_drawlist.clear();
+	if (m_cache_lod_range == 0)
+		m_lod.reset();
+	if (m_lod) {
+		// Forget the terrain far behind, checked whenever the camera has
+		// moved about one top level cell
+		const f32 top_size = MAP_BLOCKSIZE << LodTerrain::MAX_LEVEL;
+		v3f camera_pos = m_camera_position / BS;
+		if (camera_pos.getDistanceFrom(m_lod_evict_position) > top_size) {
+			size_t evicted = m_lod->evict(camera_pos, m_cache_lod_range + top_size);
+			g_profiler->avg(PROFILER_METRIC("LOD blocks evicted [#]"), evicted);
+			m_lod_evict_position = camera_pos;
+		}
+	}
+	if (m_lod && !m_control.range_all && m_cache_lod_range > m_control.wanted_range) {
+		// Limit the number of meshes built per update to avoid hitches
+		// when moving quickly, the remaining ones follow in the next updates.
+		bool complete = m_lod->select(m_camera_position / BS, m_control.wanted_range,
+				m_cache_lod_range, m_lod_drawlist, 32);
+		if (!complete)
+			m_needs_update_drawlist = true;
+		g_profiler->avg(PROFILER_METRIC("LOD cells drawn [#]"), m_lod_drawlist.size());
+	}
 }
 
 void ClientMap::touchMapBlocks()
@@ -739,7 +873,8 @@ void ClientMap::touchMapBlocks()
 	if (m_control.range_all || m_loops_occlusion_culler)
 		return;
 
-	ScopeProfiler sp(g_profiler, "CM::touchMapBlocks()", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("CM::touchMapBlocks()", PRECISION_MILLI), SPT_AVG);
 
 	const v3s16 cam_pos_nodes = floatToInt(m_camera_position, BS);
 
@@ -798,8 +933,8 @@ void ClientMap::touchMapBlocks()
 		}
 	}
 
-	g_profiler->avg("MapBlocks in range [#]", blocks_in_range);
-	g_profiler->avg("MapBlocks loaded [#]", blocks_loaded);
+	g_profiler->avg(PROFILER_METRIC("MapBlocks in range [#]"), blocks_in_range);
+	g_profiler->avg(PROFILER_METRIC("MapBlocks loaded [#]"), blocks_loaded);
 }
 
 void MeshBufListMaps::addFromBlock(v3s16 block_pos, MapBlockMesh *block_mesh,
@@ -837,7 +972,8 @@ namespace {
 			if (total == 0)
 				return;
 			float rate = (total - cache_miss) / (float)total;
-			profiler->avg("CM::transformBuffers...: cache hit rate [%]", 100 * rate);
+			profiler->avg(PROFILER_METRIC("CM::transformBuffers...: cache hit rate [%]"),
+					100 * rate);
 			*this = {0, 0};
 		}
 	} buffer_transform_stats;
@@ -978,17 +1114,25 @@ static u32 transformBuffersToDrawOrder(
 	return can_merge < 2 ? 0 : can_merge;
 }
 
+// Metric of the solid or the transparent pass, depending on a local
+// is_solid_pass. Both are interned once per call site.
+#define PASS_METRIC(solid, trans) [is_solid_pass] () -> const ProfilerMetric & { \
+		static const ProfilerMetric solid_metric(solid); \
+		static const ProfilerMetric trans_metric(trans); \
+		return is_solid_pass ? solid_metric : trans_metric; \
+	}()
+#define RENDER_METRIC(text) \
+	PASS_METRIC("renderMap(SOLID): " text, "renderMap(TRANS): " text)
+#define SHADOW_METRIC(text) \
+	PASS_METRIC("renderMap(SHADOW SOLID): " text, "renderMap(SHADOW TRANS): " text)
+
 void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 {
 	ZoneScoped;
 
 	const bool is_transparent_pass = pass == scene::ESNRP_TRANSPARENT;
 
-	std::string prefix;
-	if (pass == scene::ESNRP_SOLID)
-		prefix = "renderMap(SOLID): ";
-	else
-		prefix = "renderMap(TRANS): ";
+	const bool is_solid_pass = pass == scene::ESNRP_SOLID;
 
 	/*
 		Get animation parameters
@@ -1085,7 +1229,7 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 		}
 	}
 
-	g_profiler->avg(prefix + "collecting [ms]", tt_collect.stop(true));
+	g_profiler->avg(RENDER_METRIC("collecting [ms]"), tt_collect.stop(true));
 
 	TimeTaker tt_draw("");
 
@@ -1138,11 +1282,14 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 		vertex_count += descriptor.draw(driver);
 	}
 
-	g_profiler->avg(prefix + "draw meshes [ms]", tt_draw.stop(true));
+	g_profiler->avg(RENDER_METRIC("draw meshes [ms]"), tt_draw.stop(true));
 
 	if (pass == scene::ESNRP_SOLID) {
-		g_profiler->avg("renderMap(): animated meshes [#]", mesh_animate_count);
-		g_profiler->avg(prefix + "merged buffers [#]", merged_count);
+		renderLod(driver);
+
+		g_profiler->avg(PROFILER_METRIC("renderMap(): animated meshes [#]"),
+				mesh_animate_count);
+		g_profiler->avg(RENDER_METRIC("merged buffers [#]"), merged_count);
 
 		u32 cached_count = 0;
 		for (auto it = m_dynamic_buffers.begin(); it != m_dynamic_buffers.end(); ) {
@@ -1156,24 +1303,72 @@ void ClientMap::renderMap(video::IVideoDriver* driver, s32 pass)
 				it++;
 			}
 		}
-		g_profiler->avg(prefix + "merged buffers in cache [#]", cached_count);
+		g_profiler->avg(RENDER_METRIC("merged buffers in cache [#]"), cached_count);
 
 		buffer_transform_stats.commit(g_profiler);
 	}
 
 	if (pass == scene::ESNRP_TRANSPARENT) {
-		g_profiler->avg("renderMap(): transparent buffers [#]", draw_order.size());
+		g_profiler->avg(PROFILER_METRIC("renderMap(): transparent buffers [#]"),
+				draw_order.size());
 	}
 
-	g_profiler->avg(prefix + "vertices drawn [#]", vertex_count);
-	g_profiler->avg(prefix + "drawcalls [#]", drawcall_count);
-	g_profiler->avg(prefix + "material swaps [#]", material_swaps);
+	g_profiler->avg(RENDER_METRIC("vertices drawn [#]"), vertex_count);
+	g_profiler->avg(RENDER_METRIC("drawcalls [#]"), drawcall_count);
+	g_profiler->avg(RENDER_METRIC("material swaps [#]"), material_swaps);
 	if (material_swaps && array_texture_use) {
 		int percent = (100.0f * array_texture_use) / material_swaps;
-		g_profiler->avg(prefix + "array texture use [%]", percent);
+		g_profiler->avg(RENDER_METRIC("array texture use [%]"), percent);
 	}
 }
 
+void ClientMap::renderLod(video::IVideoDriver *driver)
+{
+	if (m_lod_drawlist.empty())
+		return;
+
+	if (!m_lod_material.MaterialType) {
+		IShaderSource *ssrc = m_client->getShaderSource();
+		m_lod_material.MaterialType =
+				ssrc->getShaderInfo(ssrc->getShaderRaw("lod_shader", false)).material;
+		m_lod_material.FogEnable = true;
+		m_lod_material.BackfaceCulling = true;
+	}
+
+	// The summaries store daylight colors
+	const u32 daynight_ratio = m_client->getEnv().getDayNightRatio();
+	const u8 brightness = 255 * decode_light_f(daynight_ratio / 1000.0f);
+	m_lod_material.ColorParam = video::SColor(255, brightness, brightness, brightness);
+	m_lod_material.Wireframe = m_control.show_wireframe;
+	driver->setMaterial(m_lod_material);
+
+	auto is_frustum_culled = m_client->getCamera()->getFrustumCuller();
+	core::matrix4 m;
+	u32 vertex_count = 0;
+	for (const LodCellKey &key : m_lod_drawlist) {
+		// meshes are built by updateDrawList()
+		scene::SMeshBuffer *buf = m_lod->getCachedMesh(key);
+		if (!buf)
+			continue;
+		v3f origin = intToFloat(key.getBlockPos() * MAP_BLOCKSIZE, BS);
+		aabb3f box = buf->getBoundingBox();
+		if (is_frustum_culled(origin + box.getCenter(), box.getRadius()))
+			continue;
+		m.setTranslation(origin - intToFloat(m_camera_offset, BS));
+		driver->setTransform(video::ETS_WORLD, m);
+		driver->drawMeshBuffer(buf);
+		vertex_count += buf->getVertexCount();
+	}
+	g_profiler->avg(PROFILER_METRIC("renderMap(): LOD vertices drawn [#]"), vertex_count);
+}
+
+void ClientMap::addLodBlock(v3s16 blockpos, std::unique_ptr<LodSummary> summary)
+{
+	if (!m_lod)
+		m_lod = std::make_unique<LodTerrain>();
+	m_lod->addBlock(blockpos, std::move(summary));
+}
+
 void ClientMap::invalidateMapBlockMesh(MapBlockMesh *mesh)
 {
 	// find all buffers for this block
@@ -1293,7 +1488,8 @@ static bool getVisibleBrightness(Map *map, const v3f &p0, v3f dir, float step,
 int ClientMap::getBackgroundBrightness(float max_d, u32 daylight_factor,
 		int oldvalue, bool *sunlight_seen_result)
 {
-	ScopeProfiler sp(g_profiler, "CM::getBackgroundBrightness", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("CM::getBackgroundBrightness", PRECISION_MILLI), SPT_AVG);
 	static v3f z_directions[50] = {
 		v3f(-100, 0, 0)
 	};
@@ -1419,11 +1615,7 @@ void ClientMap::renderMapShadows(video::IVideoDriver *driver,
 		ModifyMaterialCallback cb, s32 pass, int frame, int total_frames)
 {
 	bool is_transparent_pass = pass != scene::ESNRP_SOLID;
-	std::string prefix;
-	if (is_transparent_pass)
-		prefix = "renderMap(SHADOW TRANS): ";
-	else
-		prefix = "renderMap(SHADOW SOLID): ";
+	const bool is_solid_pass = !is_transparent_pass;
 
 	const auto mesh_grid = m_client->getMeshGrid();
 	// Gets world position from block map position
@@ -1527,10 +1719,10 @@ void ClientMap::renderMapShadows(video::IVideoDriver *driver,
 	// will be broken. (TODO why?)
 	driver->draw3DLine(v3f(), v3f(), video::SColor(0));
 
-	g_profiler->avg(prefix + "draw meshes [ms]", draw.stop(true));
-	g_profiler->avg(prefix + "vertices drawn [#]", vertex_count);
-	g_profiler->avg(prefix + "drawcalls [#]", drawcall_count);
-	g_profiler->avg(prefix + "material swaps [#]", material_swaps);
+	g_profiler->avg(SHADOW_METRIC("draw meshes [ms]"), draw.stop(true));
+	g_profiler->avg(SHADOW_METRIC("vertices drawn [#]"), vertex_count);
+	g_profiler->avg(SHADOW_METRIC("drawcalls [#]"), drawcall_count);
+	g_profiler->avg(SHADOW_METRIC("material swaps [#]"), material_swaps);
 }
 
 void ClientMap::clearDrawListShadow()
@@ -1547,7 +1739,8 @@ void ClientMap::clearDrawListShadow()
 */
 void ClientMap::updateDrawListShadow(v3f shadow_light_pos, v3f shadow_light_dir, float radius, float length)
 {
-	ScopeProfiler sp(g_profiler, "CM::updateDrawListShadow()", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("CM::updateDrawListShadow()", PRECISION_MILLI), SPT_AVG);
 
 	clearDrawListShadow();
 
@@ -1590,19 +1783,21 @@ void ClientMap::updateDrawListShadow(v3f shadow_light_pos, v3f shadow_light_dir,
 		}
 	}
 
-	g_profiler->avg("SHADOW MapBlock meshes in range [#]", blocks_in_range_with_mesh);
-	g_profiler->avg("SHADOW MapBlocks drawn [#]", m_drawlist_shadow.size());
-	g_profiler->avg("SHADOW MapBlocks loaded [#]", blocks_loaded);
+	g_profiler->avg(PROFILER_METRIC("SHADOW MapBlock meshes in range [#]"),
+			blocks_in_range_with_mesh);
+	g_profiler->avg(PROFILER_METRIC("SHADOW MapBlocks drawn [#]"), m_drawlist_shadow.size());
+	g_profiler->avg(PROFILER_METRIC("SHADOW MapBlocks loaded [#]"), blocks_loaded);
 }
 
 void ClientMap::reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks)
 {
-	g_profiler->avg("CM::reportMetrics loaded blocks [#]", all_blocks);
+	g_profiler->avg(PROFILER_METRIC("CM::reportMetrics loaded blocks [#]"), all_blocks);
 }
 
 void ClientMap::updateTransparentMeshBuffers()
 {
-	ScopeProfiler sp(g_profiler, "CM::updateTransparentMeshBuffers", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("CM::updateTransparentMeshBuffers", PRECISION_MILLI), SPT_AVG);
 	u32 sorted_blocks = 0;
 	u32 unsorted_blocks = 0;
 	bool transparency_sorting_enabled = m_cache_transparency_sorting_distance > 0;
@@ -1640,8 +1835,8 @@ void ClientMap::updateTransparentMeshBuffers()
 		}
 	}
 
-	g_profiler->avg("CM::Transparent Buffers - Sorted", sorted_blocks);
-	g_profiler->avg("CM::Transparent Buffers - Unsorted", unsorted_blocks);
+	g_profiler->avg(PROFILER_METRIC("CM::Transparent Buffers - Sorted"), sorted_blocks);
+	g_profiler->avg(PROFILER_METRIC("CM::Transparent Buffers - Unsorted"), unsorted_blocks);
 	m_needs_update_transparent_meshes = false;
 }
 
@@ -8,7 +8,9 @@
 #include "map.h"
 #include <ISceneNode.h>
 #include <map>
+#include <memory>
 #include <functional>
+#include <unordered_map>
 
 struct MapDrawControl
 {
@@ -24,6 +26,10 @@ struct MapDrawControl
 
 class Client;
 class RenderingEngine;
+class LodTerrain;
+class OcclusionRaster;
+struct LodCellKey;
+struct LodSummary;
 
 enum CameraMode : int;
 
@@ -92,6 +98,8 @@ class ClientMap : public Map, public scene::ISceneNode
 	void getBlocksInViewRange(v3s16 cam_pos_nodes,
 		v3s16 *p_blocks_min, v3s16 *p_blocks_max, float range=-1.0f);
 
+	/// @brief Rebuilds m_drawlist on the calling (main) thread.
+	/// Occlusion results are reused while the camera stays at the same node.
 	void updateDrawList();
 	/// @brief clears m_drawlist and m_keeplist
 	void clearDrawList();
@@ -117,6 +125,14 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	void invalidateMapBlockMesh(MapBlockMesh *mesh);
 
+	/// Forget cached occlusion results, to be called when map content changes
+	void invalidateOcclusionCache() { m_occlusion_cache.clear(); }
+
+	/// Add or replace the distant terrain summary of a mapblock
+	void addLodBlock(v3s16 blockpos, std::unique_ptr<LodSummary> summary);
+	/// @return range of distant terrain in nodes, 0 if disabled
+	u16 getLodRange() const { return m_cache_lod_range; }
+
 	// For debug printing
 	void PrintInfo(std::ostream &out) override;
 
@@ -133,10 +149,16 @@ class ClientMap : public Map, public scene::ISceneNode
 	void reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks) override;
 private:
 	bool isMeshOccluded(MapBlock *mesh_block, u16 mesh_size, v3s16 cam_pos_nodes);
+	// same as isMeshOccluded, but reuses results of previous draw list updates
+	bool isMeshOccludedCached(MapBlock *mesh_block, u16 mesh_size, v3s16 cam_pos_nodes);
+	// draw the solid sides of the meshes around the camera into m_occlusion_raster
+	void rasterizeOccluders(v3s16 cam_pos_nodes, const MeshGrid &mesh_grid);
 
 	// update the vertex order in transparent mesh buffers
 	void updateTransparentMeshBuffers();
 
+	void renderLod(video::IVideoDriver *driver);
+
 	// Orders blocks by distance to the camera
 	class MapBlockComparer
 	{
@@ -169,12 +191,20 @@ class ClientMap : public Map, public scene::ISceneNode
 	video::SColor m_camera_light_color = video::SColor(0xFFFFFFFF);
 	bool m_needs_update_transparent_meshes = true;
 
-	std::map<v3s16, MapBlock*, MapBlockComparer> m_drawlist;
+	// Blocks to draw, ordered by MapBlockComparer
+	using DrawList = std::vector<std::pair<v3s16, MapBlock*>>;
+	DrawList m_drawlist;
 	// List of additional blocks to keep (relevant with mesh_chunk > 1, since
 	// not all blocks contain a mesh)
 	std::vector<MapBlock*> m_keeplist;
 	std::map<v3s16, MapBlock*> m_drawlist_shadow;
 	bool m_needs_update_drawlist;
+	// Occlusion culling results by mesh position, valid for the camera node
+	// m_occlusion_cache_camera until the map changes
+	std::unordered_map<v3s16, bool> m_occlusion_cache;
+	v3s16 m_occlusion_cache_camera;
+	// created when raster culling is first used
+	std::unique_ptr<OcclusionRaster> m_occlusion_raster;
 	CachedMeshBuffers m_dynamic_buffers;
 
 	bool m_cache_trilinear_filter;
@@ -185,4 +215,13 @@ class ClientMap : public Map, public scene::ISceneNode
 
 	bool m_loops_occlusion_culler;
 	bool m_enable_raytraced_culling;
+	bool m_enable_raster_culling;
+	u16 m_cache_lod_range;
+
+	// distant terrain, created once the first summary arrives
+	std::unique_ptr<LodTerrain> m_lod;
+	// camera position of the last LOD eviction, in nodes
+	v3f m_lod_evict_position;
+	std::vector<LodCellKey> m_lod_drawlist;
+	video::SMaterial m_lod_material;
 };
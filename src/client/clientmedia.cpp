@@ -15,6 +15,9 @@
 #include "util/serialize.h"
 #include "util/hashing.h"
 #include "util/string.h"
+#include "threading/mutex_auto_lock.h"
+#include "threading/thread.h"
+#include <IImage.h>
 #include <sstream>
 
 static std::string getMediaCacheDir()
@@ -40,6 +43,138 @@ bool clientMediaUpdateCacheCopy(const std::string &raw_hash, const std::string &
 	return false;
 }
 
+// Check that the data matches the announced checksum
+static bool checkMediaSha1(const std::string &name, const std::string &sha1,
+		const std::string &data, bool is_from_cache)
+{
+	// Compute actual checksum of data
+	std::string data_sha1 = hashing::sha1(data);
+
+	// Check that received file matches announced checksum
+	if (data_sha1 != sha1) {
+		infostream << "Client: "
+			<< (is_from_cache ? "Cached" : "Received") << " media file "
+			<< hex_encode(sha1) << " \"" << name << "\" "
+			<< "mismatches actual checksum " << hex_encode(data_sha1)
+			<< std::endl;
+		return false;
+	}
+	return true;
+}
+
+/*
+	CachedMediaPreloader
+*/
+
+class MediaPreloadThread : public Thread
+{
+public:
+	MediaPreloadThread(CachedMediaPreloader *preloader) :
+		Thread("MediaPreload"), m_preloader(preloader)
+	{}
+
+protected:
+	void *run() override
+	{
+		while (m_preloader->processNext())
+			;
+		return nullptr;
+	}
+
+private:
+	CachedMediaPreloader *m_preloader;
+};
+
+bool CachedMediaPreloader::Result::isLoadable(const std::string &name) const
+{
+	return image || (valid && !Client::isImageMedia(name));
+}
+
+CachedMediaPreloader::CachedMediaPreloader(const FileCache &cache,
+		DecodeImage decode_image, std::vector<File> &&files) :
+	m_cache(cache), m_decode_image(std::move(decode_image)),
+	m_files(std::move(files)), m_results(m_files.size())
+{
+	// Leave a core for the main thread, which does the rest of the work
+	u32 num_threads = rangelim(Thread::getNumberOfProcessors(), 2U, 5U) - 1;
+	num_threads = std::min<size_t>(num_threads, m_files.size());
+	for (u32 i = 0; i < num_threads; i++) {
+		m_threads.push_back(std::make_unique<MediaPreloadThread>(this));
+		m_threads.back()->start();
+	}
+}
+
+CachedMediaPreloader::~CachedMediaPreloader()
+{
+	{
+		MutexAutoLock lock(m_mutex);
+		m_stop = true;
+	}
+	m_cv.notify_all();
+	for (auto &thread : m_threads)
+		thread->wait();
+	for (auto &result : m_results) {
+		if (result.image)
+			result.image->drop();
+	}
+}
+
+CachedMediaPreloader::Result &CachedMediaPreloader::get(size_t i)
+{
+	std::unique_lock lock(m_mutex);
+	m_cv.wait(lock, [&] { return m_results[i].ready; });
+	return m_results[i];
+}
+
+void CachedMediaPreloader::release(size_t i)
+{
+	{
+		MutexAutoLock lock(m_mutex);
+		Result &result = m_results[i];
+		if (result.image)
+			result.image->drop();
+		result = Result();
+		result.ready = true;
+		m_released++;
+	}
+	m_cv.notify_all();
+}
+
+bool CachedMediaPreloader::processNext()
+{
+	size_t i;
+	{
+		std::unique_lock lock(m_mutex);
+		// Stay close to the main thread, to limit memory usage
+		m_cv.wait(lock, [this] {
+			return m_stop || m_next >= m_files.size() ||
+					m_next < m_released + MAX_AHEAD;
+		});
+		if (m_stop || m_next >= m_files.size())
+			return false;
+		i = m_next++;
+	}
+
+	const File &file = m_files[i];
+	Result result;
+	std::ostringstream os(std::ios_base::binary);
+	if (m_cache.load(hex_encode(file.sha1), os)) {
+		result.data = os.str();
+		result.valid = checkMediaSha1(file.name,
+				file.sha1, result.data, true);
+	}
+	if (result.valid && Client::isImageMedia(file.name))
+		result.image = m_decode_image(result.data, file.name);
+	result.ready = true;
+
+	{
+		MutexAutoLock lock(m_mutex);
+		m_results[i] = std::move(result);
+	}
+	m_cv.notify_all();
+	return true;
+}
+
 /*
 	ClientMediaDownloader
 */
@@ -62,9 +197,9 @@ ClientMediaDownloader::~ClientMediaDownloader()
 }
 
 bool ClientMediaDownloader::loadMedia(Client *client, const std::string &data,
-		const std::string &name)
+		const std::string &name, const std::string &sha1)
 {
-	return client->loadMedia(data, name);
+	return client->loadMedia(data, name, sha1);
 }
 
 void ClientMediaDownloader::addFile(const std::string &name, const std::string &sha1)
@@ -186,12 +321,42 @@ void ClientMediaDownloader::initialStep(Client *client)
 
 	// Check media cache
 	m_uncached_count = m_files.size();
+	std::vector<CachedMediaPreloader::File> files;
+	files.reserve(m_files.size());
+	for (auto &file_it : m_files)
+		files.push_back({file_it.first, file_it.second->sha1});
+	CachedMediaPreloader preloader(m_media_cache,
+		[client] (const std::string &data, const std::string &name) {
+			return client->decodeImageMedia(data, name);
+		}, std::move(files));
+
+	size_t i = 0;
 	for (auto &file_it : m_files) {
 		const std::string &name = file_it.first;
 		FileStatus *filestatus = file_it.second;
-		const std::string &sha1 = filestatus->sha1;
 
-		if (tryLoadFromCache(name, sha1, client)) {
+		CachedMediaPreloader::Result &cached = preloader.get(i);
+		bool loaded = false;
+		if (cached.image) {
+			client->loadImageMedia(name, cached.image, filestatus->sha1);
+			loaded = true;
+		} else if (cached.isLoadable(name)) {
+			loaded = loadMedia(client, cached.data, name, filestatus->sha1);
+		}
+		if (cached.valid) {
+			if (loaded) {
+				verbosestream << "Client: Loaded cached media: "
+					<< hex_encode(filestatus->sha1) << " \"" << name << "\""
+					<< std::endl;
+			} else {
+				infostream << "Client: Failed to load cached media: "
+					<< hex_encode(filestatus->sha1) << " \"" << name << "\""
+					<< std::endl;
+			}
+		}
+		preloader.release(i++);
+
+		if (loaded) {
 			filestatus->received = true;
 			m_uncached_count--;
 		}
@@ -536,25 +701,13 @@ bool IClientMediaDownloader::checkAndLoad(
 		const std::string &data, bool is_from_cache, Client *client)
 {
 	const char *cached_or_received = is_from_cache ? "cached" : "received";
-	const char *cached_or_received_uc = is_from_cache ? "Cached" : "Received";
 	std::string sha1_hex = hex_encode(sha1);
 
-	// Compute actual checksum of data
-	std::string data_sha1 = hashing::sha1(data);
-
-	// Check that received file matches announced checksum
-	if (data_sha1 != sha1) {
-		std::string data_sha1_hex = hex_encode(data_sha1);
-		infostream << "Client: "
-			<< cached_or_received_uc << " media file "
-			<< sha1_hex << " \"" << name << "\" "
-			<< "mismatches actual checksum " << data_sha1_hex
-			<< std::endl;
+	if (!checkMediaSha1(name, sha1, data, is_from_cache))
 		return false;
-	}
 
 	// Checksum is ok, try loading the file
-	bool success = loadMedia(client, data, name);
+	bool success = loadMedia(client, data, name, sha1);
 	if (!success) {
 		infostream << "Client: "
 			<< "Failed to load " << cached_or_received << " media: "
@@ -635,9 +788,9 @@ SingleMediaDownloader::~SingleMediaDownloader()
 }
 
 bool SingleMediaDownloader::loadMedia(Client *client, const std::string &data,
-		const std::string &name)
+		const std::string &name, const std::string &sha1)
 {
-	return client->loadMedia(data, name, true);
+	return client->loadMedia(data, name, sha1, true);
 }
 
 void SingleMediaDownloader::addFile(const std::string &name, const std::string &sha1)
@@ -7,7 +7,11 @@
 #include "irrlichttypes.h"
 #include "filecache.h"
 #include "util/basic_macros.h"
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 #include <unordered_map>
@@ -15,6 +19,10 @@
 class Client;
 struct HTTPFetchResult;
 
+namespace video {
+class IImage;
+}
+
 #define MTHASHSET_FILE_SIGNATURE 0x4d544853 // 'MTHS'
 #define MTHASHSET_FILE_NAME "index.mth"
 
@@ -28,6 +36,71 @@ bool clientMediaUpdateCache(const std::string &raw_hash,
 bool clientMediaUpdateCacheCopy(const std::string &raw_hash,
 	const std::string &path);
 
+class MediaPreloadThread;
+
+/*
+	Reads files from the media cache, verifies their checksums and decodes
+	images on worker threads. The main thread takes the results in order and
+	inserts them into the client, which is not thread-safe.
+*/
+class CachedMediaPreloader
+{
+public:
+	DISABLE_CLASS_COPY(CachedMediaPreloader)
+
+	struct File {
+		std::string name;
+		std::string sha1;
+	};
+
+	struct Result {
+		bool ready = false;
+		// found in the cache and the checksum matches
+		bool valid = false;
+		std::string data;
+		// decoded image, for image files only
+		video::IImage *image = nullptr;
+
+		// Whether the file can be loaded from this result. Otherwise it
+		// has to be fetched, which includes images that failed to decode.
+		bool isLoadable(const std::string &name) const;
+	};
+
+	// Decodes an image file, returns nullptr on error. Must be thread-safe.
+	using DecodeImage = std::function<video::IImage *(
+			const std::string &data, const std::string &name)>;
+
+	CachedMediaPreloader(const FileCache &cache, DecodeImage decode_image,
+			std::vector<File> &&files);
+	~CachedMediaPreloader();
+
+	/// Wait until file i was processed
+	Result &get(size_t i);
+
+	/// Free the memory of file i, and let the workers continue
+	void release(size_t i);
+
+	/// Process the next file, called by the workers
+	/// @return false if there is nothing left to do
+	bool processNext();
+
+private:
+	// Maximum number of files that are processed but not yet taken
+	static constexpr size_t MAX_AHEAD = 256;
+
+	FileCache m_cache;
+	DecodeImage m_decode_image;
+	const std::vector<File> m_files;
+	std::vector<Result> m_results;
+	std::vector<std::unique_ptr<MediaPreloadThread>> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	size_t m_next = 0;
+	size_t m_released = 0;
+	bool m_stop = false;
+};
+
 // more of a base class than an interface but this name was most convenient...
 class IClientMediaDownloader
 {
@@ -68,7 +141,7 @@ class IClientMediaDownloader
 
 	// Forwards the call to the appropriate Client method
 	virtual bool loadMedia(Client *client, const std::string &data,
-		const std::string &name) = 0;
+		const std::string &name, const std::string &sha1) = 0;
 
 	bool tryLoadFromCache(const std::string &name, const std::string &sha1,
 			Client *client);
@@ -117,7 +190,7 @@ class ClientMediaDownloader : public IClientMediaDownloader
 
 protected:
 	bool loadMedia(Client *client, const std::string &data,
-			const std::string &name) override;
+			const std::string &name, const std::string &sha1) override;
 
 	static std::string makeReferer(Client *client);
 
@@ -207,7 +280,7 @@ class SingleMediaDownloader : public IClientMediaDownloader
 
 protected:
 	bool loadMedia(Client *client, const std::string &data,
-			const std::string &name) override;
+			const std::string &name, const std::string &sha1) override;
 
 private:
 	void initialStep(Client *client);
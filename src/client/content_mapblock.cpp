@@ -14,6 +14,8 @@
 #include "client/tile.h"
 #include "mesh.h"
 #include "client/meshgen/collector.h"
+#include "client/meshgen/face_merger.h"
+#include "client/meshgen/geometry_cache.h"
 #include "client/renderingengine.h"
 #include "client.h"
 #include "noise.h"
@@ -67,8 +69,12 @@ MapblockMeshGenerator::MapblockMeshGenerator(MeshMakeData *input, MeshCollector
 	nodedef(data->m_nodedef),
 	blockpos_nodes(data->m_blockpos * MAP_BLOCKSIZE)
 {
+	if (data->m_greedy_meshing)
+		face_merger = std::make_unique<GreedyFaceMerger>(data->m_side_length);
 }
 
+MapblockMeshGenerator::~MapblockMeshGenerator() = default;
+
 void MapblockMeshGenerator::useTile(TileSpec *tile_ret, int index, u8 set_flags,
 		u8 reset_flags, bool special)
 {
@@ -275,6 +281,9 @@ void MapblockMeshGenerator::drawCuboid(const aabb3f &box,
 		QuadDiagonal diagonal = face_lighter(k, &vertices[4 * k]);
 		const u16 *indices = diagonal == QuadDiagonal::Diag13 ? quad_indices_13 : quad_indices_02;
 		int tileindex = MYMIN(k, tilecount - 1);
+		if (cur_node.mergeable &&
+				face_merger->add(tiles[tileindex], k, cur_node.p, &vertices[4 * k]))
+			continue;
 		collector->append(tiles[tileindex], &vertices[4 * k], 4, indices, 6);
 	}
 }
@@ -1792,6 +1801,7 @@ void MapblockMeshGenerator::errorUnknownDrawtype()
 void MapblockMeshGenerator::drawNode()
 {
 	cur_node.origin = intToFloat(cur_node.p, BS);
+	cur_node.mergeable = face_merger && cur_node.f->drawtype == NDT_NORMAL;
 	switch (cur_node.f->drawtype) {
 		case NDT_AIRLIKE:  // Not drawn at all
 			return;
@@ -1830,11 +1840,31 @@ void MapblockMeshGenerator::generate()
 {
 	ZoneScoped;
 
+	// Copy the geometry of unchanged nodes if possible
+	const MeshGeometryCache *previous = data->m_previous_geometry.get();
+	if (previous && (!previous->hasNodeRanges() || data->m_regenerate.empty()))
+		previous = nullptr;
+	size_t range = 0;
+
+	u32 index = 0;
 	for (cur_node.p.Z = 0; cur_node.p.Z < data->m_side_length; cur_node.p.Z++)
 	for (cur_node.p.Y = 0; cur_node.p.Y < data->m_side_length; cur_node.p.Y++)
-	for (cur_node.p.X = 0; cur_node.p.X < data->m_side_length; cur_node.p.X++) {
+	for (cur_node.p.X = 0; cur_node.p.X < data->m_side_length; cur_node.p.X++, index++) {
+		collector->current_node = index;
+		if (previous && !data->m_regenerate[index]) {
+			// ranges are ordered by node
+			const auto &ranges = previous->node_ranges;
+			while (range < ranges.size() && ranges[range].node < index)
+				range++;
+			for (; range < ranges.size() && ranges[range].node == index; range++)
+				collector->appendRecorded(previous->prebuffers, ranges[range]);
+			continue;
+		}
 		cur_node.n = data->m_vmanip.getNodeNoEx(blockpos_nodes + cur_node.p);
 		cur_node.f = &nodedef->get(cur_node.n);
 		drawNode();
 	}
+
+	if (face_merger)
+		face_merger->flush(collector);
 }
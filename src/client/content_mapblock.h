@@ -6,9 +6,11 @@
 
 #include "nodedef.h"
 #include "tile.h"
+#include <memory>
 
 struct MeshMakeData;
 struct MeshCollector;
+class GreedyFaceMerger;
 
 struct LightPair {
 	u8 lightDay;
@@ -47,6 +49,7 @@ class MapblockMeshGenerator
 {
 public:
 	MapblockMeshGenerator(MeshMakeData *input, MeshCollector *output);
+	~MapblockMeshGenerator();
 	void generate();
 
 private:
@@ -57,6 +60,9 @@ class MapblockMeshGenerator
 
 	const v3s16 blockpos_nodes;
 
+	// only present if greedy meshing is enabled
+	std::unique_ptr<GreedyFaceMerger> face_merger;
+
 // current node
 	struct {
 		v3s16 p; // relative to blockpos_nodes
@@ -65,6 +71,7 @@ class MapblockMeshGenerator
 		const ContentFeatures *f;
 		LightFrame lframe; // smooth lighting
 		video::SColor lcolor; // unsmooth lighting
+		bool mergeable; // full faces may be passed to face_merger
 	} cur_node;
 
 // lighting
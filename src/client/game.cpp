@@ -1285,16 +1285,16 @@ void Game::updateProfilers(const RunStats &stats, const FpsControl &draw_times,
 	g_profiler->graphSet("FPS", 1.0f / dtime);
 
 	auto stats2 = driver->getFrameStats();
-	g_profiler->avg("Irr: drawcalls", stats2.Drawcalls);
+	g_profiler->avg(PROFILER_METRIC("Irr: drawcalls"), stats2.Drawcalls);
 	if (stats2.Drawcalls > 0)
-		g_profiler->avg("Irr: primitives per drawcall",
+		g_profiler->avg(PROFILER_METRIC("Irr: primitives per drawcall"),
 			stats2.PrimitivesDrawn / float(stats2.Drawcalls));
-	g_profiler->avg("Irr: HW buffers uploaded", stats2.HWBuffersUploaded);
-	g_profiler->avg("Irr: HW buffers active", stats2.HWBuffersActive);
+	g_profiler->avg(PROFILER_METRIC("Irr: HW buffers uploaded"), stats2.HWBuffersUploaded);
+	g_profiler->avg(PROFILER_METRIC("Irr: HW buffers active"), stats2.HWBuffersActive);
 	u32 skinned_meshes = stats2.SWSkinnedMeshes + stats2.HWSkinnedMeshes;
 	if (skinned_meshes > 0) {
 		f32 use_pct = std::floor(100.0f * stats2.HWSkinnedMeshes / skinned_meshes);
-		g_profiler->avg("Irr: HW skinning use [%]", use_pct);
+		g_profiler->avg(PROFILER_METRIC("Irr: HW skinning use [%]"), use_pct);
 	}
 
 	if (profiler_interval.step(dtime, profiler_print_interval)) {
@@ -3416,6 +3416,11 @@ void Game::updateFrame(ProfilerGraph *graph, RunStats *stats, f32 dtime,
 		runData.fog_range = FOG_RANGE_ALL;
 	} else {
 		runData.fog_range = draw_control->wanted_range * BS;
+		// distant terrain is drawn beyond the viewing range
+		if (sky->getFogDistance() < 0) {
+			f32 lod_range = client->getEnv().getClientMap().getLodRange();
+			runData.fog_range = std::max(runData.fog_range, lod_range * BS);
+		}
 	}
 
 	/*
@@ -3562,7 +3567,8 @@ void Game::updateFrame(ProfilerGraph *graph, RunStats *stats, f32 dtime,
 		runData.damage_flash -= 384.0f * dtime;
 	}
 
-	g_profiler->avg("Game::updateFrame(): update frame [ms]", tt_update.stop(true));
+	g_profiler->avg(PROFILER_METRIC("Game::updateFrame(): update frame [ms]"),
+			tt_update.stop(true));
 }
 
 void Game::updateClouds(float dtime)
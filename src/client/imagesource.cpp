@@ -13,9 +13,18 @@
 #include "texturepaths.h"
 #include "irrlicht_changes/printing.h"
 #include "irr_ptr.h"
+#include "filesys.h"
+#include "porting.h"
 #include "util/base64.h"
+#include "util/hashing.h"
+#include "util/hex.h"
 #include "util/numeric.h"
+#include "util/serialize.h"
 #include "util/strfnd.h"
+#include <algorithm>
+#include <ctime>
+#include <sstream>
+#include <zstd.h>
 
 
 ////////////////////////////////
@@ -29,7 +38,8 @@ SourceImageCache::~SourceImageCache() {
 	m_images.clear();
 }
 
-void SourceImageCache::insert(const std::string &name, video::IImage *img, bool prefer_local)
+void SourceImageCache::insert(const std::string &name, video::IImage *img, bool prefer_local,
+		const std::string &file_hash)
 {
 	assert(img); // Pre-condition
 	// Remove old image
@@ -41,6 +51,8 @@ void SourceImageCache::insert(const std::string &name, video::IImage *img, bool
 
 	video::IImage* toadd = img;
 	bool need_to_grab = true;
+	m_content_hashes.erase(name);
+	m_paths.erase(name);
 
 	// Try to use local texture instead if asked to
 	if (prefer_local) {
@@ -53,9 +65,12 @@ void SourceImageCache::insert(const std::string &name, video::IImage *img, bool
 			if (img2){
 				toadd = img2;
 				need_to_grab = false;
+				m_paths[name] = path;
 			}
 		}
 	}
+	if (need_to_grab && !file_hash.empty())
+		m_content_hashes[name] = file_hash;
 
 	if (need_to_grab)
 		toadd->grab();
@@ -91,12 +106,371 @@ video::IImage* SourceImageCache::getOrLoad(const std::string &name)
 
 	if (img){
 		m_images[name] = img;
+		m_paths[name] = path;
 		img->grab(); // Grab for caller
 	}
 	return img;
 }
 
 
+const std::string &SourceImageCache::getContentHash(const std::string &name)
+{
+	auto it = m_content_hashes.find(name);
+	if (it != m_content_hashes.end())
+		return it->second;
+
+	std::string &hash = m_content_hashes[name];
+	video::IImage *img = getOrLoad(name);
+	if (!img)
+		return hash;
+
+	// Hash the file if there is one, it is smaller than the pixels
+	auto path_it = m_paths.find(name);
+	std::string data;
+	if (path_it != m_paths.end() && fs::ReadFile(path_it->second, data, false)) {
+		hash = hashing::sha1(data);
+		img->drop();
+		return hash;
+	}
+
+	std::ostringstream os(std::ios::binary);
+	core::dimension2du dim = img->getDimension();
+	writeU32(os, dim.Width);
+	writeU32(os, dim.Height);
+	writeU8(os, img->getColorFormat());
+	os.write(reinterpret_cast<const char *>(img->getData()),
+			img->getImageDataSizeInBytes());
+	hash = hashing::sha1(os.str());
+	img->drop();
+	return hash;
+}
+
+////////////////////////////////////
+// GeneratedImageCache Functions //
+////////////////////////////////////
+
+static video::IImage *copy_image(video::IImage *img)
+{
+	video::IImage *copy = RenderingEngine::get_video_driver()->
+			createImage(img->getColorFormat(), img->getDimension());
+	sanity_check(copy);
+	img->copyTo(copy);
+	return copy;
+}
+
+// Returns an image that can be modified in place, which is a copy if img is
+// shared, e.g. with GeneratedImageCache. Takes over the reference to img.
+static video::IImage *make_writable(video::IImage *img)
+{
+	if (img->getReferenceCount() == 1)
+		return img;
+	video::IImage *copy = copy_image(img);
+	img->drop();
+	return copy;
+}
+
+GeneratedImageCache::~GeneratedImageCache()
+{
+	for (auto &it : m_images)
+		it.second.image->drop();
+}
+
+video::IImage *GeneratedImageCache::get(const std::string &name,
+		std::set<std::string> &source_image_names)
+{
+	auto it = m_images.find(name);
+	if (it == m_images.end())
+		return nullptr;
+
+	Entry &entry = it->second;
+	m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+	source_image_names.insert(entry.source_image_names.begin(),
+			entry.source_image_names.end());
+	entry.image->grab();
+	return entry.image;
+}
+
+void GeneratedImageCache::insert(const std::string &name, video::IImage *img,
+		const std::set<std::string> &source_image_names)
+{
+	const size_t size = img->getImageDataSizeInBytes();
+	// Not worth pushing out many other images
+	if (size > m_max_size / 4)
+		return;
+
+	auto it = m_images.find(name);
+	if (it != m_images.end())
+		erase(it);
+	while (m_size + size > m_max_size && !m_lru.empty())
+		erase(m_images.find(m_lru.back()));
+
+	img->grab();
+	m_lru.push_front(name);
+	m_images.emplace(name, Entry{img, source_image_names, m_lru.begin()});
+	m_size += size;
+}
+
+void GeneratedImageCache::invalidate(const std::string &source_name)
+{
+	for (auto it = m_images.begin(); it != m_images.end();) {
+		auto next = std::next(it);
+		if (it->second.source_image_names.count(source_name) > 0)
+			erase(it);
+		it = next;
+	}
+}
+
+void GeneratedImageCache::erase(std::unordered_map<std::string, Entry>::iterator it)
+{
+	m_size -= it->second.image->getImageDataSizeInBytes();
+	it->second.image->drop();
+	m_lru.erase(it->second.lru_it);
+	m_images.erase(it);
+}
+
+/////////////////////////////////////
+// PersistentImageCache Functions //
+/////////////////////////////////////
+
+// Increase when the file format or the way images are generated changes
+static constexpr u8 PERSISTENT_IMAGE_VERSION = 2;
+
+PersistentImageCache::PersistentImageCache(const std::string &dir,
+		const std::string &settings_key, size_t max_size, u64 max_age) :
+	m_files(dir), m_dir(dir), m_settings_key(settings_key),
+	m_max_size(max_size), m_max_age(max_age)
+{
+	loadIndex();
+}
+
+PersistentImageCache::~PersistentImageCache()
+{
+	if (m_index_changed)
+		saveIndex();
+}
+
+std::string PersistentImageCache::getFileName(const std::string &name) const
+{
+	return hex_encode(hashing::sha1(m_settings_key + name));
+}
+
+video::IImage *PersistentImageCache::createImage(core::dimension2du dim)
+{
+	return RenderingEngine::get_video_driver()->createImage(video::ECF_A8R8G8B8, dim);
+}
+
+void PersistentImageCache::readIndex(std::unordered_map<std::string, IndexEntry> &index)
+{
+	std::ostringstream os(std::ios::binary);
+	if (!m_files.load(INDEX_FILE, os))
+		return;
+	std::istringstream is(os.str());
+	std::string file_name;
+	IndexEntry entry;
+	while (is >> file_name >> entry.size >> entry.last_used)
+		index[file_name] = entry;
+}
+
+void PersistentImageCache::loadIndex()
+{
+	readIndex(m_index);
+
+	// Files that are not in the index are left alone, they may belong to
+	// another client using the same directory. Only files that the index
+	// knows about are ever deleted.
+	std::set<std::string> present;
+	for (const fs::DirListNode &node : fs::GetDirListing(m_dir)) {
+		if (!node.dir && m_index.count(node.name) != 0)
+			present.insert(node.name);
+	}
+	for (auto it = m_index.begin(); it != m_index.end();) {
+		if (present.count(it->first) == 0) {
+			it = m_index.erase(it);
+			m_index_changed = true;
+		} else {
+			m_size += it->second.size;
+			++it;
+		}
+	}
+
+	evict(m_max_size);
+}
+
+void PersistentImageCache::saveIndex()
+{
+	// Keep what other clients have added to the index in the meantime
+	std::unordered_map<std::string, IndexEntry> on_disk;
+	readIndex(on_disk);
+	for (const auto &it : on_disk) {
+		if (m_removed.count(it.first) != 0)
+			continue;
+		auto [ours, inserted] = m_index.emplace(it.first, it.second);
+		if (inserted) {
+			if (!fs::PathExists(m_dir + DIR_DELIM + it.first))
+				m_index.erase(ours);
+		} else {
+			ours->second.last_used = std::max(ours->second.last_used,
+					it.second.last_used);
+		}
+	}
+
+	std::ostringstream os;
+	for (const auto &it : m_index)
+		os << it.first << " " << it.second.size << " " << it.second.last_used << "\n";
+	if (!fs::safeWriteToFile(m_dir + DIR_DELIM + INDEX_FILE, os.str())) {
+		warningstream << "PersistentImageCache: Failed to write the index"
+				<< std::endl;
+	}
+}
+
+void PersistentImageCache::evict(size_t target_size, const std::string &keep)
+{
+	const u64 now = time(nullptr);
+	std::vector<std::pair<u64, std::string>> by_age;
+	for (const auto &it : m_index) {
+		if (it.first == keep)
+			continue;
+		if (now >= it.second.last_used + m_max_age)
+			by_age.emplace_back(0, it.first); // outdated, goes first
+		else
+			by_age.emplace_back(it.second.last_used, it.first);
+	}
+	std::sort(by_age.begin(), by_age.end());
+
+	for (const auto &it : by_age) {
+		if (it.first != 0 && m_size <= target_size)
+			break;
+		remove(it.second);
+	}
+}
+
+void PersistentImageCache::remove(const std::string &file_name)
+{
+	auto it = m_index.find(file_name);
+	if (it == m_index.end())
+		return;
+	fs::DeleteSingleFileOrEmptyDirectory(m_dir + DIR_DELIM + file_name);
+	m_size -= it->second.size;
+	m_index.erase(it);
+	m_removed.insert(file_name);
+	m_index_changed = true;
+}
+
+bool PersistentImageCache::isWorthKeeping(core::dimension2du dim, u64 generation_us)
+{
+	// Measured with benchmark_persistent_image_cache, reading a file and
+	// decompressing it takes LOAD_BASE_US plus a bit per pixel
+	constexpr u64 LOAD_BASE_US = 20;
+	constexpr u64 LOAD_PIXELS_PER_US = 100;
+	return generation_us > LOAD_BASE_US + dim.getArea() / LOAD_PIXELS_PER_US;
+}
+
+video::IImage *PersistentImageCache::get(const std::string &name,
+		SourceImageCache &sources, std::set<std::string> &source_image_names)
+{
+	const std::string file_name = getFileName(name);
+	auto index_it = m_index.find(file_name);
+	if (index_it == m_index.end())
+		return nullptr;
+	std::string data;
+	if (!fs::ReadFile(m_dir + DIR_DELIM + file_name, data)) {
+		remove(file_name);
+		return nullptr;
+	}
+
+	std::istringstream is(data, std::ios::binary);
+	try {
+		if (readU8(is) != PERSISTENT_IMAGE_VERSION ||
+				deSerializeString16(is) != m_settings_key + name)
+			return nullptr;
+
+		std::set<std::string> names;
+		u16 count = readU16(is);
+		for (u16 i = 0; i < count; i++) {
+			std::string source_name = deSerializeString16(is);
+			if (deSerializeString16(is) != sources.getContentHash(source_name))
+				return nullptr; // outdated
+			names.insert(std::move(source_name));
+		}
+
+		core::dimension2du dim;
+		dim.Width = readU32(is);
+		dim.Height = readU32(is);
+		if (dim.Width > ImageSource::MAX_IMAGE_DIMENSION ||
+				dim.Height > ImageSource::MAX_IMAGE_DIMENSION)
+			return nullptr;
+
+		// The pixels are decompressed right into the image
+		const size_t size = dim.getArea() * 4;
+		const size_t offset = is.tellg();
+		video::IImage *img = createImage(dim);
+		sanity_check(img && img->getImageDataSizeInBytes() == size);
+		if (ZSTD_decompress(img->getData(), size, data.data() + offset,
+				data.size() - offset) != size) {
+			img->drop();
+			return nullptr;
+		}
+		source_image_names.merge(names);
+		index_it->second.last_used = time(nullptr);
+		m_index_changed = true;
+		return img;
+	} catch (SerializationError &e) {
+		warningstream << "PersistentImageCache: Ignoring broken file for \""
+				<< name << "\": " << e.what() << std::endl;
+		return nullptr;
+	}
+}
+
+void PersistentImageCache::insert(const std::string &name, video::IImage *img,
+		SourceImageCache &sources, const std::set<std::string> &source_image_names)
+{
+	if (img->getColorFormat() != video::ECF_A8R8G8B8 ||
+			source_image_names.size() > U16_MAX)
+		return;
+
+	std::ostringstream os(std::ios::binary);
+	writeU8(os, PERSISTENT_IMAGE_VERSION);
+	os << serializeString16(m_settings_key + name);
+	writeU16(os, source_image_names.size());
+	for (const std::string &source_name : source_image_names) {
+		os << serializeString16(source_name);
+		os << serializeString16(sources.getContentHash(source_name));
+	}
+	core::dimension2du dim = img->getDimension();
+	writeU32(os, dim.Width);
+	writeU32(os, dim.Height);
+	// zstd decompresses several times faster than zlib, the checksum
+	// catches broken files
+	const size_t size = img->getImageDataSizeInBytes();
+	std::string compressed(ZSTD_compressBound(size), '\0');
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+	const size_t compressed_size = ZSTD_compress2(cctx, compressed.data(),
+			compressed.size(), img->getData(), size);
+	ZSTD_freeCCtx(cctx);
+	if (ZSTD_isError(compressed_size))
+		return;
+	os.write(compressed.data(), compressed_size);
+
+	const std::string file_name = getFileName(name);
+	const std::string data = os.str();
+	if (!m_files.update(file_name, data)) {
+		warningstream << "PersistentImageCache: Failed to write image \""
+				<< name << "\"" << std::endl;
+		remove(file_name);
+		return;
+	}
+
+	m_removed.erase(file_name);
+	IndexEntry &entry = m_index[file_name];
+	m_size = m_size - entry.size + data.size();
+	entry = {data.size(), (u64)time(nullptr)};
+	m_index_changed = true;
+	// Leave some room, so that this does not happen on every insert
+	if (m_size > m_max_size)
+		evict(m_max_size / 4 * 3, file_name);
+}
+
 ////////////////////////////
 // Image Helper Functions //
 ////////////////////////////
@@ -124,47 +498,6 @@ static inline void blit_with_alpha(video::IImage *src, video::IImage *dst,
 	blit_with_alpha2<overlay>(src, dst, v2s32(), dst_pos, size);
 }
 
-// Apply a color to an image.  Uses an int (0-255) to calculate the ratio.
-// If the ratio is 255 or -1 and keep_alpha is true, then it multiples the
-// color alpha with the destination alpha.
-// Otherwise, any pixels that are not fully transparent get the color alpha.
-static void apply_colorize(video::IImage *dst, v2u32 dst_pos, v2u32 size,
-		const video::SColor color, int ratio, bool keep_alpha);
-
-// paint a texture using the given color
-static void apply_multiplication(video::IImage *dst, v2u32 dst_pos, v2u32 size,
-		const video::SColor color);
-
-// Perform a Screen blend with the given color. The opposite effect of a
-// Multiply blend.
-static void apply_screen(video::IImage *dst, v2u32 dst_pos, v2u32 size,
-		const video::SColor color);
-
-// Adjust the hue, saturation, and lightness of destination. Like
-// "Hue-Saturation" in GIMP.
-// If colorize is true then the image will be converted to a grayscale
-// image as though seen through a colored glass, like "Colorize" in GIMP.
-static void apply_hue_saturation(video::IImage *dst, v2u32 dst_pos, v2u32 size,
-		s32 hue, s32 saturation, s32 lightness, bool colorize);
-
-// Apply an overlay blend to an images.
-// Overlay blend combines Multiply and Screen blend modes.The parts of the top
-// layer where the base layer is light become lighter, the parts where the base
-// layer is dark become darker.Areas where the base layer are mid grey are
-// unaffected.An overlay with the same picture looks like an S - curve.
-static void apply_overlay(video::IImage *overlay, video::IImage *dst,
-		v2s32 overlay_pos, v2s32 dst_pos, v2u32 size, bool hardlight);
-
-// Adjust the brightness and contrast of the base image. Conceptually like
-// "Brightness-Contrast" in GIMP but allowing brightness to be wound all the
-// way up to white or down to black.
-static void apply_brightness_contrast(video::IImage *dst, v2u32 dst_pos, v2u32 size,
-		s32 brightness, s32 contrast);
-
-// Apply a mask to an image
-static void apply_mask(video::IImage *mask, video::IImage *dst,
-		v2s32 mask_pos, v2s32 dst_pos, v2u32 size);
-
 // Draw or overlay a crack
 static void draw_crack(video::IImage *crack, video::IImage *dst,
 		bool use_overlay, s32 frame_count, s32 progression,
@@ -417,6 +750,92 @@ void blit_pixel(video::SColor src_col, video::SColor &dst_col)
 	dst_col.set(dst_a, dst.r, dst.g, dst.b);
 }
 
+/** Call a function for each pixel in an area of an image
+ *
+ * Images in the ECF_A8R8G8B8 format are accessed directly, which lets the
+ * compiler vectorize simple functions.
+ *
+ * \param fn Called as fn(video::SColor &pixel), changes are written back
+*/
+template <typename F>
+void for_each_pixel(video::IImage *dst, v2u32 pos, v2u32 size, F &&fn)
+{
+	const v2u32 dim = dst->getDimension();
+	if (pos.X >= dim.X || pos.Y >= dim.Y)
+		return;
+	size = componentwise_min(size, dim - pos);
+
+	if (dst->getColorFormat() == video::ECF_A8R8G8B8) {
+		video::SColor *pixels = reinterpret_cast<video::SColor *>(dst->getData());
+		for (u32 y = pos.Y; y < pos.Y + size.Y; y++) {
+			video::SColor *row = pixels + (size_t)y * dim.X;
+			for (u32 x = pos.X; x < pos.X + size.X; x++)
+				fn(row[x]);
+		}
+		return;
+	}
+
+	for (u32 y = pos.Y; y < pos.Y + size.Y; y++)
+	for (u32 x = pos.X; x < pos.X + size.X; x++) {
+		video::SColor c = dst->getPixel(x, y);
+		fn(c);
+		dst->setPixel(x, y, c);
+	}
+}
+
+/** Call a function for each pair of pixels in two images
+ *
+ * Positions and size are clipped like in blit_with_alpha().
+ *
+ * \param fn Called as fn(video::SColor src_pixel, video::SColor &dst_pixel),
+ *   changes to the latter are written back
+*/
+template <typename F>
+void for_each_pixel_pair(video::IImage *src, video::IImage *dst,
+	v2s32 src_pos, v2s32 dst_pos, v2u32 size, F &&fn)
+{
+	dst_pos -= componentwise_min(src_pos, {0,0});
+	src_pos = componentwise_max(src_pos, {0,0});
+	src_pos -= componentwise_min(dst_pos, {0,0});
+	dst_pos = componentwise_max(dst_pos, {0,0});
+
+	const v2u32 src_dim = src->getDimension();
+	const v2u32 dst_dim = dst->getDimension();
+	const v2u32 src_pos_u = v2u32::from(src_pos);
+	const v2u32 dst_pos_u = v2u32::from(dst_pos);
+	if (src_pos_u.X >= src_dim.X || src_pos_u.Y >= src_dim.Y)
+		return;
+	if (dst_pos_u.X >= dst_dim.X || dst_pos_u.Y >= dst_dim.Y)
+		return;
+	size = componentwise_min(size,
+		componentwise_min(src_dim - src_pos_u, dst_dim - dst_pos_u));
+
+	if (src->getColorFormat() == video::ECF_A8R8G8B8 &&
+			dst->getColorFormat() == video::ECF_A8R8G8B8) {
+		const video::SColor *pixels_src =
+			reinterpret_cast<const video::SColor *>(src->getData());
+		video::SColor *pixels_dst =
+			reinterpret_cast<video::SColor *>(dst->getData());
+		for (u32 y0 = 0; y0 < size.Y; ++y0) {
+			const video::SColor *row_src = pixels_src +
+				(size_t)(src_pos_u.Y + y0) * src_dim.X + src_pos_u.X;
+			video::SColor *row_dst = pixels_dst +
+				(size_t)(dst_pos_u.Y + y0) * dst_dim.X + dst_pos_u.X;
+			for (u32 x0 = 0; x0 < size.X; ++x0)
+				fn(row_src[x0], row_dst[x0]);
+		}
+		return;
+	}
+
+	for (u32 y0 = 0; y0 < size.Y; ++y0)
+	for (u32 x0 = 0; x0 < size.X; ++x0) {
+		u32 dst_x = dst_pos_u.X + x0, dst_y = dst_pos_u.Y + y0;
+		video::SColor c = dst->getPixel(dst_x, dst_y);
+		fn(src->getPixel(src_pos_u.X + x0, src_pos_u.Y + y0), c);
+		dst->setPixel(dst_x, dst_y, c);
+	}
+}
+
 }  // namespace (anonymous)
 
 template<bool overlay>
@@ -483,81 +902,64 @@ static void blit_with_alpha2(video::IImage *src, video::IImage *dst,
 /*
 	Apply color to destination, using a weighted interpolation blend
 */
-static void apply_colorize(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+void apply_colorize(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 		const video::SColor color, int ratio, bool keep_alpha)
 {
 	u32 alpha = color.getAlpha();
-	video::SColor dst_c;
 	if ((ratio == -1 && alpha == 255) || ratio == 255) { // full replacement of color
 		if (keep_alpha) { // replace the color with alpha = dest alpha * color alpha
-			dst_c = color;
-			for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
-			for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
-				u32 dst_alpha = dst->getPixel(x, y).getAlpha();
+			for_each_pixel(dst, dst_pos, size, [&] (video::SColor &dst_c) {
+				u32 dst_alpha = dst_c.getAlpha();
 				if (dst_alpha > 0) {
+					dst_c = color;
 					dst_c.setAlpha(dst_alpha * alpha / 255);
-					dst->setPixel(x, y, dst_c);
 				}
-			}
+			});
 		} else { // replace the color including the alpha
-			for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
-			for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++)
-				if (dst->getPixel(x, y).getAlpha() > 0)
-					dst->setPixel(x, y, color);
+			for_each_pixel(dst, dst_pos, size, [&] (video::SColor &dst_c) {
+				if (dst_c.getAlpha() > 0)
+					dst_c = color;
+			});
 		}
 	} else {  // interpolate between the color and destination
 		float interp = (ratio == -1 ? color.getAlpha() / 255.0f : ratio / 255.0f);
-		for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
-		for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
-			dst_c = dst->getPixel(x, y);
-			if (dst_c.getAlpha() > 0) {
+		for_each_pixel(dst, dst_pos, size, [&] (video::SColor &dst_c) {
+			if (dst_c.getAlpha() > 0)
 				dst_c = color.getInterpolated(dst_c, interp);
-				dst->setPixel(x, y, dst_c);
-			}
-		}
+		});
 	}
 }
 
 /*
 	Apply color to destination, using a Multiply blend mode
 */
-static void apply_multiplication(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+void apply_multiplication(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 		const video::SColor color)
 {
-	video::SColor dst_c;
-
-	for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
-	for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
-		dst_c = dst->getPixel(x, y);
+	for_each_pixel(dst, dst_pos, size, [&] (video::SColor &dst_c) {
 		dst_c.set(
 				dst_c.getAlpha(),
 				(dst_c.getRed() * color.getRed()) / 255,
 				(dst_c.getGreen() * color.getGreen()) / 255,
 				(dst_c.getBlue() * color.getBlue()) / 255
 				);
-		dst->setPixel(x, y, dst_c);
-	}
+	});
 }
 
 /*
 	Apply color to destination, using a Screen blend mode
 */
-static void apply_screen(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+void apply_screen(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 		const video::SColor color)
 {
-	video::SColor dst_c;
-
-	for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
-	for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
-		dst_c = dst->getPixel(x, y);
+	for_each_pixel(dst, dst_pos, size, [&] (video::SColor &dst_c) {
 		dst_c.set(
 			dst_c.getAlpha(),
 			255 - ((255 - dst_c.getRed())   * (255 - color.getRed()))   / 255,
 			255 - ((255 - dst_c.getGreen()) * (255 - color.getGreen())) / 255,
 			255 - ((255 - dst_c.getBlue())  * (255 - color.getBlue()))  / 255
 		);
-		dst->setPixel(x, y, dst_c);
-	}
+	});
 }
 
 /*
@@ -573,7 +975,7 @@ static void apply_screen(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 	be converted to a grayscale image as seen through a colored glass, like
 	"Colorize" in GIMP.
 */
-static void apply_hue_saturation(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+void apply_hue_saturation(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 	s32 hue, s32 saturation, s32 lightness, bool colorize)
 {
 	video::SColorf colorf;
@@ -640,22 +1042,15 @@ static void apply_hue_saturation(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 	Apply an Overlay blend to destination
 	If hardlight is true then swap the dst & blend images (a hardlight blend)
 */
-static void apply_overlay(video::IImage *blend, video::IImage *dst,
+void apply_overlay(video::IImage *blend, video::IImage *dst,
 	v2s32 blend_pos, v2s32 dst_pos, v2u32 size, bool hardlight)
 {
-	video::IImage *blend_layer = hardlight ? dst : blend;
-	video::IImage *base_layer  = hardlight ? blend : dst;
-	v2s32 blend_layer_pos = hardlight ? dst_pos : blend_pos;
-	v2s32 base_layer_pos  = hardlight ? blend_pos : dst_pos;
-
-	for (u32 y = 0; y < size.Y; y++)
-	for (u32 x = 0; x < size.X; x++) {
-		s32 base_x = x + base_layer_pos.X;
-		s32 base_y = y + base_layer_pos.Y;
-
-		video::SColor blend_c =
-			blend_layer->getPixel(x + blend_layer_pos.X, y + blend_layer_pos.Y);
-		video::SColor base_c = base_layer->getPixel(base_x, base_y);
+	for_each_pixel_pair(blend, dst, blend_pos, dst_pos, size,
+			[hardlight] (video::SColor blend_c, video::SColor &dst_c) {
+		video::SColor base_c = dst_c;
+		if (hardlight)
+			std::swap(blend_c, base_c);
+
 		f32 blend_r = blend_c.getRed()   / 255.0f;
 		f32 blend_g = blend_c.getGreen() / 255.0f;
 		f32 blend_b = blend_c.getBlue()  / 255.0f;
@@ -663,15 +1058,14 @@ static void apply_overlay(video::IImage *blend, video::IImage *dst,
 		f32 base_g = base_c.getGreen() / 255.0f;
 		f32 base_b = base_c.getBlue()  / 255.0f;
 
-		base_c.set(
+		dst_c.set(
 			base_c.getAlpha(),
 			// Do a Multiply blend if less that 0.5, otherwise do a Screen blend
 			(u32)((base_r < 0.5f ? 2 * base_r * blend_r : 1 - 2 * (1 - base_r) * (1 - blend_r)) * 255),
 			(u32)((base_g < 0.5f ? 2 * base_g * blend_g : 1 - 2 * (1 - base_g) * (1 - blend_g)) * 255),
 			(u32)((base_b < 0.5f ? 2 * base_b * blend_b : 1 - 2 * (1 - base_b) * (1 - blend_b)) * 255)
 		);
-		dst->setPixel(base_x, base_y, base_c);
-	}
+	});
 }
 
 /*
@@ -680,7 +1074,7 @@ static void apply_overlay(video::IImage *blend, video::IImage *dst,
 	Conceptually like GIMP's "Brightness-Contrast" feature but allows brightness to be
 	wound all the way up to white or down to black.
 */
-static void apply_brightness_contrast(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+void apply_brightness_contrast(video::IImage *dst, v2u32 dst_pos, v2u32 size,
 	s32 brightness, s32 contrast)
 {
 	// Only allow normalized contrast to get as high as 127/128 to avoid infinite slope.
@@ -714,39 +1108,26 @@ static void apply_brightness_contrast(video::IImage *dst, v2u32 dst_pos, v2u32 s
 	// rounded rather than trunc'd.
 	c += 0.5f;
 
-	video::SColor dst_c;
-	for (u32 y = dst_pos.Y; y < dst_pos.Y + size.Y; y++)
-	for (u32 x = dst_pos.X; x < dst_pos.X + size.X; x++) {
-		dst_c = dst->getPixel(x, y);
-
+	for_each_pixel(dst, dst_pos, size, [&] (video::SColor &dst_c) {
 		dst_c.set(
 			dst_c.getAlpha(),
 			core::clamp((int)(slope * dst_c.getRed()   + c), 0, 255),
 			core::clamp((int)(slope * dst_c.getGreen() + c), 0, 255),
 			core::clamp((int)(slope * dst_c.getBlue()  + c), 0, 255)
 		);
-		dst->setPixel(x, y, dst_c);
-	}
+	});
 }
 
 /*
 	Apply mask to destination
 */
-static void apply_mask(video::IImage *mask, video::IImage *dst,
+void apply_mask(video::IImage *mask, video::IImage *dst,
 		v2s32 mask_pos, v2s32 dst_pos, v2u32 size)
 {
-	for (u32 y0 = 0; y0 < size.Y; y0++) {
-		for (u32 x0 = 0; x0 < size.X; x0++) {
-			s32 mask_x = x0 + mask_pos.X;
-			s32 mask_y = y0 + mask_pos.Y;
-			s32 dst_x = x0 + dst_pos.X;
-			s32 dst_y = y0 + dst_pos.Y;
-			video::SColor mask_c = mask->getPixel(mask_x, mask_y);
-			video::SColor dst_c = dst->getPixel(dst_x, dst_y);
-			dst_c.color &= mask_c.color;
-			dst->setPixel(dst_x, dst_y, dst_c);
-		}
-	}
+	for_each_pixel_pair(mask, dst, mask_pos, dst_pos, size,
+			[] (video::SColor mask_c, video::SColor &dst_c) {
+		dst_c.color &= mask_c.color;
+	});
 }
 
 static video::IImage *create_crack_image(video::IImage *crack, s32 frame_index,
@@ -1114,7 +1495,7 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 				tracestream << "Adding \"" << filename << "\" to combined "
 					<< pos_base << std::endl;
 
-				video::IImage *img = generateImage(filename, source_image_names);
+				video::IImage *img = getOrGenerateImage(filename, source_image_names);
 				if (!img) {
 					errorstream << "generateImagePart(): Failed to load image \""
 						<< filename << "\" for [combine" << std::endl;
@@ -1295,9 +1676,9 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 			std::string imagename_right = sf.next("{");
 
 			// Generate images for the faces of the cube
-			video::IImage *img_top = generateImage(imagename_top, source_image_names);
-			video::IImage *img_left = generateImage(imagename_left, source_image_names);
-			video::IImage *img_right = generateImage(imagename_right, source_image_names);
+			video::IImage *img_top = getOrGenerateImage(imagename_top, source_image_names);
+			video::IImage *img_left = getOrGenerateImage(imagename_left, source_image_names);
+			video::IImage *img_right = getOrGenerateImage(imagename_right, source_image_names);
 
 			if (!img_top || !img_left || !img_right) {
 				errorstream << "generateImagePart(): Failed to create textures"
@@ -1326,7 +1707,7 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 			u32 percent = stoi(sf.next(":"), 0, 100);
 			std::string filename = unescape_string(sf.next_esc(":", escape), escape);
 
-			video::IImage *img = generateImage(filename, source_image_names);
+			video::IImage *img = getOrGenerateImage(filename, source_image_names);
 			if (img) {
 				core::dimension2d<u32> dim = img->getDimension();
 				if (!baseimg) {
@@ -1394,7 +1775,7 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 			sf.next(":");
 			std::string filename = unescape_string(sf.next_esc(":", escape), escape);
 
-			video::IImage *img = generateImage(filename, source_image_names);
+			video::IImage *img = getOrGenerateImage(filename, source_image_names);
 			if (img) {
 				upscaleImagesToMatchLargest(baseimg, img);
 
@@ -1749,7 +2130,7 @@ bool ImageSource::generateImagePart(std::string_view part_of_name,
 			sf.next(":");
 			std::string filename = unescape_string(sf.next_esc(":", escape), escape);
 
-			video::IImage *img = generateImage(filename, source_image_names);
+			video::IImage *img = getOrGenerateImage(filename, source_image_names);
 			if (img) {
 				upscaleImagesToMatchLargest(baseimg, img);
 
@@ -1803,10 +2184,57 @@ ImageSource::ImageSource() :
 		m_setting_mipmap{g_settings->getBool("mip_map")},
 		m_setting_trilinear_filter{g_settings->getBool("trilinear_filter")},
 		m_setting_bilinear_filter{g_settings->getBool("bilinear_filter")},
-		m_setting_anisotropic_filter{g_settings->getBool("anisotropic_filter")}
+		m_setting_anisotropic_filter{g_settings->getBool("anisotropic_filter")},
+		m_generatedcache(32 * 1024 * 1024),
+		m_persistentcache(porting::path_cache + DIR_DELIM + "images",
+			"filter=" + std::to_string(m_setting_trilinear_filter || m_setting_bilinear_filter) +
+			",min_size=" + std::to_string(g_settings->getU16("texture_min_size")) + ";")
 {}
 
-video::IImage* ImageSource::generateImage(std::string_view name,
+video::IImage *ImageSource::generateImage(std::string_view name,
+		std::set<std::string> &source_image_names)
+{
+	if (name.find_first_of("^[(") == std::string_view::npos)
+		return generateImageUncached(name, source_image_names);
+
+	const std::string name_s(name);
+	video::IImage *img = m_persistentcache.get(name_s, m_sourcecache,
+			source_image_names);
+	if (img)
+		return img;
+
+	// Only images that took longer to make than to read back are kept
+	std::set<std::string> tmp;
+	const u64 start = porting::getTimeUs();
+	img = generateImageUncached(name, tmp);
+	if (img && m_persistentcache.isWorthKeeping(img->getDimension(),
+			porting::getTimeUs() - start))
+		m_persistentcache.insert(name_s, img, m_sourcecache, tmp);
+	source_image_names.merge(tmp);
+	return img;
+}
+
+video::IImage *ImageSource::getOrGenerateImage(std::string_view name,
+		std::set<std::string> &source_image_names)
+{
+	// Plain source images are already cached
+	if (name.find_first_of("^[(") == std::string_view::npos)
+		return generateImageUncached(name, source_image_names);
+
+	const std::string name_s(name);
+	video::IImage *img = m_generatedcache.get(name_s, source_image_names);
+	if (img)
+		return img;
+
+	std::set<std::string> tmp;
+	img = generateImageUncached(name, tmp);
+	if (img)
+		m_generatedcache.insert(name_s, img, tmp);
+	source_image_names.merge(tmp);
+	return img;
+}
+
+video::IImage* ImageSource::generateImageUncached(std::string_view name,
 		std::set<std::string> &source_image_names)
 {
 	// Get the base image
@@ -1860,7 +2288,9 @@ video::IImage* ImageSource::generateImage(std::string_view name,
 		using a recursive call.
 	*/
 	if (last_separator_pos != -1) {
-		baseimg = generateImage(name.substr(0, last_separator_pos), source_image_names);
+		baseimg = getOrGenerateImage(name.substr(0, last_separator_pos), source_image_names);
+		if (baseimg)
+			baseimg = make_writable(baseimg);
 	}
 
 	/*
@@ -1880,7 +2310,7 @@ video::IImage* ImageSource::generateImage(std::string_view name,
 			&& last_part_of_name.back() == paren_close) {
 		auto name2 = last_part_of_name.substr(1,
 				last_part_of_name.size() - 2);
-		video::IImage *tmp = generateImage(name2, source_image_names);
+		video::IImage *tmp = getOrGenerateImage(name2, source_image_names);
 		if (!tmp) {
 			errorstream << "generateImage(): "
 				"Failed to generate \"" << name2 << "\"\n"
@@ -1894,7 +2324,7 @@ video::IImage* ImageSource::generateImage(std::string_view name,
 			blit_with_alpha(tmp, baseimg, v2s32(0, 0), dim);
 			tmp->drop();
 		} else {
-			baseimg = tmp;
+			baseimg = make_writable(tmp);
 		}
 	} else if (!generateImagePart(last_part_of_name, baseimg, source_image_names)) {
 		// Generate image according to part of name
@@ -1919,7 +2349,9 @@ video::IImage* ImageSource::generateImage(std::string_view name,
 	return baseimg;
 }
 
-void ImageSource::insertSourceImage(const std::string &name, video::IImage *img, bool prefer_local)
+void ImageSource::insertSourceImage(const std::string &name, video::IImage *img, bool prefer_local,
+		const std::string &file_hash)
 {
-	m_sourcecache.insert(name, img, prefer_local);
+	m_sourcecache.insert(name, img, prefer_local, file_hash);
+	m_generatedcache.invalidate(name);
 }
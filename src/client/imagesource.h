@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include "filecache.h"
+#include "irr_v2d.h"
 #include <IImage.h>
+#include <SColor.h>
+#include <list>
 #include <unordered_map>
 #include <set>
 #include <string>
@@ -20,14 +24,133 @@ class SourceImageCache {
 public:
 	~SourceImageCache();
 
-	void insert(const std::string &name, video::IImage *img, bool prefer_local);
+	// file_hash is a hash of the file the image was decoded from, if known
+	void insert(const std::string &name, video::IImage *img, bool prefer_local,
+			const std::string &file_hash = "");
 
 	video::IImage* get(const std::string &name);
 
 	// Primarily fetches from cache, secondarily tries to read from filesystem.
 	video::IImage *getOrLoad(const std::string &name);
+
+	// Returns a hash of the file the image was loaded from, or of the pixels
+	// if there is no such file. Empty if there is no such image.
+	// The hash is kept until the image is replaced.
+	const std::string &getContentHash(const std::string &name);
 private:
 	std::unordered_map<std::string, video::IImage*> m_images;
+	std::unordered_map<std::string, std::string> m_content_hashes;
+	// Files of the images read from the filesystem, hashed when needed
+	std::unordered_map<std::string, std::string> m_paths;
+};
+
+// A cache of images generated from texture modifiers, e.g. the common
+// "default_wood.png^[colorize:#ff0000" part of several textures.
+// Keeps the most recently used images up to a total size.
+class GeneratedImageCache {
+public:
+	GeneratedImageCache(size_t max_size) : m_max_size(max_size) {}
+	~GeneratedImageCache();
+
+	// Returns the cached image, which should be dropped, or nullptr.
+	// The image is shared with the cache and must not be modified.
+	// The names of the source images it was made from are added to source_image_names.
+	video::IImage *get(const std::string &name, std::set<std::string> &source_image_names);
+
+	// Stores the image, which must not be modified afterwards
+	void insert(const std::string &name, video::IImage *img,
+			const std::set<std::string> &source_image_names);
+
+	// Removes all images made from the named source image
+	void invalidate(const std::string &source_name);
+
+	size_t getSize() const { return m_size; }
+
+private:
+	struct Entry {
+		video::IImage *image;
+		std::set<std::string> source_image_names;
+		std::list<std::string>::iterator lru_it;
+	};
+
+	void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+	std::unordered_map<std::string, Entry> m_images;
+	// names, most recently used first
+	std::list<std::string> m_lru;
+	// size of all images in bytes
+	size_t m_size = 0;
+	size_t m_max_size;
+};
+
+// Keeps generated images on disk, so that they can be reused in the next
+// session. Each file lists the source images that were used along with the
+// hashes of their files, an image is only returned if none of them has
+// changed since.
+// An index of the files and when they were last used is kept, files that
+// have not been used for max_age seconds and the least recently used ones
+// beyond max_size bytes are deleted. Files missing from the index are never
+// deleted, the directory may be shared with other clients.
+class PersistentImageCache {
+public:
+	// settings_key must describe all settings that affect image generation
+	PersistentImageCache(const std::string &dir, const std::string &settings_key,
+			size_t max_size = 64 * 1024 * 1024, u64 max_age = 30 * 24 * 3600);
+	// Writes the index
+	virtual ~PersistentImageCache();
+
+	// Returns the cached image, which should be dropped, or nullptr.
+	// The names of the source images it was made from are added to source_image_names.
+	video::IImage *get(const std::string &name, SourceImageCache &sources,
+			std::set<std::string> &source_image_names);
+
+	// Writes the image to disk
+	void insert(const std::string &name, video::IImage *img,
+			SourceImageCache &sources, const std::set<std::string> &source_image_names);
+
+	// Whether get() is expected to be faster than making the image again,
+	// which took generation_us microseconds
+	static bool isWorthKeeping(core::dimension2du dim, u64 generation_us);
+
+	// Size of all files in bytes
+	size_t getSize() const { return m_size; }
+
+	static constexpr const char *INDEX_FILE = "index.txt";
+
+protected:
+	std::string getFileName(const std::string &name) const;
+
+	// Creates an ECF_A8R8G8B8 image using the video driver
+	virtual video::IImage *createImage(core::dimension2du dim);
+
+private:
+	struct IndexEntry {
+		size_t size;
+		// seconds since the epoch
+		u64 last_used;
+	};
+
+	void readIndex(std::unordered_map<std::string, IndexEntry> &index);
+	void loadIndex();
+	// Merges the index on disk, which other clients may have changed
+	void saveIndex();
+	// Deletes outdated files, and the least recently used ones until at most
+	// target_size bytes are left. The file keep is never deleted.
+	void evict(size_t target_size, const std::string &keep = "");
+	void remove(const std::string &file_name);
+
+	FileCache m_files;
+	std::string m_dir;
+	std::string m_settings_key;
+	size_t m_max_size;
+	u64 m_max_age;
+
+	// by file name
+	std::unordered_map<std::string, IndexEntry> m_index;
+	// files deleted in this session
+	std::set<std::string> m_removed;
+	size_t m_size = 0;
+	bool m_index_changed = false;
 };
 
 // Generates images using texture modifiers, and caches source images.
@@ -38,11 +161,14 @@ struct ImageSource {
 	 * "stone.png^mineral_coal.png^[crack:1:0".
 	 * The returned Image should be dropped.
 	 * source_image_names is important to determine when to flush the image from a cache (dynamic media)
+	 * Images that are slow to make are kept on disk for the next session.
 	 */
 	video::IImage* generateImage(std::string_view name, std::set<std::string> &source_image_names);
 
 	// Insert a source image into the cache without touching the filesystem.
-	void insertSourceImage(const std::string &name, video::IImage *img, bool prefer_local);
+	// file_hash is a hash of the file it was decoded from, if known.
+	void insertSourceImage(const std::string &name, video::IImage *img, bool prefer_local,
+			const std::string &file_hash = "");
 
 	// This was picked so that the image buffer size fits in an s32 (assuming 32bpp).
 	// The exact value is 23170 but this provides some leeway.
@@ -54,6 +180,17 @@ struct ImageSource {
 
 private:
 
+	// Same as generateImage, without m_persistentcache
+	video::IImage *generateImageUncached(std::string_view name,
+			std::set<std::string> &source_image_names);
+
+	// Same as generateImageUncached, but takes the image from m_generatedcache if
+	// possible. Used for the parts of a name.
+	// The returned image may be shared with the cache, so it must be copied
+	// before it is modified.
+	video::IImage *getOrGenerateImage(std::string_view name,
+			std::set<std::string> &source_image_names);
+
 	// Generate image based on a string like "stone.png" or "[crack:1:0".
 	// If baseimg is NULL, it is created. Otherwise stuff is made on it.
 	// source_image_names is important to determine when to flush the image from a cache (dynamic media).
@@ -68,4 +205,55 @@ struct ImageSource {
 
 	// Cache of source images
 	SourceImageCache m_sourcecache;
+	// Cache of images generated for the parts of names
+	GeneratedImageCache m_generatedcache;
+	// Cache of images that are slow to make, kept between sessions
+	PersistentImageCache m_persistentcache;
 };
+
+// Texture modifiers used by ImageSource, operating in-place on the part of
+// dst given by dst_pos and size.
+
+// Apply a color to an image.  Uses an int (0-255) to calculate the ratio.
+// If the ratio is 255 or -1 and keep_alpha is true, then it multiples the
+// color alpha with the destination alpha.
+// Otherwise, any pixels that are not fully transparent get the color alpha.
+void apply_colorize(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		const video::SColor color, int ratio, bool keep_alpha);
+
+// paint a texture using the given color
+void apply_multiplication(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		const video::SColor color);
+
+// Perform a Screen blend with the given color. The opposite effect of a
+// Multiply blend.
+void apply_screen(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		const video::SColor color);
+
+// Adjust the hue, saturation, and lightness of destination. Like
+// "Hue-Saturation" in GIMP.
+// If colorize is true then the image will be converted to a grayscale
+// image as though seen through a colored glass, like "Colorize" in GIMP.
+void apply_hue_saturation(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		s32 hue, s32 saturation, s32 lightness, bool colorize);
+
+// Apply an overlay blend to an images.
+// Overlay blend combines Multiply and Screen blend modes.The parts of the top
+// layer where the base layer is light become lighter, the parts where the base
+// layer is dark become darker.Areas where the base layer are mid grey are
+// unaffected.An overlay with the same picture looks like an S - curve.
+// The result is always written to dst at dst_pos, also for a hardlight blend
+// (which swaps the layers, not the positions). Areas outside of either image
+// are skipped.
+void apply_overlay(video::IImage *overlay, video::IImage *dst,
+		v2s32 overlay_pos, v2s32 dst_pos, v2u32 size, bool hardlight);
+
+// Adjust the brightness and contrast of the base image. Conceptually like
+// "Brightness-Contrast" in GIMP but allowing brightness to be wound all the
+// way up to white or down to black.
+void apply_brightness_contrast(video::IImage *dst, v2u32 dst_pos, v2u32 size,
+		s32 brightness, s32 contrast);
+
+// Apply a mask to an image. Areas outside of either image are skipped.
+void apply_mask(video::IImage *mask, video::IImage *dst,
+		v2s32 mask_pos, v2s32 dst_pos, v2u32 size);
@@ -0,0 +1,363 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "lod_terrain.h"
+#include "client/mesh.h"
+#include "client/node_visuals.h"
+#include "nodedef.h"
+#include "voxel.h"
+#include "util/numeric.h"
+#include <algorithm>
+#include <cmath>
+
+/*
+	LodSummary
+*/
+
+bool LodSummary::isEmpty() const
+{
+	return std::all_of(std::begin(height), std::end(height),
+			[] (u16 h) { return h == 0; });
+}
+
+void LodSummary::fromVManip(const VoxelManipulator *vmanip,
+		const NodeDefManager *ndef, v3s16 pos)
+{
+	// Same surface criterion as the minimap
+	for (s16 z = 0; z < SIZE; z++)
+	for (s16 x = 0; x < SIZE; x++) {
+		const u16 i = index(x, z);
+		height[i] = 0;
+		for (s16 y = SIZE - 1; y >= 0; y--) {
+			MapNode n = vmanip->getNodeNoExNoEmerge(pos + v3s16(x, y, z));
+			if (n.getContent() == CONTENT_IGNORE)
+				continue;
+			const ContentFeatures &f = ndef->get(n);
+			if (f.drawtype == NDT_AIRLIKE)
+				continue;
+			height[i] = y + 1;
+			color[i] = f.visuals->minimap_color;
+			break;
+		}
+	}
+}
+
+void LodSummary::merge(const LodSummary *const children[8], u8 child_level)
+{
+	const u16 child_height = SIZE << child_level;
+
+	for (u16 z = 0; z < SIZE; z++)
+	for (u16 x = 0; x < SIZE; x++) {
+		const u16 i = index(x, z);
+		height[i] = 0;
+		// Each column covers 2x2 child columns, use the highest one
+		for (u16 dz = 0; dz < 2; dz++)
+		for (u16 dx = 0; dx < 2; dx++) {
+			const u16 cx = 2 * x + dx, cz = 2 * z + dz;
+			const u16 ci = index(cx % SIZE, cz % SIZE);
+			for (int cy = 1; cy >= 0; cy--) {
+				const LodSummary *child = children[cx / SIZE + 2 * cy + 4 * (cz / SIZE)];
+				if (!child || child->height[ci] == 0)
+					continue;
+				const u16 h = cy * child_height + child->height[ci];
+				if (h > height[i]) {
+					height[i] = h;
+					color[i] = child->color[ci];
+				}
+				break;
+			}
+		}
+	}
+}
+
+/*
+	Mesh building
+*/
+
+// Vertex order matches the cuboids of MapblockMeshGenerator
+enum LodFace { LOD_TOP, LOD_RIGHT, LOD_LEFT, LOD_BACK, LOD_FRONT };
+
+static void addBoxFace(scene::SMeshBuffer *buf, const aabb3f &box, LodFace face,
+		video::SColor color)
+{
+	const v3f &a = box.MinEdge, &b = box.MaxEdge;
+	v3f pos[4];
+	v3f normal;
+	switch (face) {
+	case LOD_TOP:
+		pos[0] = v3f(a.X, b.Y, b.Z); pos[1] = v3f(b.X, b.Y, b.Z);
+		pos[2] = v3f(b.X, b.Y, a.Z); pos[3] = v3f(a.X, b.Y, a.Z);
+		normal = v3f(0, 1, 0);
+		break;
+	case LOD_RIGHT:
+		pos[0] = v3f(b.X, b.Y, a.Z); pos[1] = v3f(b.X, b.Y, b.Z);
+		pos[2] = v3f(b.X, a.Y, b.Z); pos[3] = v3f(b.X, a.Y, a.Z);
+		normal = v3f(1, 0, 0);
+		break;
+	case LOD_LEFT:
+		pos[0] = v3f(a.X, b.Y, b.Z); pos[1] = v3f(a.X, b.Y, a.Z);
+		pos[2] = v3f(a.X, a.Y, a.Z); pos[3] = v3f(a.X, a.Y, b.Z);
+		normal = v3f(-1, 0, 0);
+		break;
+	case LOD_BACK:
+		pos[0] = v3f(b.X, b.Y, b.Z); pos[1] = v3f(a.X, b.Y, b.Z);
+		pos[2] = v3f(a.X, a.Y, b.Z); pos[3] = v3f(b.X, a.Y, b.Z);
+		normal = v3f(0, 0, 1);
+		break;
+	case LOD_FRONT:
+		pos[0] = v3f(a.X, b.Y, a.Z); pos[1] = v3f(b.X, b.Y, a.Z);
+		pos[2] = v3f(b.X, a.Y, a.Z); pos[3] = v3f(a.X, a.Y, a.Z);
+		normal = v3f(0, 0, -1);
+		break;
+	}
+
+	applyFacesShading(color, normal);
+
+	const u16 base = buf->getVertexCount();
+	for (int j = 0; j < 4; j++)
+		buf->Vertices->Data.emplace_back(pos[j], normal, color, v2f(0, 0));
+	for (u16 k : {0, 1, 2, 2, 3, 0})
+		buf->Indices->Data.push_back(base + k);
+}
+
+void buildLodMesh(const LodSummary &summary, u8 level, scene::SMeshBuffer *buf)
+{
+	constexpr u16 SIZE = LodSummary::SIZE;
+	const f32 column_width = (1 << level) * BS;
+	// vertex positions are relative to the center of the first node
+	const f32 base = -0.5f * BS;
+
+	auto height_at = [&] (s16 x, s16 z) -> u16 {
+		// Cell borders are closed down to the cell bottom so that no gaps
+		// appear next to cells of another level
+		if (x < 0 || z < 0 || x >= SIZE || z >= SIZE)
+			return 0;
+		return summary.height[LodSummary::index(x, z)];
+	};
+
+	for (s16 z = 0; z < SIZE; z++)
+	for (s16 x = 0; x < SIZE; x++) {
+		const u16 h = height_at(x, z);
+		if (h == 0)
+			continue;
+		const video::SColor color = summary.color[LodSummary::index(x, z)];
+		const f32 top = base + h * BS;
+		aabb3f box(base + x * column_width, base, base + z * column_width,
+				base + (x + 1) * column_width, top, base + (z + 1) * column_width);
+		addBoxFace(buf, box, LOD_TOP, color);
+
+		// Walls where the neighbor column is lower
+		const struct { s16 dx, dz; LodFace face; } sides[] = {
+			{1, 0, LOD_RIGHT}, {-1, 0, LOD_LEFT}, {0, 1, LOD_BACK}, {0, -1, LOD_FRONT},
+		};
+		for (auto &side : sides) {
+			const u16 nh = height_at(x + side.dx, z + side.dz);
+			if (nh >= h)
+				continue;
+			aabb3f wall = box;
+			wall.MinEdge.Y = base + nh * BS;
+			addBoxFace(buf, wall, side.face, color);
+		}
+	}
+
+	buf->recalculateBoundingBox();
+}
+
+/*
+	LodTerrain
+*/
+
+void LodTerrain::addBlock(v3s16 blockpos, std::unique_ptr<LodSummary> summary)
+{
+	if (!summary || summary->isEmpty()) {
+		if (m_blocks.erase(blockpos) == 0)
+			return; // was already empty
+	} else {
+		m_blocks[blockpos] = std::move(summary);
+	}
+	invalidateParents(blockpos);
+}
+
+void LodTerrain::invalidateParents(v3s16 blockpos)
+{
+	for (u8 level = 0; level <= MAX_LEVEL; level++) {
+		// creates cells as needed, so m_cells has an entry for every
+		// cell that has (or had) some content
+		Cell &cell = m_cells[{getContainerPos(blockpos, 1 << level), level}];
+		cell.summary_valid = false;
+		cell.mesh_valid = false;
+	}
+}
+
+u8 LodTerrain::selectLevel(f32 distance, f32 full_range)
+{
+	if (distance < full_range || full_range <= 0)
+		return 0;
+	// every level covers twice the distance of the previous one
+	int level = 1 + (int)std::floor(std::log2(distance / full_range));
+	return rangelim(level, 1, MAX_LEVEL);
+}
+
+const LodSummary *LodTerrain::getSummary(const LodCellKey &key)
+{
+	if (key.level == 0) {
+		auto it = m_blocks.find(key.pos);
+		return it == m_blocks.end() ? nullptr : it->second.get();
+	}
+
+	auto it = m_cells.find(key);
+	if (it == m_cells.end())
+		return nullptr;
+	Cell &cell = it->second;
+	if (cell.summary_valid)
+		return cell.summary.get();
+
+	const LodSummary *children[8];
+	bool any = false;
+	for (int i = 0; i < 8; i++) {
+		v3s16 child_pos = key.pos * 2 + v3s16(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+		children[i] = getSummary({child_pos, (u8)(key.level - 1)});
+		any |= children[i] != nullptr;
+	}
+	// note: getSummary() may have inserted into m_cells, but references
+	// into an unordered_map stay valid
+	if (any) {
+		if (!cell.summary)
+			cell.summary = std::make_unique<LodSummary>();
+		cell.summary->merge(children, key.level - 1);
+	} else {
+		cell.summary.reset();
+	}
+	cell.summary_valid = true;
+	return cell.summary.get();
+}
+
+scene::SMeshBuffer *LodTerrain::getMesh(const LodCellKey &key)
+{
+	auto it = m_cells.find(key);
+	if (it == m_cells.end())
+		return nullptr;
+	Cell &cell = it->second;
+	if (!cell.mesh_valid) {
+		const LodSummary *summary = getSummary(key);
+		cell.mesh.reset();
+		if (summary) {
+			cell.mesh = make_irr<scene::SMeshBuffer>();
+			buildLodMesh(*summary, key.level, cell.mesh.get());
+			cell.mesh->setHardwareMappingHint(scene::EHM_STATIC);
+		}
+		cell.mesh_valid = true;
+		m_mesh_builds++;
+	}
+	return cell.mesh.get();
+}
+
+scene::SMeshBuffer *LodTerrain::getCachedMesh(const LodCellKey &key) const
+{
+	auto it = m_cells.find(key);
+	return it == m_cells.end() ? nullptr : it->second.mesh.get();
+}
+
+f32 LodTerrain::getTopCellDistance(v3f pos, v3s16 blockpos)
+{
+	const s16 top_blocks = 1 << MAX_LEVEL;
+	v3f cell_min = intToFloat(getContainerPos(blockpos, top_blocks) *
+			(top_blocks * MAP_BLOCKSIZE), 1) - 0.5f;
+	aabb3f box(cell_min, cell_min + top_blocks * MAP_BLOCKSIZE);
+	v3f nearest(
+		rangelim(pos.X, box.MinEdge.X, box.MaxEdge.X),
+		rangelim(pos.Y, box.MinEdge.Y, box.MaxEdge.Y),
+		rangelim(pos.Z, box.MinEdge.Z, box.MaxEdge.Z));
+	return nearest.getDistanceFrom(pos);
+}
+
+size_t LodTerrain::evict(v3f camera_pos, f32 keep_range)
+{
+	// Whole top level cells are dropped at once, so the merged summaries
+	// of the remaining cells never miss any of their blocks
+	size_t removed = 0;
+	for (auto it = m_blocks.begin(); it != m_blocks.end();) {
+		if (getTopCellDistance(camera_pos, it->first) > keep_range) {
+			it = m_blocks.erase(it);
+			removed++;
+		} else {
+			++it;
+		}
+	}
+	for (auto it = m_cells.begin(); it != m_cells.end();) {
+		if (getTopCellDistance(camera_pos, it->first.getBlockPos()) > keep_range)
+			it = m_cells.erase(it);
+		else
+			++it;
+	}
+	return removed;
+}
+
+bool LodTerrain::select(v3f camera_pos, f32 full_range, f32 lod_range,
+		std::vector<LodCellKey> &out, u32 max_builds)
+{
+	const s16 top_size = MAP_BLOCKSIZE << MAX_LEVEL;
+	auto to_cell = [&] (f32 p) {
+		return getContainerPos((s16)rangelim(std::floor(p), -S16_MAX, S16_MAX), top_size);
+	};
+	v3s16 pmin(to_cell(camera_pos.X - lod_range), to_cell(camera_pos.Y - lod_range),
+			to_cell(camera_pos.Z - lod_range));
+	v3s16 pmax(to_cell(camera_pos.X + lod_range), to_cell(camera_pos.Y + lod_range),
+			to_cell(camera_pos.Z + lod_range));
+
+	SelectState state{camera_pos, full_range, lod_range, max_builds, true};
+	v3s16 p;
+	for (p.Z = pmin.Z; p.Z <= pmax.Z; p.Z++)
+	for (p.Y = pmin.Y; p.Y <= pmax.Y; p.Y++)
+	for (p.X = pmin.X; p.X <= pmax.X; p.X++)
+		selectRecursive({p, MAX_LEVEL}, state, out);
+	return state.complete;
+}
+
+void LodTerrain::selectRecursive(const LodCellKey &key, SelectState &state,
+		std::vector<LodCellKey> &out)
+{
+	auto it = m_cells.find(key);
+	if (it == m_cells.end())
+		return; // nothing here
+
+	// distance from the camera to the cell, in nodes
+	const f32 size = MAP_BLOCKSIZE << key.level;
+	v3f cell_min = intToFloat(key.getBlockPos() * MAP_BLOCKSIZE, 1) - 0.5f;
+	aabb3f box(cell_min, cell_min + size);
+	v3f nearest(
+		rangelim(state.camera_pos.X, box.MinEdge.X, box.MaxEdge.X),
+		rangelim(state.camera_pos.Y, box.MinEdge.Y, box.MaxEdge.Y),
+		rangelim(state.camera_pos.Z, box.MinEdge.Z, box.MaxEdge.Z));
+	const f32 distance = nearest.getDistanceFrom(state.camera_pos);
+	if (distance > state.lod_range)
+		return;
+
+	const u8 wanted = selectLevel(distance, state.full_range);
+	if (wanted < key.level) {
+		for (int i = 0; i < 8; i++) {
+			v3s16 child_pos = key.pos * 2 + v3s16(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+			selectRecursive({child_pos, (u8)(key.level - 1)}, state, out);
+		}
+		return;
+	}
+	// full detail meshes are drawn by ClientMap
+	if (wanted == 0)
+		return;
+
+	Cell &cell = it->second;
+	if (!cell.mesh_valid) {
+		if (state.builds_left == 0) {
+			state.complete = false;
+			// draw the outdated mesh for now, if any
+			if (cell.mesh)
+				out.push_back(key);
+			return;
+		}
+		state.builds_left--;
+	}
+	scene::SMeshBuffer *mesh = getMesh(key);
+	if (mesh && mesh->getIndexCount() > 0)
+		out.push_back(key);
+}
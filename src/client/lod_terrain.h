@@ -0,0 +1,174 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include "irrlichttypes_bloated.h"
+#include "irr_ptr.h"
+#include "constants.h"
+#include "util/basic_macros.h"
+#include <CMeshBuffer.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class NodeDefManager;
+class VoxelManipulator;
+
+/*
+	Distant terrain level of detail
+
+	A LOD cell of level L covers 2^L x 2^L x 2^L mapblocks. Its contents are
+	summarized as a heightfield of MAP_BLOCKSIZE x MAP_BLOCKSIZE columns,
+	so a column at level L is 2^L nodes wide. Level 0 summaries are made
+	from mapblocks by the mesh generation threads, higher levels are
+	merged from their 8 children on demand.
+*/
+
+struct LodSummary
+{
+	static constexpr u16 SIZE = MAP_BLOCKSIZE;
+
+	// Height of the column surface above the cell bottom, in nodes.
+	// 0 means there is nothing in the column.
+	u16 height[SIZE * SIZE] = {};
+	// Color of the topmost node in the column
+	video::SColor color[SIZE * SIZE];
+
+	static u16 index(u16 x, u16 z) { return z * SIZE + x; }
+
+	bool isEmpty() const;
+
+	/// Summarize the mapblock at (node) position pos
+	void fromVManip(const VoxelManipulator *vmanip, const NodeDefManager *ndef,
+			v3s16 pos);
+
+	/**
+	 * Merge the summaries of 2x2x2 cells of level child_level.
+	 * @param children indexed by x + 2 * y + 4 * z, may contain nullptr
+	 *     for empty cells
+	 */
+	void merge(const LodSummary *const children[8], u8 child_level);
+};
+
+/**
+ * Build the mesh of a LOD cell
+ * @param summary summary of the cell
+ * @param level LOD level of the cell
+ * @param buf output, vertex positions are relative to the cell origin
+ */
+void buildLodMesh(const LodSummary &summary, u8 level, scene::SMeshBuffer *buf);
+
+struct LodCellKey
+{
+	v3s16 pos; // in units of the cell size
+	u8 level;
+
+	bool operator==(const LodCellKey &other) const
+	{
+		return pos == other.pos && level == other.level;
+	}
+
+	/// @return position of the cell origin in mapblocks
+	v3s16 getBlockPos() const { return pos * (1 << level); }
+};
+
+template<>
+struct std::hash<LodCellKey>
+{
+	std::size_t operator()(const LodCellKey &k) const noexcept
+	{
+		return std::hash<v3s16>()(k.pos) ^ ((std::size_t)k.level << 48);
+	}
+};
+
+/*
+	Cache of LOD summaries and meshes
+*/
+class LodTerrain
+{
+public:
+	static constexpr u8 MAX_LEVEL = 5;
+
+	LodTerrain() = default;
+	DISABLE_CLASS_COPY(LodTerrain)
+
+	/**
+	 * Add or replace the summary of a mapblock
+	 * @param summary nullptr if the block is empty
+	 */
+	void addBlock(v3s16 blockpos, std::unique_ptr<LodSummary> summary);
+
+	/**
+	 * @param distance distance of the cell to the camera, in nodes
+	 * @param full_range distance up to which full detail meshes are drawn
+	 * @return level of detail that should be used, 0 meaning full detail
+	 */
+	static u8 selectLevel(f32 distance, f32 full_range);
+
+	/**
+	 * Find the cells to draw in a LOD range around the camera
+	 * @param camera_pos in nodes
+	 * @param full_range distance up to which full detail meshes are drawn
+	 * @param lod_range maximum drawing distance of LOD meshes
+	 * @param out list of cells that have something to draw
+	 * @param max_builds maximum number of meshes to (re)build
+	 * @return false if some meshes were not built due to max_builds
+	 */
+	bool select(v3f camera_pos, f32 full_range, f32 lod_range,
+			std::vector<LodCellKey> &out, u32 max_builds = U32_MAX);
+
+	/**
+	 * Get the mesh of a cell, (re)building it if needed.
+	 * @return nullptr if there is nothing to draw
+	 */
+	scene::SMeshBuffer *getMesh(const LodCellKey &key);
+
+	/// @return the last built mesh of a cell, which may be outdated
+	scene::SMeshBuffer *getCachedMesh(const LodCellKey &key) const;
+
+	/// @return the summary of a cell or nullptr if empty
+	const LodSummary *getSummary(const LodCellKey &key);
+
+	/**
+	 * Forget everything about the top level cells that are further away
+	 * than keep_range, so that the cache does not grow without bounds.
+	 * @param camera_pos in nodes
+	 * @return number of level 0 summaries removed
+	 */
+	size_t evict(v3f camera_pos, f32 keep_range);
+
+	size_t getBlockCount() const { return m_blocks.size(); }
+
+	/// number of meshes built since construction
+	u32 getMeshBuildCount() const { return m_mesh_builds; }
+
+private:
+	struct Cell {
+		std::unique_ptr<LodSummary> summary;
+		irr_ptr<scene::SMeshBuffer> mesh;
+		bool summary_valid = false;
+		bool mesh_valid = false;
+	};
+
+	struct SelectState {
+		v3f camera_pos;
+		f32 full_range;
+		f32 lod_range;
+		u32 builds_left;
+		bool complete;
+	};
+
+	void selectRecursive(const LodCellKey &key, SelectState &state,
+			std::vector<LodCellKey> &out);
+	void invalidateParents(v3s16 blockpos);
+	/// @return distance from pos (in nodes) to the top level cell of blockpos
+	static f32 getTopCellDistance(v3f pos, v3s16 blockpos);
+
+	// level 0 summaries, owned
+	std::unordered_map<v3s16, std::unique_ptr<LodSummary>> m_blocks;
+	// meshes of all levels and merged summaries of levels > 0
+	std::unordered_map<LodCellKey, Cell> m_cells;
+	u32 m_mesh_builds = 0;
+};
@@ -11,9 +11,11 @@
 #include "shader.h"
 #include "mesh.h"
 #include "minimap.h"
+#include "lod_terrain.h"
 #include "content_mapblock.h"
 #include "util/tracy_wrapper.h"
 #include "client/meshgen/collector.h"
+#include "client/meshgen/geometry_cache.h"
 #include "client/renderingengine.h"
 #include <array>
 #include <algorithm>
@@ -661,17 +663,48 @@ MapBlockMesh::MapBlockMesh(Client *client, MeshMakeData *data):
 			}
 		}
 	}
+	if (mesh_grid.isMeshPos(bp) && data->m_generate_lod) {
+		m_lod_summaries.resize(mesh_grid.getCellVolume());
+		v3s16 ofs;
+
+		// Same layout as the minimap mapblocks
+		for (ofs.Z = 0; ofs.Z < mesh_grid.cell_size; ofs.Z++)
+		for (ofs.Y = 0; ofs.Y < mesh_grid.cell_size; ofs.Y++)
+		for (ofs.X = 0; ofs.X < mesh_grid.cell_size; ofs.X++) {
+			v3s16 p = (bp + ofs) * MAP_BLOCKSIZE;
+			if (data->m_vmanip.getNodeNoEx(p).getContent() != CONTENT_IGNORE) {
+				auto summary = std::make_unique<LodSummary>();
+				summary->fromVManip(&data->m_vmanip, data->m_nodedef, p);
+				m_lod_summaries[mesh_grid.getOffsetIndex(ofs)] = std::move(summary);
+			}
+		}
+	}
 
 	// algin vertices to mesh grid, not meshgen area
 	v3f offset = intToFloat((data->m_blockpos - mesh_grid.getMeshPos(data->m_blockpos)) * MAP_BLOCKSIZE, BS);
 
 	MeshCollector collector(m_bounding_sphere_center, offset);
 
+	std::shared_ptr<MeshGeometryCache> geometry;
+	if (data->m_keep_geometry) {
+		geometry = std::make_shared<MeshGeometryCache>(data);
+		// merged faces don't belong to a single node
+		if (data->m_greedy_meshing)
+			geometry->disableNodeRanges();
+		else
+			collector.node_ranges = &geometry->node_ranges;
+	}
+
 	{
 		// Generate everything
 		MapblockMeshGenerator(data, &collector).generate();
 	}
 
+	if (geometry) {
+		geometry->prebuffers = collector.prebuffers;
+		m_geometry_cache = std::move(geometry);
+	}
+
 	/*
 		Convert MeshCollector to SMesh
 	*/
@@ -770,6 +803,13 @@ MapBlockMesh::~MapBlockMesh()
 	porting::TrackFreedMemory(sz);
 }
 
+std::vector<std::unique_ptr<LodSummary>> MapBlockMesh::moveLodSummaries()
+{
+	std::vector<std::unique_ptr<LodSummary>> lod_summaries;
+	lod_summaries.swap(m_lod_summaries);
+	return lod_summaries;
+}
+
 bool MapBlockMesh::animate(bool faraway, float time, int crack,
 	u32 daynight_ratio)
 {
@@ -13,6 +13,7 @@
 #include "client/tile.h"
 #include "voxel.h"
 #include <map>
+#include <memory>
 
 namespace video {
 	class IVideoDriver;
@@ -29,6 +30,8 @@ class ITextureSource;
 
 
 struct MinimapMapblock;
+struct LodSummary;
+class MeshGeometryCache;
 
 struct MeshMakeData
 {
@@ -46,8 +49,17 @@ struct MeshMakeData
 	// relative to blockpos
 	v3s16 m_crack_pos_relative = v3s16(-1337,-1337,-1337);
 	bool m_generate_minimap = false;
+	bool m_generate_lod = false;
 	bool m_smooth_lighting = false;
 	bool m_enable_water_reflections = false;
+	bool m_greedy_meshing = false;
+
+	// Geometry of the previous mesh. If set, only nodes marked in
+	// m_regenerate are generated, the others are copied.
+	std::shared_ptr<const MeshGeometryCache> m_previous_geometry;
+	std::vector<bool> m_regenerate;
+	// Keep the geometry in the mesh for the next update
+	bool m_keep_geometry = false;
 
 	const NodeDefManager *m_nodedef;
 
@@ -208,6 +220,16 @@ class MapBlockMesh
 		return minimap_mapblocks;
 	}
 
+	/// @return distant terrain summaries, indexed like the minimap mapblocks.
+	/// nullptr entries stand for blocks that were not loaded.
+	std::vector<std::unique_ptr<LodSummary>> moveLodSummaries();
+
+	/// @return geometry kept for the next update, may be nullptr
+	std::shared_ptr<const MeshGeometryCache> getGeometryCache() const
+	{
+		return m_geometry_cache;
+	}
+
 	/// @return true if the mesh contains nothing to draw
 	bool isEmpty() const
 	{
@@ -279,6 +301,8 @@ class MapBlockMesh
 
 	irr_ptr<scene::IMesh> m_mesh[MAX_TILE_LAYERS];
 	std::vector<MinimapMapblock*> m_minimap_mapblocks;
+	std::vector<std::unique_ptr<LodSummary>> m_lod_summaries;
+	std::shared_ptr<const MeshGeometryCache> m_geometry_cache;
 	ITextureSource *m_tsrc;
 	IShaderSource *m_shdrsrc;
 
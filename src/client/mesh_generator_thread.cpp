@@ -8,6 +8,7 @@
 #include "client.h"
 #include "mapblock.h"
 #include "mapblock_mesh.h"
+#include "client/meshgen/geometry_cache.h"
 #include "map.h"
 #include "util/directiontables.h"
 #include "porting.h"
@@ -91,13 +92,24 @@ MeshUpdateQueue::MeshUpdateQueue(Client *client):
 {
 	m_cache_smooth_lighting = g_settings->getBool("smooth_lighting");
 	m_cache_enable_water_reflections = g_settings->getBool("enable_water_reflections");
+	m_cache_greedy_meshing = g_settings->getBool("greedy_meshing");
+	m_cache_generate_lod = g_settings->getU16("lod_range") > 0;
+	g_settings->registerChangedCallback("lod_range", onLodRangeChanged, this);
 }
 
 MeshUpdateQueue::~MeshUpdateQueue()
 {
+	g_settings->deregisterAllChangedCallbacks(this);
 	clear(true);
 }
 
+void MeshUpdateQueue::onLodRangeChanged(const std::string &name, void *data)
+{
+	// Blocks meshed from now on get summaries, or stop getting them
+	static_cast<MeshUpdateQueue *>(data)->m_cache_generate_lod =
+			g_settings->getU16("lod_range") > 0;
+}
+
 bool MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
 	bool urgent, bool from_neighbor)
 {
@@ -130,6 +142,7 @@ bool MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
 			q->crack_level = m_client->getCrackLevel();
 			q->crack_pos = m_client->getCrackPos();
 			q->urgent |= urgent;
+			q->previous_geometry = getGeometryCache(map, mesh_position);
 			q->retrieveBlocks(map, mesh_grid.cell_size);
 			return true;
 		}
@@ -145,6 +158,7 @@ bool MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
 	q->crack_level = m_client->getCrackLevel();
 	q->crack_pos = m_client->getCrackPos();
 	q->urgent = urgent;
+	q->previous_geometry = getGeometryCache(map, mesh_position);
 	q->retrieveBlocks(map, mesh_grid.cell_size);
 
 	/*
@@ -155,7 +169,7 @@ bool MeshUpdateQueue::addBlock(Map *map, v3s16 p, bool ack_block_to_server,
 	if (from_neighbor && q->checkSkip(mesh_grid.cell_size)) {
 		assert(!ack_block_to_server);
 		m_urgents.erase(mesh_position);
-		g_profiler->add("MeshUpdateQueue: updates skipped", 1);
+		g_profiler->add(PROFILER_METRIC("MeshUpdateQueue: updates skipped"), 1);
 		return true;
 	}
 
@@ -239,6 +253,34 @@ void MeshUpdateQueue::fillDataFromMapBlocks(QueuedMeshUpdate *q)
 	data->m_generate_minimap = !!m_client->getMinimap();
 	data->m_smooth_lighting = m_cache_smooth_lighting;
 	data->m_enable_water_reflections = m_cache_enable_water_reflections;
+	data->m_greedy_meshing = m_cache_greedy_meshing;
+	data->m_generate_lod = m_cache_generate_lod;
+
+	/*
+		Only generate the nodes that changed since the current mesh,
+		or nothing at all if they are the same.
+	*/
+	if (q->previous_geometry) {
+		u32 changed = q->previous_geometry->findChangedNodes(data, data->m_regenerate);
+		if (changed == 0) {
+			q->unchanged = true;
+		} else if (changed != U32_MAX) {
+			g_profiler->avg(PROFILER_METRIC("MeshUpdateQueue: nodes regenerated [#]"),
+					changed);
+			data->m_previous_geometry = q->previous_geometry;
+		}
+	}
+	// Blocks that are being edited will likely be updated again soon
+	data->m_keep_geometry = q->urgent;
+}
+
+std::shared_ptr<const MeshGeometryCache> MeshUpdateQueue::getGeometryCache(
+		Map *map, v3s16 mesh_position)
+{
+	MapBlock *block = map->getBlockNoCreateNoEx(mesh_position);
+	if (!block || !block->mesh)
+		return nullptr;
+	return block->mesh->getGeometryCache();
 }
 
 /*
@@ -256,14 +298,18 @@ void MeshUpdateWorkerThread::doUpdate()
 {
 	QueuedMeshUpdate *q;
 	while ((q = m_queue_in->pop())) {
-		ScopeProfiler sp(g_profiler, "Client: Mesh making (sum)");
-
-		// This generates the mesh:
-		MapBlockMesh *mesh_new = new MapBlockMesh(m_client, q->data);
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("Client: Mesh making (sum)", PRECISION_MILLI));
 
 		MeshUpdateResult r;
 		r.p = q->p;
-		r.mesh = mesh_new;
+		if (q->unchanged) {
+			r.unchanged_geometry = q->previous_geometry;
+			g_profiler->add(PROFILER_METRIC("MeshUpdateQueue: unchanged meshes"), 1);
+		} else {
+			// This generates the mesh:
+			r.mesh = new MapBlockMesh(m_client, q->data);
+		}
 		r.solid_sides = get_solid_sides(q->data);
 		r.ack_list = std::move(q->ack_list);
 		r.urgent = q->urgent;
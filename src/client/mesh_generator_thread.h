@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <ctime>
 #include <mutex>
 #include <unordered_set>
@@ -18,6 +19,7 @@ class MapBlock;
 class MapBlockMesh;
 struct MeshMakeData;
 class Client;
+class MeshGeometryCache;
 
 struct QueuedMeshUpdate
 {
@@ -28,6 +30,9 @@ struct QueuedMeshUpdate
 	MeshMakeData *data = nullptr; // This is generated in MeshUpdateQueue::pop()
 	std::vector<MapBlock*> map_blocks;
 	bool urgent = false;
+	// geometry of the current mesh, to be diffed against
+	std::shared_ptr<const MeshGeometryCache> previous_geometry;
+	bool unchanged = false; // set in MeshUpdateQueue::pop()
 
 	QueuedMeshUpdate() = default;
 	~QueuedMeshUpdate();
@@ -106,8 +111,15 @@ class MeshUpdateQueue
 	// TODO: Add callback to update these when g_settings changes, and update all meshes
 	bool m_cache_smooth_lighting;
 	bool m_cache_enable_water_reflections;
+	bool m_cache_greedy_meshing;
+	// updated when lod_range changes, read by the mesh threads
+	std::atomic<bool> m_cache_generate_lod;
+
+	static void onLodRangeChanged(const std::string &name, void *data);
 
 	void fillDataFromMapBlocks(QueuedMeshUpdate *q);
+	std::shared_ptr<const MeshGeometryCache> getGeometryCache(Map *map,
+			v3s16 mesh_position);
 };
 
 struct MeshUpdateResult
@@ -118,6 +130,8 @@ struct MeshUpdateResult
 	std::vector<v3s16> ack_list;
 	bool urgent = false;
 	std::vector<MapBlock*> map_blocks;
+	// If set, nothing changed and the mesh with this geometry can be kept
+	std::shared_ptr<const MeshGeometryCache> unchanged_geometry;
 
 	MeshUpdateResult() = default;
 };
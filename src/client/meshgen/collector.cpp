@@ -47,8 +47,59 @@ void MeshCollector::append(const TileLayer &layer, const video::S3DVertex *verti
 				(vertices[i].Pos - m_center_pos).getLengthSQ());
 	}
 
+	u32 index_count = p.indices.size();
 	for (u32 i = 0; i < numIndices; i++)
 		p.indices.push_back(indices[i] + vertex_count);
+
+	if (node_ranges)
+		recordRange(p, layernum, vertex_count, index_count);
+}
+
+void MeshCollector::appendRecorded(
+		const std::array<std::vector<PreMeshBuffer>, MAX_TILE_LAYERS> &from,
+		const NodeGeometryRange &range)
+{
+	const PreMeshBuffer &src = from[range.layernum][range.buffer];
+	PreMeshBuffer &p = findBuffer(src.layer, range.layernum, range.vertex_count);
+
+	// vertices already have the offset applied
+	u32 vertex_count = p.vertices.size();
+	auto v_begin = src.vertices.begin() + range.first_vertex;
+	p.vertices.insert(p.vertices.end(), v_begin, v_begin + range.vertex_count);
+	for (u32 i = vertex_count; i < p.vertices.size(); i++) {
+		m_bounding_radius_sq = std::max(m_bounding_radius_sq,
+				(p.vertices[i].Pos - offset - m_center_pos).getLengthSQ());
+	}
+
+	u32 index_count = p.indices.size();
+	for (u32 i = 0; i < range.index_count; i++) {
+		u16 index = src.indices[range.first_index + i];
+		p.indices.push_back(index - range.first_vertex + vertex_count);
+	}
+
+	if (node_ranges)
+		recordRange(p, range.layernum, vertex_count, index_count);
+}
+
+void MeshCollector::recordRange(const PreMeshBuffer &p, u8 layernum,
+		u32 first_vertex, u32 first_index)
+{
+	const u16 buffer = &p - prebuffers[layernum].data();
+	// extend the previous range if possible
+	if (!node_ranges->empty()) {
+		NodeGeometryRange &last = node_ranges->back();
+		if (last.node == current_node && last.layernum == layernum &&
+				last.buffer == buffer &&
+				last.first_vertex + last.vertex_count == first_vertex &&
+				last.first_index + last.index_count == first_index) {
+			last.vertex_count = p.vertices.size() - last.first_vertex;
+			last.index_count = p.indices.size() - last.first_index;
+			return;
+		}
+	}
+	node_ranges->push_back({current_node, layernum, buffer,
+			first_vertex, (u32)p.vertices.size() - first_vertex,
+			first_index, (u32)p.indices.size() - first_index});
 }
 
 PreMeshBuffer &MeshCollector::findBuffer(
@@ -43,6 +43,16 @@ struct PreMeshBuffer
 	bool append(const PreMeshBuffer &other);
 };
 
+/// Part of a PreMeshBuffer that was generated by a single node
+struct NodeGeometryRange
+{
+	u32 node; // index of the node in the meshgen area
+	u8 layernum;
+	u16 buffer; // index into MeshCollector::prebuffers[layernum]
+	u32 first_vertex, vertex_count;
+	u32 first_index, index_count;
+};
+
 struct MeshCollector
 {
 	std::array<std::vector<PreMeshBuffer>, MAX_TILE_LAYERS> prebuffers;
@@ -51,6 +61,12 @@ struct MeshCollector
 	v3f m_center_pos;
 	v3f offset;
 
+	// If set, the geometry appended for each node is recorded here,
+	// ordered by node index
+	std::vector<NodeGeometryRange> *node_ranges = nullptr;
+	// node that the next append belongs to
+	u32 current_node = 0;
+
 	// center_pos: pos to use for bounding-sphere, in BS-space
 	// offset: offset added to vertices
 	MeshCollector(const v3f center_pos, v3f offset = v3f()) : m_center_pos(center_pos), offset(offset) {}
@@ -59,6 +75,15 @@ struct MeshCollector
 			const video::S3DVertex *vertices, u32 numVertices,
 			const u16 *indices, u32 numIndices);
 
+	/**
+	 * Append geometry recorded by another collector for the same meshgen area
+	 * @param from prebuffers of the other collector
+	 * @param range what to copy
+	 */
+	void appendRecorded(
+			const std::array<std::vector<PreMeshBuffer>, MAX_TILE_LAYERS> &from,
+			const NodeGeometryRange &range);
+
 private:
 	void append(const TileLayer &material,
 			const video::S3DVertex *vertices, u32 numVertices,
@@ -66,4 +91,6 @@ struct MeshCollector
 			u8 layernum);
 
 	PreMeshBuffer &findBuffer(const TileLayer &layer, u8 layernum, u32 numVertices);
+	void recordRange(const PreMeshBuffer &p, u8 layernum,
+			u32 first_vertex, u32 first_index);
 };
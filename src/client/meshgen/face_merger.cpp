@@ -0,0 +1,185 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "face_merger.h"
+#include "collector.h"
+#include "constants.h"
+#include "util/numeric.h"
+#include <algorithm>
+#include <cassert>
+
+// Maps cuboid face index to the axis of its normal
+static const u8 face_axis[6] = {1, 1, 0, 0, 2, 2};
+// Maps cuboid face index to the two axes spanning the face
+static const u8 face_plane_axes[6][2] = {
+	{0, 2}, {0, 2}, // up, down
+	{2, 1}, {2, 1}, // right, left
+	{0, 1}, {0, 1}, // back, front
+};
+
+static constexpr u16 quad_indices[] = {0, 1, 2, 2, 3, 0};
+
+bool GreedyFaceMerger::canMerge(const TileSpec &tile)
+{
+	// Rotated and world-aligned tiles don't have the texture coordinates we expect
+	if (tile.world_aligned || tile.rotation != TileRotation::None)
+		return false;
+	constexpr u8 tileable = MATERIAL_FLAG_TILEABLE_HORIZONTAL |
+			MATERIAL_FLAG_TILEABLE_VERTICAL;
+	for (auto &layer : tile.layers) {
+		if (layer.empty())
+			continue;
+		// the texture must repeat and cracks are drawn per node
+		if ((layer.material_flags & tileable) != tileable)
+			return false;
+		if (layer.material_flags & MATERIAL_FLAG_CRACK)
+			return false;
+	}
+	return true;
+}
+
+bool GreedyFaceMerger::add(const TileSpec &tile, u8 face, v3s16 p,
+		const video::S3DVertex *vertices)
+{
+	assert(face < 6);
+	if (!canMerge(tile))
+		return false;
+	// Quads with interpolated lighting can't be stretched
+	video::SColor color = vertices[0].Color;
+	for (int j = 1; j < 4; j++) {
+		if (vertices[j].Color != color)
+			return false;
+	}
+
+	u32 material = findMaterial(tile, color, face, vertices, intToFloat(p, BS));
+	m_faces.push_back({material, face, p});
+	return true;
+}
+
+u32 GreedyFaceMerger::findMaterial(const TileSpec &tile, video::SColor color,
+		u8 face, const video::S3DVertex *vertices, v3f origin)
+{
+	// Most of the time consecutive faces share the material, so search backwards
+	for (size_t i = m_materials.size(); i-- > 0; ) {
+		const Material &m = m_materials[i];
+		if (m.face != face || m.color != color)
+			continue;
+		bool same = true;
+		for (int l = 0; l < MAX_TILE_LAYERS; l++) {
+			const TileLayer &a = m.tile.layers[l], &b = tile.layers[l];
+			if (a != b || a.texture_layer_idx != b.texture_layer_idx) {
+				same = false;
+				break;
+			}
+		}
+		if (same)
+			return i;
+	}
+
+	Material m;
+	m.tile = tile;
+	m.color = color;
+	m.face = face;
+	for (int j = 0; j < 4; j++) {
+		m.vertices[j] = vertices[j];
+		m.vertices[j].Pos -= origin;
+	}
+	m_materials.push_back(m);
+	return m_materials.size() - 1;
+}
+
+void GreedyFaceMerger::emitQuad(MeshCollector *collector, const Material &m,
+		v3s16 p, int axis_a, int axis_b, u16 w, u16 h) const
+{
+	// Texture coordinates change linearly along the face, find the change per node
+	v2f dt_a, dt_b;
+	for (int j = 0; j < 4; j++) {
+		const video::S3DVertex &v = m.vertices[j];
+		dt_a += (v.Pos[axis_a] > 0 ? 0.5f : -0.5f) * v.TCoords;
+		dt_b += (v.Pos[axis_b] > 0 ? 0.5f : -0.5f) * v.TCoords;
+	}
+
+	const v3f origin = intToFloat(p, BS);
+	video::S3DVertex vertices[4];
+	for (int j = 0; j < 4; j++) {
+		video::S3DVertex &v = vertices[j];
+		v = m.vertices[j];
+		if (v.Pos[axis_a] > 0) {
+			v.Pos[axis_a] += (w - 1) * BS;
+			v.TCoords += dt_a * (w - 1);
+		}
+		if (v.Pos[axis_b] > 0) {
+			v.Pos[axis_b] += (h - 1) * BS;
+			v.TCoords += dt_b * (h - 1);
+		}
+		v.Pos += origin;
+	}
+	collector->append(m.tile, vertices, 4, quad_indices, 6);
+}
+
+void GreedyFaceMerger::flush(MeshCollector *collector)
+{
+	if (m_faces.empty())
+		return;
+
+	// Group faces into slices: same direction and same plane
+	auto slice_of = [] (const Face &f) {
+		return f.p[face_axis[f.face]];
+	};
+	std::sort(m_faces.begin(), m_faces.end(), [&] (const Face &a, const Face &b) {
+		if (a.face != b.face)
+			return a.face < b.face;
+		return slice_of(a) < slice_of(b);
+	});
+
+	const u16 side = m_side_length;
+	m_grid.assign(side * side, 0);
+
+	size_t begin = 0;
+	while (begin < m_faces.size()) {
+		const u8 face = m_faces[begin].face;
+		const s16 slice = slice_of(m_faces[begin]);
+		const int axis_a = face_plane_axes[face][0];
+		const int axis_b = face_plane_axes[face][1];
+
+		size_t end = begin;
+		for (; end < m_faces.size(); end++) {
+			const Face &f = m_faces[end];
+			if (f.face != face || slice_of(f) != slice)
+				break;
+			m_grid[f.p[axis_b] * side + f.p[axis_a]] = f.material + 1;
+		}
+
+		v3s16 p;
+		p[face_axis[face]] = slice;
+		for (u16 b = 0; b < side; b++)
+		for (u16 a = 0; a < side; a++) {
+			const u32 id = m_grid[b * side + a];
+			if (!id)
+				continue;
+
+			// Grow along the first axis, then add rows as long as they match
+			u16 w = 1;
+			while (a + w < side && m_grid[b * side + a + w] == id)
+				w++;
+			u16 h = 1;
+			for (; b + h < side; h++) {
+				const u32 *row = &m_grid[(b + h) * side + a];
+				if (!std::all_of(row, row + w, [id] (u32 v) { return v == id; }))
+					break;
+			}
+
+			for (u16 y = b; y < b + h; y++)
+				std::fill_n(&m_grid[y * side + a], w, 0);
+
+			p[axis_a] = a;
+			p[axis_b] = b;
+			emitQuad(collector, m_materials[id - 1], p, axis_a, axis_b, w, h);
+		}
+
+		begin = end;
+	}
+
+	m_faces.clear();
+}
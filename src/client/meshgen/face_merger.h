@@ -0,0 +1,72 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include <vector>
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include <S3DVertex.h>
+#include "client/tile.h"
+
+struct MeshCollector;
+
+/*
+	Greedy meshing of solid node faces.
+
+	Full faces of solid nodes are collected instead of being appended to
+	the MeshCollector right away. Once all nodes are drawn, coplanar faces
+	with identical tile and vertex color are merged into larger quads.
+	Texture coordinates are stretched so that the texture repeats once
+	per node, which requires the tile to be tileable in both directions.
+*/
+class GreedyFaceMerger
+{
+public:
+	/// @param side_length size of the meshgen area in nodes
+	GreedyFaceMerger(u16 side_length) : m_side_length(side_length) {}
+
+	/**
+	 * Try to take over a face of a solid node.
+	 * @param tile tile of the face
+	 * @param face face index as used by cuboid drawing (up-down-right-left-back-front)
+	 * @param p node position relative to the meshgen area
+	 * @param vertices the 4 vertices of the face, including node origin
+	 * @return false if the face can not be merged and must be drawn normally
+	 */
+	bool add(const TileSpec &tile, u8 face, v3s16 p, const video::S3DVertex *vertices);
+
+	/// Merges all collected faces and appends the result to the collector
+	void flush(MeshCollector *collector);
+
+	/// @return number of faces currently collected
+	size_t getFaceCount() const { return m_faces.size(); }
+
+private:
+	struct Material {
+		TileSpec tile;
+		video::SColor color;
+		u8 face;
+		// vertices of a unit face, relative to node origin
+		video::S3DVertex vertices[4];
+	};
+
+	struct Face {
+		u32 material; // index into m_materials
+		u8 face;
+		v3s16 p;
+	};
+
+	static bool canMerge(const TileSpec &tile);
+	u32 findMaterial(const TileSpec &tile, video::SColor color, u8 face,
+			const video::S3DVertex *vertices, v3f origin);
+	void emitQuad(MeshCollector *collector, const Material &m,
+			v3s16 p, int axis_a, int axis_b, u16 w, u16 h) const;
+
+	const u16 m_side_length;
+	std::vector<Material> m_materials;
+	std::vector<Face> m_faces;
+	// scratch grid for one slice, holds material index + 1 (0 = no face)
+	std::vector<u32> m_grid;
+};
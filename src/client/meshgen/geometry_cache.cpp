@@ -0,0 +1,69 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "geometry_cache.h"
+#include "client/mapblock_mesh.h"
+
+MeshGeometryCache::MeshGeometryCache(const MeshMakeData *data) :
+	m_blockpos(data->m_blockpos),
+	m_side_length(data->m_side_length),
+	m_crack_pos_relative(data->m_crack_pos_relative)
+{
+	const v3s16 origin = m_blockpos * MAP_BLOCKSIZE;
+	m_area = VoxelArea(origin + DEPENDENCY_MIN,
+			origin + v3s16(m_side_length - 1) + DEPENDENCY_MAX);
+
+	m_nodes.reserve(m_area.getVolume());
+	v3s16 p;
+	for (p.Z = m_area.MinEdge.Z; p.Z <= m_area.MaxEdge.Z; p.Z++)
+	for (p.Y = m_area.MinEdge.Y; p.Y <= m_area.MaxEdge.Y; p.Y++)
+	for (p.X = m_area.MinEdge.X; p.X <= m_area.MaxEdge.X; p.X++)
+		m_nodes.push_back(data->m_vmanip.getNodeNoExNoEmerge(p));
+}
+
+u32 MeshGeometryCache::findChangedNodes(const MeshMakeData *data,
+		std::vector<bool> &regenerate) const
+{
+	if (data->m_blockpos != m_blockpos || data->m_side_length != m_side_length)
+		return U32_MAX;
+
+	const s16 side = m_side_length;
+	const v3s16 origin = m_blockpos * MAP_BLOCKSIZE;
+	regenerate.assign(side * side * side, false);
+	u32 count = 0;
+
+	// p is relative to origin
+	auto mark = [&] (v3s16 p) {
+		if (p.X < 0 || p.Y < 0 || p.Z < 0 || p.X >= side || p.Y >= side || p.Z >= side)
+			return;
+		auto &&r = regenerate[(p.Z * side + p.Y) * side + p.X];
+		if (!r) {
+			r = true;
+			count++;
+		}
+	};
+
+	size_t i = 0;
+	v3s16 p;
+	for (p.Z = m_area.MinEdge.Z; p.Z <= m_area.MaxEdge.Z; p.Z++)
+	for (p.Y = m_area.MinEdge.Y; p.Y <= m_area.MaxEdge.Y; p.Y++)
+	for (p.X = m_area.MinEdge.X; p.X <= m_area.MaxEdge.X; p.X++, i++) {
+		if (data->m_vmanip.getNodeNoExNoEmerge(p) == m_nodes[i])
+			continue;
+		// every node that depends on p
+		v3s16 d;
+		for (d.Z = DEPENDENCY_MIN.Z; d.Z <= DEPENDENCY_MAX.Z; d.Z++)
+		for (d.Y = DEPENDENCY_MIN.Y; d.Y <= DEPENDENCY_MAX.Y; d.Y++)
+		for (d.X = DEPENDENCY_MIN.X; d.X <= DEPENDENCY_MAX.X; d.X++)
+			mark(p - origin - d);
+	}
+
+	// the crack is drawn on a single node
+	if (data->m_crack_pos_relative != m_crack_pos_relative) {
+		mark(data->m_crack_pos_relative);
+		mark(m_crack_pos_relative);
+	}
+
+	return count;
+}
@@ -0,0 +1,59 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include "irrlichttypes.h"
+#include "mapnode.h"
+#include "voxel.h"
+#include "collector.h"
+
+struct MeshMakeData;
+
+/*
+	Input and output of a mesh generation, kept so that the next update of
+	the same mesh only needs to generate the nodes that changed. The geometry
+	of the other nodes is copied.
+*/
+class MeshGeometryCache
+{
+public:
+	// Nodes (relative to a node) that its geometry depends on.
+	// Rooted plantlike nodes are lit by the nodes around the node above.
+	static constexpr v3s16 DEPENDENCY_MIN{-1, -1, -1};
+	static constexpr v3s16 DEPENDENCY_MAX{1, 2, 1};
+
+	/// Takes a snapshot of the mesh generation input
+	MeshGeometryCache(const MeshMakeData *data);
+
+	/**
+	 * Find the nodes whose geometry may differ for a new input.
+	 * @param regenerate output, true for nodes that must be generated again,
+	 *     indexed like NodeGeometryRange::node
+	 * @return number of such nodes, U32_MAX if nothing can be reused
+	 */
+	u32 findChangedNodes(const MeshMakeData *data, std::vector<bool> &regenerate) const;
+
+	/// @return true if the geometry can be copied per node
+	bool hasNodeRanges() const { return m_per_node; }
+
+	/// Disable copying of geometry, only change detection will work
+	void disableNodeRanges() { m_per_node = false; node_ranges.clear(); }
+
+	// generated geometry before colors were applied and buffers merged
+	std::array<std::vector<PreMeshBuffer>, MAX_TILE_LAYERS> prebuffers;
+	std::vector<NodeGeometryRange> node_ranges;
+
+private:
+	v3s16 m_blockpos;
+	u16 m_side_length;
+	v3s16 m_crack_pos_relative;
+	bool m_per_node = true;
+
+	// nodes of the meshgen area and of the area around it that it depends on
+	VoxelArea m_area;
+	std::vector<MapNode> m_nodes;
+};
@@ -16,15 +16,126 @@
 #include "voxel.h"
 
 ////
-//// MinimapUpdateThread
+//// MinimapScanCache
 ////
 
-MinimapUpdateThread::~MinimapUpdateThread()
+MinimapScanCache::~MinimapScanCache()
 {
-	for (auto &it : m_blocks_cache) {
+	for (auto &it : m_blocks)
 		delete it.second;
+}
+
+void MinimapScanCache::setBlock(v3s16 pos, MinimapMapblock *data)
+{
+	if (data) {
+		// Swap two values in the map using single lookup
+		auto result = m_blocks.emplace(pos, data);
+		if (!result.second) {
+			delete result.first->second;
+			result.first->second = data;
+		}
+	} else {
+		auto it = m_blocks.find(pos);
+		if (it == m_blocks.end())
+			return;
+		delete it->second;
+		m_blocks.erase(it);
+	}
+
+	auto tile = m_tiles.find(v2s16(pos.X, pos.Z));
+	if (tile != m_tiles.end())
+		tile->second.dirty = true;
+}
+
+void MinimapScanCache::updateTile(v2s16 pos, Tile &tile)
+{
+	for (u16 i = 0; i < MAP_BLOCKSIZE * MAP_BLOCKSIZE; i++) {
+		MinimapPixel &pixel = tile.pixels[i];
+		pixel.air_count = 0;
+		pixel.height = 0;
+		pixel.n = MapNode(CONTENT_AIR);
+	}
+
+	// Upper blocks cover the lower ones
+	for (s16 y = tile.y_min; y <= tile.y_max; y++) {
+		auto it = m_blocks.find(v3s16(pos.X, y, pos.Y));
+		if (it == m_blocks.end())
+			continue;
+		const MinimapMapblock &block = *it->second;
+		for (u16 i = 0; i < MAP_BLOCKSIZE * MAP_BLOCKSIZE; i++) {
+			const MinimapPixel &in_pixel = block.data[i];
+			MinimapPixel &out_pixel = tile.pixels[i];
+			out_pixel.air_count += in_pixel.air_count;
+			if (in_pixel.n.param0 != CONTENT_AIR) {
+				out_pixel.n = in_pixel.n;
+				tile.surface_y[i] = y * MAP_BLOCKSIZE + in_pixel.height;
+			}
+		}
+	}
+	tile.dirty = false;
+}
+
+void MinimapScanCache::getMap(v3s16 pos, s16 size, s16 height, MinimapPixel *out)
+{
+	v3s16 pos_min(pos.X - size / 2, pos.Y - height / 2, pos.Z - size / 2);
+	v3s16 pos_max(pos_min.X + size - 1, pos.Y + height / 2, pos_min.Z + size - 1);
+	v3s16 blockpos_min = getNodeBlockPos(pos_min);
+	v3s16 blockpos_max = getNodeBlockPos(pos_max);
+
+	// Forget tiles that went out of view
+	for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+		const v2s16 &p = it->first;
+		if (p.X < blockpos_min.X || p.X > blockpos_max.X ||
+				p.Y < blockpos_min.Z || p.Y > blockpos_max.Z)
+			it = m_tiles.erase(it);
+		else
+			++it;
+	}
+
+	v2s16 tilepos;
+	for (tilepos.Y = blockpos_min.Z; tilepos.Y <= blockpos_max.Z; ++tilepos.Y)
+	for (tilepos.X = blockpos_min.X; tilepos.X <= blockpos_max.X; ++tilepos.X) {
+		auto result = m_tiles.try_emplace(tilepos);
+		Tile &tile = result.first->second;
+		if (result.second || tile.dirty ||
+				tile.y_min != blockpos_min.Y || tile.y_max != blockpos_max.Y) {
+			tile.y_min = blockpos_min.Y;
+			tile.y_max = blockpos_max.Y;
+			updateTile(tilepos, tile);
+		}
+
+		v3s16 block_node_min(tilepos.X * MAP_BLOCKSIZE, 0, tilepos.Y * MAP_BLOCKSIZE);
+		// clip
+		s16 x_min = std::max(block_node_min.X, pos_min.X);
+		s16 x_max = std::min<s16>(block_node_min.X + MAP_BLOCKSIZE - 1, pos_max.X);
+		s16 z_min = std::max(block_node_min.Z, pos_min.Z);
+		s16 z_max = std::min<s16>(block_node_min.Z + MAP_BLOCKSIZE - 1, pos_max.Z);
+
+		for (s16 z = z_min; z <= z_max; ++z)
+		for (s16 x = x_min; x <= x_max; ++x) {
+			u16 i = (z - block_node_min.Z) * MAP_BLOCKSIZE + (x - block_node_min.X);
+			const MinimapPixel &in_pixel = tile.pixels[i];
+			MinimapPixel &out_pixel = out[(x - pos_min.X) + (z - pos_min.Z) * size];
+
+			out_pixel = in_pixel;
+			if (in_pixel.n.param0 != CONTENT_AIR) {
+				// Height within the scanned part of the surface block,
+				// plus the offset of that block
+				s16 surface_block_y = getContainerPos(tile.surface_y[i], MAP_BLOCKSIZE) *
+						MAP_BLOCKSIZE;
+				s16 offset = std::max(surface_block_y, pos_min.Y) - pos_min.Y;
+				out_pixel.height = offset + tile.surface_y[i] - surface_block_y;
+			}
+		}
 	}
+}
 
+////
+//// MinimapUpdateThread
+////
+
+MinimapUpdateThread::~MinimapUpdateThread()
+{
 	for (auto &q : m_update_queue) {
 		delete q.data;
 	}
@@ -77,23 +188,8 @@ void MinimapUpdateThread::doUpdate()
 {
 	QueuedMinimapUpdate update;
 
-	while (popBlockUpdate(&update)) {
-		if (update.data) {
-			// Swap two values in the map using single lookup
-			auto result = m_blocks_cache.emplace(update.pos, update.data);
-			if (!result.second) {
-				delete result.first->second;
-				result.first->second = update.data;
-			}
-		} else {
-			auto it = m_blocks_cache.find(update.pos);
-			if (it != m_blocks_cache.end()) {
-				delete it->second;
-				m_blocks_cache.erase(it);
-			}
-		}
-	}
-
+	while (popBlockUpdate(&update))
+		m_scan_cache.setBlock(update.pos, update.data);
 
 	if (data->map_invalidated && (
 				data->mode.type == MINIMAP_TYPE_RADAR ||
@@ -105,55 +201,7 @@ void MinimapUpdateThread::doUpdate()
 
 void MinimapUpdateThread::getMap(v3s16 pos, s16 size, s16 height)
 {
-	v3s16 pos_min(pos.X - size / 2, pos.Y - height / 2, pos.Z - size / 2);
-	v3s16 pos_max(pos_min.X + size - 1, pos.Y + height / 2, pos_min.Z + size - 1);
-	v3s16 blockpos_min = getNodeBlockPos(pos_min);
-	v3s16 blockpos_max = getNodeBlockPos(pos_max);
-
-// clear the map
-	for (int z = 0; z < size; z++)
-	for (int x = 0; x < size; x++) {
-		MinimapPixel &mmpixel = data->minimap_scan[x + z * size];
-		mmpixel.air_count = 0;
-		mmpixel.height = 0;
-		mmpixel.n = MapNode(CONTENT_AIR);
-	}
-
-// draw the map
-	v3s16 blockpos;
-	for (blockpos.Z = blockpos_min.Z; blockpos.Z <= blockpos_max.Z; ++blockpos.Z)
-	for (blockpos.Y = blockpos_min.Y; blockpos.Y <= blockpos_max.Y; ++blockpos.Y)
-	for (blockpos.X = blockpos_min.X; blockpos.X <= blockpos_max.X; ++blockpos.X) {
-		auto pblock = m_blocks_cache.find(blockpos);
-		if (pblock == m_blocks_cache.end())
-			continue;
-		const MinimapMapblock &block = *pblock->second;
-
-		v3s16 block_node_min(blockpos * MAP_BLOCKSIZE);
-		v3s16 block_node_max(block_node_min + MAP_BLOCKSIZE - 1);
-		// clip
-		v3s16 range_min = componentwise_max(block_node_min, pos_min);
-		v3s16 range_max = componentwise_min(block_node_max, pos_max);
-
-		v3s16 pos;
-		pos.Y = range_min.Y;
-		for (pos.Z = range_min.Z; pos.Z <= range_max.Z; ++pos.Z)
-		for (pos.X = range_min.X; pos.X <= range_max.X; ++pos.X) {
-			v3s16 inblock_pos = pos - block_node_min;
-			const MinimapPixel &in_pixel =
-				block.data[inblock_pos.Z * MAP_BLOCKSIZE + inblock_pos.X];
-
-			v3s16 inmap_pos = pos - pos_min;
-			MinimapPixel &out_pixel =
-				data->minimap_scan[inmap_pos.X + inmap_pos.Z * size];
-
-			out_pixel.air_count += in_pixel.air_count;
-			if (in_pixel.n.param0 != CONTENT_AIR) {
-				out_pixel.n = in_pixel.n;
-				out_pixel.height = inmap_pos.Y + in_pixel.height;
-			}
-		}
-	}
+	m_scan_cache.getMap(pos, size, height, data->minimap_scan);
 }
 
 ////
@@ -727,15 +775,22 @@ void Minimap::updateActiveMarkers()
 
 void MinimapMapblock::getMinimapNodes(VoxelManipulator *vmanip, const NodeDefManager *nodedef, const v3s16 &pos)
 {
+	// Make sure the block is in the area once, then walk down the columns
+	// by index instead of looking up each node
+	vmanip->addArea(VoxelArea(pos, pos + (MAP_BLOCKSIZE - 1)));
+	const VoxelArea &area = vmanip->m_area;
+	const s32 y_stride = area.getExtent().X;
+
 	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
 	for (s16 z = 0; z < MAP_BLOCKSIZE; z++) {
 		s16 air_count = 0;
 		bool surface_found = false;
 		MinimapPixel *mmpixel = &data[z * MAP_BLOCKSIZE + x];
 
-		for (s16 y = MAP_BLOCKSIZE -1; y >= 0; y--) {
-			v3s16 p(x, y, z);
-			MapNode n = vmanip->getNodeNoEx(pos + p);
+		s32 i = area.index(pos + v3s16(x, MAP_BLOCKSIZE - 1, z));
+		for (s16 y = MAP_BLOCKSIZE -1; y >= 0; y--, i -= y_stride) {
+			MapNode n = (vmanip->m_flags[i] & VOXELFLAG_NO_DATA) ?
+					MapNode(CONTENT_IGNORE) : vmanip->m_data[i];
 			const ContentFeatures &f = nodedef->get(n);
 			if (!surface_found && f.drawtype != NDT_AIRLIKE) {
 				mmpixel->height = y;
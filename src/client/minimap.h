@@ -6,15 +6,18 @@
 
 #include "irrlichttypes.h"
 #include "irr_ptr.h"
+#include "irr_v2d.h"
+#include "irr_v3d.h"
 #include "rect.h"
 #include "CMeshBuffer.h"
 
 #include "constants.h"
 #include "hud_element.h"
 #include "mapnode.h"
+#include "util/basic_macros.h"
 #include "util/thread.h"
-#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace video {
@@ -71,6 +74,45 @@ struct MinimapMapblock {
 	MinimapPixel data[MAP_BLOCKSIZE * MAP_BLOCKSIZE];
 };
 
+/*
+	Merges the MinimapMapblocks around a position into a flat scan.
+	The merged block columns are kept as tiles, so that only the tiles
+	of changed blocks need to be redone when moving around.
+*/
+class MinimapScanCache {
+public:
+	MinimapScanCache() = default;
+	~MinimapScanCache();
+	DISABLE_CLASS_COPY(MinimapScanCache);
+
+	// Takes ownership of the data, nullptr removes the block
+	void setBlock(v3s16 pos, MinimapMapblock *data);
+
+	/**
+	 * Fill the scan of a size * size area centered at pos.
+	 * Heights are relative to the bottom of the scanned range.
+	 * @param out array of size * size pixels, X first
+	 */
+	void getMap(v3s16 pos, s16 size, s16 height, MinimapPixel *out);
+
+	size_t getTileCount() const { return m_tiles.size(); }
+
+private:
+	// The blocks of a column from y_min to y_max, merged
+	struct Tile {
+		s16 y_min, y_max;
+		bool dirty;
+		MinimapPixel pixels[MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+		// node Y of the surface in world coordinates
+		s16 surface_y[MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	};
+
+	void updateTile(v2s16 pos, Tile &tile);
+
+	std::unordered_map<v3s16, MinimapMapblock *> m_blocks;
+	std::unordered_map<v2s16, Tile> m_tiles;
+};
+
 struct MinimapData {
 	MinimapModeDef mode;
 	v3s16 pos;
@@ -112,7 +154,7 @@ class MinimapUpdateThread : public UpdateThread {
 private:
 	std::mutex m_queue_mutex;
 	std::deque<QueuedMinimapUpdate> m_update_queue;
-	std::map<v3s16, MinimapMapblock *> m_blocks_cache;
+	MinimapScanCache m_scan_cache;
 };
 
 class Minimap {
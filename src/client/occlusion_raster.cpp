@@ -0,0 +1,211 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "occlusion_raster.h"
+#include "debug.h"
+#include "util/numeric.h"
+#include <algorithm>
+#include <cmath>
+
+OcclusionRaster::OcclusionRaster(u16 size) :
+	m_size(size)
+{
+	FATAL_ERROR_IF(size == 0 || (size & (size - 1)) != 0,
+			"OcclusionRaster size must be a power of two");
+	for (u32 s = size; s > 0; s /= 2)
+		m_levels.emplace_back(s * s, 0.0f);
+}
+
+void OcclusionRaster::begin(v3f position, v3f direction, f32 fov)
+{
+	m_position = position;
+	m_forward = direction;
+	m_forward.normalize();
+	// any vector that is not parallel to the view direction will do
+	v3f up = std::fabs(m_forward.Y) > 0.9f ? v3f(0, 0, 1) : v3f(0, 1, 0);
+	m_right = up.crossProduct(m_forward);
+	m_right.normalize();
+	m_up = m_forward.crossProduct(m_right);
+	m_scale = 1.0f / std::tan(fov * 0.5f);
+
+	std::fill(m_levels[0].begin(), m_levels[0].end(), 0.0f);
+}
+
+v3f OcclusionRaster::toView(v3f p) const
+{
+	p -= m_position;
+	return v3f(p.dotProduct(m_right), p.dotProduct(m_up), p.dotProduct(m_forward));
+}
+
+OcclusionRaster::ScreenPoint OcclusionRaster::toScreen(v3f view) const
+{
+	f32 f = 0.5f * m_scale / view.Z;
+	return {
+		(0.5f + view.X * f) * m_size,
+		(0.5f - view.Y * f) * m_size,
+		1.0f / view.Z
+	};
+}
+
+void OcclusionRaster::addOccluder(const aabb3f &box)
+{
+	const v3f &lo = box.MinEdge;
+	const v3f &hi = box.MaxEdge;
+	for (u8 axis = 0; axis < 3; axis++) {
+		f32 plane;
+		if (m_position[axis] < lo[axis])
+			plane = lo[axis];
+		else if (m_position[axis] > hi[axis])
+			plane = hi[axis];
+		else
+			continue; // camera is between both sides
+
+		const u8 a1 = (axis + 1) % 3;
+		const u8 a2 = (axis + 2) % 3;
+		v3f corners[4];
+		for (u8 i = 0; i < 4; i++) {
+			v3f c;
+			c[axis] = plane;
+			c[a1] = (i == 1 || i == 2) ? hi[a1] : lo[a1];
+			c[a2] = i >= 2 ? hi[a2] : lo[a2];
+			corners[i] = toView(c);
+		}
+		drawPolygon(corners, 4);
+	}
+}
+
+void OcclusionRaster::drawPolygon(const v3f *points, u8 count)
+{
+	// Clip against the near plane, each vertex adds at most one more
+	v3f clipped[8];
+	u8 n = 0;
+	for (u8 i = 0; i < count; i++) {
+		const v3f &a = points[i];
+		const v3f &b = points[(i + 1) % count];
+		bool a_in = a.Z >= NEAR_PLANE;
+		bool b_in = b.Z >= NEAR_PLANE;
+		if (a_in)
+			clipped[n++] = a;
+		if (a_in != b_in) {
+			v3f p = a + (b - a) * ((NEAR_PLANE - a.Z) / (b.Z - a.Z));
+			p.Z = NEAR_PLANE;
+			clipped[n++] = p;
+		}
+	}
+	if (n < 3)
+		return;
+
+	ScreenPoint screen[8];
+	for (u8 i = 0; i < n; i++)
+		screen[i] = toScreen(clipped[i]);
+	for (u8 i = 1; i + 1 < n; i++)
+		drawTriangle(screen[0], screen[i], screen[i + 1]);
+}
+
+void OcclusionRaster::drawTriangle(const ScreenPoint &a, const ScreenPoint &b,
+		const ScreenPoint &c)
+{
+	const f32 area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::fabs(area) < 1e-6f)
+		return;
+
+	// Pixels whose centers may be covered. Limit the coordinates first,
+	// they can be huge for points close to the near plane.
+	auto first = [this] (f32 a, f32 b, f32 c) {
+		f32 v = rangelim(std::min({a, b, c}), -1.0f, m_size + 1.0f);
+		return std::max<s32>(0, std::ceil(v - 0.5f));
+	};
+	auto last = [this] (f32 a, f32 b, f32 c) {
+		f32 v = rangelim(std::max({a, b, c}), -1.0f, m_size + 1.0f);
+		return std::min<s32>(m_size - 1, std::floor(v - 0.5f));
+	};
+	const s32 x0 = first(a.x, b.x, c.x), x1 = last(a.x, b.x, c.x);
+	const s32 y0 = first(a.y, b.y, c.y), y1 = last(a.y, b.y, c.y);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	// Barycentric coordinates are linear in screen space, and so is 1/z
+	const f32 inv_area = 1.0f / area;
+	const f32 l0_dx = (b.y - c.y) * inv_area, l0_dy = (c.x - b.x) * inv_area;
+	const f32 l1_dx = (c.y - a.y) * inv_area, l1_dy = (a.x - c.x) * inv_area;
+	const f32 px = x0 + 0.5f - c.x, py = y0 + 0.5f - c.y;
+	const f32 l0_start = ((b.y - c.y) * px + (c.x - b.x) * py) * inv_area;
+	const f32 l1_start = ((c.y - a.y) * px + (a.x - c.x) * py) * inv_area;
+
+	std::vector<f32> &depth = m_levels[0];
+	for (s32 y = y0; y <= y1; y++) {
+		const f32 l0_row = l0_start + (y - y0) * l0_dy;
+		const f32 l1_row = l1_start + (y - y0) * l1_dy;
+		f32 *row = &depth[y * m_size];
+		for (s32 x = x0; x <= x1; x++) {
+			const f32 l0 = l0_row + (x - x0) * l0_dx;
+			const f32 l1 = l1_row + (x - x0) * l1_dx;
+			const f32 l2 = 1.0f - l0 - l1;
+			const f32 z = l0 * a.z + l1 * b.z + l2 * c.z;
+			const bool inside = l0 >= 0.0f && l1 >= 0.0f && l2 >= 0.0f;
+			row[x] = inside ? std::max(row[x], z) : row[x];
+		}
+	}
+}
+
+void OcclusionRaster::finish()
+{
+	for (size_t level = 1; level < m_levels.size(); level++) {
+		const std::vector<f32> &src = m_levels[level - 1];
+		std::vector<f32> &dst = m_levels[level];
+		const u32 size = m_size >> level;
+		const u32 src_size = size * 2;
+		for (u32 y = 0; y < size; y++)
+		for (u32 x = 0; x < size; x++) {
+			const f32 *top = &src[2 * y * src_size + 2 * x];
+			const f32 *bottom = top + src_size;
+			dst[y * size + x] = std::min({top[0], top[1], bottom[0], bottom[1]});
+		}
+	}
+}
+
+bool OcclusionRaster::isOccluded(const aabb3f &box) const
+{
+	f32 min_x = m_size, min_y = m_size, max_x = 0.0f, max_y = 0.0f;
+	f32 nearest = 0.0f;
+	for (u8 i = 0; i < 8; i++) {
+		v3f corner((i & 1) ? box.MaxEdge.X : box.MinEdge.X,
+				(i & 2) ? box.MaxEdge.Y : box.MinEdge.Y,
+				(i & 4) ? box.MaxEdge.Z : box.MinEdge.Z);
+		v3f view = toView(corner);
+		if (view.Z < NEAR_PLANE)
+			return false;
+		ScreenPoint p = toScreen(view);
+		min_x = std::min(min_x, p.x);
+		min_y = std::min(min_y, p.y);
+		max_x = std::max(max_x, p.x);
+		max_y = std::max(max_y, p.y);
+		nearest = std::max(nearest, p.z);
+	}
+
+	// Nothing is known outside of the buffer
+	if (min_x < 0.0f || min_y < 0.0f || max_x > m_size || max_y > m_size)
+		return false;
+
+	const s32 x0 = min_x, y0 = min_y;
+	const s32 x1 = std::min<s32>(max_x, m_size - 1);
+	const s32 y1 = std::min<s32>(max_y, m_size - 1);
+
+	// Use the level where the box covers at most 2x2 texels
+	size_t level = 0;
+	while (level + 1 < m_levels.size() &&
+			((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		level++;
+
+	// Small margin so that a surface does not hide itself
+	const f32 threshold = nearest * 1.0001f;
+	const std::vector<f32> &depth = m_levels[level];
+	const s32 size = m_size >> level;
+	for (s32 y = y0 >> level; y <= y1 >> level; y++)
+	for (s32 x = x0 >> level; x <= x1 >> level; x++) {
+		if (depth[y * size + x] <= threshold)
+			return false;
+	}
+	return true;
+}
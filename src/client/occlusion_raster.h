@@ -0,0 +1,77 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include "irr_aabb3d.h"
+#include <vector>
+
+/*
+	Software occlusion culling
+
+	Opaque surfaces are rasterized into a small depth buffer, then a pyramid
+	holding the farthest depth of each 2x2 texels is built from it. Boxes are
+	tested against the pyramid level where they cover only a few texels.
+
+	The buffer is square and covers the field of view in both directions.
+	Depth is stored as 1/z, so 0 means nothing was drawn and larger values
+	are closer to the camera.
+*/
+class OcclusionRaster
+{
+public:
+	// Distance of the near plane, anything closer is clipped
+	static constexpr f32 NEAR_PLANE = 0.05f;
+
+	/// @param size width and height of the depth buffer, a power of two
+	OcclusionRaster(u16 size);
+
+	/**
+	 * Clear the depth buffer and set up the view.
+	 * @param position camera position
+	 * @param direction view direction, will be normalized
+	 * @param fov field of view in radians
+	 */
+	void begin(v3f position, v3f direction, f32 fov);
+
+	/**
+	 * Draw the sides of an opaque box that face the camera.
+	 * A box that is flat along one axis draws a single rectangle.
+	 */
+	void addOccluder(const aabb3f &box);
+
+	/// Build the depth pyramid, call after all occluders were added
+	void finish();
+
+	/// @return true if the box is certainly hidden behind the occluders
+	bool isOccluded(const aabb3f &box) const;
+
+	u16 getSize() const { return m_size; }
+	/// @return depth value at a texel of the full resolution buffer
+	f32 getDepth(u16 x, u16 y) const { return m_levels[0][y * m_size + x]; }
+
+private:
+	// Point in screen space, z is 1/depth
+	struct ScreenPoint {
+		f32 x, y, z;
+	};
+
+	v3f toView(v3f p) const;
+	ScreenPoint toScreen(v3f view) const;
+	// Rasterize a convex polygon in view space
+	void drawPolygon(const v3f *points, u8 count);
+	void drawTriangle(const ScreenPoint &a, const ScreenPoint &b,
+			const ScreenPoint &c);
+
+	u16 m_size;
+	// level 0 is the depth buffer, each next level has half the size
+	std::vector<std::vector<f32>> m_levels;
+
+	v3f m_position;
+	v3f m_right, m_up, m_forward;
+	// 1 / tan(fov / 2)
+	f32 m_scale = 1.0f;
+};
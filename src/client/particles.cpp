@@ -15,6 +15,7 @@
 #include "light.h"
 #include "localplayer.h"
 #include "clientmap.h"
+#include "mapblock.h"
 #include "mapnode.h"
 #include "node_visuals.h"
 #include "nodedef.h"
@@ -52,6 +53,76 @@ static video::ITexture *extractTexture(const TileDef &def, const TileLayer &laye
 	return nullptr;
 }
 
+/*
+	ParticleNodeCache
+*/
+
+void ParticleNodeCache::clear()
+{
+	m_blocks.clear();
+	m_last_block = nullptr;
+}
+
+ParticleNodeCache::Block &ParticleNodeCache::getBlock(v3s16 blockpos)
+{
+	if (m_last_block && m_last_blockpos == blockpos)
+		return *m_last_block;
+
+	auto result = m_blocks.try_emplace(blockpos);
+	Block &block = result.first->second;
+	if (result.second)
+		block.block = m_map->getBlockNoCreateNoEx(blockpos);
+	m_last_blockpos = blockpos;
+	m_last_block = &block;
+	return block;
+}
+
+bool ParticleNodeCache::isFree(v3s16 min, v3s16 max)
+{
+	v3s16 p;
+	for (p.Z = min.Z; p.Z <= max.Z; p.Z++)
+	for (p.Y = min.Y; p.Y <= max.Y; p.Y++)
+	for (p.X = min.X; p.X <= max.X; p.X++) {
+		v3s16 blockpos, relpos;
+		getNodeBlockPosWithOffset(p, blockpos, relpos);
+		Block &block = getBlock(blockpos);
+		if (!block.block)
+			return false;
+
+		if (!block.free_known) {
+			block.free_known = true;
+			if (block.block->isAir() && !m_ndef->get(CONTENT_AIR).walkable) {
+				block.free.set();
+			} else {
+				u32 i = 0;
+				for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+				for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+				for (s16 x = 0; x < MAP_BLOCKSIZE; x++, i++) {
+					MapNode n = block.block->getNodeNoCheck(x, y, z);
+					block.free[i] = n.getContent() != CONTENT_IGNORE &&
+							!m_ndef->get(n).walkable;
+				}
+			}
+		}
+
+		u32 i = (relpos.Z * MAP_BLOCKSIZE + relpos.Y) * MAP_BLOCKSIZE + relpos.X;
+		if (!block.free[i])
+			return false;
+	}
+	return true;
+}
+
+MapNode ParticleNodeCache::getNode(v3s16 p, bool *is_valid_position)
+{
+	v3s16 blockpos, relpos;
+	getNodeBlockPosWithOffset(p, blockpos, relpos);
+	MapBlock *block = getBlock(blockpos).block;
+	*is_valid_position = block != nullptr;
+	if (!block)
+		return {CONTENT_IGNORE};
+	return block->getNodeNoCheck(relpos);
+}
+
 /*
 	Particle
 */
@@ -99,8 +170,10 @@ bool Particle::attachToBuffer(ParticleBuffer *buffer)
 	return false;
 }
 
-void Particle::step(float dtime, ClientEnvironment *env)
+void Particle::step(float dtime, const ParticleStepContext &ctx)
 {
+	ClientEnvironment *env = ctx.env;
+
 	m_time += dtime;
 
 	// apply drag (not handled by collisionMoveSimple) and brownian motion
@@ -112,9 +185,19 @@ void Particle::step(float dtime, ClientEnvironment *env)
 		aabb3f box(v3f(-m_p.size / 2.0f), v3f(m_p.size / 2.0f));
 		v3f p_pos = m_pos * BS;
 		v3f p_velocity = m_velocity * BS;
-		collisionMoveResult r = collisionMoveSimple(env, env->getGameDef(),
-			box, 0.0f, dtime, &p_pos, &p_velocity, m_acceleration * BS, nullptr,
-			m_p.object_collision);
+		collisionMoveResult r;
+		// Most particles fly through the air, check that cheaply first
+		FreeMovement free;
+		if (!m_p.object_collision &&
+				getFreeMovement(box, dtime, p_pos, p_velocity, m_acceleration * BS, free) &&
+				ctx.nodes->isFree(free.area_min, free.area_max)) {
+			p_pos = free.pos;
+			p_velocity = free.speed;
+		} else {
+			r = collisionMoveSimple(env, env->getGameDef(),
+				box, 0.0f, dtime, &p_pos, &p_velocity, m_acceleration * BS, nullptr,
+				m_p.object_collision);
+		}
 
 		f32 bounciness = m_p.bounce.pickWithin();
 		if (r.collides && (m_p.collision_removal || bounciness > 0)) {
@@ -170,15 +253,16 @@ void Particle::step(float dtime, ClientEnvironment *env)
 		alpha = m_texture.tex -> alpha.blend(m_time / (m_expiration+0.1f));
 
 	// Update lighting
-	auto col = updateLight(env);
+	auto col = updateLight(ctx);
 	col.setAlpha(255 * alpha);
 
 	// Update model
-	updateVertices(env, col);
+	updateVertices(ctx, col);
 }
 
-video::SColor Particle::updateLight(ClientEnvironment *env)
+video::SColor Particle::updateLight(const ParticleStepContext &ctx)
 {
+	ClientEnvironment *env = ctx.env;
 	u8 light = 0;
 	bool pos_ok;
 
@@ -187,12 +271,12 @@ video::SColor Particle::updateLight(ClientEnvironment *env)
 		floor(m_pos.Y+0.5),
 		floor(m_pos.Z+0.5)
 	);
-	MapNode n = env->getClientMap().getNode(p, &pos_ok);
+	MapNode n = ctx.nodes->getNode(p, &pos_ok);
 	if (pos_ok)
-		light = n.getLightBlend(env->getDayNightRatio(),
+		light = n.getLightBlend(ctx.daynight_ratio,
 				env->getGameDef()->ndef()->getLightingFlags(n));
 	else
-		light = blend_light(env->getDayNightRatio(), LIGHT_SUN, 0);
+		light = blend_light(ctx.daynight_ratio, LIGHT_SUN, 0);
 
 	u8 m_light = decode_light(light + m_p.glow);
 	return video::SColor(255,
@@ -201,7 +285,7 @@ video::SColor Particle::updateLight(ClientEnvironment *env)
 		m_light * m_base_color.getBlue() / 255);
 }
 
-void Particle::updateVertices(ClientEnvironment *env, video::SColor color)
+void Particle::updateVertices(const ParticleStepContext &ctx, video::SColor color)
 {
 	f32 tx0, tx1, ty0, ty1;
 	v2f scale;
@@ -238,31 +322,27 @@ void Particle::updateVertices(ClientEnvironment *env, video::SColor color)
 	auto half = m_p.size * .5f,
 	     hx   = half * scale.X,
 	     hy   = half * scale.Y;
-	vertices[0] = video::S3DVertex(-hx, -hy,
-		0, 0, 0, 0, color, tx0, ty1);
-	vertices[1] = video::S3DVertex(hx, -hy,
-		0, 0, 0, 0, color, tx1, ty1);
-	vertices[2] = video::S3DVertex(hx, hy,
-		0, 0, 0, 0, color, tx1, ty0);
-	vertices[3] = video::S3DVertex(-hx, hy,
-		0, 0, 0, 0, color, tx0, ty0);
-
-	// Update position -- see #10398
-	auto *player = env->getLocalPlayer();
-	v3s16 camera_offset = env->getCameraOffset();
-
-	for (u16 i = 0; i < 4; i++) {
-		video::S3DVertex &vertex = vertices[i];
-		if (m_p.vertical) {
-			v3f ppos = player->getPosition() / BS;
-			vertex.Pos.rotateXZBy(std::atan2(ppos.Z - m_pos.Z, ppos.X - m_pos.X) /
-				core::DEGTORAD + 90);
-		} else {
-			vertex.Pos.rotateYZBy(player->getPitch());
-			vertex.Pos.rotateXZBy(player->getYaw());
-		}
-		vertex.Pos += m_pos * BS - intToFloat(camera_offset, BS);
+
+	// Rotate the quad to face the player -- see #10398
+	v3f right = ctx.billboard_right, up = ctx.billboard_up;
+	if (m_p.vertical) {
+		right = v3f(1, 0, 0);
+		up = v3f(0, 1, 0);
+		right.rotateXZBy(std::atan2(ctx.player_pos.Z - m_pos.Z,
+				ctx.player_pos.X - m_pos.X) / core::DEGTORAD + 90);
 	}
+	right *= hx;
+	up *= hy;
+	const v3f center = m_pos * BS - ctx.camera_offset;
+
+	vertices[0] = video::S3DVertex(center - right - up,
+		v3f(), color, v2f(tx0, ty1));
+	vertices[1] = video::S3DVertex(center + right - up,
+		v3f(), color, v2f(tx1, ty1));
+	vertices[2] = video::S3DVertex(center + right + up,
+		v3f(), color, v2f(tx1, ty0));
+	vertices[3] = video::S3DVertex(center - right + up,
+		v3f(), color, v2f(tx0, ty0));
 }
 
 /*
@@ -681,7 +761,8 @@ void ParticleBuffer::render()
 */
 
 ParticleManager::ParticleManager(ClientEnvironment *env) :
-	m_env(env)
+	m_env(env),
+	m_node_cache(&env->getClientMap(), env->getGameDef()->ndef())
 {}
 
 ParticleManager::~ParticleManager()
@@ -729,6 +810,25 @@ void ParticleManager::stepParticles(float dtime)
 {
 	MutexAutoLock lock(m_particle_list_lock);
 
+	if (m_particles.empty())
+		return;
+
+	LocalPlayer *player = m_env->getLocalPlayer();
+	ParticleStepContext ctx;
+	ctx.env = m_env;
+	ctx.nodes = &m_node_cache;
+	ctx.daynight_ratio = m_env->getDayNightRatio();
+	ctx.player_pos = player->getPosition() / BS;
+	ctx.camera_offset = intToFloat(m_env->getCameraOffset(), BS);
+	ctx.billboard_right = v3f(1, 0, 0);
+	ctx.billboard_up = v3f(0, 1, 0);
+	for (v3f *axis : {&ctx.billboard_right, &ctx.billboard_up}) {
+		axis->rotateYZBy(player->getPitch());
+		axis->rotateXZBy(player->getYaw());
+	}
+	// The map may have changed since the last step
+	m_node_cache.clear();
+
 	for (size_t i = 0; i < m_particles.size();) {
 		Particle &p = *m_particles[i];
 		if (p.isExpired()) {
@@ -741,7 +841,7 @@ void ParticleManager::stepParticles(float dtime)
 			m_particles[i] = std::move(m_particles.back());
 			m_particles.pop_back();
 		} else {
-			p.step(dtime, m_env);
+			p.step(dtime, ctx);
 			++i;
 		}
 	}
@@ -771,9 +871,10 @@ void ParticleManager::stepBuffers(float dtime)
 		}
 	}
 
-	g_profiler->avg("ParticleManager: particle buffer count [#]", m_particle_buffers.size());
+	g_profiler->avg(PROFILER_METRIC("ParticleManager: particle buffer count [#]"),
+			m_particle_buffers.size());
 	if (!m_particle_buffers.empty())
-		g_profiler->avg("ParticleManager: buffer allocated size [#]", alloc);
+		g_profiler->avg(PROFILER_METRIC("ParticleManager: buffer allocated size [#]"), alloc);
 }
 
 void ParticleManager::clearAll()
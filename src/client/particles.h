@@ -10,11 +10,14 @@
 #include "S3DVertex.h"
 #include "CMeshBuffer.h"
 
+#include <bitset>
 #include <mutex>
 #include <memory>
 #include <vector>
 #include <unordered_map>
 #include "../particles.h"
+#include "constants.h"
+#include "mapnode.h"
 #include "util/numeric.h"
 
 namespace video {
@@ -24,7 +27,9 @@ namespace video {
 struct ClientEvent;
 class ParticleManager;
 class ClientEnvironment;
-struct MapNode;
+class Map;
+class MapBlock;
+class NodeDefManager;
 struct ContentFeatures;
 class LocalPlayer;
 class ITextureSource;
@@ -59,6 +64,58 @@ struct ClientParticleTexRef
 	explicit ClientParticleTexRef(video::ITexture *tp): ref(tp) {};
 };
 
+/*
+	Map access for particles. Remembers the blocks that were looked at and
+	which of their nodes particles can move through freely.
+	Has to be cleared whenever the map may have changed.
+*/
+class ParticleNodeCache
+{
+public:
+	ParticleNodeCache(Map *map, const NodeDefManager *ndef) :
+		m_map(map), m_ndef(ndef)
+	{}
+
+	void clear();
+
+	/// @return true if all nodes in the area are loaded and not walkable
+	bool isFree(v3s16 min, v3s16 max);
+
+	/// Like Map::getNode()
+	MapNode getNode(v3s16 p, bool *is_valid_position);
+
+private:
+	static constexpr u32 NODES = MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE;
+
+	struct Block {
+		MapBlock *block = nullptr;
+		bool free_known = false;
+		// set for nodes that are loaded and not walkable
+		std::bitset<NODES> free;
+	};
+
+	Block &getBlock(v3s16 blockpos);
+
+	Map *m_map;
+	const NodeDefManager *m_ndef;
+	std::unordered_map<v3s16, Block> m_blocks;
+	v3s16 m_last_blockpos;
+	Block *m_last_block = nullptr;
+};
+
+// Values shared by all particles during a step
+struct ParticleStepContext
+{
+	ClientEnvironment *env;
+	ParticleNodeCache *nodes;
+	u32 daynight_ratio;
+	// Player position in nodes
+	v3f player_pos;
+	v3f camera_offset;
+	// Axes of particles facing the camera
+	v3f billboard_right, billboard_up;
+};
+
 class ParticleSpawner;
 class ParticleBuffer;
 
@@ -79,7 +136,7 @@ class Particle
 
 	DISABLE_CLASS_COPY(Particle)
 
-	void step(float dtime, ClientEnvironment *env);
+	void step(float dtime, const ParticleStepContext &ctx);
 
 	bool isExpired () const
 	{ return m_expiration < m_time; }
@@ -95,8 +152,8 @@ class Particle
 	bool attachToBuffer(ParticleBuffer *buffer);
 
 private:
-	video::SColor updateLight(ClientEnvironment *env);
-	void updateVertices(ClientEnvironment *env, video::SColor color);
+	video::SColor updateLight(const ParticleStepContext &ctx);
+	void updateVertices(const ParticleStepContext &ctx, video::SColor color);
 
 	ParticleBuffer *m_buffer = nullptr;
 	u16 m_index; // index in m_buffer
@@ -272,6 +329,8 @@ class ParticleManager
 
 	IntervalLimiter m_buffer_gc;
 
+	ParticleNodeCache m_node_cache;
+
 	std::mutex m_particle_list_lock;
 	std::mutex m_spawner_list_lock;
 };
@@ -103,7 +103,7 @@ void Sky::render()
 	if (!camera || !driver)
 		return;
 
-	ScopeProfiler sp(g_profiler, "Sky::render()", SPT_AVG, PRECISION_MICRO);
+	ScopeProfiler sp(g_profiler, PROFILER_METRIC("Sky::render()", PRECISION_MICRO), SPT_AVG);
 
 	// Draw perspective skybox
 
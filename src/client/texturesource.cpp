@@ -108,7 +108,8 @@ class TextureSource final : public IWritableTextureSource
 
 	// Insert a source image into the cache without touching the filesystem.
 	// Shall be called from the main thread.
-	void insertSourceImage(const std::string &name, video::IImage *img);
+	void insertSourceImage(const std::string &name, video::IImage *img,
+			const std::string &file_hash);
 
 	// Rebuild images and textures from the current set of source images
 	// Shall be called from the main thread.
@@ -527,11 +528,12 @@ void TextureSource::processQueue()
 	}
 }
 
-void TextureSource::insertSourceImage(const std::string &name, video::IImage *img)
+void TextureSource::insertSourceImage(const std::string &name, video::IImage *img,
+		const std::string &file_hash)
 {
 	sanity_check(std::this_thread::get_id() == m_main_thread);
 
-	m_imagesource.insertSourceImage(name, img, true);
+	m_imagesource.insertSourceImage(name, img, true, file_hash);
 	m_source_image_existence.set(name, true);
 
 	// now we need to check for any textures that need updating
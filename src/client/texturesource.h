@@ -128,8 +128,10 @@ class IWritableTextureSource : public ITextureSource
 	/**
 	 * @brief Inserts a source image. Must be called from the main thread.
 	 * Takes ownership of @p img
+	 * @param file_hash hash of the file the image was decoded from
 	 */
-	virtual void insertSourceImage(const std::string &name, video::IImage *img)=0;
+	virtual void insertSourceImage(const std::string &name, video::IImage *img,
+			const std::string &file_hash)=0;
 
 	/**
 	 * Rebuilds all textures (in case-source images have changed)
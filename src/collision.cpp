@@ -217,6 +217,57 @@ bool wouldCollideWithCeiling(
 	return false;
 }
 
+// Looks up the collision boxes of a node and stores them in the cache of its
+// block, returning the value for MapBlockCollisionCache::shape
+static u8 fill_collision_cache_entry(MapBlock *block, v3s16 relp,
+		const NodeDefManager *nodedef, MapBlockCollisionCache *cache)
+{
+	thread_local std::vector<aabb3f> nodeboxes;
+
+	const MapNode n = block->getNodeNoCheck(relp);
+	if (n.getContent() == CONTENT_IGNORE)
+		return MapBlockCollisionCache::IGNORE;
+
+	// Blocks usually have few distinct nodes
+	const u32 key = (u32)n.getContent() << 8 | n.getParam2();
+	for (size_t i = 0; i < cache->shapes.size(); i++) {
+		if (cache->shapes[i].key == key)
+			return i;
+	}
+
+	if (cache->shapes.size() >= MapBlockCollisionCache::MAX_SHAPES)
+		return MapBlockCollisionCache::DYNAMIC;
+
+	const ContentFeatures &f = nodedef->get(n);
+	int n_bouncy_value = 0;
+	nodeboxes.clear();
+	if (f.walkable) {
+		// Negative bouncy may have a meaning, but we need +value here.
+		n_bouncy_value = abs(itemgroup_get(f.groups, "bouncy"));
+
+		// Connected node boxes change with the neighbors, which may be in
+		// another block, so these are never cached
+		if ((f.drawtype == NDT_NODEBOX && f.node_box.type == NODEBOX_CONNECTED) ||
+				n_bouncy_value > U8_MAX)
+			return MapBlockCollisionCache::DYNAMIC;
+
+		n.getCollisionBoxes(nodedef, &nodeboxes, 0);
+	}
+
+	if (nodeboxes.size() > U8_MAX ||
+			cache->boxes.size() + nodeboxes.size() > U16_MAX)
+		return MapBlockCollisionCache::DYNAMIC;
+
+	MapBlockCollisionCache::Shape shape;
+	shape.key = key;
+	shape.first = cache->boxes.size();
+	shape.count = nodeboxes.size();
+	shape.bouncy = n_bouncy_value;
+	cache->shapes.push_back(shape);
+	cache->boxes.insert(cache->boxes.end(), nodeboxes.begin(), nodeboxes.end());
+	return cache->shapes.size() - 1;
+}
+
 static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *gamedef,
 		Environment *env, std::vector<NearbyCollisionInfo> &cinfo)
 {
@@ -267,33 +318,50 @@ static bool add_area_node_boxes(const v3s16 min, const v3s16 max, IGameDef *game
 			continue;
 		}
 
-		const MapNode n = block->getNodeNoCheck(relp);
-
-		if (n.getContent() != CONTENT_IGNORE) {
-			any_position_valid = true;
-			const ContentFeatures &f = nodedef->get(n);
-
-			if (!f.walkable)
-				continue;
-
-			// Negative bouncy may have a meaning, but we need +value here.
-			int n_bouncy_value = abs(itemgroup_get(f.groups, "bouncy"));
+		MapBlockCollisionCache *cache = block->getCollisionCache();
+		u8 &shape_index = cache->shape[relp.Z * MAP_BLOCKSIZE * MAP_BLOCKSIZE +
+				relp.Y * MAP_BLOCKSIZE + relp.X];
+		if (shape_index == MapBlockCollisionCache::UNKNOWN)
+			shape_index = fill_collision_cache_entry(block, relp, nodedef, cache);
 
-			u8 neighbors = n.getNeighbors(p, map);
+		if (shape_index == MapBlockCollisionCache::IGNORE) {
+			// Collide with loaded CONTENT_IGNORE nodes
+			aabb3f box = getNodeBox(p, BS);
+			cinfo.emplace_back(true, 0, p, box);
+			continue;
+		}
 
-			nodeboxes.clear();
-			n.getCollisionBoxes(nodedef, &nodeboxes, neighbors);
+		any_position_valid = true;
+		v3f posf = intToFloat(p, BS);
 
-			v3f posf = intToFloat(p, BS);
-			for (auto box : nodeboxes) {
+		if (shape_index != MapBlockCollisionCache::DYNAMIC) {
+			const MapBlockCollisionCache::Shape &shape = cache->shapes[shape_index];
+			for (u32 i = shape.first; i < shape.first + shape.count; i++) {
+				aabb3f box = cache->boxes[i];
 				box.MinEdge += posf;
 				box.MaxEdge += posf;
-				cinfo.emplace_back(false, n_bouncy_value, p, box);
+				cinfo.emplace_back(false, shape.bouncy, p, box);
 			}
-		} else {
-			// Collide with loaded CONTENT_IGNORE nodes
-			aabb3f box = getNodeBox(p, BS);
-			cinfo.emplace_back(true, 0, p, box);
+			continue;
+		}
+
+		const MapNode n = block->getNodeNoCheck(relp);
+		const ContentFeatures &f = nodedef->get(n);
+		if (!f.walkable)
+			continue;
+
+		// Negative bouncy may have a meaning, but we need +value here.
+		int n_bouncy_value = abs(itemgroup_get(f.groups, "bouncy"));
+
+		u8 neighbors = n.getNeighbors(p, map);
+
+		nodeboxes.clear();
+		n.getCollisionBoxes(nodedef, &nodeboxes, neighbors);
+
+		for (auto box : nodeboxes) {
+			box.MinEdge += posf;
+			box.MaxEdge += posf;
+			cinfo.emplace_back(false, n_bouncy_value, p, box);
 		}
 	}
 
@@ -371,7 +439,58 @@ static void add_object_boxes(Environment *env,
 	}
 }
 
-#define PROFILER_NAME(text) (dynamic_cast<ServerEnvironment*>(env) ? ("Server: " text) : ("Client: " text))
+#define COLLISION_METRIC(text) [env] () -> const ProfilerMetric & { \
+		static const ProfilerMetric server("Server: " text, PRECISION_MICRO); \
+		static const ProfilerMetric client("Client: " text, PRECISION_MICRO); \
+		return dynamic_cast<ServerEnvironment*>(env) ? server : client; \
+	}()
+
+// Nodes that are looked at for a movement
+static void getMovementArea(const aabb3f &box_0, f32 dtime, v3f pos_f,
+		v3f aspeed_f, v3s16 &min, v3s16 &max)
+{
+	// Movement if no collisions
+	v3f newpos_f = pos_f + aspeed_f * dtime;
+	v3f minpos_f(
+		MYMIN(pos_f.X, newpos_f.X),
+		MYMIN(pos_f.Y, newpos_f.Y) + 0.01f * BS, // bias rounding, player often at +/-n.5
+		MYMIN(pos_f.Z, newpos_f.Z)
+	);
+	v3f maxpos_f(
+		MYMAX(pos_f.X, newpos_f.X),
+		MYMAX(pos_f.Y, newpos_f.Y),
+		MYMAX(pos_f.Z, newpos_f.Z)
+	);
+	min = floatToInt(minpos_f + box_0.MinEdge, BS) - v3s16(1, 1, 1);
+	max = floatToInt(maxpos_f + box_0.MaxEdge, BS) + v3s16(1, 1, 1);
+}
+
+bool getFreeMovement(const aabb3f &box_0, f32 dtime,
+		v3f pos_f, v3f speed_f, v3f accel_f, FreeMovement &result)
+{
+	// collisionMoveSimple() limits dtime and warns about it
+	if (dtime > DTIME_LIMIT)
+		return false;
+
+	result.pos = pos_f;
+	result.speed = speed_f;
+	// Not moving at all
+	if (speed_f == v3f() && accel_f == v3f()) {
+		result.area_min = v3s16(0, 0, 0);
+		result.area_max = v3s16(-1, -1, -1);
+		return true;
+	}
+
+	// Same as the no-collision case of collisionMoveSimple()
+	v3f aspeed_f = speed_f + accel_f * 0.5f * dtime;
+	aspeed_f = truncate(rangelimv(aspeed_f, -5000.0f, 5000.0f), 10000.0f);
+	getMovementArea(box_0, dtime, pos_f, aspeed_f, result.area_min, result.area_max);
+
+	result.pos += aspeed_f * dtime;
+	result.speed += accel_f * dtime;
+	result.speed = truncate(rangelimv(result.speed, -5000.0f, 5000.0f), 10000.0f);
+	return true;
+}
 
 collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 		const aabb3f &box_0,
@@ -382,7 +501,7 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 {
 	static bool time_notification_done = false;
 
-	ScopeProfiler sp(g_profiler, PROFILER_NAME("collisionMoveSimple()"), SPT_AVG, PRECISION_MICRO);
+	ScopeProfiler sp(g_profiler, COLLISION_METRIC("collisionMoveSimple()"), SPT_AVG);
 
 	collisionMoveResult result;
 
@@ -416,20 +535,8 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 	thread_local std::vector<NearbyCollisionInfo> cinfo;
 	cinfo.clear();
 	{
-		// Movement if no collisions
-		v3f newpos_f = *pos_f + aspeed_f * dtime;
-		v3f minpos_f(
-			MYMIN(pos_f->X, newpos_f.X),
-			MYMIN(pos_f->Y, newpos_f.Y) + 0.01f * BS, // bias rounding, player often at +/-n.5
-			MYMIN(pos_f->Z, newpos_f.Z)
-		);
-		v3f maxpos_f(
-			MYMAX(pos_f->X, newpos_f.X),
-			MYMAX(pos_f->Y, newpos_f.Y),
-			MYMAX(pos_f->Z, newpos_f.Z)
-		);
-		v3s16 min = floatToInt(minpos_f + box_0.MinEdge, BS) - v3s16(1, 1, 1);
-		v3s16 max = floatToInt(maxpos_f + box_0.MaxEdge, BS) + v3s16(1, 1, 1);
+		v3s16 min, max;
+		getMovementArea(box_0, dtime, *pos_f, aspeed_f, min, max);
 
 		bool any_position_valid = add_area_node_boxes(min, max, gamedef, env, cinfo);
 
@@ -644,7 +751,7 @@ bool collision_check_intersection(Environment *env, IGameDef *gamedef,
 		const aabb3f &box_0, const v3f &pos_f, ActiveObject *self,
 		bool collide_with_objects)
 {
-	ScopeProfiler sp(g_profiler, PROFILER_NAME("collision_check_intersection()"), SPT_AVG, PRECISION_MICRO);
+	ScopeProfiler sp(g_profiler, COLLISION_METRIC("collision_check_intersection()"), SPT_AVG);
 
 	std::vector<NearbyCollisionInfo> cinfo;
 	{
@@ -5,6 +5,9 @@
 #pragma once
 
 #include "irrlichttypes_bloated.h"
+#include "irr_aabb3d.h"
+#include "constants.h"
+#include <cstring>
 #include <vector>
 
 class IGameDef;
@@ -48,6 +51,37 @@ struct collisionMoveResult
 	std::vector<CollisionInfo> collisions;
 };
 
+/// Collision boxes of the nodes of a mapblock, relative to the node position.
+/// Filled node by node as the collision code needs them, the mapblock drops
+/// it whenever one of its nodes changes or when it was not used for a while.
+struct MapBlockCollisionCache
+{
+	// Values of shape[] that are not an index into shapes
+	static constexpr u8 UNKNOWN = 0xFF; // not looked at yet
+	static constexpr u8 IGNORE = 0xFE; // CONTENT_IGNORE
+	static constexpr u8 DYNAMIC = 0xFD; // depends on the neighbors, not cached
+	static constexpr u8 MAX_SHAPES = 0xFD;
+
+	// Seconds after which an unused cache is dropped, see MapBlock::incrementUsageTimer()
+	static constexpr float UNUSED_TIMEOUT = 10.0f;
+
+	// Boxes shared by all nodes with the same content and param2
+	struct Shape {
+		u32 key; // content << 8 | param2
+		u16 first; // index into boxes
+		u8 count;
+		u8 bouncy;
+	};
+
+	u8 shape[MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	std::vector<Shape> shapes;
+	std::vector<aabb3f> boxes;
+	// Seconds since the collision code last used the cache
+	float unused_time = 0.0f;
+
+	MapBlockCollisionCache() { memset(shape, UNKNOWN, sizeof(shape)); }
+};
+
 /// Status if any problems were ever encountered during collision detection.
 /// @warning For unit test use only.
 extern bool g_collision_problems_encountered;
@@ -60,6 +94,22 @@ collisionMoveResult collisionMoveSimple(Environment *env, IGameDef *gamedef,
 		v3f accel_f, ActiveObject *self=NULL,
 		bool collide_with_objects=true);
 
+/// Result of collisionMoveSimple() if nothing is in the way
+struct FreeMovement
+{
+	/// Nodes that must be loaded and not walkable
+	v3s16 area_min, area_max;
+	v3f pos;
+	v3f speed;
+};
+
+/// @brief Moves like collisionMoveSimple() would, but leaves checking for
+///        collisions to the caller. Lets callers that already know the free
+///        space around them skip the full collision detection.
+/// @returns `false` if the movement must go through collisionMoveSimple()
+bool getFreeMovement(const aabb3f &box_0, f32 dtime,
+		v3f pos_f, v3f speed_f, v3f accel_f, FreeMovement &result);
+
 /// @brief A simpler version of "collisionMoveSimple" that only checks whether
 ///        a collision occurs at the given position.
 /// @param self (optional) ActiveObject to ignore in the collision detection.
@@ -454,6 +454,31 @@ void CraftDefinitionShaped::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+bool CraftDefinitionShaped::getPattern(CraftPattern &pattern) const
+{
+	assert(hash_inited); // Pre-condition
+	if (width == 0)
+		return false;
+	std::vector<std::string> rec_names = recipe_names;
+	while (rec_names.size() % width != 0)
+		rec_names.emplace_back("");
+
+	unsigned int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+	if (!craftGetBounds(rec_names, width, min_x, max_x, min_y, max_y))
+		return false;
+
+	pattern.method = CRAFT_METHOD_NORMAL;
+	pattern.shapeless = false;
+	pattern.width = max_x - min_x + 1;
+	pattern.height = max_y - min_y + 1;
+	pattern.slots.clear();
+	for (unsigned int y = min_y; y <= max_y; y++) {
+		for (unsigned int x = min_x; x <= max_x; x++)
+			pattern.slots.push_back(rec_names[y * width + x]);
+	}
+	return true;
+}
+
 std::string CraftDefinitionShaped::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -706,6 +731,19 @@ void CraftDefinitionShapeless::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+bool CraftDefinitionShapeless::getPattern(CraftPattern &pattern) const
+{
+	assert(hash_inited); // Pre-condition
+	if (recipe_names.empty())
+		return false;
+	pattern.method = CRAFT_METHOD_NORMAL;
+	pattern.shapeless = true;
+	pattern.width = recipe_names.size();
+	pattern.height = 1;
+	pattern.slots = recipe_names;
+	return true;
+}
+
 std::string CraftDefinitionShapeless::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -909,6 +947,17 @@ void CraftDefinitionCooking::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+bool CraftDefinitionCooking::getPattern(CraftPattern &pattern) const
+{
+	assert(hash_inited); // Pre-condition
+	pattern.method = CRAFT_METHOD_COOKING;
+	pattern.shapeless = true;
+	pattern.width = 1;
+	pattern.height = 1;
+	pattern.slots = {recipe_name};
+	return true;
+}
+
 std::string CraftDefinitionCooking::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -1012,6 +1061,17 @@ void CraftDefinitionFuel::initHash(IGameDef *gamedef)
 		hash_type = CRAFT_HASH_TYPE_ITEM_NAMES;
 }
 
+bool CraftDefinitionFuel::getPattern(CraftPattern &pattern) const
+{
+	assert(hash_inited); // Pre-condition
+	pattern.method = CRAFT_METHOD_FUEL;
+	pattern.shapeless = true;
+	pattern.width = 1;
+	pattern.height = 1;
+	pattern.slots = {recipe_name};
+	return true;
+}
+
 std::string CraftDefinitionFuel::dump() const
 {
 	std::ostringstream os(std::ios::binary);
@@ -1025,6 +1085,16 @@ std::string CraftDefinitionFuel::dump() const
 	Craft definition manager
 */
 
+// Size limit of indexed patterns, so that keys stay unique
+constexpr unsigned int CRAFT_INDEX_SIZE_MAX = 0x3fff;
+
+static u64 craftIndexKey(CraftMethod method, bool shapeless,
+		unsigned int width, unsigned int height, u32 first_matcher)
+{
+	return (u64)first_matcher << 32 | (u64)method << 30 | (u64)shapeless << 28 |
+		(u64)height << 14 | width;
+}
+
 class CCraftDefManager: public IWritableCraftDefManager
 {
 public:
@@ -1054,6 +1124,26 @@ class CCraftDefManager: public IWritableCraftDefManager
 		CraftDefinition::RecipePriority priority_best =
 			CraftDefinition::PRIORITY_NO_RECIPE;
 		CraftDefinition *def_best = nullptr;
+		auto try_def = [&] (CraftDefinition *def) {
+			CraftDefinition::RecipePriority priority = def->getPriority();
+			if (priority <= priority_best || !def->check(input, gamedef))
+				return;
+
+			// Check if the crafted node/item exists
+			CraftOutput out = def->getOutput(input, gamedef);
+			ItemStack is;
+			is.deSerialize(out.item, gamedef->idef());
+			if (!is.isKnown(gamedef->idef())) {
+				infostream << "trying to craft non-existent "
+					<< out.item << ", ignoring recipe" << std::endl;
+				return;
+			}
+
+			output = out;
+			priority_best = priority;
+			def_best = def;
+		};
+
 		for (int type = 0; type <= craft_hash_type_max; type++) {
 			u64 hash = getHashForGrid((CraftHashType) type, input_names);
 
@@ -1076,25 +1166,16 @@ class CCraftDefManager: public IWritableCraftDefManager
 				/*errorstream << "Checking " << input.dump() << std::endl
 					<< " against " << def->dump() << std::endl;*/
 
-				CraftDefinition::RecipePriority priority = def->getPriority();
-				if (priority > priority_best
-						&& def->check(input, gamedef)) {
-					// Check if the crafted node/item exists
-					CraftOutput out = def->getOutput(input, gamedef);
-					ItemStack is;
-					is.deSerialize(out.item, gamedef->idef());
-					if (!is.isKnown(gamedef->idef())) {
-						infostream << "trying to craft non-existent "
-							<< out.item << ", ignoring recipe" << std::endl;
-						continue;
-					}
-
-					output = out;
-					priority_best = priority;
-					def_best = def;
-				}
+				try_def(def);
 			}
 		}
+
+		// Recipes with groups, also from back to front
+		std::vector<const IndexedRecipe *> candidates;
+		findIndexedRecipes(input, gamedef->idef(), candidates);
+		for (const IndexedRecipe *recipe : candidates)
+			try_def(recipe->def);
+
 		if (priority_best == CraftDefinition::PRIORITY_NO_RECIPE)
 			return false;
 		if (decrementInput)
@@ -1194,6 +1275,13 @@ class CCraftDefManager: public IWritableCraftDefManager
 				}
 			}
 		}
+		for (const auto &it : m_recipe_index) {
+			for (const IndexedRecipe &recipe : it.second) {
+				os << "indexed " << it.first
+					<< " def " << recipe.def->dump()
+					<< "\n";
+			}
+		}
 		return os.str();
 	}
 	virtual void registerCraft(CraftDefinition *def, IGameDef *gamedef)
@@ -1218,6 +1306,15 @@ class CCraftDefManager: public IWritableCraftDefManager
 			}
 			m_craft_defs[type].clear();
 		}
+		for (auto &it : m_recipe_index) {
+			for (auto &recipe : it.second)
+				delete recipe.def;
+		}
+		m_recipe_index.clear();
+		m_indexed_count = 0;
+		m_matcher_ids.clear();
+		m_matcher_groups.clear();
+		m_group_matchers.clear();
 		m_output_craft_definitions.clear();
 	}
 	virtual void initHashes(IGameDef *gamedef)
@@ -1225,10 +1322,20 @@ class CCraftDefManager: public IWritableCraftDefManager
 		// Move the CraftDefs from the unhashed layer into layers higher up.
 		std::vector<CraftDefinition *> &unhashed =
 			m_craft_defs[(int) CRAFT_HASH_TYPE_UNHASHED][0];
+		CraftPattern pattern;
 		for (auto def : unhashed) {
 			// Initialize and get the definition's hash
 			def->initHash(gamedef);
 			CraftHashType type = def->getHashType();
+
+			// Recipes with groups would all end up in a few count buckets
+			if (type == CRAFT_HASH_TYPE_COUNT && def->getPattern(pattern) &&
+					pattern.width <= CRAFT_INDEX_SIZE_MAX &&
+					pattern.height <= CRAFT_INDEX_SIZE_MAX) {
+				addIndexedRecipe(def, pattern);
+				continue;
+			}
+
 			u64 hash = def->getHash(type);
 
 			// Enter the definition
@@ -1237,10 +1344,213 @@ class CCraftDefManager: public IWritableCraftDefManager
 		unhashed.clear();
 	}
 private:
+	/*
+		Recipes with groups are indexed by their pattern. Every distinct slot
+		("" for empty, an item name or "group:...") gets a matcher id. Inputs
+		are turned into the matcher ids each slot satisfies, which finds the
+		recipes by their first slot and rules out most others without check().
+	*/
+	struct IndexedRecipe {
+		CraftDefinition *def;
+		// Registration order, later recipes override earlier ones
+		u32 order;
+		std::vector<u32> slots;
+	};
+
+	u32 getMatcherId(const std::string &slot)
+	{
+		auto it = m_matcher_ids.find(slot);
+		if (it != m_matcher_ids.end())
+			return it->second;
+
+		u32 id = m_matcher_groups.size();
+		m_matcher_ids.emplace(slot, id);
+		m_matcher_groups.emplace_back();
+		if (isGroupRecipeStr(slot)) {
+			// Same parsing as inputItemMatchesRecipe()
+			std::vector<std::string> &groups = m_matcher_groups.back();
+			Strfnd f(slot.substr(6));
+			do {
+				groups.push_back(f.next(","));
+			} while (!f.at_end());
+			m_group_matchers[groups[0]].push_back(id);
+		}
+		return id;
+	}
+
+	void addIndexedRecipe(CraftDefinition *def, const CraftPattern &pattern)
+	{
+		IndexedRecipe recipe;
+		recipe.def = def;
+		recipe.order = m_indexed_count++;
+		for (const std::string &slot : pattern.slots)
+			recipe.slots.push_back(getMatcherId(slot));
+
+		// Shapeless recipes are found by any of their slots, so prefer an
+		// item name over a group, which matches more inputs
+		u32 first = recipe.slots[0];
+		if (pattern.shapeless) {
+			for (u32 id : recipe.slots) {
+				if (m_matcher_groups[id].empty()) {
+					first = id;
+					break;
+				}
+			}
+		}
+		m_recipe_index[craftIndexKey(pattern.method, pattern.shapeless,
+				pattern.width, pattern.height, first)].push_back(std::move(recipe));
+	}
+
+	// Gets the sorted matcher ids that an item satisfies
+	void getMatchers(const std::string &name, IItemDefManager *idef,
+			std::vector<u32> &ids) const
+	{
+		ids.clear();
+		auto it = m_matcher_ids.find(name);
+		if (it != m_matcher_ids.end())
+			ids.push_back(it->second);
+		if (name.empty() || m_group_matchers.empty() || !idef->isKnown(name))
+			return;
+
+		// Group matchers are listed under their first group
+		const ItemGroupList &groups = idef->get(name).groups;
+		for (const auto &group : groups) {
+			if (group.second == 0)
+				continue;
+			auto git = m_group_matchers.find(group.first);
+			if (git == m_group_matchers.end())
+				continue;
+			for (u32 id : git->second) {
+				bool all_groups_match = true;
+				for (const std::string &check_group : m_matcher_groups[id]) {
+					if (itemgroup_get(groups, check_group) == 0) {
+						all_groups_match = false;
+						break;
+					}
+				}
+				if (all_groups_match)
+					ids.push_back(id);
+			}
+		}
+		std::sort(ids.begin(), ids.end());
+	}
+
+	// Finds the indexed recipes that may match, latest first
+	void findIndexedRecipes(const CraftInput &input, IItemDefManager *idef,
+			std::vector<const IndexedRecipe *> &candidates) const
+	{
+		if (m_recipe_index.empty())
+			return;
+
+		// Matchers of each distinct item name of the input, never reallocated
+		// so that references stay valid
+		std::vector<std::pair<const std::string *, std::vector<u32>>> cache;
+		cache.reserve(input.items.size() + 1);
+		auto matchers_of = [&] (const std::string &name) -> const std::vector<u32> & {
+			for (const auto &it : cache) {
+				if (*it.first == name)
+					return it.second;
+			}
+			cache.emplace_back(&name, std::vector<u32>());
+			getMatchers(name, idef, cache.back().second);
+			return cache.back().second;
+		};
+		auto contains = [] (const std::vector<u32> &ids, u32 id) {
+			return std::binary_search(ids.begin(), ids.end(), id);
+		};
+		static const std::string empty_name;
+
+		// Shaped: the bounding boxes have to match slot by slot
+		if (input.method == CRAFT_METHOD_NORMAL && input.width > 0) {
+			const unsigned int inp_width = input.width;
+			unsigned int min_x = inp_width, max_x = 0, min_y = 0, max_y = 0;
+			bool found = false;
+			for (size_t i = 0; i < input.items.size(); i++) {
+				if (input.items[i].name.empty())
+					continue;
+				unsigned int x = i % inp_width, y = i / inp_width;
+				if (!found)
+					min_y = y;
+				found = true;
+				min_x = std::min(min_x, x);
+				max_x = std::max(max_x, x);
+				max_y = y;
+			}
+			const unsigned int w = max_x - min_x + 1, h = max_y - min_y + 1;
+			if (found && w <= CRAFT_INDEX_SIZE_MAX && h <= CRAFT_INDEX_SIZE_MAX) {
+				std::vector<const std::vector<u32> *> slot_matchers;
+				slot_matchers.reserve(w * h);
+				for (unsigned int y = min_y; y <= max_y; y++) {
+					for (unsigned int x = min_x; x <= max_x; x++) {
+						size_t i = y * inp_width + x;
+						slot_matchers.push_back(&matchers_of(
+							i < input.items.size() ? input.items[i].name : empty_name));
+					}
+				}
+				for (u32 first : *slot_matchers[0]) {
+					auto it = m_recipe_index.find(craftIndexKey(
+							CRAFT_METHOD_NORMAL, false, w, h, first));
+					if (it == m_recipe_index.end())
+						continue;
+					for (const IndexedRecipe &recipe : it->second) {
+						bool match = true;
+						for (size_t i = 1; i < recipe.slots.size() && match; i++)
+							match = contains(*slot_matchers[i], recipe.slots[i]);
+						if (match)
+							candidates.push_back(&recipe);
+					}
+				}
+			}
+		}
+
+		// Shapeless: every slot has to be satisfied by some input item
+		std::vector<u32> all_matchers;
+		u32 count = 0;
+		for (const ItemStack &item : input.items) {
+			if (item.name.empty())
+				continue;
+			count++;
+			const std::vector<u32> &ids = matchers_of(item.name);
+			all_matchers.insert(all_matchers.end(), ids.begin(), ids.end());
+		}
+		std::sort(all_matchers.begin(), all_matchers.end());
+		all_matchers.erase(std::unique(all_matchers.begin(), all_matchers.end()),
+				all_matchers.end());
+		if (count > 0 && count <= CRAFT_INDEX_SIZE_MAX) {
+			for (u32 first : all_matchers) {
+				auto it = m_recipe_index.find(craftIndexKey(
+						input.method, true, count, 1, first));
+				if (it == m_recipe_index.end())
+					continue;
+				for (const IndexedRecipe &recipe : it->second) {
+					bool match = true;
+					for (size_t i = 0; i < recipe.slots.size() && match; i++)
+						match = contains(all_matchers, recipe.slots[i]);
+					if (match)
+						candidates.push_back(&recipe);
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(),
+			[] (const IndexedRecipe *r1, const IndexedRecipe *r2) {
+				return r1->order > r2->order;
+			});
+	}
+
 	std::vector<std::unordered_map<u64, std::vector<CraftDefinition*> > >
 		m_craft_defs;
 	std::unordered_map<std::string, std::vector<CraftDefinition*> >
 		m_output_craft_definitions;
+
+	// Indexed recipes by method, shape and first matcher
+	std::unordered_map<u64, std::vector<IndexedRecipe>> m_recipe_index;
+	u32 m_indexed_count = 0;
+	std::unordered_map<std::string, u32> m_matcher_ids;
+	// Groups of each matcher, empty if it isn't a group
+	std::vector<std::vector<std::string>> m_matcher_groups;
+	// Group matcher ids by their first group
+	std::unordered_map<std::string, std::vector<u32>> m_group_matchers;
 };
 
 IWritableCraftDefManager* createCraftDefManager()
@@ -109,6 +109,22 @@ struct CraftReplacements
 	std::string dump() const;
 };
 
+/*
+	The slots every matching input has, used to index recipes with groups.
+	A slot is an item name, "group:..." or "" for an empty slot.
+*/
+struct CraftPattern
+{
+	CraftMethod method = CRAFT_METHOD_NORMAL;
+	// Shapeless patterns are a single row in any order
+	bool shapeless = false;
+	// Size of the bounding box of the non-empty slots
+	unsigned int width = 0;
+	unsigned int height = 0;
+	// Slots of the bounding box, row by row
+	std::vector<std::string> slots;
+};
+
 /*
 	Crafting definition base class
 */
@@ -162,6 +178,10 @@ class CraftDefinition
 	// to be called after all mods are loaded, so that we catch all aliases
 	virtual void initHash(IGameDef *gamedef) = 0;
 
+	// Gets the pattern that check() requires, after initHash() was called
+	// Returns false if the recipe can't be described by one
+	virtual bool getPattern(CraftPattern &pattern) const { return false; }
+
 	virtual std::string dump() const=0;
 
 protected:
@@ -197,6 +217,7 @@ class CraftDefinitionShaped: public CraftDefinition
 	virtual u64 getHash(CraftHashType type) const;
 
 	virtual void initHash(IGameDef *gamedef);
+	virtual bool getPattern(CraftPattern &pattern) const;
 
 	virtual std::string dump() const;
 
@@ -241,6 +262,7 @@ class CraftDefinitionShapeless: public CraftDefinition
 	virtual u64 getHash(CraftHashType type) const;
 
 	virtual void initHash(IGameDef *gamedef);
+	virtual bool getPattern(CraftPattern &pattern) const;
 
 	virtual std::string dump() const;
 
@@ -322,6 +344,7 @@ class CraftDefinitionCooking: public CraftDefinition
 	virtual u64 getHash(CraftHashType type) const;
 
 	virtual void initHash(IGameDef *gamedef);
+	virtual bool getPattern(CraftPattern &pattern) const;
 
 	virtual std::string dump() const;
 
@@ -365,6 +388,7 @@ class CraftDefinitionFuel: public CraftDefinition
 	virtual u64 getHash(CraftHashType type) const;
 
 	virtual void initHash(IGameDef *gamedef);
+	virtual bool getPattern(CraftPattern &pattern) const;
 
 	virtual std::string dump() const;
 
@@ -11,8 +11,10 @@
 #include "filesys.h"
 #include "server/player_sao.h"
 #include "util/string.h"
+#include "util/serialize.h"
 #include <json/json.h>
 #include <cassert>
+#include <sstream>
 
 // !!! WARNING !!!
 // This backend is intended to be used on Minetest 0.4.16 only for the transition backend
@@ -524,3 +526,337 @@ Json::Value *ModStorageDatabaseFiles::getOrCreateJson(const std::string &modname
 
 	return &(m_mod_storage[modname] = std::move(meta));
 }
+
+/*
+	Binary mod storage log, starting with MODSTORAGE_LOG_HEADER.
+	Each record is:
+	u8 op
+	u16 len, modname
+	if op != REMOVE_MOD: u32 len, key
+	if op == SET: u32 len, value
+*/
+
+static constexpr std::string_view MODSTORAGE_LOG_HEADER("MTMS\x01", 5);
+
+enum ModStorageLogOp : u8 {
+	MODSTORAGE_LOG_SET = 0,
+	MODSTORAGE_LOG_REMOVE = 1,
+	MODSTORAGE_LOG_REMOVE_MOD = 2,
+};
+
+// Compact the log once at least this much and half of it is garbage
+static constexpr u64 MODSTORAGE_LOG_COMPACT_MIN = 1024 * 1024;
+
+// Appends a record to out, returns the offset of its value in out
+static size_t write_modstorage_record(std::string &out, u8 op,
+	std::string_view modname, std::string_view key, std::string_view value)
+{
+	out.push_back((char)op);
+	out.append(serializeString16(modname));
+	if (op == MODSTORAGE_LOG_REMOVE_MOD)
+		return out.size();
+	out.append(serializeString32(key));
+	if (op == MODSTORAGE_LOG_REMOVE)
+		return out.size();
+	out.append(serializeString32(value));
+	return out.size() - value.size();
+}
+
+ModStorageDatabaseBinary::ModStorageDatabaseBinary(const std::string &savedir):
+	m_path(savedir + DIR_DELIM + "mod_storage.bin")
+{
+	load();
+}
+
+ModStorageDatabaseBinary::~ModStorageDatabaseBinary()
+{
+	writePending();
+}
+
+void ModStorageDatabaseBinary::load()
+{
+	std::string data;
+	if (!fs::PathExists(m_path))
+		return;
+	if (!fs::ReadFile(m_path, data, true))
+		throw DatabaseException("ModStorageDatabaseBinary: cannot read " + m_path);
+	if (data.compare(0, MODSTORAGE_LOG_HEADER.size(), MODSTORAGE_LOG_HEADER) != 0)
+		throw DatabaseException("ModStorageDatabaseBinary: " + m_path +
+			" is not a mod storage log");
+
+	std::istringstream is(std::move(data), std::ios::binary);
+	is.seekg(MODSTORAGE_LOG_HEADER.size());
+	u64 end = MODSTORAGE_LOG_HEADER.size();
+	bool truncated = false;
+	try {
+		while (canRead(is)) {
+			const u8 op = readU8(is);
+			const std::string modname = deSerializeString16(is);
+			if (op == MODSTORAGE_LOG_REMOVE_MOD) {
+				const u64 start = end;
+				end = is.tellg();
+				indexRemoveMod(modname);
+				m_garbage += end - start;
+				continue;
+			}
+			const std::string key = deSerializeString32(is);
+			if (op == MODSTORAGE_LOG_REMOVE) {
+				const u64 start = end;
+				end = is.tellg();
+				indexRemove(modname, key);
+				m_garbage += end - start;
+				continue;
+			}
+			if (op != MODSTORAGE_LOG_SET)
+				throw SerializationError("unknown record type");
+			const std::string value = deSerializeString32(is);
+			const u64 start = end;
+			end = is.tellg();
+			indexSet(modname, key, {end - value.size(), (u32)value.size(), (u32)(end - start)});
+		}
+	} catch (SerializationError &e) {
+		// Most likely a crash in the middle of writing a record
+		warningstream << "ModStorageDatabaseBinary: dropping incomplete data at the end of "
+			<< m_path << ": " << e.what() << std::endl;
+		truncated = true;
+	}
+	m_file_size = end;
+
+	if (truncated && !compact())
+		throw DatabaseException("ModStorageDatabaseBinary: cannot repair " + m_path);
+}
+
+bool ModStorageDatabaseBinary::compact()
+{
+	std::string out(MODSTORAGE_LOG_HEADER);
+	std::unordered_map<std::string, ModIndex> index;
+	for (const auto &mod_it : m_index) {
+		ModIndex &mod = index[mod_it.first];
+		for (const auto &it : mod_it.second) {
+			const size_t start = out.size();
+			const std::string value = readValue(it.second);
+			const size_t offset = write_modstorage_record(out, MODSTORAGE_LOG_SET,
+				mod_it.first, it.first, value);
+			mod[it.first] = {offset, it.second.size, (u32)(out.size() - start)};
+		}
+	}
+
+	m_writer.close();
+	m_reader.close();
+	if (!fs::safeWriteToFile(m_path, out)) {
+		errorstream << "ModStorageDatabaseBinary: failed to compact " << m_path << std::endl;
+		return false;
+	}
+
+	m_index = std::move(index);
+	m_file_size = out.size();
+	m_garbage = 0;
+	return true;
+}
+
+ModStorageDatabaseBinary::Entry ModStorageDatabaseBinary::append(u8 op,
+	std::string_view modname, std::string_view key, std::string_view value)
+{
+	if (m_file_size == 0 && m_pending.empty())
+		m_pending.append(MODSTORAGE_LOG_HEADER);
+
+	const size_t start = m_pending.size();
+	const size_t offset = write_modstorage_record(m_pending, op, modname, key, value);
+	Entry entry{m_file_size + offset, (u32)value.size(), (u32)(m_pending.size() - start)};
+
+	if (!m_in_save)
+		writePending();
+	return entry;
+}
+
+bool ModStorageDatabaseBinary::writeToLog(std::string_view data)
+{
+	if (!m_writer.is_open())
+		m_writer = open_ofstream(m_path.c_str(), true, std::ios::app);
+	m_writer.write(data.data(), data.size());
+	m_writer.flush();
+	return m_writer.good();
+}
+
+bool ModStorageDatabaseBinary::writePending()
+{
+	if (m_pending.empty())
+		return true;
+
+	// Offsets of pending records are relative to m_file_size, so they must
+	// not be appended after the remains of a failed write
+	if (m_log_torn && !repairLog())
+		return false;
+
+	if (!writeToLog(m_pending)) {
+		errorstream << "ModStorageDatabaseBinary: failed to write to "
+			<< m_path << std::endl;
+		m_writer.close();
+		m_log_torn = true;
+		return false;
+	}
+
+	m_file_size += m_pending.size();
+	m_pending.clear();
+	return true;
+}
+
+bool ModStorageDatabaseBinary::repairLog()
+{
+	m_writer.close();
+	m_reader.close();
+
+	std::string data;
+	if (m_file_size > 0 && !fs::ReadFile(m_path, data, true))
+		return false;
+	if (data.size() < m_file_size) {
+		errorstream << "ModStorageDatabaseBinary: " << m_path
+			<< " is shorter than expected" << std::endl;
+		return false;
+	}
+	data.resize(m_file_size);
+	if (!fs::safeWriteToFile(m_path, data)) {
+		errorstream << "ModStorageDatabaseBinary: failed to repair "
+			<< m_path << std::endl;
+		return false;
+	}
+
+	m_log_torn = false;
+	return true;
+}
+
+std::string ModStorageDatabaseBinary::readValue(const Entry &entry)
+{
+	if (entry.offset >= m_file_size)
+		return m_pending.substr(entry.offset - m_file_size, entry.size);
+
+	if (!m_reader.is_open())
+		m_reader = open_ifstream(m_path.c_str(), true);
+	std::string value(entry.size, '\0');
+	m_reader.clear();
+	m_reader.seekg(entry.offset);
+	m_reader.read(value.data(), value.size());
+	if ((u32)m_reader.gcount() != entry.size)
+		throw DatabaseException("ModStorageDatabaseBinary: failed to read from " + m_path);
+	return value;
+}
+
+void ModStorageDatabaseBinary::indexSet(const std::string &modname,
+	const std::string &key, const Entry &entry)
+{
+	auto result = m_index[modname].emplace(key, entry);
+	if (!result.second) {
+		m_garbage += result.first->second.record_size;
+		result.first->second = entry;
+	}
+}
+
+void ModStorageDatabaseBinary::indexRemove(const std::string &modname, const std::string &key)
+{
+	auto mod = m_index.find(modname);
+	if (mod == m_index.end())
+		return;
+	auto it = mod->second.find(key);
+	if (it == mod->second.end())
+		return;
+	m_garbage += it->second.record_size;
+	mod->second.erase(it);
+	if (mod->second.empty())
+		m_index.erase(mod);
+}
+
+void ModStorageDatabaseBinary::indexRemoveMod(const std::string &modname)
+{
+	auto mod = m_index.find(modname);
+	if (mod == m_index.end())
+		return;
+	for (const auto &it : mod->second)
+		m_garbage += it.second.record_size;
+	m_index.erase(mod);
+}
+
+void ModStorageDatabaseBinary::getModEntries(const std::string &modname, StringMap *storage)
+{
+	auto mod = m_index.find(modname);
+	if (mod == m_index.end())
+		return;
+	for (const auto &it : mod->second)
+		(*storage)[it.first] = readValue(it.second);
+}
+
+void ModStorageDatabaseBinary::getModKeys(const std::string &modname,
+		std::vector<std::string> *storage)
+{
+	auto mod = m_index.find(modname);
+	if (mod == m_index.end())
+		return;
+	storage->reserve(storage->size() + mod->second.size());
+	for (const auto &it : mod->second)
+		storage->push_back(it.first);
+}
+
+bool ModStorageDatabaseBinary::getModEntry(const std::string &modname,
+	const std::string &key, std::string *value)
+{
+	auto mod = m_index.find(modname);
+	if (mod == m_index.end())
+		return false;
+	auto it = mod->second.find(key);
+	if (it == mod->second.end())
+		return false;
+	*value = readValue(it->second);
+	return true;
+}
+
+bool ModStorageDatabaseBinary::hasModEntry(const std::string &modname, const std::string &key)
+{
+	auto mod = m_index.find(modname);
+	return mod != m_index.end() && mod->second.count(key) > 0;
+}
+
+bool ModStorageDatabaseBinary::setModEntry(const std::string &modname,
+	const std::string &key, std::string_view value)
+{
+	indexSet(modname, key, append(MODSTORAGE_LOG_SET, modname, key, value));
+	return true;
+}
+
+bool ModStorageDatabaseBinary::removeModEntry(const std::string &modname,
+		const std::string &key)
+{
+	if (!hasModEntry(modname, key))
+		return false;
+	m_garbage += append(MODSTORAGE_LOG_REMOVE, modname, key).record_size;
+	indexRemove(modname, key);
+	return true;
+}
+
+bool ModStorageDatabaseBinary::removeModEntries(const std::string &modname)
+{
+	if (m_index.count(modname) == 0)
+		return false;
+	m_garbage += append(MODSTORAGE_LOG_REMOVE_MOD, modname).record_size;
+	indexRemoveMod(modname);
+	return true;
+}
+
+void ModStorageDatabaseBinary::listMods(std::vector<std::string> *res)
+{
+	for (const auto &pair : m_index)
+		res->push_back(pair.first);
+}
+
+void ModStorageDatabaseBinary::beginSave()
+{
+	m_in_save = true;
+}
+
+void ModStorageDatabaseBinary::endSave()
+{
+	m_in_save = false;
+	if (!writePending())
+		throw DatabaseException("ModStorageDatabaseBinary: failed to write to " + m_path);
+
+	if (m_garbage >= MODSTORAGE_LOG_COMPACT_MIN && m_garbage * 2 >= m_file_size)
+		compact();
+}
@@ -11,6 +11,7 @@
 #include "database.h"
 #include <unordered_map>
 #include <unordered_set>
+#include <fstream>
 #include <json/json.h> // for Json::Value
 
 class PlayerDatabaseFiles : public PlayerDatabase
@@ -84,3 +85,76 @@ class ModStorageDatabaseFiles : public ModStorageDatabase
 	std::unordered_map<std::string, Json::Value> m_mod_storage;
 	std::unordered_set<std::string> m_modified;
 };
+
+/*
+	Stores all mod storage entries in one append-only binary log.
+	Only the position of each value is kept in memory, so a change appends
+	one small record instead of rewriting all entries of the mod.
+	The log is compacted once most of it consists of overwritten records.
+*/
+class ModStorageDatabaseBinary : public ModStorageDatabase
+{
+public:
+	ModStorageDatabaseBinary(const std::string &savedir);
+	virtual ~ModStorageDatabaseBinary();
+
+	virtual void getModEntries(const std::string &modname, StringMap *storage);
+	virtual void getModKeys(const std::string &modname, std::vector<std::string> *storage);
+	virtual bool getModEntry(const std::string &modname,
+		const std::string &key, std::string *value);
+	virtual bool hasModEntry(const std::string &modname, const std::string &key);
+	virtual bool setModEntry(const std::string &modname,
+		const std::string &key, std::string_view value);
+	virtual bool removeModEntry(const std::string &modname, const std::string &key);
+	virtual bool removeModEntries(const std::string &modname);
+	virtual void listMods(std::vector<std::string> *res);
+
+	virtual void beginSave();
+	/// @throws DatabaseException if the log could not be written
+	virtual void endSave();
+	// Records are kept and written with the next save
+	virtual void rollbackSave() { m_in_save = false; }
+
+protected:
+	// Appends data to the end of the log file. On failure, any part of it
+	// may have reached the file.
+	virtual bool writeToLog(std::string_view data);
+
+private:
+	struct Entry {
+		// Location of the value in the log
+		u64 offset;
+		u32 size;
+		// Size of the whole record, which becomes garbage once overwritten
+		u32 record_size;
+	};
+	typedef std::unordered_map<std::string, Entry> ModIndex;
+
+	void load();
+	bool compact();
+	// Queues a record and returns the location of its value
+	Entry append(u8 op, std::string_view modname,
+		std::string_view key = {}, std::string_view value = {});
+	bool writePending();
+	// Cuts the log back to m_file_size after a failed write
+	bool repairLog();
+	std::string readValue(const Entry &entry);
+
+	void indexSet(const std::string &modname, const std::string &key, const Entry &entry);
+	void indexRemove(const std::string &modname, const std::string &key);
+	void indexRemoveMod(const std::string &modname);
+
+	std::string m_path;
+	std::unordered_map<std::string, ModIndex> m_index;
+	std::ofstream m_writer;
+	std::ifstream m_reader;
+	// Size of the log on disk
+	u64 m_file_size = 0;
+	// Records to be appended to the log at the end of the save
+	std::string m_pending;
+	// Bytes of the log that are no longer needed
+	u64 m_garbage = 0;
+	// A failed write may have left part of a record after m_file_size
+	bool m_log_torn = false;
+	bool m_in_save = false;
+};
@@ -181,6 +181,8 @@ class ModStorageDatabasePostgreSQL : private Database_PostgreSQL, public ModStor
 	bool removeModEntries(const std::string &modname);
 	void listMods(std::vector<std::string> *res);
 
+	void rollbackSave() { rollback(); }
+
 	PARENT_CLASS_FUNCS
 
 protected:
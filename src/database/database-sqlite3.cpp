@@ -106,6 +106,15 @@ void Database_SQLite3::endSave()
 	sqlite3_reset(m_stmt_end);
 }
 
+void Database_SQLite3::rollback()
+{
+	// SQLite may have rolled back by itself already
+	if (!m_database || sqlite3_get_autocommit(m_database))
+		return;
+	SQLOK(sqlite3_exec(m_database, "ROLLBACK;", NULL, NULL, NULL),
+		"Failed to roll back SQLite3 transaction");
+}
+
 void Database_SQLite3::openDatabase()
 {
 	if (m_database) return;
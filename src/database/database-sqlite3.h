@@ -21,6 +21,8 @@ class Database_SQLite3 : public Database
 
 	void beginSave() override;
 	void endSave() override;
+	// Discards the changes since beginSave(), if a transaction is open
+	void rollback();
 
 	bool initialized() const override { return m_initialized; }
 
@@ -283,6 +285,8 @@ class ModStorageDatabaseSQLite3 : private Database_SQLite3, public ModStorageDat
 	virtual bool removeModEntries(const std::string &modname);
 	virtual void listMods(std::vector<std::string> *res);
 
+	virtual void rollbackSave() { rollback(); }
+
 	PARENT_CLASS_FUNCS
 
 protected:
@@ -0,0 +1,399 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "database-writebehind.h"
+#include <algorithm>
+#include "log.h"
+#include "exceptions.h"
+#include "threading/mutex_auto_lock.h"
+#include "remoteplayer.h"
+#include "server/player_sao.h"
+
+ModStorageDatabaseWriteBehind::ModStorageDatabaseWriteBehind(ModStorageDatabase *backend) :
+	m_backend(backend),
+	m_thread("ModStorage", this)
+{
+	m_thread.start();
+}
+
+ModStorageDatabaseWriteBehind::~ModStorageDatabaseWriteBehind()
+{
+	m_thread.stop();
+	m_thread.wait();
+
+	endSave();
+	// Nobody is left to retry or to report the failure to
+	if (!flush()) {
+		errorstream << "ModStorageDatabaseWriteBehind: changes of these mod storage entries are lost:";
+		for (const auto &mod : m_queued) {
+			if (mod.second.clear)
+				errorstream << " " << mod.first << ":*";
+			for (const auto &it : mod.second.keys)
+				errorstream << " " << mod.first << ":" << it.first;
+		}
+		errorstream << std::endl;
+	}
+}
+
+void ModStorageDatabaseWriteBehind::mergeOlder(Changes &newer, Changes &&older)
+{
+	for (auto &it : older) {
+		auto found = newer.find(it.first);
+		if (found == newer.end()) {
+			newer.emplace(it.first, std::move(it.second));
+			continue;
+		}
+		ModChanges &mod = found->second;
+		// Everything older was removed anyway
+		if (mod.clear)
+			continue;
+		mod.clear = it.second.clear;
+		for (auto &key : it.second.keys)
+			mod.keys.try_emplace(key.first, std::move(key.second));
+	}
+}
+
+void ModStorageDatabaseWriteBehind::endSave()
+{
+	if (m_changes.empty())
+		return;
+
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		mergeOlder(m_changes, std::move(m_queued));
+		m_queued = std::move(m_changes);
+	}
+	m_changes.clear();
+	m_thread.deferUpdate();
+}
+
+bool ModStorageDatabaseWriteBehind::flush()
+{
+	MutexAutoLock backend_lock(m_backend_mutex);
+
+	Changes changes;
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		changes.swap(m_queued);
+	}
+	if (changes.empty())
+		return true;
+
+	try {
+		m_backend->beginSave();
+		for (const auto &mod : changes) {
+			if (mod.second.clear)
+				m_backend->removeModEntries(mod.first);
+			for (const auto &it : mod.second.keys) {
+				if (it.second)
+					m_backend->setModEntry(mod.first, it.first, *it.second);
+				else
+					m_backend->removeModEntry(mod.first, it.first);
+			}
+		}
+		m_backend->endSave();
+	} catch (BaseException &e) {
+		errorstream << "ModStorageDatabaseWriteBehind: failed to save, will retry: "
+			<< e.what() << std::endl;
+		// Don't leave the transaction of the backend open
+		try {
+			m_backend->rollbackSave();
+		} catch (BaseException &e) {
+			errorstream << "ModStorageDatabaseWriteBehind: failed to roll back: "
+				<< e.what() << std::endl;
+		}
+		// Keep the changes for the next attempt
+		{
+			MutexAutoLock lock(m_queue_mutex);
+			mergeOlder(m_queued, std::move(changes));
+		}
+		// The thread schedules its own retries
+		if (!m_thread.isCurrentThread())
+			m_thread.deferUpdate();
+		return false;
+	}
+	return true;
+}
+
+StringMap &ModStorageDatabaseWriteBehind::getMod(const std::string &modname)
+{
+	auto found = m_mods.find(modname);
+	if (found != m_mods.end())
+		return found->second;
+
+	// Changes are only made to loaded mods, so the backend has all entries
+	StringMap &mod = m_mods[modname];
+	MutexAutoLock lock(m_backend_mutex);
+	m_backend->getModEntries(modname, &mod);
+	return mod;
+}
+
+void ModStorageDatabaseWriteBehind::getModEntries(const std::string &modname,
+		StringMap *storage)
+{
+	for (const auto &it : getMod(modname))
+		(*storage)[it.first] = it.second;
+}
+
+void ModStorageDatabaseWriteBehind::getModKeys(const std::string &modname,
+		std::vector<std::string> *storage)
+{
+	const StringMap &mod = getMod(modname);
+	storage->reserve(storage->size() + mod.size());
+	for (const auto &it : mod)
+		storage->push_back(it.first);
+}
+
+bool ModStorageDatabaseWriteBehind::getModEntry(const std::string &modname,
+	const std::string &key, std::string *value)
+{
+	const StringMap &mod = getMod(modname);
+	auto found = mod.find(key);
+	if (found == mod.end())
+		return false;
+	*value = found->second;
+	return true;
+}
+
+bool ModStorageDatabaseWriteBehind::hasModEntry(const std::string &modname,
+		const std::string &key)
+{
+	return getMod(modname).count(key) > 0;
+}
+
+bool ModStorageDatabaseWriteBehind::setModEntry(const std::string &modname,
+	const std::string &key, std::string_view value)
+{
+	getMod(modname)[key] = value;
+	m_changes[modname].keys[key] = std::string(value);
+	return true;
+}
+
+bool ModStorageDatabaseWriteBehind::removeModEntry(const std::string &modname,
+		const std::string &key)
+{
+	if (getMod(modname).erase(key) == 0)
+		return false;
+	m_changes[modname].keys[key] = std::nullopt;
+	return true;
+}
+
+bool ModStorageDatabaseWriteBehind::removeModEntries(const std::string &modname)
+{
+	StringMap &mod = getMod(modname);
+	if (mod.empty())
+		return false;
+	mod.clear();
+	ModChanges &changes = m_changes[modname];
+	changes.clear = true;
+	changes.keys.clear();
+	return true;
+}
+
+void ModStorageDatabaseWriteBehind::listMods(std::vector<std::string> *res)
+{
+	std::vector<std::string> stored;
+	{
+		MutexAutoLock lock(m_backend_mutex);
+		m_backend->listMods(&stored);
+	}
+
+	// The backend may lag behind for the loaded mods
+	for (const auto &it : m_mods) {
+		if (!it.second.empty())
+			res->push_back(it.first);
+	}
+	for (std::string &modname : stored) {
+		if (m_mods.count(modname) == 0)
+			res->push_back(std::move(modname));
+	}
+}
+
+/*
+	PlayerDatabaseWriteBehind
+*/
+
+// Detached copy of everything the player databases save
+struct PlayerSnapshot
+{
+	PlayerSnapshot(RemotePlayer *src, IItemDefManager *idef);
+	~PlayerSnapshot();
+
+	// Loads the copy into a player like PlayerDatabase::loadPlayer()
+	void restore(RemotePlayer *dst, PlayerSAO *dst_sao);
+
+	RemotePlayer player;
+	PlayerSAO sao;
+};
+
+PlayerSnapshot::PlayerSnapshot(RemotePlayer *src, IItemDefManager *idef) :
+	player(src->getName(), idef),
+	// Not added to any environment, any valid peer id works
+	sao(nullptr, &player, 15000, false)
+{
+	PlayerSAO *src_sao = src->getPlayerSAO();
+	sanity_check(src_sao);
+
+	sao.accessObjectProperties()->breath_max = src_sao->accessObjectProperties()->breath_max;
+	sao.setHPRaw(src_sao->getHP());
+	sao.setBreath(src_sao->getBreath(), false);
+	sao.setBasePosition(src_sao->getBasePosition());
+	sao.setLookPitch(src_sao->getLookPitch());
+	sao.setPlayerYaw(src_sao->getRotation().Y);
+	for (const auto &it : src_sao->getMeta().getStrings())
+		sao.getMeta().setString(it.first, it.second);
+	player.inventory = src->inventory;
+
+	sao.finalize(&player, {});
+	player.setPlayerSAO(&sao);
+}
+
+PlayerSnapshot::~PlayerSnapshot()
+{
+	player.setPlayerSAO(nullptr);
+}
+
+void PlayerSnapshot::restore(RemotePlayer *dst, PlayerSAO *dst_sao)
+{
+	dst_sao->setLookPitch(sao.getLookPitch());
+	dst_sao->setPlayerYaw(sao.getRotation().Y);
+	dst_sao->setBasePosition(sao.getBasePosition());
+	dst_sao->setHPRaw(sao.getHP());
+	dst_sao->setBreath(sao.getBreath(), false);
+	for (const auto &it : sao.getMeta().getStrings())
+		dst_sao->getMeta().setString(it.first, it.second);
+	dst_sao->getMeta().setModified(false);
+	dst->inventory = player.inventory;
+}
+
+PlayerDatabaseWriteBehind::PlayerDatabaseWriteBehind(PlayerDatabase *backend,
+		IItemDefManager *idef) :
+	m_idef(idef),
+	m_backend(backend),
+	m_thread("PlayerSave", this)
+{
+	m_thread.start();
+}
+
+PlayerDatabaseWriteBehind::~PlayerDatabaseWriteBehind()
+{
+	m_thread.stop();
+	m_thread.wait();
+
+	// Nobody is left to retry or to report the failure to
+	if (!flush()) {
+		errorstream << "PlayerDatabaseWriteBehind: data of these players is lost:";
+		for (const auto &it : m_queued)
+			errorstream << " " << it.first;
+		errorstream << std::endl;
+	}
+}
+
+void PlayerDatabaseWriteBehind::savePlayer(RemotePlayer *player)
+{
+	// Writes happen later, so this reports the failures of earlier ones
+	const bool write_failed = m_write_failed;
+
+	auto snapshot = std::make_unique<PlayerSnapshot>(player, m_idef);
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		m_queued[player->getName()] = std::move(snapshot);
+	}
+	m_thread.deferUpdate();
+
+	// The player stays modified and is saved again next time
+	if (write_failed)
+		throw DatabaseException("Failed to save player " + player->getName() +
+			": writing to the player database failed");
+	player->onSuccessfulSave();
+}
+
+bool PlayerDatabaseWriteBehind::writeSnapshots(Snapshots &snapshots)
+{
+	bool success = true;
+	for (auto &it : snapshots) {
+		try {
+			m_backend->savePlayer(&it.second->player);
+		} catch (DatabaseException &e) {
+			errorstream << "Failed to save player " << it.first << ", will retry. Exception: "
+				<< e.what() << std::endl;
+			// Unless there is a newer copy by now
+			MutexAutoLock lock(m_queue_mutex);
+			m_queued.try_emplace(it.first, std::move(it.second));
+			success = false;
+		}
+	}
+
+	if (!snapshots.empty())
+		m_write_failed = !success;
+	// The thread schedules its own retries
+	if (!success && !m_thread.isCurrentThread())
+		m_thread.deferUpdate();
+	return success;
+}
+
+bool PlayerDatabaseWriteBehind::flush()
+{
+	MutexAutoLock backend_lock(m_backend_mutex);
+
+	Snapshots snapshots;
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		snapshots.swap(m_queued);
+	}
+	return writeSnapshots(snapshots);
+}
+
+bool PlayerDatabaseWriteBehind::loadPlayer(RemotePlayer *player, PlayerSAO *sao)
+{
+	MutexAutoLock backend_lock(m_backend_mutex);
+
+	// The player might have left just now
+	Snapshots snapshots;
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		auto found = m_queued.find(player->getName());
+		if (found != m_queued.end()) {
+			snapshots.emplace(found->first, std::move(found->second));
+			m_queued.erase(found);
+		}
+	}
+	if (!writeSnapshots(snapshots)) {
+		// The backend still has older data, which must not be handed out
+		MutexAutoLock lock(m_queue_mutex);
+		auto found = m_queued.find(player->getName());
+		if (found != m_queued.end()) {
+			found->second->restore(player, sao);
+			return true;
+		}
+	}
+
+	return m_backend->loadPlayer(player, sao);
+}
+
+bool PlayerDatabaseWriteBehind::removePlayer(const std::string &name)
+{
+	MutexAutoLock backend_lock(m_backend_mutex);
+
+	bool queued;
+	{
+		MutexAutoLock lock(m_queue_mutex);
+		queued = m_queued.erase(name) > 0;
+	}
+	return m_backend->removePlayer(name) || queued;
+}
+
+void PlayerDatabaseWriteBehind::listPlayers(std::vector<std::string> &res)
+{
+	MutexAutoLock backend_lock(m_backend_mutex);
+
+	m_backend->listPlayers(res);
+
+	// Players that were never written yet
+	MutexAutoLock lock(m_queue_mutex);
+	for (const auto &it : m_queued) {
+		if (std::find(res.begin(), res.end(), it.first) == res.end())
+			res.push_back(it.first);
+	}
+}
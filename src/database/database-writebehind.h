@@ -0,0 +1,153 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include "database.h"
+#include "porting.h"
+#include "util/thread.h"
+
+class IItemDefManager;
+struct PlayerSnapshot;
+
+// Calls flush() of the database whenever an update is deferred,
+// and again a few seconds later if it failed
+template <typename T>
+class WriteBehindThread : public UpdateThread
+{
+public:
+	WriteBehindThread(const std::string &name, T *db) :
+		UpdateThread(name), m_db(db) {}
+
+protected:
+	void doUpdate() override
+	{
+		if (m_db->flush())
+			return;
+		for (int i = 0; i < 50 && !stopRequested(); i++)
+			sleep_ms(100);
+		deferUpdate();
+	}
+
+private:
+	T *m_db;
+};
+
+/*
+	Keeps the entries of all used mods in memory and writes changes to
+	the wrapped backend from a background thread.
+
+	Changes made between beginSave() and endSave() are collected per key
+	and handed to the thread at endSave(), which applies them to the
+	backend inside a single beginSave()/endSave() pair. The destructor
+	writes out everything that is still pending.
+*/
+class ModStorageDatabaseWriteBehind : public ModStorageDatabase
+{
+public:
+	// Takes ownership of the backend
+	ModStorageDatabaseWriteBehind(ModStorageDatabase *backend);
+	virtual ~ModStorageDatabaseWriteBehind();
+
+	virtual void getModEntries(const std::string &modname, StringMap *storage);
+	virtual void getModKeys(const std::string &modname, std::vector<std::string> *storage);
+	virtual bool getModEntry(const std::string &modname,
+		const std::string &key, std::string *value);
+	virtual bool hasModEntry(const std::string &modname, const std::string &key);
+	virtual bool setModEntry(const std::string &modname,
+		const std::string &key, std::string_view value);
+	virtual bool removeModEntry(const std::string &modname, const std::string &key);
+	virtual bool removeModEntries(const std::string &modname);
+	virtual void listMods(std::vector<std::string> *res);
+
+	virtual void beginSave() {}
+	virtual void endSave();
+
+	// Writes all changes handed over by endSave() to the backend.
+	// On failure they are kept and a retry is scheduled.
+	bool flush();
+
+private:
+	struct ModChanges {
+		// All entries of the mod are removed before applying the keys
+		bool clear = false;
+		// nullopt = removed
+		std::unordered_map<std::string, std::optional<std::string>> keys;
+	};
+	typedef std::unordered_map<std::string, ModChanges> Changes;
+
+	// Adds the older changes to newer ones, which take precedence
+	static void mergeOlder(Changes &newer, Changes &&older);
+
+	// Loads the mod from the backend if needed
+	StringMap &getMod(const std::string &modname);
+
+	// Guards m_backend, which is also used by the thread
+	std::mutex m_backend_mutex;
+	std::unique_ptr<ModStorageDatabase> m_backend;
+
+	// Complete entries of the mods used so far
+	std::unordered_map<std::string, StringMap> m_mods;
+	// Changes since the last endSave()
+	Changes m_changes;
+
+	// Changes handed over to the thread
+	std::mutex m_queue_mutex;
+	Changes m_queued;
+
+	WriteBehindThread<ModStorageDatabaseWriteBehind> m_thread;
+};
+
+/*
+	Copies the saved state of players and writes the copies to the wrapped
+	backend from a background thread.
+
+	Only the most recent copy of each player is kept. Before a player is
+	loaded, its pending copy is written so the backend is current. If that
+	fails, the player is loaded from the copy instead.
+	The destructor writes out everything that is still pending.
+*/
+class PlayerDatabaseWriteBehind : public PlayerDatabase
+{
+public:
+	// Takes ownership of the backend
+	PlayerDatabaseWriteBehind(PlayerDatabase *backend, IItemDefManager *idef);
+	virtual ~PlayerDatabaseWriteBehind();
+
+	// Marks the player as saved, the copy is written later.
+	// Throws DatabaseException while writes to the backend are failing.
+	virtual void savePlayer(RemotePlayer *player);
+	virtual bool loadPlayer(RemotePlayer *player, PlayerSAO *sao);
+	virtual bool removePlayer(const std::string &name);
+	virtual void listPlayers(std::vector<std::string> &res);
+
+	// Writes all pending copies to the backend.
+	// On failure they are kept and a retry is scheduled.
+	bool flush();
+
+private:
+	typedef std::unordered_map<std::string, std::unique_ptr<PlayerSnapshot>> Snapshots;
+
+	// m_backend_mutex must be locked
+	bool writeSnapshots(Snapshots &snapshots);
+
+	IItemDefManager *m_idef;
+
+	// Guards m_backend, which is also used by the thread
+	std::mutex m_backend_mutex;
+	std::unique_ptr<PlayerDatabase> m_backend;
+
+	std::mutex m_queue_mutex;
+	Snapshots m_queued;
+
+	// Whether the last attempt to write copies failed
+	std::atomic<bool> m_write_failed{false};
+
+	WriteBehindThread<PlayerDatabaseWriteBehind> m_thread;
+};
@@ -90,4 +90,8 @@ class ModStorageDatabase : public Database
 	virtual bool removeModEntry(const std::string &modname, const std::string &key) = 0;
 	virtual bool removeModEntries(const std::string &modname) = 0;
 	virtual void listMods(std::vector<std::string> *res) = 0;
+
+	// Ends a save after beginSave() that failed part way, discarding its
+	// changes where the backend supports that
+	virtual void rollbackSave() {}
 };
@@ -104,6 +104,7 @@ void set_default_settings()
 	settings->setDefault("sound_extensions_blacklist", "");
 	settings->setDefault("mesh_generation_interval", "0");
 	settings->setDefault("mesh_generation_threads", "0");
+	settings->setDefault("greedy_meshing", "false");
 	settings->setDefault("mesh_buffer_min_vertices", "300");
 	settings->setDefault("free_move", "false");
 	settings->setDefault("pitch_move", "false");
@@ -128,6 +129,7 @@ void set_default_settings()
 	settings->setDefault("enable_split_login_register", "true");
 	settings->setDefault("occlusion_culler", "bfs");
 	settings->setDefault("enable_raytraced_culling", "true");
+	settings->setDefault("enable_raster_culling", "false");
 	settings->setDefault("chat_weblink_color", "#8888FF");
 
 	// Keymap
@@ -252,6 +254,7 @@ void set_default_settings()
 	settings->setDefault("fps_max", "60");
 	settings->setDefault("fps_max_unfocused", "10");
 	settings->setDefault("viewing_range", "190");
+	settings->setDefault("lod_range", "0");
 	settings->setDefault("client_mesh_chunk", "1");
 	settings->setDefault("screen_w", "1024");
 	settings->setDefault("screen_h", "600");
@@ -438,9 +441,8 @@ void set_default_settings()
 #else
 	settings->setDefault("random_mod_load_order", "false");
 #endif
-#if USE_PROMETHEUS
 	settings->setDefault("prometheus_listener_address", "127.0.0.1:30000");
-#endif
+	settings->setDefault("prometheus_builtin_exporter", "false");
 
 	// Network
 	settings->setDefault("enable_ipv6", "true");
@@ -473,6 +475,7 @@ void set_default_settings()
 
 	settings->setDefault("chat_message_format", "<@name> @message");
 	settings->setDefault("profiler_print_interval", "0");
+	settings->setDefault("profiler_trace_threshold", "0");
 	settings->setDefault("active_object_send_range_blocks", "8");
 	settings->setDefault("active_block_range", "4");
 	//settings->setDefault("max_simultaneous_block_sends_per_client", "1");
@@ -487,12 +490,15 @@ void set_default_settings()
 	settings->setDefault("time_speed", "72");
 	settings->setDefault("world_start_time", "6125");
 	settings->setDefault("server_unload_unused_data_timeout", "29");
+	settings->setDefault("server_map_memory_budget", "0");
+	settings->setDefault("mapblock_palette_compression", "false");
 	settings->setDefault("max_objects_per_block", "256");
 	settings->setDefault("server_map_save_interval", "5.3");
 	settings->setDefault("chat_message_max_size", "500");
 	settings->setDefault("chat_message_limit_per_10sec", "8.0");
 	settings->setDefault("chat_message_limit_trigger_kick", "50");
 	settings->setDefault("sqlite_synchronous", "2");
+	settings->setDefault("mod_storage_write_behind", "true");
 	settings->setDefault("map_compression_level_disk", "-1");
 	settings->setDefault("map_compression_level_net", "-1");
 	settings->setDefault("full_block_send_enable_min_time_from_building", "2.0");
@@ -87,6 +87,12 @@ EmergeManager::EmergeManager(Server *server, MetricsBackend *mb)
 			"minetest_emerge_completed", help_str,
 			{{"status", emergeActionStrs[i]}}
 		);
+		m_emerge_latency_histogram[i] = mb->addHistogram(
+			"minetest_emerge_latency_seconds",
+			"Time from requesting a block until its emerge completed",
+			MetricsBackend::durationBuckets(),
+			{{"status", emergeActionStrs[i]}}
+		);
 	}
 
 	m_qlimit_total = g_settings->getU32("emergequeue_limit_total");
@@ -403,6 +409,7 @@ bool EmergeManager::pushBlockEmergeData(
 	} else {
 		bedata.flags = flags;
 		bedata.peer_requested = peer_requested;
+		bedata.queued_us = porting::getTimeUs();
 
 		count_peer++;
 	}
@@ -454,10 +461,14 @@ EmergeThread *EmergeManager::getOptimalThread()
 	return m_threads[index];
 }
 
-void EmergeManager::reportCompletedEmerge(EmergeAction action)
+void EmergeManager::reportCompletedEmerge(EmergeAction action, u64 queued_us)
 {
 	assert((size_t)action < ARRLEN(m_completed_emerge_counter));
 	m_completed_emerge_counter[(int)action]->increment();
+	if (queued_us != 0) {
+		m_emerge_latency_histogram[(int)action]->observe(
+			(porting::getTimeUs() - queued_us) / 1e6);
+	}
 }
 
 
@@ -504,16 +515,17 @@ void EmergeThread::cancelPendingItems()
 
 		m_emerge->popBlockEmergeData(pos, &bedata);
 
-		runCompletionCallbacks(pos, EMERGE_CANCELLED, bedata.callbacks);
+		runCompletionCallbacks(pos, EMERGE_CANCELLED, bedata);
 	}
 }
 
 
 void EmergeThread::runCompletionCallbacks(v3s16 pos, EmergeAction action,
-	const EmergeCallbackList &callbacks)
+	const BlockEmergeData &bedata)
 {
-	m_emerge->reportCompletedEmerge(action);
+	m_emerge->reportCompletedEmerge(action, bedata.queued_us);
 
+	const EmergeCallbackList &callbacks = bedata.callbacks;
 	for (size_t i = 0; i != callbacks.size(); i++) {
 		EmergeCompletionCallback callback;
 		void *param;
@@ -589,8 +601,9 @@ MapBlock *EmergeThread::finishGen(v3s16 pos, BlockMakeData *bmdata,
 	std::map<v3s16, MapBlock *> *modified_blocks)
 {
 	Server::EnvAutoLock envlock(m_server);
-	ScopeProfiler sp(g_profiler,
-		"EmergeThread: after Mapgen::makeChunk", SPT_AVG);
+	static const ProfilerMetric metric("EmergeThread: after Mapgen::makeChunk",
+			PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, metric, SPT_AVG);
 
 	/*
 		Perform post-processing on blocks (invalidate lighting, queue liquid
@@ -675,6 +688,13 @@ void *EmergeThread::run()
 	v3s16 pos;
 	std::map<v3s16, MapBlock*> modified_blocks;
 	std::string databuf;
+	const ProfilerMetric processed_metric(m_name + ": processed [#]");
+	static const ProfilerMetric load_metric("EmergeThread: load block - async (sum)",
+			PRECISION_MILLI);
+	static const ProfilerMetric make_chunk_metric("EmergeThread: Mapgen::makeChunk",
+			PRECISION_MILLI);
+	static const ProfilerMetric on_generated_metric("EmergeThread: Lua on_generated",
+			PRECISION_MILLI);
 
 	m_map    = &m_server->m_env->getServerMap();
 	m_emerge = m_server->getEmergeManager();
@@ -700,7 +720,7 @@ void *EmergeThread::run()
 			continue;
 		}
 
-		g_profiler->add(m_name + ": processed [#]", 1);
+		g_profiler->add(processed_metric, 1);
 
 		if (blockpos_over_max_limit(pos))
 			continue;
@@ -714,7 +734,7 @@ void *EmergeThread::run()
 		if (action == EMERGE_FROM_DISK) {
 			auto &m_db = *m_emerge->m_db;
 			{
-				ScopeProfiler sp(g_profiler, "EmergeThread: load block - async (sum)");
+				ScopeProfiler sp(g_profiler, load_metric);
 				MutexAutoLock dblock(m_db.mutex);
 				// Note: this can throw an exception, but there isn't really
 				// a good, safe way to handle it.
@@ -731,15 +751,13 @@ void *EmergeThread::run()
 			m_trans_liquid = &bmdata.transforming_liquid;
 
 			{
-				ScopeProfiler sp(g_profiler,
-					"EmergeThread: Mapgen::makeChunk", SPT_AVG);
+				ScopeProfiler sp(g_profiler, make_chunk_metric, SPT_AVG);
 
 				m_mapgen->makeChunk(&bmdata);
 			}
 
 			{
-				ScopeProfiler sp(g_profiler,
-					"EmergeThread: Lua on_generated", SPT_AVG);
+				ScopeProfiler sp(g_profiler, on_generated_metric, SPT_AVG);
 
 				try {
 					m_script->on_generated(&bmdata, m_mapgen->blockseed);
@@ -759,7 +777,7 @@ void *EmergeThread::run()
 			m_trans_liquid = nullptr;
 		}
 
-		runCompletionCallbacks(pos, action, bedata.callbacks);
+		runCompletionCallbacks(pos, action, bedata);
 
 		if (block)
 			modified_blocks[pos] = block;
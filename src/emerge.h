@@ -78,6 +78,8 @@ typedef std::vector<
 struct BlockEmergeData {
 	u16 peer_requested;
 	u16 flags;
+	// When the block was first requested, from porting::getTimeUs()
+	u64 queued_us = 0;
 	EmergeCallbackList callbacks;
 };
 
@@ -213,6 +215,7 @@ class EmergeManager {
 
 	// Emerge metrics
 	MetricCounterPtr m_completed_emerge_counter[5];
+	MetricHistogramPtr m_emerge_latency_histogram[5];
 
 	// Managers of various map generation-related components
 	// Note that each Mapgen gets a copy(!) of these to work with
@@ -235,7 +238,7 @@ class EmergeManager {
 
 	bool popBlockEmergeData(v3s16 pos, BlockEmergeData *bedata);
 
-	void reportCompletedEmerge(EmergeAction action);
+	void reportCompletedEmerge(EmergeAction action, u64 queued_us);
 
 	friend class EmergeThread;
 };
@@ -45,7 +45,7 @@ class EmergeThread : public Thread {
 
 	void runCompletionCallbacks(
 		v3s16 pos, EmergeAction action,
-		const EmergeCallbackList &callbacks);
+		const BlockEmergeData &bedata);
 
 private:
 	Server *m_server;
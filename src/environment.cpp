@@ -9,6 +9,8 @@
 #include "settings.h"
 #include "daynightratio.h"
 #include "emerge.h"
+#include "map.h"
+#include "mapblock.h"
 
 
 Environment::Environment(IGameDef *gamedef):
@@ -61,12 +63,62 @@ float Environment::getTimeOfDayF()
 	return m_time_of_day_f;
 }
 
-bool Environment::line_of_sight(v3f pos1, v3f pos2, v3s16 *p)
+namespace {
+
+// Remembers the last block that was looked up, as lines and rays usually
+// stay in the same block for many nodes
+class CachedBlockGetter
+{
+public:
+	CachedBlockGetter(Map &map) : m_map(map) {}
+
+	MapBlock *get(v3s16 bp)
+	{
+		if (bp != m_last_bp) {
+			m_last_block = m_map.getBlockNoCreateNoEx(bp);
+			m_last_bp = bp;
+		}
+		return m_last_block;
+	}
+
+	MapNode getNode(v3s16 p, bool *is_valid_position = nullptr)
+	{
+		v3s16 bp, relp;
+		getNodeBlockPosWithOffset(p, bp, relp);
+		MapBlock *block = get(bp);
+		if (is_valid_position)
+			*is_valid_position = block != nullptr;
+		if (!block)
+			return {CONTENT_IGNORE};
+		return block->getNodeNoCheck(relp);
+	}
+
+private:
+	Map &m_map;
+	v3s16 m_last_bp {S16_MAX, S16_MAX, S16_MAX};
+	MapBlock *m_last_block = nullptr;
+};
+
+bool line_of_sight_cached(CachedBlockGetter &blocks, v3f pos1, v3f pos2,
+		v3s16 *p)
 {
 	// Iterate trough nodes on the line
 	voxalgo::VoxelLineIterator iterator(pos1 / BS, (pos2 - pos1) / BS);
 	do {
-		MapNode n = getMap().getNode(iterator.m_current_node_pos);
+		v3s16 bp, relp;
+		getNodeBlockPosWithOffset(iterator.m_current_node_pos, bp, relp);
+		MapBlock *block = blocks.get(bp);
+
+		// Walk through blocks of air without looking at their nodes
+		if (block && block->isAir()) {
+			do {
+				iterator.next();
+			} while (iterator.m_current_index <= iterator.m_last_index &&
+					getNodeBlockPos(iterator.m_current_node_pos) == bp);
+			continue;
+		}
+
+		MapNode n = block ? block->getNodeNoCheck(relp) : MapNode(CONTENT_IGNORE);
 
 		// Return non-air
 		if (n.param0 != CONTENT_AIR) {
@@ -79,6 +131,29 @@ bool Environment::line_of_sight(v3f pos1, v3f pos2, v3s16 *p)
 	return true;
 }
 
+}
+
+bool Environment::line_of_sight(v3f pos1, v3f pos2, v3s16 *p)
+{
+	CachedBlockGetter blocks(getMap());
+	return line_of_sight_cached(blocks, pos1, pos2, p);
+}
+
+void Environment::bulk_line_of_sight(const std::vector<std::pair<v3f, v3f>> &lines,
+		std::vector<std::optional<v3s16>> &results)
+{
+	CachedBlockGetter blocks(getMap());
+	results.clear();
+	results.reserve(lines.size());
+	for (const auto &line : lines) {
+		v3s16 p;
+		if (line_of_sight_cached(blocks, line.first, line.second, &p))
+			results.emplace_back(std::nullopt);
+		else
+			results.emplace_back(p);
+	}
+}
+
 /*
 	Check how a node can be pointed at
 */
@@ -127,7 +202,11 @@ void Environment::continueRaycast(RaycastState *state, PointedThing *result_p)
 	}
 
 	Map &map = getMap();
+	CachedBlockGetter blocks(map);
 	std::vector<aabb3f> boxes;
+	const bool air_pointable = isPointableNode(MapNode(CONTENT_AIR), nodedef,
+			state->m_liquids_pointable, state->m_pointabilities) !=
+			PointabilityType::POINTABLE_NOT;
 	while (state->m_iterator.m_current_index <= lastIndex) {
 		// Test the nodes around the current node in search_range.
 		core::aabbox3d<s16> new_nodes = state->m_search_range;
@@ -161,13 +240,21 @@ void Environment::continueRaycast(RaycastState *state, PointedThing *result_p)
 		for (s16 z = new_nodes.MinEdge.Z; z <= new_nodes.MaxEdge.Z; z++)
 		for (s16 y = new_nodes.MinEdge.Y; y <= new_nodes.MaxEdge.Y; y++)
 		for (s16 x = new_nodes.MinEdge.X; x <= new_nodes.MaxEdge.X; x++) {
-			MapNode n;
 			v3s16 np(x, y, z);
-			bool is_valid_position;
+			v3s16 bp, relp;
+			getNodeBlockPosWithOffset(np, bp, relp);
+			MapBlock *block = blocks.get(bp);
+			if (!block)
+				continue;
 
-			n = map.getNode(np, &is_valid_position);
-			if (!is_valid_position)
+			if (!air_pointable && block->isAir()) {
+				// Skip ahead to the end of the row in this block
+				x = std::min<s16>(bp.X * MAP_BLOCKSIZE + MAP_BLOCKSIZE - 1,
+						new_nodes.MaxEdge.X);
 				continue;
+			}
+
+			const MapNode n = block->getNodeNoCheck(relp);
 
 			PointabilityType pointable = isPointableNode(n, nodedef,
 					state->m_liquids_pointable,
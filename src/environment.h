@@ -17,6 +17,8 @@
 #include <atomic>
 #include <mutex>
 #include <optional>
+#include <utility>
+#include <vector>
 #include "irr_v3d.h"
 #include "util/basic_macros.h"
 #include "line3d.h"
@@ -70,6 +72,15 @@ class Environment
 	 */
 	bool line_of_sight(v3f pos1, v3f pos2, v3s16 *p = nullptr);
 
+	/*!
+	 * Does line_of_sight() for many lines at once.
+	 * \param lines start and end of each line
+	 * \param results output, for each line the position of the first
+	 * non-air node the line intersects, if any
+	 */
+	void bulk_line_of_sight(const std::vector<std::pair<v3f, v3f>> &lines,
+			std::vector<std::optional<v3s16>> &results);
+
 	/*!
 	 * Gets the objects pointed by the shootline as
 	 * pointed things.
@@ -610,6 +610,81 @@ void InventoryList::deSerialize(std::istream &is)
 	throw SerializationError(ss.str());
 }
 
+enum InventoryListUpdate : u8 {
+	INVLIST_KEEP = 0,
+	INVLIST_FULL = 1,
+	INVLIST_DELTA = 2,
+};
+
+static void serialize_item_binary(std::ostream &os, const ItemStack &item)
+{
+	os << serializeString32(item.empty() ? "" : item.getItemString());
+}
+
+static ItemStack deserialize_item_binary(std::istream &is, IItemDefManager *itemdef)
+{
+	ItemStack item;
+	std::string str = deSerializeString32(is);
+	if (!str.empty())
+		item.deSerialize(str, itemdef);
+	return item;
+}
+
+void InventoryList::serializeBinary(std::ostream &os, bool incremental) const
+{
+	if (incremental && !m_dirty) {
+		writeU8(os, INVLIST_KEEP);
+		return;
+	}
+
+	if (incremental && !m_dirty_all) {
+		u32 count = 0;
+		for (u32 i = 0; i < m_dirty_slots.size(); i++)
+			count += m_dirty_slots[i];
+
+		// Each delta entry costs an index, prefer the full list if most changed
+		if (count * 2 <= m_items.size()) {
+			writeU8(os, INVLIST_DELTA);
+			writeU32(os, count);
+			for (u32 i = 0; i < m_dirty_slots.size(); i++) {
+				if (!m_dirty_slots[i])
+					continue;
+				writeU32(os, i);
+				serialize_item_binary(os, m_items[i]);
+			}
+			return;
+		}
+	}
+
+	writeU8(os, INVLIST_FULL);
+	writeU32(os, m_items.size());
+	writeU32(os, m_width);
+	for (const ItemStack &item : m_items)
+		serialize_item_binary(os, item);
+}
+
+void InventoryList::deSerializeBinary(std::istream &is, bool incremental)
+{
+	if (incremental) {
+		u32 count = readU32(is);
+		for (u32 n = 0; n < count; n++) {
+			u32 i = readU32(is);
+			ItemStack item = deserialize_item_binary(is, m_itemdef);
+			if (i < m_items.size())
+				changeItem(i, item);
+		}
+		return;
+	}
+
+	u32 size = readU32(is);
+	u32 width = readU32(is);
+	setSize(size);
+	m_width = width;
+	for (ItemStack &item : m_items)
+		item = deserialize_item_binary(is, m_itemdef);
+	setModified();
+}
+
 InventoryList & InventoryList::operator = (const InventoryList &other)
 {
 	checkResizeLock();
@@ -619,7 +694,7 @@ InventoryList & InventoryList::operator = (const InventoryList &other)
 	m_width = other.m_width;
 	m_name = other.m_name;
 	m_itemdef = other.m_itemdef;
-	//setDirty(true);
+	setModified();
 
 	return *this;
 }
@@ -657,7 +732,7 @@ ItemStack InventoryList::changeItem(u32 i, const ItemStack &newitem)
 	ItemStack olditem = m_items[i];
 	if (olditem != newitem) {
 		m_items[i] = newitem;
-		setModified();
+		setSlotModified(i);
 	}
 	return olditem;
 }
@@ -666,7 +741,7 @@ void InventoryList::deleteItem(u32 i)
 {
 	assert(i < m_items.size()); // Pre-condition
 	m_items[i].clear();
-	setModified();
+	setSlotModified(i);
 }
 
 ItemStack InventoryList::addItem(const ItemStack &newitem_)
@@ -715,7 +790,7 @@ ItemStack InventoryList::addItem(u32 i, const ItemStack &newitem)
 
 	ItemStack leftover = m_items[i].addItem(newitem, m_itemdef);
 	if (leftover != newitem)
-		setModified();
+		setSlotModified(i);
 	return leftover;
 }
 
@@ -770,8 +845,10 @@ ItemStack InventoryList::removeItem(const ItemStack &item, bool match_meta)
 	for (auto i = m_items.rbegin(); i != m_items.rend(); ++i) {
 		if (i->name == item.name && (!match_meta || i->metadata == item.metadata)) {
 			u32 still_to_remove = item.count - removed.count;
-			ItemStack leftover = removed.addItem(i->takeItem(still_to_remove),
-					m_itemdef);
+			ItemStack taken = i->takeItem(still_to_remove);
+			if (!taken.empty())
+				setSlotModified(m_items.rend() - i - 1);
+			ItemStack leftover = removed.addItem(taken, m_itemdef);
 			// Allow oversized stacks
 			removed.count += leftover.count;
 
@@ -779,8 +856,6 @@ ItemStack InventoryList::removeItem(const ItemStack &item, bool match_meta)
 				break;
 		}
 	}
-	if (!removed.empty())
-		setModified();
 	return removed;
 }
 
@@ -791,7 +866,7 @@ ItemStack InventoryList::takeItem(u32 i, u32 takecount)
 
 	ItemStack taken = m_items[i].takeItem(takecount);
 	if (!taken.empty())
-		setModified();
+		setSlotModified(i);
 	return taken;
 }
 
@@ -1022,6 +1097,75 @@ void Inventory::deSerialize(std::istream &is)
 	throw SerializationError(ss.str());
 }
 
+void Inventory::serializeBinary(std::ostream &os, bool incremental) const
+{
+	writeU8(os, 0); // version
+	writeU16(os, m_lists.size());
+	for (const InventoryList *list : m_lists) {
+		os << serializeString16(list->getName());
+		list->serializeBinary(os, incremental);
+	}
+}
+
+void Inventory::deSerializeBinary(std::istream &is)
+{
+	u8 version = readU8(is);
+	if (version != 0)
+		throw SerializationError("Unsupported inventory version " + itos(version));
+
+	std::vector<InventoryList *> new_lists;
+	u16 count = readU16(is);
+	new_lists.reserve(count);
+
+	for (u16 n = 0; n < count; n++) {
+		std::string listname = deSerializeString16(is);
+		u8 update = readU8(is);
+
+		InventoryList *list = getList(listname);
+		if (update == INVLIST_KEEP) {
+			if (list) {
+				new_lists.push_back(list);
+			} else {
+				errorstream << "Inventory::deSerializeBinary(): Tried to keep list '" <<
+					listname << "' which is non-existent." << std::endl;
+			}
+			continue;
+		}
+		if (update != INVLIST_FULL && update != INVLIST_DELTA)
+			throw SerializationError("Unknown inventory list update " + itos(update));
+
+		if (!list && update == INVLIST_DELTA) {
+			// Consume the changes, they cannot be applied
+			errorstream << "Inventory::deSerializeBinary(): Tried to update list '" <<
+				listname << "' which is non-existent." << std::endl;
+			InventoryList dummy(listname, 0, m_itemdef);
+			dummy.deSerializeBinary(is, true);
+			continue;
+		}
+
+		bool create_new = !list;
+		if (create_new)
+			list = new InventoryList(listname, 0, m_itemdef);
+		list->deSerializeBinary(is, update == INVLIST_DELTA);
+
+		new_lists.push_back(list);
+		if (create_new)
+			m_lists.push_back(list);
+	}
+
+	// Remove all lists that were not sent
+	for (auto &list : m_lists) {
+		if (std::find(new_lists.begin(), new_lists.end(), list) != new_lists.end())
+			continue;
+
+		delete list;
+		list = nullptr;
+		setModified();
+	}
+	m_lists.erase(std::remove(m_lists.begin(), m_lists.end(),
+			nullptr), m_lists.end());
+}
+
 InventoryList * Inventory::addList(const std::string &name, u32 size)
 {
 	setModified();
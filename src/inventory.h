@@ -164,6 +164,9 @@ class InventoryList
 	void setName(const std::string &name);
 	void serialize(std::ostream &os, bool incremental) const;
 	void deSerialize(std::istream &is);
+	// Compact network format, only the modified slots if incremental
+	void serializeBinary(std::ostream &os, bool incremental) const;
+	void deSerializeBinary(std::istream &is, bool incremental);
 
 	InventoryList(const InventoryList &other) { *this = other; }
 	InventoryList & operator = (const InventoryList &other);
@@ -243,7 +246,27 @@ class InventoryList
 	void moveItemSomewhere(u32 i, InventoryList *dest, u32 count);
 
 	inline bool checkModified() const { return m_dirty; }
-	inline void setModified(bool dirty = true) { m_dirty = dirty; }
+	// Marks the whole list as modified, or everything as handled
+	inline void setModified(bool dirty = true)
+	{
+		m_dirty = dirty;
+		m_dirty_all = dirty;
+		if (!dirty)
+			m_dirty_slots.assign(m_items.size(), false);
+	}
+	inline void setSlotModified(u32 i)
+	{
+		m_dirty = true;
+		if (m_dirty_all)
+			return;
+		if (m_dirty_slots.size() != m_items.size())
+			m_dirty_slots.resize(m_items.size(), false);
+		m_dirty_slots[i] = true;
+	}
+	inline bool checkSlotModified(u32 i) const
+	{
+		return m_dirty_all || (i < m_dirty_slots.size() && m_dirty_slots[i]);
+	}
 
 	// Problem: C++ keeps references to InventoryList and ItemStack indices
 	// until a better solution is found, this serves as a guard to prevent side-effects
@@ -270,6 +293,9 @@ class InventoryList
 	u32 m_width = 0;
 	IItemDefManager *m_itemdef;
 	bool m_dirty = true;
+	// The receiver needs the whole list, not just the slots below
+	bool m_dirty_all = true;
+	std::vector<bool> m_dirty_slots;
 	int m_resize_locks = 0; // Lua callback sanity
 };
 
@@ -292,6 +318,12 @@ class Inventory
 	// Never ever serialize to disk using "incremental"!
 	void serialize(std::ostream &os, bool incremental = false) const;
 	void deSerialize(std::istream &is);
+	// Network format for protocol version >= 52. An incremental update only
+	// contains the slots modified since the last setModified(false).
+	// Used for player and detached inventories, node metadata inventories
+	// are sent in full with their metadata (see Server::sendMetadataChanged).
+	void serializeBinary(std::ostream &os, bool incremental = false) const;
+	void deSerializeBinary(std::istream &is);
 
 	// Creates a new list if none exists or truncates existing lists
 	InventoryList * addList(const std::string &name, u32 size);
@@ -15,6 +15,7 @@
 #include "gamedef.h"
 #include "rollback_interface.h"
 #include "environment.h"
+#include <deque>
 #include <queue>
 
 /*
@@ -93,12 +94,7 @@ MapSector *Map::getSectorNoGenerate(v2s16 p)
 
 MapBlock *Map::getBlockNoCreateNoEx(v3s16 p3d)
 {
-	v2s16 p2d(p3d.X, p3d.Z);
-	MapSector *sector = getSectorNoGenerate(p2d);
-	if (!sector)
-		return nullptr;
-	MapBlock *block = sector->getBlockNoCreateNoEx(p3d.Y);
-	return block;
+	return m_block_index.get(p3d);
 }
 
 MapBlock *Map::getBlockNoCreate(v3s16 p3d)
@@ -268,10 +264,12 @@ bool Map::removeNodeWithEvent(v3s16 p)
 struct TimeOrderedMapBlock {
 	MapSector *sect;
 	MapBlock *block;
+	size_t bytes;
 
-	TimeOrderedMapBlock(MapSector *sect, MapBlock *block) :
+	TimeOrderedMapBlock(MapSector *sect, MapBlock *block, size_t bytes) :
 		sect(sect),
-		block(block)
+		block(block),
+		bytes(bytes)
 	{}
 
 	bool operator<(const TimeOrderedMapBlock &b) const
@@ -300,8 +298,10 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 	const auto start_time = porting::getTimeUs();
 	beginSave();
 
+	u64 resident_bytes = 0;
+
 	// If there is no practical limit, we spare creation of mapblock_queue
-	if (max_loaded_blocks < 0) {
+	if (max_loaded_blocks < 0 && m_memory_budget == 0) {
 		MapBlockVect blocks;
 		for (auto &sector_it : m_sectors) {
 			MapSector *sector = sector_it.second;
@@ -337,6 +337,7 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 				} else {
 					all_blocks_deleted = false;
 					block_count_all++;
+					resident_bytes += block->getMemoryUsage();
 				}
 			}
 
@@ -352,31 +353,23 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 			for (const auto &entry : sector->getBlocks()) {
 				MapBlock *block = entry.second.get();
 				block->incrementUsageTimer(dtime);
-				mapblock_queue.push(TimeOrderedMapBlock(const_cast<MapSector*>(sector), block));
+				const size_t bytes = block->getMemoryUsage();
+				resident_bytes += bytes;
+				mapblock_queue.push(TimeOrderedMapBlock(
+						const_cast<MapSector*>(sector), block, bytes));
 			}
 		}
 		block_count_all = mapblock_queue.size();
 
-		// Delete old blocks, and blocks over the limit from the memory
-		while (!mapblock_queue.empty() && ((s32)mapblock_queue.size() > max_loaded_blocks
-				|| mapblock_queue.top().block->getUsageTimer() > unload_timeout)) {
-			TimeOrderedMapBlock b = mapblock_queue.top();
-			mapblock_queue.pop();
-
+		auto unload_block = [&] (const TimeOrderedMapBlock &b) -> bool {
 			MapBlock *block = b.block;
-
-			if (block->refGet() != 0) {
-				locked_blocks++;
-				continue;
-			}
-
 			v3s16 p = block->getPos();
 
 			// Save if modified
 			if (block->getModified() != MOD_STATE_CLEAN && save_before_unloading) {
 				modprofiler.add(block->getModifiedReasonString(), 1);
 				if (!saveBlock(block))
-					continue;
+					return false;
 				saved_blocks_count++;
 			}
 
@@ -388,6 +381,85 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 
 			deleted_blocks_count++;
 			block_count_all--;
+			resident_bytes -= b.bytes;
+			return true;
+		};
+		auto over_budget = [&] () {
+			return m_memory_budget > 0 && resident_bytes > m_memory_budget;
+		};
+
+		// Modified blocks that are only unloaded for the memory budget, with
+		// the number of blocks examined up to them. Clean blocks are cheaper
+		// to drop, but are only preferred within a window at the end of the
+		// LRU order, so that recently used blocks are not dropped before old
+		// modified ones.
+		constexpr u32 CLEAN_FIRST_WINDOW = 64;
+		std::deque<std::pair<TimeOrderedMapBlock, u32>> dirty_blocks;
+		u32 examined = 0;
+		auto unload_dirty = [&] (u32 examined_limit) {
+			while (!dirty_blocks.empty() && over_budget() &&
+					dirty_blocks.front().second <= examined_limit) {
+				unload_block(dirty_blocks.front().first);
+				dirty_blocks.pop_front();
+			}
+		};
+
+		// Delete old blocks, and blocks over the limits from the memory,
+		// least recently used first
+		while (!mapblock_queue.empty()) {
+			TimeOrderedMapBlock b = mapblock_queue.top();
+			const bool expired = b.block->getUsageTimer() > unload_timeout;
+			const bool over_count = max_loaded_blocks >= 0 &&
+					(s32)mapblock_queue.size() > max_loaded_blocks;
+			if (!expired && !over_count && !over_budget())
+				break;
+
+			// Modified blocks that left the window go before this one
+			examined++;
+			if (examined > CLEAN_FIRST_WINDOW) {
+				unload_dirty(examined - CLEAN_FIRST_WINDOW);
+				if (!expired && !over_count && !over_budget())
+					break;
+			}
+			mapblock_queue.pop();
+
+			if (b.block->refGet() != 0) {
+				locked_blocks++;
+				continue;
+			}
+
+			if (!expired && !over_count &&
+					b.block->getModified() != MOD_STATE_CLEAN && save_before_unloading) {
+				dirty_blocks.emplace_back(b, examined);
+				continue;
+			}
+
+			unload_block(b);
+		}
+		unload_dirty(U32_MAX);
+
+		// Close to the budget, write back the least recently used modified
+		// blocks so that they can be dropped quickly later
+		if (m_memory_budget > 0 && save_before_unloading &&
+				resident_bytes > m_memory_budget / 4 * 3) {
+			u32 written = 0;
+			auto write_back = [&] (MapBlock *block) {
+				if (block->getModified() == MOD_STATE_CLEAN)
+					return;
+				modprofiler.add(block->getModifiedReasonString(), 1);
+				if (saveBlock(block))
+					saved_blocks_count++;
+				written++;
+			};
+			for (auto &it : dirty_blocks) {
+				if (written >= 64)
+					break;
+				write_back(it.first.block);
+			}
+			while (written < 64 && !mapblock_queue.empty()) {
+				write_back(mapblock_queue.top().block);
+				mapblock_queue.pop();
+			}
 		}
 
 		// Delete empty sectors
@@ -401,6 +473,7 @@ void Map::timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 	endSave();
 	const auto end_time = porting::getTimeUs();
 
+	m_resident_bytes = resident_bytes;
 	reportMetrics(end_time - start_time, saved_blocks_count, block_count_all);
 
 	// Finally delete the empty sectors
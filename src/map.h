@@ -12,6 +12,7 @@
 
 #include "irrlichttypes_bloated.h"
 #include "mapblock.h" // for forEachNodeInArea
+#include "mapblockindex.h"
 #include "mapnode.h"
 #include "constants.h"
 #include "voxel.h"
@@ -181,6 +182,8 @@ class Map /*: public NodeContainer*/
 	/*
 		Updates usage timers and unloads unused blocks and sectors.
 		Saves modified blocks before unloading if possible.
+		If a memory budget is set, the least recently used blocks are
+		unloaded until the loaded blocks fit into it, clean ones first.
 	*/
 	void timerUpdate(float dtime, float unload_timeout, s32 max_loaded_blocks,
 			std::vector<v3s16> *unloaded_blocks=NULL);
@@ -191,6 +194,11 @@ class Map /*: public NodeContainer*/
 	*/
 	void unloadUnreferencedBlocks(std::vector<v3s16> *unloaded_blocks=NULL);
 
+	// Limit for the estimated memory usage of loaded blocks, 0 = unlimited
+	void setMemoryBudget(size_t bytes) { m_memory_budget = bytes; }
+	// Estimated memory usage of loaded blocks, as of the last timerUpdate()
+	u64 getResidentBytes() const { return m_resident_bytes; }
+
 	// Deletes sectors and their blocks from memory
 	// Takes cache into account
 	// If deleted sector is in sector cache, clears cache
@@ -284,6 +292,14 @@ class Map /*: public NodeContainer*/
 
 	std::unordered_map<v2s16, MapSector*> m_sectors;
 
+	// All blocks of all sectors, for fast lookup by position.
+	// Kept up to date by MapSector.
+	MapBlockIndex m_block_index;
+	friend class MapSector;
+
+	size_t m_memory_budget = 0;
+	u64 m_resident_bytes = 0;
+
 	// Be sure to set this to NULL when the cached sector is deleted
 	MapSector *m_sector_cache = nullptr;
 	v2s16 m_sector_cache_p;
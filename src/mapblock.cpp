@@ -4,12 +4,15 @@
 
 #include "mapblock.h"
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include "map.h"
+#include "collision.h"
 #include "nodedef.h"
 #include "nodemetadata.h"
 #include "gamedef.h"
+#include "inventory.h"
 #include "log.h"
 #include "content_mapnode.h"  // For legacy name-id mapping
 #include "content_nodemeta.h" // For legacy deserialization
@@ -98,6 +101,8 @@ static const char *modified_reason_strings[] = {
 	MapBlock
 */
 
+bool MapBlock::s_palette_compression = false;
+
 MapBlock::MapBlock(v3s16 pos, IGameDef *gamedef):
 		m_pos(pos),
 		m_pos_relative(pos * MAP_BLOCKSIZE),
@@ -120,8 +125,9 @@ MapBlock::~MapBlock()
 #endif
 
 	delete[] data;
-	if (!m_is_mono_block)
+	if (!m_is_mono_block && m_palette_bits == 0)
 		porting::TrackFreedMemory(sizeof(MapNode) * nodecount);
+	delete[] m_palette_indices;
 }
 
 static inline size_t get_max_objects_per_block()
@@ -216,11 +222,52 @@ void MapBlock::copyTo(VoxelManipulator &dst)
 	v3s16 data_size(MAP_BLOCKSIZE, MAP_BLOCKSIZE, MAP_BLOCKSIZE);
 	VoxelArea data_area(v3s16(0,0,0), data_size - v3s16(1,1,1));
 
+	if (m_palette_bits != 0) {
+		thread_local std::unique_ptr<MapNode[]> nodes(new MapNode[nodecount]);
+		getNodes(nodes.get());
+		dst.copyFrom(nodes.get(), false, data_area, v3s16(0,0,0),
+				getPosRelative(), data_size);
+		return;
+	}
+
 	// Copy from data to VoxelManipulator
 	dst.copyFrom(data, m_is_mono_block, data_area, v3s16(0,0,0),
 			getPosRelative(), data_size);
 }
 
+void MapBlock::getNodes(MapNode *dest)
+{
+	if (m_is_mono_block) {
+		std::fill_n(dest, nodecount, data[0]);
+	} else if (m_palette_bits == 0) {
+		std::copy_n(data, nodecount, dest);
+	} else if (m_palette_bits == 8) {
+		for (u32 i = 0; i < nodecount; i++)
+			dest[i] = data[m_palette_indices[i]];
+	} else {
+		// Unpack one byte of indices at a time
+		const u32 per_byte = 8 / m_palette_bits;
+		const u8 mask = (1U << m_palette_bits) - 1;
+		for (u32 i = 0; i < nodecount; i += per_byte) {
+			u8 packed = m_palette_indices[i / per_byte];
+			for (u32 j = 0; j < per_byte; j++) {
+				dest[i + j] = data[packed & mask];
+				packed >>= m_palette_bits;
+			}
+		}
+	}
+}
+
+size_t MapBlock::getNodeMemoryUsage() const
+{
+	if (m_is_mono_block)
+		return sizeof(MapNode);
+	if (m_palette_bits == 0)
+		return sizeof(MapNode) * nodecount;
+	return sizeof(MapNode) * (1U << m_palette_bits) +
+		nodecount * m_palette_bits / 8;
+}
+
 void MapBlock::copyFrom(const VoxelManipulator &src)
 {
 	v3s16 data_size(MAP_BLOCKSIZE, MAP_BLOCKSIZE, MAP_BLOCKSIZE);
@@ -230,9 +277,43 @@ void MapBlock::copyFrom(const VoxelManipulator &src)
 	// Copy from VoxelManipulator to data
 	src.copyTo(data, data_area, v3s16(0,0,0),
 			getPosRelative(), data_size);
+	expireCollisionCache();
 	tryShrinkNodes();
 }
 
+size_t MapBlock::getMemoryUsage()
+{
+	// Rough per-entry overhead of the node based std containers
+	constexpr size_t node_overhead = 48;
+
+	size_t bytes = sizeof(MapBlock) + getNodeMemoryUsage();
+
+	for (const auto &it : m_node_metadata) {
+		const NodeMetadata *meta = it.second;
+		bytes += sizeof(NodeMetadata) + node_overhead;
+		for (const auto &var : meta->getStrings())
+			bytes += var.first.size() + var.second.size() + node_overhead;
+		if (const Inventory *inv = const_cast<NodeMetadata *>(meta)->getInventory()) {
+			for (const InventoryList *list : inv->getLists())
+				bytes += sizeof(InventoryList) + list->getSize() * sizeof(ItemStack);
+		}
+	}
+
+	for (const StaticObject &obj : m_static_objects.getAllStored())
+		bytes += sizeof(StaticObject) + obj.data.size();
+	for (const auto &it : m_static_objects.getAllActives())
+		bytes += sizeof(StaticObject) + it.second.data.size() + node_overhead;
+
+	bytes += m_node_timers.size() * (sizeof(NodeTimer) + 2 * node_overhead);
+
+	if (m_collision_cache)
+		bytes += sizeof(MapBlockCollisionCache) +
+			m_collision_cache->shapes.capacity() * sizeof(MapBlockCollisionCache::Shape) +
+			m_collision_cache->boxes.capacity() * sizeof(aabb3f);
+
+	return bytes;
+}
+
 void MapBlock::reallocate(u32 count, MapNode n)
 {
 	assert(count == 1 || count == nodecount);
@@ -241,8 +322,9 @@ void MapBlock::reallocate(u32 count, MapNode n)
 	assert(!m_gamedef->isClient() || count == nodecount);
 
 	delete[] data;
-	if (data && !m_is_mono_block && count == 1)
+	if (data && !m_is_mono_block && m_palette_bits == 0 && count == 1)
 		porting::TrackFreedMemory(sizeof(MapNode) * nodecount);
+	freePalette();
 
 	data = new MapNode[count];
 	std::fill_n(data, count, n);
@@ -250,6 +332,14 @@ void MapBlock::reallocate(u32 count, MapNode n)
 	m_is_mono_block = (count == 1);
 }
 
+void MapBlock::freePalette()
+{
+	delete[] m_palette_indices;
+	m_palette_indices = nullptr;
+	m_palette_bits = 0;
+	m_palette_size = 0;
+}
+
 void MapBlock::tryShrinkNodes()
 {
 	// For now monoblocks are disabled on the client.
@@ -257,7 +347,7 @@ void MapBlock::tryShrinkNodes()
 	if (m_gamedef->isClient())
 		return;
 
-	if (m_is_mono_block)
+	if (m_is_mono_block || m_palette_bits != 0)
 		return;
 
 	MapNode n = data[0];
@@ -273,14 +363,129 @@ void MapBlock::tryShrinkNodes()
 		reallocate(1, n);
 		m_is_air = n.getContent() == CONTENT_AIR;
 		m_is_air_expired = false;
+		return;
 	}
+
+	if (!s_palette_compression)
+		return;
+
+	// Collect the distinct nodes, giving up if there are too many
+	MapNode palette[256];
+	u16 palette_size = 0;
+	thread_local u8 indices[nodecount];
+	u8 last_index = 0;
+	for (u32 i = 0; i < nodecount; i++) {
+		const MapNode &node = data[i];
+		// Neighboring nodes are often the same
+		if (palette_size == 0 || node != palette[last_index]) {
+			u16 k = 0;
+			while (k < palette_size && palette[k] != node)
+				k++;
+			if (k == palette_size) {
+				if (palette_size == 256)
+					return;
+				palette[palette_size++] = node;
+			}
+			last_index = k;
+		}
+		indices[i] = last_index;
+	}
+
+	u8 bits = 8;
+	if (palette_size <= 2)
+		bits = 1;
+	else if (palette_size <= 4)
+		bits = 2;
+	else if (palette_size <= 16)
+		bits = 4;
+
+	u8 *packed = new u8[nodecount * bits / 8]();
+	for (u32 i = 0; i < nodecount; i++) {
+		const u32 bit = i * bits;
+		packed[bit / 8] |= indices[i] << (bit % 8);
+	}
+
+	delete[] data;
+	porting::TrackFreedMemory(sizeof(MapNode) * nodecount);
+	data = new MapNode[1U << bits];
+	std::copy_n(palette, palette_size, data);
+	m_palette_indices = packed;
+	m_palette_bits = bits;
+	m_palette_size = palette_size;
 }
 
 void MapBlock::expandNodesIfNeeded()
 {
 	if (m_is_mono_block) {
 		reallocate(nodecount, data[0]);
+	} else if (m_palette_bits != 0) {
+		MapNode *nodes = new MapNode[nodecount];
+		getNodes(nodes);
+		delete[] data;
+		freePalette();
+		data = nodes;
+	}
+}
+
+void MapBlock::widenPalette(u8 bits)
+{
+	assert(bits > m_palette_bits && bits <= 8);
+
+	u8 *packed = new u8[nodecount * bits / 8]();
+	for (u32 i = 0; i < nodecount; i++) {
+		const u32 bit = i * bits;
+		packed[bit / 8] |= getDataIndex(i) << (bit % 8);
+	}
+	MapNode *palette = new MapNode[1U << bits];
+	std::copy_n(data, m_palette_size, palette);
+
+	delete[] data;
+	delete[] m_palette_indices;
+	data = palette;
+	m_palette_indices = packed;
+	m_palette_bits = bits;
+}
+
+void MapBlock::setCompressedNode(u32 i, MapNode n)
+{
+	if (m_is_mono_block) {
+		if (data[0] == n)
+			return;
+		if (!s_palette_compression) {
+			expandNodesIfNeeded();
+			data[i] = n;
+			return;
+		}
+		// Turn into a paletted block with one bit per node
+		MapNode *palette = new MapNode[2];
+		palette[0] = data[0];
+		delete[] data;
+		data = palette;
+		m_is_mono_block = false;
+		m_palette_indices = new u8[nodecount / 8]();
+		m_palette_bits = 1;
+		m_palette_size = 1;
+	}
+
+	u16 k = 0;
+	while (k < m_palette_size && data[k] != n)
+		k++;
+	if (k == m_palette_size) {
+		if (m_palette_size == (1U << m_palette_bits)) {
+			if (m_palette_bits == 8) {
+				expandNodesIfNeeded();
+				data[i] = n;
+				return;
+			}
+			widenPalette(m_palette_bits * 2);
+		}
+		data[m_palette_size++] = n;
 	}
+
+	const u32 bit = i * m_palette_bits;
+	const u8 mask = ((1U << m_palette_bits) - 1) << (bit % 8);
+	u8 &byte = m_palette_indices[bit / 8];
+	byte = (byte & ~mask) | (k << (bit % 8));
 }
 
 void MapBlock::actuallyUpdateIsAir()
@@ -292,6 +497,13 @@ void MapBlock::actuallyUpdateIsAir()
 		m_is_air = data[0].getContent() == CONTENT_AIR;
 		return;
 	}
+	if (m_palette_bits != 0) {
+		// Unused palette entries make this err on the side of "not air"
+		m_is_air = std::all_of(data, data + m_palette_size, [] (MapNode n) {
+			return n.getContent() == CONTENT_AIR;
+		});
+		return;
+	}
 	bool only_air = true;
 	for (u32 i = 0; i < nodecount; i++) {
 		MapNode &n = data[i];
@@ -310,6 +522,26 @@ void MapBlock::expireIsAirCache()
 	m_is_air_expired = true;
 }
 
+MapBlockCollisionCache *MapBlock::getCollisionCache()
+{
+	if (!m_collision_cache)
+		m_collision_cache = std::make_unique<MapBlockCollisionCache>();
+	m_collision_cache->unused_time = 0.0f;
+	return m_collision_cache.get();
+}
+
+void MapBlock::stepCollisionCache(float dtime)
+{
+	m_collision_cache->unused_time += dtime;
+	if (m_collision_cache->unused_time > MapBlockCollisionCache::UNUSED_TIMEOUT)
+		dropCollisionCache();
+}
+
+void MapBlock::dropCollisionCache()
+{
+	m_collision_cache.reset();
+}
+
 /*
 	Serialization
 */
@@ -418,11 +650,17 @@ void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int
 	Buffer<u8> buf;
 	const u8 content_width = 2;
 	const u8 params_width = 2;
+	std::unique_ptr<MapNode[]> unpacked_nodes;
+	if (m_palette_bits != 0) {
+		unpacked_nodes.reset(new MapNode[nodecount]);
+		getNodes(unpacked_nodes.get());
+	}
+	MapNode *nodes = unpacked_nodes ? unpacked_nodes.get() : data;
 	if(disk)
 	{
 		const size_t size = m_is_mono_block ? 1 : nodecount;
 		std::unique_ptr<MapNode[]> tmp_nodes(new MapNode[size]);
-		std::copy_n(data, size, tmp_nodes.get());
+		std::copy_n(nodes, size, tmp_nodes.get());
 		getBlockNodeIdMapping(&nimap, tmp_nodes.get(), size, m_gamedef->ndef());
 
 		buf = MapNode::serializeBulk(version, tmp_nodes.get(), nodecount,
@@ -437,7 +675,7 @@ void MapBlock::serialize(std::ostream &os_compressed, u8 version, bool disk, int
 	}
 	else
 	{
-		buf = MapNode::serializeBulk(version, data, nodecount,
+		buf = MapNode::serializeBulk(version, nodes, nodecount,
 				content_width, params_width, m_is_mono_block);
 	}
 
@@ -507,6 +745,7 @@ void MapBlock::deSerialize(std::istream &in_compressed, u8 version, bool disk)
 	TRACESTREAM(<<"MapBlock::deSerialize "<<getPos()<<std::endl);
 
 	m_is_air_expired = true;
+	expireCollisionCache();
 	expandNodesIfNeeded();
 
 	if(version <= 21)
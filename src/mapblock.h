@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include "irr_v3d.h"
 #include "mapnode.h"
@@ -21,6 +22,7 @@ class MapBlockMesh;
 class VoxelManipulator;
 class NameIdMapping;
 class TestMapBlock;
+struct MapBlockCollisionCache;
 
 #define BLOCK_TIMESTAMP_UNDEFINED 0xffffffff
 
@@ -226,7 +228,7 @@ class MapBlock
 		if (!*valid_position)
 			return {CONTENT_IGNORE};
 
-		return data[m_is_mono_block ? 0 : z * zstride + y * ystride + x];
+		return data[getDataIndex(z * zstride + y * ystride + x)];
 	}
 
 	inline MapNode getNode(v3s16 p, bool *valid_position)
@@ -245,8 +247,8 @@ class MapBlock
 		if (!isValidPosition(x, y, z))
 			throw InvalidPositionException();
 
-		expandNodesIfNeeded();
-		data[z * zstride + y * ystride + x] = n;
+		setNodeData(z * zstride + y * ystride + x, n);
+		expireCollisionCache();
 		raiseModified(MOD_STATE_WRITE_NEEDED, MOD_REASON_SET_NODE);
 	}
 
@@ -261,7 +263,7 @@ class MapBlock
 
 	inline MapNode getNodeNoCheck(s16 x, s16 y, s16 z)
 	{
-		return data[m_is_mono_block ? 0 : z * zstride + y * ystride + x];
+		return data[getDataIndex(z * zstride + y * ystride + x)];
 	}
 
 	inline MapNode getNodeNoCheck(v3s16 p)
@@ -271,8 +273,8 @@ class MapBlock
 
 	inline void setNodeNoCheck(s16 x, s16 y, s16 z, MapNode n)
 	{
-		expandNodesIfNeeded();
-		data[z * zstride + y * ystride + x] = n;
+		setNodeData(z * zstride + y * ystride + x, n);
+		expireCollisionCache();
 		raiseModified(MOD_STATE_WRITE_NEEDED, MOD_REASON_SET_NODE);
 	}
 
@@ -284,6 +286,20 @@ class MapBlock
 	// Copies data to VoxelManipulator to getPosRelative()
 	void copyTo(VoxelManipulator &dst);
 
+	// Copies all nodes to dest, which must hold nodecount nodes
+	void getNodes(MapNode *dest);
+
+	// Whether tryShrinkNodes() may store blocks with few distinct nodes
+	// as a palette plus packed indices. Only used by the server.
+	static void setPaletteCompression(bool enabled) { s_palette_compression = enabled; }
+
+	// Bytes used by the node storage, for statistics
+	size_t getNodeMemoryUsage() const;
+
+	// Estimate of all bytes used by the block, including node metadata
+	// and static objects. See Map::timerUpdate().
+	size_t getMemoryUsage();
+
 	// Copies data from VoxelManipulator to getPosRelative()
 	void copyFrom(const VoxelManipulator &src);
 
@@ -302,6 +318,17 @@ class MapBlock
 		return m_is_air;
 	}
 
+	// Collision boxes of the nodes, created when first needed.
+	// See collisionMoveSimple().
+	MapBlockCollisionCache *getCollisionCache();
+
+	// Call this when nodes were changed
+	inline void expireCollisionCache()
+	{
+		if (m_collision_cache)
+			dropCollisionCache();
+	}
+
 	bool onObjectsActivation();
 	bool saveStaticObject(u16 id, const StaticObject &obj, u32 reason);
 
@@ -348,6 +375,10 @@ class MapBlock
 	inline void incrementUsageTimer(float dtime)
 	{
 		m_usage_timer += dtime;
+		// Blocks near players stay loaded, but their collision cache
+		// goes once nothing moves in them anymore
+		if (m_collision_cache)
+			stepCollisionCache(dtime);
 	}
 
 	inline float getUsageTimer()
@@ -436,11 +467,38 @@ class MapBlock
 	*/
 
 	void deSerialize_pre22(std::istream &is, u8 version, bool disk);
-	// check if all nodes are identical, if so convert to monoblock
+	// check if all nodes are identical, if so convert to monoblock,
+	// otherwise try to convert to a paletted block
 	void tryShrinkNodes();
-	// if a monoblock, expand storage back to the full array
+	// if a monoblock or paletted, expand storage back to the full array
 	void expandNodesIfNeeded();
 	void reallocate(u32 count, MapNode n);
+	void freePalette();
+	// Sets the node at index i of a monoblock or paletted block
+	void setCompressedNode(u32 i, MapNode n);
+	// Re-packs the palette indices with more bits per node
+	void widenPalette(u8 bits);
+
+	inline u32 getDataIndex(u32 i) const
+	{
+		if (m_is_mono_block)
+			return 0;
+		if (m_palette_bits == 0)
+			return i;
+		const u32 bit = i * m_palette_bits;
+		return (m_palette_indices[bit / 8] >> (bit % 8)) &
+			((1U << m_palette_bits) - 1);
+	}
+
+	inline void setNodeData(u32 i, MapNode n)
+	{
+		if (m_is_mono_block || m_palette_bits != 0)
+			setCompressedNode(i, n);
+		else
+			data[i] = n;
+	}
+	void stepCollisionCache(float dtime);
+	void dropCollisionCache();
 
 	static void getBlockNodeIdMapping(NameIdMapping *nimap, MapNode *nodes,
 		u32 count, const NodeDefManager *nodedef);
@@ -489,6 +547,9 @@ class MapBlock
 	// provides the item and node definitions
 	IGameDef *m_gamedef;
 
+	// see getCollisionCache()
+	std::unique_ptr<MapBlockCollisionCache> m_collision_cache;
+
 	/*
 		When the block is accessed, this is set to 0.
 		Map will unload the block when this reaches a timeout.
@@ -500,6 +561,17 @@ class MapBlock
 	 * (For reduced memory usage)
 	 */
 	bool m_is_mono_block;
+
+	/*
+	 * For paletted blocks, data holds the distinct nodes (the palette) and
+	 * m_palette_indices the index of every node into it, packed with
+	 * m_palette_bits (1, 2, 4 or 8) bits per node. 0 bits if not paletted.
+	 */
+	u8 m_palette_bits = 0;
+	u16 m_palette_size = 0;
+	u8 *m_palette_indices = nullptr;
+
+	static bool s_palette_compression;
 public:
 	//// ABM optimizations ////
 	// True if we never want to cache content types for this block
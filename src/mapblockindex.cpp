@@ -0,0 +1,98 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "mapblockindex.h"
+#include <cassert>
+
+// Must be a power of two
+static constexpr size_t MIN_CAPACITY = 64;
+
+MapBlockIndex::MapBlockIndex()
+{
+	rehash(MIN_CAPACITY);
+}
+
+void MapBlockIndex::insert(v3s16 p, MapBlock *block)
+{
+	assert(block);
+	// Keep the load factor at or below 1/2
+	if ((m_size + 1) * 2 > m_keys.size())
+		rehash(m_keys.size() * 2);
+
+	const u64 key = pack(p);
+	size_t i = slot(key);
+	while (m_keys[i] != EMPTY) {
+		assert(m_keys[i] != key);
+		i = (i + 1) & m_mask;
+	}
+	m_keys[i] = key;
+	m_values[i] = block;
+	m_size++;
+}
+
+bool MapBlockIndex::erase(v3s16 p)
+{
+	const u64 key = pack(p);
+	size_t i = slot(key);
+	while (m_keys[i] != key) {
+		if (m_keys[i] == EMPTY)
+			return false;
+		i = (i + 1) & m_mask;
+	}
+
+	// Shift back the following entries of the probe run instead of
+	// leaving a tombstone, so lookups stay short
+	for (size_t j = (i + 1) & m_mask; m_keys[j] != EMPTY; j = (j + 1) & m_mask) {
+		const size_t home = slot(m_keys[j]);
+		// Can the entry at j be moved into the hole at i?
+		// It can if its home slot is not in the cyclic range (i, j].
+		const bool home_in_range = i <= j ?
+				(i < home && home <= j) : (i < home || home <= j);
+		if (home_in_range)
+			continue;
+		m_keys[i] = m_keys[j];
+		m_values[i] = m_values[j];
+		i = j;
+	}
+	m_keys[i] = EMPTY;
+	m_values[i] = nullptr;
+	m_size--;
+	return true;
+}
+
+void MapBlockIndex::clear()
+{
+	m_keys.assign(MIN_CAPACITY, EMPTY);
+	m_values.assign(MIN_CAPACITY, nullptr);
+	m_size = 0;
+	setCapacity(MIN_CAPACITY);
+}
+
+void MapBlockIndex::setCapacity(size_t capacity)
+{
+	m_mask = capacity - 1;
+	m_shift = 64;
+	for (size_t c = capacity; c > 1; c >>= 1)
+		m_shift--;
+}
+
+void MapBlockIndex::rehash(size_t capacity)
+{
+	std::vector<u64> old_keys(capacity, EMPTY);
+	std::vector<MapBlock *> old_values(capacity, nullptr);
+	old_keys.swap(m_keys);
+	old_values.swap(m_values);
+
+	setCapacity(capacity);
+
+	for (size_t k = 0; k < old_keys.size(); k++) {
+		if (old_keys[k] == EMPTY)
+			continue;
+		size_t i = slot(old_keys[k]);
+		while (m_keys[i] != EMPTY)
+			i = (i + 1) & m_mask;
+		m_keys[i] = old_keys[k];
+		m_values[i] = old_values[k];
+	}
+}
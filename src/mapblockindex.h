@@ -0,0 +1,78 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include "irrlichttypes.h"
+#include "irr_v3d.h"
+#include <vector>
+
+class MapBlock;
+
+/*
+	Flat hash table from block positions to the loaded MapBlocks.
+
+	Uses open addressing with linear probing over an array of packed
+	positions, so a lookup usually touches one or two cache lines.
+	Not thread-safe: insert() may reallocate the arrays, so concurrent
+	access needs an external lock, like the rest of Map.
+*/
+class MapBlockIndex
+{
+public:
+	MapBlockIndex();
+
+	MapBlock *get(v3s16 p) const
+	{
+		const u64 key = pack(p);
+		for (size_t i = slot(key);; i = (i + 1) & m_mask) {
+			if (m_keys[i] == key)
+				return m_values[i];
+			if (m_keys[i] == EMPTY)
+				return nullptr;
+		}
+	}
+
+	// The position must not be in the index yet
+	void insert(v3s16 p, MapBlock *block);
+	// Returns whether the position was in the index
+	bool erase(v3s16 p);
+	void clear();
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	template <typename F>
+	void forEach(F callback) const
+	{
+		for (size_t i = 0; i < m_keys.size(); i++) {
+			if (m_keys[i] != EMPTY)
+				callback(m_values[i]);
+		}
+	}
+
+private:
+	// Positions only use the lower 48 bits, so this is never a valid key
+	static constexpr u64 EMPTY = ~(u64)0;
+
+	static u64 pack(v3s16 p)
+	{
+		return (u64)(u16)p.X | ((u64)(u16)p.Y << 16) | ((u64)(u16)p.Z << 32);
+	}
+
+	size_t slot(u64 key) const
+	{
+		// Fibonacci hashing, takes the well mixed upper bits
+		return (key * 0x9E3779B97F4A7C15ULL) >> m_shift;
+	}
+
+	void setCapacity(size_t capacity);
+	void rehash(size_t capacity);
+
+	std::vector<u64> m_keys;
+	std::vector<MapBlock *> m_values;
+	size_t m_mask;
+	u8 m_shift;
+	size_t m_size = 0;
+};
@@ -5,6 +5,7 @@
 #include "mapsector.h"
 #include "exceptions.h"
 #include "mapblock.h"
+#include "map.h"
 
 MapSector::MapSector(Map *parent, v2s16 pos, IGameDef *gamedef):
 		m_parent(parent),
@@ -26,6 +27,7 @@ void MapSector::deleteBlocks(size_t *used_count)
 	for (auto &it : m_blocks) {
 		if (it.second->refGet() > 0)
 			u++;
+		m_parent->m_block_index.erase(it.second->getPos());
 		it.second.reset();
 	}
 	if (used_count)
@@ -75,6 +77,7 @@ MapBlock *MapSector::createBlankBlock(s16 y)
 	MapBlock *block = block_u.get();
 
 	m_blocks[y] = std::move(block_u);
+	m_parent->m_block_index.insert(block->getPos(), block);
 
 	return block;
 }
@@ -92,6 +95,7 @@ void MapSector::insertBlock(std::unique_ptr<MapBlock> block)
 	assert(p2d == m_pos);
 
 	// Insert into container
+	m_parent->m_block_index.insert(block->getPos(), block.get());
 	m_blocks[block_y] = std::move(block);
 }
 
@@ -114,6 +118,7 @@ std::unique_ptr<MapBlock> MapSector::detachBlock(MapBlock *block)
 	std::unique_ptr<MapBlock> ret = std::move(it->second);
 	assert(ret.get() == block);
 	m_blocks.erase(it);
+	m_parent->m_block_index.erase(block->getPos());
 
 	// Mark as removed
 	block->makeOrphan();
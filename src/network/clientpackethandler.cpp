@@ -350,7 +350,10 @@ void Client::handleCommand_Inventory(NetworkPacket* pkt)
 	LocalPlayer *player = m_env.getLocalPlayer();
 	assert(player != NULL);
 
-	player->inventory.deSerialize(is);
+	if (m_proto_ver >= 52)
+		player->inventory.deSerializeBinary(is);
+	else
+		player->inventory.deSerialize(is);
 
 	m_update_wielded_item = true;
 
@@ -951,7 +954,10 @@ void Client::handleCommand_DetachedInventory(NetworkPacket* pkt)
 
 	std::string contents(pkt->getRemainingString(), pkt->getRemainingBytes());
 	std::istringstream is(contents, std::ios::binary);
-	inv->deSerialize(is);
+	if (m_proto_ver >= 52)
+		inv->deSerializeBinary(is);
+	else
+		inv->deSerialize(is);
 }
 
 void Client::handleCommand_ShowFormSpec(NetworkPacket* pkt)
@@ -1722,7 +1728,7 @@ void Client::handleCommand_MediaPush(NetworkPacket *pkt)
 		}
 
 		// Actually load media
-		loadMedia(filedata, filename, true);
+		loadMedia(filedata, filename, raw_hash, true);
 
 		// Cache file for the next time when this client joins the same server
 		if (cached)
@@ -0,0 +1,214 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "metricsserver.h"
+
+#include <cstring>
+#include "log.h"
+#include "porting.h"
+#include "network/networkexceptions.h"
+#include "util/string.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define LAST_SOCKET_ERR() WSAGetLastError()
+#define SOCKET_ERR_STR(e) itos(e)
+#define close_socket(s) closesocket(s)
+typedef int socklen_t;
+#else
+#include <cerrno>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#define LAST_SOCKET_ERR() (errno)
+#define SOCKET_ERR_STR(e) strerror(e)
+#define close_socket(s) close(s)
+#endif
+
+// A client closing its end must not kill the server with SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+// Scrapers send small requests, anything bigger is not for us
+static constexpr size_t MAX_REQUEST_SIZE = 8192;
+// Clients are served one at a time, so each one gets a hard time limit
+// for the whole exchange, not only per read.
+static constexpr u64 CLIENT_DEADLINE_MS = 5000;
+
+MetricsHttpServer::MetricsHttpServer(const std::string &address,
+		ContentCallback get_content) :
+	Thread("MetricsHttpServer"),
+	m_get_content(std::move(get_content))
+{
+	size_t colon = address.rfind(':');
+	if (colon == std::string::npos)
+		throw SocketException("Metrics address needs a port: " + address);
+	std::string host = address.substr(0, colon);
+	std::string port = address.substr(colon + 1);
+	if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+		host = host.substr(1, host.size() - 2);
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	struct addrinfo *resolved = nullptr;
+	int e = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+			&hints, &resolved);
+	if (e != 0)
+		throw ResolveError(gai_strerror(e));
+
+	std::string error = "no address";
+	for (auto *ai = resolved; ai; ai = ai->ai_next) {
+		int handle = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (handle < 0) {
+			error = SOCKET_ERR_STR(LAST_SOCKET_ERR());
+			continue;
+		}
+		int value = 1;
+		setsockopt(handle, SOL_SOCKET, SO_REUSEADDR,
+				reinterpret_cast<char *>(&value), sizeof(value));
+		if (bind(handle, ai->ai_addr, ai->ai_addrlen) != 0 ||
+				::listen(handle, 16) != 0) {
+			error = SOCKET_ERR_STR(LAST_SOCKET_ERR());
+			close_socket(handle);
+			continue;
+		}
+		m_handle = handle;
+		break;
+	}
+	freeaddrinfo(resolved);
+	if (m_handle < 0)
+		throw SocketException("Failed to listen on " + address + ": " + error);
+
+	struct sockaddr_storage bound;
+	socklen_t len = sizeof(bound);
+	if (getsockname(m_handle, (struct sockaddr *)&bound, &len) == 0) {
+		if (bound.ss_family == AF_INET6)
+			m_port = ntohs(((struct sockaddr_in6 *)&bound)->sin6_port);
+		else
+			m_port = ntohs(((struct sockaddr_in *)&bound)->sin_port);
+	}
+}
+
+MetricsHttpServer::~MetricsHttpServer()
+{
+	stop();
+	wait();
+	if (m_handle >= 0)
+		close_socket(m_handle);
+}
+
+// Waits until the socket is ready for the given poll events,
+// returns false on timeout
+static bool wait_socket(int handle, short events, int timeout_ms)
+{
+#ifdef _WIN32
+	WSAPOLLFD pfd;
+	pfd.fd = handle;
+	pfd.events = events;
+	return WSAPoll(&pfd, 1, timeout_ms) > 0;
+#else
+	struct pollfd pfd;
+	pfd.fd = handle;
+	pfd.events = events;
+	return poll(&pfd, 1, timeout_ms) > 0;
+#endif
+}
+
+// Milliseconds left until the deadline, 0 once it has passed
+static int time_left(u64 deadline)
+{
+	u64 now = porting::getTimeMs();
+	return now >= deadline ? 0 : (int)(deadline - now);
+}
+
+void *MetricsHttpServer::run()
+{
+	while (!stopRequested()) {
+		// Wake up regularly to notice stop requests
+		if (!wait_socket(m_handle, POLLIN, 500))
+			continue;
+		int client = accept(m_handle, nullptr, nullptr);
+		if (client < 0)
+			continue;
+#ifdef SO_NOSIGPIPE
+		int value = 1;
+		setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE,
+				reinterpret_cast<char *>(&value), sizeof(value));
+#endif
+		handleClient(client);
+		close_socket(client);
+	}
+	return nullptr;
+}
+
+void MetricsHttpServer::handleClient(int client)
+{
+	const u64 deadline = porting::getTimeMs() + CLIENT_DEADLINE_MS;
+	std::string request;
+	char buf[1024];
+	while (request.find("\r\n\r\n") == std::string::npos) {
+		int left = time_left(deadline);
+		if (request.size() > MAX_REQUEST_SIZE || left == 0 ||
+				!wait_socket(client, POLLIN, left))
+			return;
+		int n = recv(client, buf, sizeof(buf), 0);
+		if (n <= 0)
+			return;
+		request.append(buf, n);
+	}
+
+	// Request line: "GET /metrics HTTP/1.1", ignore any query string
+	std::string line = request.substr(0, request.find("\r\n"));
+	std::vector<std::string> parts = str_split(line, ' ');
+	std::string path = parts.size() >= 2 ? parts[1] : "";
+	path = path.substr(0, path.find('?'));
+	const bool head = !parts.empty() && parts[0] == "HEAD";
+
+	std::string status, body, type = "text/plain; charset=utf-8";
+	if (parts.empty() || (parts[0] != "GET" && !head)) {
+		status = "405 Method Not Allowed";
+	} else if (path == "/metrics") {
+		status = "200 OK";
+		type = "text/plain; version=0.0.4; charset=utf-8";
+		body = m_get_content();
+	} else {
+		status = "404 Not Found";
+	}
+
+	std::string response = "HTTP/1.1 " + status + "\r\n"
+		"Content-Type: " + type + "\r\n"
+		"Content-Length: " + std::to_string(body.size()) + "\r\n"
+		"Connection: close\r\n\r\n";
+	if (!head)
+		response += body;
+
+	size_t sent = 0;
+	while (sent < response.size()) {
+		int left = time_left(deadline);
+		if (left == 0 || !wait_socket(client, POLLOUT, left)) {
+			verbosestream << "MetricsHttpServer: client too slow, dropped"
+				<< std::endl;
+			return;
+		}
+		int n = send(client, response.data() + sent, response.size() - sent,
+				SEND_FLAGS);
+		if (n <= 0) {
+			verbosestream << "MetricsHttpServer: send failed: "
+				<< SOCKET_ERR_STR(LAST_SOCKET_ERR()) << std::endl;
+			return;
+		}
+		sent += n;
+	}
+}
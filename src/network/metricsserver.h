@@ -0,0 +1,43 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include "irrlichttypes.h"
+#include "threading/thread.h"
+#include <functional>
+#include <string>
+
+/*
+	Minimal HTTP server for Prometheus scrapes
+
+	Answers GET /metrics with the text returned by the callback, one request
+	at a time. Anything else gets a 404. A client has a few seconds for the
+	whole exchange before it is dropped.
+*/
+class MetricsHttpServer : public Thread
+{
+public:
+	typedef std::function<std::string()> ContentCallback;
+
+	/**
+	 * Binds the listening socket.
+	 * @param address "host:port", IPv6 hosts in brackets
+	 * @throws SocketException, ResolveError
+	 */
+	MetricsHttpServer(const std::string &address, ContentCallback get_content);
+	~MetricsHttpServer();
+
+	u16 getPort() const { return m_port; }
+
+protected:
+	void *run() override;
+
+private:
+	void handleClient(int client);
+
+	int m_handle = -1;
+	u16 m_port = 0;
+	ContentCallback m_get_content;
+};
@@ -6,6 +6,7 @@
 #include "network/mtp/threads.h"
 #include "log.h"
 #include "profiler.h"
+#include "tracer.h"
 #include "settings.h"
 #include "network/networkexceptions.h"
 #include "network/networkpacket.h"
@@ -92,6 +93,9 @@ void *ConnectionSendThread::run()
 		while (m_send_sleep_semaphore.wait(0)) {
 		}
 
+		static const ProfilerMetric step_metric("ConnectionSend: step");
+		TraceScope trace(step_metric);
+
 		lasttime = curtime;
 		curtime = porting::getTimeMs();
 		float dtime = CALC_DTIME(lasttime, curtime);
@@ -77,11 +77,13 @@
 	PROTOCOL VERSION 52
 		Add TOCLIENT_WIELD_ITEM
 		Type of TOCLIENT_HUDADD `size` changed from v2s32 to v2f
+		TOCLIENT_INVENTORY and TOCLIENT_DETACHED_INVENTORY use a binary format
+			that only contains the modified slots
 		[scheduled bump for 5.16.0]
 */
 
 // Note: Also update core.protocol_versions in builtin when bumping
-const u16 LATEST_PROTOCOL_VERSION = 51;
+const u16 LATEST_PROTOCOL_VERSION = 52;
 
 // See also formspec [Version History] in doc/lua_api.md
 const u16 FORMSPEC_API_VERSION = 10;
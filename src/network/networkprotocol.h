@@ -87,7 +87,8 @@ enum ToClientCommand : u16
 
 	TOCLIENT_INVENTORY = 0x27,
 	/*
-		serialized inventory
+		serialized inventory, see Inventory::serializeBinary for
+		protocol version >= 52
 	*/
 
 	TOCLIENT_TIME_OF_DAY = 0x29,
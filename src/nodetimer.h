@@ -89,6 +89,8 @@ class NodeTimerList
 		remove(timer.position);
 		insert(timer);
 	}
+	size_t size() const { return m_timers.size(); }
+
 	// Deletes all timers
 	void clear() {
 		m_timers.clear();
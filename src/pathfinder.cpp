@@ -9,6 +9,7 @@
 
 #include "pathfinder.h"
 #include "map.h"
+#include "mapblock.h"
 #include "nodedef.h"
 
 //#define PATHFINDER_DEBUG
@@ -45,6 +46,8 @@
 #endif
 
 #define PATHFINDER_MAX_WAYPOINTS 700
+/** PathfinderCache is cleared when it holds more blocks (4 KiB each) */
+#define PATHFINDER_CACHE_MAX_BLOCKS 8192
 
 /******************************************************************************/
 /* Class definitions                                                          */
@@ -158,7 +161,7 @@ class MapGridNodeContainer : public GridNodeContainer {
 	MapGridNodeContainer(Pathfinder *pathf);
 	virtual PathGridnode &access(v3s16 p);
 private:
-	std::map<v3s16, PathGridnode> m_nodes;
+	std::unordered_map<v3s16, PathGridnode> m_nodes;
 };
 
 /** class doing pathfinding */
@@ -166,7 +169,8 @@ class Pathfinder {
 
 public:
 	Pathfinder() = delete;
-	Pathfinder(Map *map, const NodeDefManager *ndef) : m_map(map), m_ndef(ndef) {}
+	Pathfinder(Map *map, const NodeDefManager *ndef, PathfinderCache *cache) :
+		m_map(map), m_ndef(ndef), m_cache(cache) {}
 
 	/**
 	 * path evaluation function
@@ -230,6 +234,13 @@ class Pathfinder {
 	bool           isValidIndex(v3s16 index);
 
 
+	/**
+	 * get the kind of a node, from the cache if there is one
+	 * @param pos real world position
+	 * @return kind of node
+	 */
+	PathNodeKind   getNodeKind(v3s16 pos);
+
 	/* algorithm functions */
 
 	/**
@@ -310,7 +321,11 @@ class Pathfinder {
 
 	const NodeDefManager *m_ndef = nullptr;
 
-	friend class PathfinderCompareHeuristic;
+	PathfinderCache *m_cache = nullptr;
+
+	/** last block looked up in m_cache, for consecutive nodes in a block */
+	v3s16 m_last_blockpos;
+	const PathfinderCache::BlockNodes *m_last_block = nullptr;
 
 #ifdef PATHFINDER_DEBUG
 
@@ -361,28 +376,19 @@ class Pathfinder {
 #endif
 };
 
+/** open list entry of the A* pathfinder: estimated cost and position */
+typedef std::pair<int, v3s16> PathOpenEntry;
+
 /** Helper class for the open list priority queue in the A* pathfinder
  *  to sort the pathfinder nodes by cost.
+ *  The estimated cost of a node does not change while it is in the open list,
+ *  so it is stored in the entry instead of being looked up for every comparison.
  */
 class PathfinderCompareHeuristic
 {
-	private:
-		Pathfinder *myPathfinder;
 	public:
-		PathfinderCompareHeuristic(Pathfinder *pf)
-		{
-			myPathfinder = pf;
-		}
-		bool operator() (v3s16 pos1, v3s16 pos2) {
-			v3s16 ipos1 = myPathfinder->getIndexPos(pos1);
-			v3s16 ipos2 = myPathfinder->getIndexPos(pos2);
-			PathGridnode &g_pos1 = myPathfinder->getIndexElement(ipos1);
-			PathGridnode &g_pos2 = myPathfinder->getIndexElement(ipos2);
-			if (!g_pos1.valid)
-				return false;
-			if (!g_pos2.valid)
-				return false;
-			return g_pos1.estimated_cost > g_pos2.estimated_cost;
+		bool operator() (const PathOpenEntry &a, const PathOpenEntry &b) const {
+			return a.first > b.first;
 		}
 };
 
@@ -396,12 +402,55 @@ std::vector<v3s16> get_path(Map* map, const NodeDefManager *ndef,
 		unsigned int searchdistance,
 		unsigned int max_jump,
 		unsigned int max_drop,
-		PathAlgorithm algo)
+		PathAlgorithm algo,
+		PathfinderCache *cache)
 {
-	return Pathfinder(map, ndef).getPath(source, destination,
+	return Pathfinder(map, ndef, cache).getPath(source, destination,
 				searchdistance, max_jump, max_drop, algo);
 }
 
+/******************************************************************************/
+const PathfinderCache::BlockNodes *PathfinderCache::getBlock(v3s16 blockpos)
+{
+	MapBlock *block = m_map->getBlockNoCreateNoEx(blockpos);
+	auto it = m_blocks.find(blockpos);
+	if (!block) {
+		if (it != m_blocks.end())
+			m_blocks.erase(it);
+		return nullptr;
+	}
+	// a block that was unloaded and loaded again is a different object
+	if (it != m_blocks.end() && it->second->block == block)
+		return it->second.get();
+
+	if (it == m_blocks.end()) {
+		if (m_blocks.size() >= PATHFINDER_CACHE_MAX_BLOCKS)
+			m_blocks.clear();
+		it = m_blocks.emplace(blockpos, std::make_unique<BlockNodes>()).first;
+	}
+	BlockNodes &nodes = *it->second;
+	nodes.block = block;
+
+	u32 i = 0;
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++, i++) {
+		MapNode n = block->getNodeNoCheck(x, y, z);
+		if (n.getContent() == CONTENT_IGNORE)
+			nodes.kinds[i] = PN_IGNORE;
+		else
+			nodes.kinds[i] = m_ndef->get(n).walkable ? PN_WALKABLE : PN_OPEN;
+	}
+	return &nodes;
+}
+
+/******************************************************************************/
+void PathfinderCache::onMapEditEvent(const MapEditEvent &event)
+{
+	for (v3s16 blockpos : event.modified_blocks)
+		m_blocks.erase(blockpos);
+}
+
 /******************************************************************************/
 PathCost::PathCost(const PathCost &b)
 {
@@ -498,20 +547,19 @@ void PathGridnode::setCost(v3s16 dir, const PathCost &cost)
 
 void GridNodeContainer::initNode(v3s16 ipos, PathGridnode *p_node)
 {
-	const NodeDefManager *ndef = m_pathf->m_ndef;
 	PathGridnode &elem = *p_node;
 
 	v3s16 realpos = m_pathf->getRealPos(ipos);
 
-	MapNode current = m_pathf->m_map->getNode(realpos);
-	MapNode below   = m_pathf->m_map->getNode(realpos + v3s16(0, -1, 0));
+	PathNodeKind current = m_pathf->getNodeKind(realpos);
+	PathNodeKind below   = m_pathf->getNodeKind(realpos + v3s16(0, -1, 0));
 
 
-	if ((current.param0 == CONTENT_IGNORE) ||
-			(below.param0 == CONTENT_IGNORE)) {
+	if ((current == PN_IGNORE) ||
+			(below == PN_IGNORE)) {
 		DEBUG_OUT("Pathfinder: " << realpos <<
 			" current or below is invalid element" << std::endl);
-		if (current.param0 == CONTENT_IGNORE) {
+		if (current == PN_IGNORE) {
 			elem.type = 'i';
 			DEBUG_OUT(ipos << ": " << 'i' << std::endl);
 		}
@@ -519,10 +567,10 @@ void GridNodeContainer::initNode(v3s16 ipos, PathGridnode *p_node)
 	}
 
 	//don't add anything if it isn't an air node
-	if (ndef->get(current).walkable || !ndef->get(below).walkable) {
+	if (current == PN_WALKABLE || below != PN_WALKABLE) {
 			DEBUG_OUT("Pathfinder: " << realpos
 				<< " not on surface" << std::endl);
-			if (ndef->get(current).walkable) {
+			if (current == PN_WALKABLE) {
 				elem.type = 's';
 				DEBUG_OUT(ipos << ": " << 's' << std::endl);
 			} else {
@@ -648,14 +696,12 @@ std::vector<v3s16> Pathfinder::getPath(v3s16 source,
 #endif
 
 	//fail if source or destination is walkable
-	MapNode node_at_pos = m_map->getNode(destination);
-	if (m_ndef->get(node_at_pos).walkable) {
+	if (getNodeKind(destination) == PN_WALKABLE) {
 		VERBOSE_TARGET << "Destination is walkable. " <<
 				"Pos: " << destination << std::endl;
 		return retval;
 	}
-	node_at_pos = m_map->getNode(source);
-	if (m_ndef->get(node_at_pos).walkable) {
+	if (getNodeKind(source) == PN_WALKABLE) {
 		VERBOSE_TARGET << "Source is walkable. " <<
 				"Pos: " << source << std::endl;
 		return retval;
@@ -795,6 +841,27 @@ std::vector<v3s16> Pathfinder::getPath(v3s16 source,
 	return retval;
 }
 
+/******************************************************************************/
+PathNodeKind Pathfinder::getNodeKind(v3s16 pos)
+{
+	if (!m_cache) {
+		MapNode n = m_map->getNode(pos);
+		if (n.getContent() == CONTENT_IGNORE)
+			return PN_IGNORE;
+		return m_ndef->get(n).walkable ? PN_WALKABLE : PN_OPEN;
+	}
+
+	v3s16 blockpos = getNodeBlockPos(pos);
+	if (!m_last_block || blockpos != m_last_blockpos) {
+		m_last_block = m_cache->getBlock(blockpos);
+		m_last_blockpos = blockpos;
+		if (!m_last_block)
+			return PN_IGNORE;
+	}
+	v3s16 rel = pos - blockpos * MAP_BLOCKSIZE;
+	return m_last_block->kinds[(rel.Z * MAP_BLOCKSIZE + rel.Y) * MAP_BLOCKSIZE + rel.X];
+}
+
 /******************************************************************************/
 v3s16 Pathfinder::getRealPos(v3s16 ipos)
 {
@@ -817,28 +884,28 @@ PathCost Pathfinder::calcCost(v3s16 pos, v3s16 dir)
 		return retval;
 	}
 
-	MapNode node_at_pos2 = m_map->getNode(pos2);
+	PathNodeKind node_at_pos2 = getNodeKind(pos2);
 
 	//did we get information about node?
-	if (node_at_pos2.param0 == CONTENT_IGNORE ) {
+	if (node_at_pos2 == PN_IGNORE) {
 			VERBOSE_TARGET << "Pathfinder: (1) area at pos: "
 					<< pos2 << " not loaded";
 			return retval;
 	}
 
-	if (!m_ndef->get(node_at_pos2).walkable) {
-		MapNode node_below_pos2 =
-			m_map->getNode(pos2 + v3s16(0, -1, 0));
+	if (node_at_pos2 != PN_WALKABLE) {
+		PathNodeKind node_below_pos2 =
+			getNodeKind(pos2 + v3s16(0, -1, 0));
 
 		//did we get information about node?
-		if (node_below_pos2.param0 == CONTENT_IGNORE ) {
+		if (node_below_pos2 == PN_IGNORE) {
 				VERBOSE_TARGET << "Pathfinder: (2) area at pos: "
 					<< (pos2 + v3s16(0, -1, 0)) << " not loaded";
 				return retval;
 		}
 
 		//test if the same-height neighbor is suitable
-		if (m_ndef->get(node_below_pos2).walkable) {
+		if (node_below_pos2 == PN_WALKABLE) {
 			//SUCCESS!
 			retval.valid = true;
 			retval.value = 1;
@@ -849,19 +916,17 @@ PathCost Pathfinder::calcCost(v3s16 pos, v3s16 dir)
 		else {
 			//test if we can fall a couple of nodes (m_maxdrop)
 			v3s16 testpos = pos2 + v3s16(0, -1, 0);
-			MapNode node_at_pos = m_map->getNode(testpos);
+			PathNodeKind node_at_pos = getNodeKind(testpos);
 
-			while ((node_at_pos.param0 != CONTENT_IGNORE) &&
-					(!m_ndef->get(node_at_pos).walkable) &&
+			while ((node_at_pos == PN_OPEN) &&
 					(testpos.Y > m_limits.MinEdge.Y)) {
 				testpos += v3s16(0, -1, 0);
-				node_at_pos = m_map->getNode(testpos);
+				node_at_pos = getNodeKind(testpos);
 			}
 
 			//did we find surface?
 			if ((testpos.Y >= m_limits.MinEdge.Y) &&
-					(node_at_pos.param0 != CONTENT_IGNORE) &&
-					(m_ndef->get(node_at_pos).walkable)) {
+					(node_at_pos == PN_WALKABLE)) {
 				if ((pos2.Y - testpos.Y - 1) <= m_maxdrop) {
 					//SUCCESS!
 					retval.valid = true;
@@ -887,34 +952,31 @@ PathCost Pathfinder::calcCost(v3s16 pos, v3s16 dir)
 
 		v3s16 targetpos = pos2; // position for jump target
 		v3s16 jumppos = pos; // position for checking if jumping space is free
-		MapNode node_target = m_map->getNode(targetpos);
-		MapNode node_jump = m_map->getNode(jumppos);
+		PathNodeKind node_target = getNodeKind(targetpos);
+		PathNodeKind node_jump = getNodeKind(jumppos);
 		bool headbanger = false; // true if anything blocks jumppath
 
-		while ((node_target.param0 != CONTENT_IGNORE) &&
-				(m_ndef->get(node_target).walkable) &&
+		while ((node_target == PN_WALKABLE) &&
 				(targetpos.Y < m_limits.MaxEdge.Y)) {
 			//if the jump would hit any solid node, discard
-			if ((node_jump.param0 == CONTENT_IGNORE) ||
-					(m_ndef->get(node_jump).walkable)) {
+			if (node_jump != PN_OPEN) {
 					headbanger = true;
 				break;
 			}
 			targetpos += v3s16(0, 1, 0);
 			jumppos   += v3s16(0, 1, 0);
-			node_target = m_map->getNode(targetpos);
-			node_jump   = m_map->getNode(jumppos);
+			node_target = getNodeKind(targetpos);
+			node_jump   = getNodeKind(jumppos);
 
 		}
 		//check headbanger one last time
-		if ((node_jump.param0 == CONTENT_IGNORE) ||
-			(m_ndef->get(node_jump).walkable)) {
+		if (node_jump != PN_OPEN) {
 			headbanger = true;
 		}
 
 		//did we find surface without banging our head?
 		if ((!headbanger) && (targetpos.Y <= m_limits.MaxEdge.Y) &&
-				(!m_ndef->get(node_target).walkable)) {
+				(node_target != PN_WALKABLE)) {
 
 			if (targetpos.Y - pos2.Y <= m_maxjump) {
 				//SUCCESS!
@@ -1089,15 +1151,12 @@ bool Pathfinder::updateCostHeuristic(v3s16 isource, v3s16 idestination)
 	// The open list contains the pathfinder nodes that still need to be
 	// checked. The priority queue sorts the pathfinder nodes by
 	// estimated cost, with lowest cost on the top.
-	std::priority_queue<v3s16, std::vector<v3s16>, PathfinderCompareHeuristic>
-			openList(PathfinderCompareHeuristic(this));
+	std::priority_queue<PathOpenEntry, std::vector<PathOpenEntry>,
+			PathfinderCompareHeuristic> openList;
 
 	v3s16 source = getRealPos(isource);
 	v3s16 destination = getRealPos(idestination);
 
-	// initial position
-	openList.push(source);
-
 	// the 4 cardinal directions
 	const static v3s16 directions[4] = {
 		v3s16(1,0, 0),
@@ -1115,10 +1174,13 @@ bool Pathfinder::updateCostHeuristic(v3s16 isource, v3s16 idestination)
 	int cur_manhattan = getXZManhattanDist(destination);
 	s_pos.estimated_cost = cur_manhattan;
 
+	// initial position
+	openList.emplace(s_pos.estimated_cost, source);
+
 	while (!openList.empty()) {
 		// Pick node with lowest total cost estimate.
 		// The "cheapest" node is always on top.
-		current_pos = openList.top();
+		current_pos = openList.top().second;
 		openList.pop();
 		v3s16 ipos = getIndexPos(current_pos);
 
@@ -1156,12 +1218,15 @@ bool Pathfinder::updateCostHeuristic(v3s16 isource, v3s16 idestination)
 			v3s16 direction_3d = v3s16(direction_flat);
 			direction_3d.Y = cost.y_change;
 
+			if (!cost.valid)
+				continue;
+
 			// get position of true neighbor
 			v3s16 neighbor = current_pos + direction_3d;
 			v3s16 ineighbor = getIndexPos(neighbor);
 			PathGridnode &n_pos = getIndexElement(ineighbor);
 
-			if (cost.valid && !n_pos.is_closed && !n_pos.is_open) {
+			if (!n_pos.is_closed && !n_pos.is_open) {
 				// heuristic function; estimate cost from neighbor to destination
 				cur_manhattan = getXZManhattanDist(neighbor);
 
@@ -1170,7 +1235,7 @@ bool Pathfinder::updateCostHeuristic(v3s16 isource, v3s16 idestination)
 				n_pos.totalcost = current_totalcost + cost.value;
 				n_pos.estimated_cost = current_totalcost + cost.value + cur_manhattan;
 				n_pos.is_open = true;
-				openList.push(neighbor);
+				openList.emplace(n_pos.estimated_cost, neighbor);
 			}
 		}
 	}
@@ -1214,20 +1279,18 @@ v3s16 Pathfinder::walkDownwards(v3s16 pos, unsigned int max_down) {
 	if (max_down == 0)
 		return pos;
 	v3s16 testpos = v3s16(pos);
-	MapNode node_at_pos = m_map->getNode(testpos);
+	PathNodeKind node_at_pos = getNodeKind(testpos);
 	unsigned int down = 0;
-	while ((node_at_pos.param0 != CONTENT_IGNORE) &&
-			(!m_ndef->get(node_at_pos).walkable) &&
+	while ((node_at_pos == PN_OPEN) &&
 			(testpos.Y > m_limits.MinEdge.Y) &&
 			(down <= max_down)) {
 		testpos += v3s16(0, -1, 0);
 		down++;
-		node_at_pos = m_map->getNode(testpos);
+		node_at_pos = getNodeKind(testpos);
 	}
 	//did we find surface?
 	if ((testpos.Y >= m_limits.MinEdge.Y) &&
-			(node_at_pos.param0 != CONTENT_IGNORE) &&
-			(m_ndef->get(node_at_pos).walkable)) {
+			(node_at_pos == PN_WALKABLE)) {
 		if (down == 0) {
 			pos = testpos;
 		} else if ((down - 1) <= max_down) {
@@ -7,8 +7,11 @@
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include "irr_v3d.h"
+#include "map.h"
 
 /******************************************************************************/
 /* Forward declarations                                                       */
@@ -16,6 +19,7 @@
 
 class NodeDefManager;
 class Map;
+class MapBlock;
 
 /******************************************************************************/
 /* Typedefs and macros                                                        */
@@ -35,10 +39,49 @@ typedef enum {
 	PA_PLAIN_NP          /**< A* algorithm without prefetching of map data */
 } PathAlgorithm;
 
+/** What the pathfinder needs to know about a node */
+typedef enum : u8 {
+	PN_IGNORE,             /**< not loaded                                   */
+	PN_WALKABLE,           /**< solid, can be stood on                       */
+	PN_OPEN                /**< can be walked through                        */
+} PathNodeKind;
+
 /******************************************************************************/
 /* declarations                                                               */
 /******************************************************************************/
 
+/**
+ * Node kinds of loaded mapblocks, shared by all path searches on a map.
+ * A block is dropped when a MapEditEvent modifies it and recomputed when
+ * it is unloaded and loaded again.
+ */
+class PathfinderCache : public MapEventReceiver {
+public:
+	PathfinderCache(Map *map, const NodeDefManager *ndef) :
+		m_map(map), m_ndef(ndef) {}
+
+	struct BlockNodes {
+		MapBlock *block;          /**< block the kinds were read from         */
+		PathNodeKind kinds[MAP_BLOCKSIZE * MAP_BLOCKSIZE * MAP_BLOCKSIZE];
+	};
+
+	/**
+	 * get the node kinds of a block
+	 * @param blockpos position of the block
+	 * @return null if the block is not loaded
+	 */
+	const BlockNodes *getBlock(v3s16 blockpos);
+
+	void onMapEditEvent(const MapEditEvent &event) override;
+
+	size_t size() const { return m_blocks.size(); }
+
+private:
+	Map *m_map;
+	const NodeDefManager *m_ndef;
+	std::unordered_map<v3s16, std::unique_ptr<BlockNodes>> m_blocks;
+};
+
 /** c wrapper function to use from scriptapi */
 std::vector<v3s16> get_path(Map *map, const NodeDefManager *ndef,
 		v3s16 source,
@@ -46,4 +89,5 @@ std::vector<v3s16> get_path(Map *map, const NodeDefManager *ndef,
 		unsigned int searchdistance,
 		unsigned int max_jump,
 		unsigned int max_drop,
-		PathAlgorithm algo);
+		PathAlgorithm algo,
+		PathfinderCache *cache = nullptr);
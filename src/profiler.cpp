@@ -4,7 +4,13 @@
 
 #include "profiler.h"
 
+#include <algorithm>
 #include <cstring>
+#include <deque>
+#include <shared_mutex>
+#include "debug.h"
+#include "log.h"
+#include "tracer.h"
 #include "util/numeric.h"
 #include "porting.h"
 
@@ -47,13 +53,106 @@ static void paging(u32 length, u32 page, u32 pagecount, u32 &minindex, u32 &maxi
 	}
 }
 
+/*
+	ProfilerMetric
+*/
+
+namespace {
+	// Shared by all names past ProfilerMetric::MAX_METRICS
+	constexpr u32 OTHER_METRIC_ID = 0;
+
+	struct MetricRegistry {
+		std::shared_mutex mutex;
+		std::unordered_map<std::string, u32> ids;
+		// deque: references stay valid when adding names
+		std::deque<std::string> names{"Profiler: other metrics"};
+		bool full = false;
+	};
+
+	MetricRegistry &get_metric_registry()
+	{
+		static MetricRegistry registry;
+		return registry;
+	}
+
+	std::atomic<u64> next_profiler_serial{1};
+
+	// Profilers by serial, for threads that exit
+	struct ProfilerList {
+		std::mutex mutex;
+		std::unordered_map<u64, Profiler *> profilers;
+	};
+
+	ProfilerList &get_profiler_list()
+	{
+		static ProfilerList list;
+		return list;
+	}
+}
+
+ProfilerMetric::ProfilerMetric(const std::string &name)
+{
+	MetricRegistry &registry = get_metric_registry();
+	{
+		std::shared_lock lock(registry.mutex);
+		auto it = registry.ids.find(name);
+		if (it != registry.ids.end()) {
+			m_id = it->second;
+			return;
+		}
+	}
+	std::unique_lock lock(registry.mutex);
+	auto it = registry.ids.find(name);
+	if (it != registry.ids.end()) {
+		m_id = it->second;
+		return;
+	}
+	if (registry.names.size() >= MAX_METRICS) {
+		if (!registry.full) {
+			warningstream << "Profiler: more than " << MAX_METRICS
+				<< " metric names, counting \"" << name << "\" and all "
+				<< "further ones as \"" << registry.names[OTHER_METRIC_ID]
+				<< "\"" << std::endl;
+			registry.full = true;
+		}
+		m_id = OTHER_METRIC_ID;
+		return;
+	}
+	m_id = registry.names.size();
+	registry.ids.emplace(name, m_id);
+	registry.names.push_back(name);
+}
+
+ProfilerMetric::ProfilerMetric(const std::string &name, TimePrecision precision) :
+	ProfilerMetric(name + " [" + TimePrecision_units[precision] + "]")
+{
+	m_precision = precision;
+}
+
+const std::string &ProfilerMetric::getName(u32 id)
+{
+	MetricRegistry &registry = get_metric_registry();
+	std::shared_lock lock(registry.mutex);
+	return registry.names.at(id);
+}
+
+/*
+	ScopeProfiler
+*/
+
 ScopeProfiler::ScopeProfiler(Profiler *profiler, const std::string &name,
 		ScopeProfilerType type, TimePrecision prec) :
+	ScopeProfiler(profiler, ProfilerMetric(name, prec), type)
+{
+}
+
+ScopeProfiler::ScopeProfiler(Profiler *profiler, const ProfilerMetric &metric,
+		ScopeProfilerType type) :
 	m_profiler(profiler),
-	m_name(name), m_type(type), m_precision(prec)
+	m_metric(metric), m_type(type), m_precision(metric.getPrecision())
 {
-	m_name.append(" [").append(TimePrecision_units[prec]).append("]");
-	m_time1 = porting::getTime(prec);
+	m_time1 = porting::getTime(m_precision);
+	m_trace_start = g_tracer->isEnabled() ? porting::getTimeUs() : 0;
 }
 
 void ScopeProfiler::stop() noexcept
@@ -62,94 +161,343 @@ void ScopeProfiler::stop() noexcept
 		return;
 
 	float duration = porting::getTime(m_precision) - m_time1;
+	if (m_trace_start)
+		g_tracer->record(m_metric.getId(), m_trace_start, porting::getTimeUs());
 
 	switch (m_type) {
 	case SPT_ADD:
-		m_profiler->add(m_name, duration);
+		m_profiler->add(m_metric, duration);
 		break;
 	case SPT_AVG:
-		m_profiler->avg(m_name, duration);
+		m_profiler->avg(m_metric, duration);
 		break;
 	case SPT_GRAPH_ADD:
-		m_profiler->graphAdd(m_name, duration);
+		m_profiler->graphAdd(m_metric.getName(), duration);
 		break;
 	case SPT_MAX:
-		m_profiler->max(m_name, duration);
+		m_profiler->max(m_metric, duration);
 		break;
 	}
 
 	m_profiler = nullptr; // don't stop a second time
 }
 
-Profiler::Profiler()
+/*
+	Profiler
+*/
+
+Profiler::ThreadCounters::~ThreadCounters()
+{
+	for (auto &chunk : chunks)
+		delete[] chunk.load(std::memory_order_relaxed);
+}
+
+Profiler::Slot &Profiler::ThreadCounters::get(u32 id)
+{
+	const u32 index = id / CHUNK_SIZE;
+	assert(index < MAX_CHUNKS);
+	Slot *chunk = chunks[index].load(std::memory_order_relaxed);
+	if (!chunk) {
+		chunk = new Slot[CHUNK_SIZE];
+		chunks[index].store(chunk, std::memory_order_release);
+	}
+	return chunk[id % CHUNK_SIZE];
+}
+
+Profiler::Slot *Profiler::ThreadCounters::find(u32 id) const
+{
+	const u32 index = id / CHUNK_SIZE;
+	if (index >= MAX_CHUNKS)
+		return nullptr;
+	Slot *chunk = chunks[index].load(std::memory_order_acquire);
+	return chunk ? &chunk[id % CHUNK_SIZE] : nullptr;
+}
+
+Profiler::Profiler() :
+	m_serial(next_profiler_serial++)
 {
 	m_start_time = porting::getTimeMs();
+
+	ProfilerList &list = get_profiler_list();
+	std::lock_guard lock(list.mutex);
+	list.profilers[m_serial] = this;
 }
 
-void Profiler::add(const std::string &name, float value)
+Profiler::~Profiler()
 {
-	MutexAutoLock lock(m_mutex);
+	ProfilerList &list = get_profiler_list();
+	std::lock_guard lock(list.mutex);
+	list.profilers.erase(m_serial);
+}
 
-	auto it = m_data.find(name);
-	if (it == m_data.end()) {
-		// mark with special value for checking
-		m_data.emplace(name, DataPair{value, -SPT_ADD});
-	} else {
-		assert(it->second.avgcount == -SPT_ADD);
-		it->second.value += value;
+Profiler::ThreadCounters *Profiler::getThreadCounters()
+{
+	// Most threads only write to one or two profilers
+	struct CacheEntry {
+		u64 serial = 0;
+		ThreadCounters *counters = nullptr;
+	};
+	thread_local CacheEntry cache[4];
+	thread_local u8 cache_next = 0;
+
+	for (const CacheEntry &entry : cache) {
+		if (entry.serial == m_serial)
+			return entry.counters;
+	}
+
+	// Hands the counters back to the profilers when the thread exits
+	struct ExitHook {
+		std::vector<u64> serials;
+		~ExitHook()
+		{
+			for (u64 serial : serials)
+				releaseThread(serial, std::this_thread::get_id());
+		}
+	};
+	thread_local ExitHook exit_hook;
+
+	ThreadCounters *counters;
+	bool created = false;
+	{
+		MutexAutoLock lock(m_mutex);
+		auto &ptr = m_threads[std::this_thread::get_id()];
+		if (!ptr) {
+			ptr = std::make_unique<ThreadCounters>();
+			created = true;
+		}
+		counters = ptr.get();
 	}
+	cache[cache_next] = {m_serial, counters};
+	cache_next = (cache_next + 1) % ARRLEN(cache);
+
+	if (created) {
+		// Forget short-lived profilers now and then
+		if (exit_hook.serials.size() >= 16) {
+			ProfilerList &list = get_profiler_list();
+			std::lock_guard lock(list.mutex);
+			auto &serials = exit_hook.serials;
+			serials.erase(std::remove_if(serials.begin(), serials.end(),
+				[&] (u64 serial) { return list.profilers.count(serial) == 0; }),
+				serials.end());
+		}
+		exit_hook.serials.push_back(m_serial);
+	}
+	return counters;
 }
 
-void Profiler::max(const std::string &name, float value)
+void Profiler::releaseThread(u64 serial, std::thread::id thread)
 {
-	MutexAutoLock lock(m_mutex);
+	ProfilerList &list = get_profiler_list();
+	std::lock_guard list_lock(list.mutex);
+	auto it = list.profilers.find(serial);
+	if (it == list.profilers.end())
+		return;
+	Profiler *profiler = it->second;
 
-	auto it = m_data.find(name);
-	if (it == m_data.end()) {
-		// mark with special value for checking
-		m_data.emplace(name, DataPair{value, -SPT_MAX});
-	} else {
-		assert(it->second.avgcount == -SPT_MAX);
-		it->second.value = std::max(value, it->second.value);
+	MutexAutoLock lock(profiler->m_mutex);
+	auto counters = profiler->m_threads.find(thread);
+	if (counters == profiler->m_threads.end())
+		return;
+	profiler->retire(*counters->second);
+	profiler->m_threads.erase(counters);
+}
+
+void Profiler::retire(const ThreadCounters &counters)
+{
+	const u32 epoch = m_epoch.load();
+	for (u32 i = 0; i < ThreadCounters::MAX_CHUNKS; i++) {
+		const Slot *chunk = counters.chunks[i].load(std::memory_order_relaxed);
+		if (!chunk)
+			continue;
+		for (u32 j = 0; j < ThreadCounters::CHUNK_SIZE; j++) {
+			const Slot &slot = chunk[j];
+			const u32 slot_epoch = slot.epoch.load(std::memory_order_relaxed);
+			if (slot_epoch == 0)
+				continue;
+
+			// Readers hold m_mutex too, so plain updates are fine here
+			Slot &dest = m_retired.get(i * ThreadCounters::CHUNK_SIZE + j);
+			const u32 dest_epoch = dest.epoch.load(std::memory_order_relaxed);
+			if (dest_epoch == 0 || (dest_epoch != epoch && slot_epoch == epoch)) {
+				dest.value.store(0.0f, std::memory_order_relaxed);
+				dest.count.store(0, std::memory_order_relaxed);
+				dest.type.store(slot.type.load(std::memory_order_relaxed),
+						std::memory_order_relaxed);
+				dest.epoch.store(slot_epoch, std::memory_order_relaxed);
+			}
+			if (slot_epoch != epoch || dest.epoch.load(std::memory_order_relaxed) != epoch)
+				continue; // cleared since
+
+			const u32 count = slot.count.load(std::memory_order_relaxed);
+			if (count == 0)
+				continue;
+			float value = slot.value.load(std::memory_order_relaxed);
+			const u32 dest_count = dest.count.load(std::memory_order_relaxed);
+			if (dest.type.load(std::memory_order_relaxed) == SPT_MAX) {
+				if (dest_count > 0)
+					value = std::max(value, dest.value.load(std::memory_order_relaxed));
+				dest.count.store(1, std::memory_order_relaxed);
+			} else {
+				value += dest.value.load(std::memory_order_relaxed);
+				dest.count.store(dest_count + count, std::memory_order_relaxed);
+			}
+			dest.value.store(value, std::memory_order_relaxed);
+		}
+	}
+}
+
+Profiler::Slot &Profiler::getSlot(u32 id, u8 type)
+{
+	Slot &slot = getThreadCounters()->get(id);
+	const u32 epoch = m_epoch.load(std::memory_order_relaxed);
+	const u32 slot_epoch = slot.epoch.load(std::memory_order_relaxed);
+	if (slot_epoch != epoch) {
+		slot.value.store(0.0f, std::memory_order_relaxed);
+		slot.count.store(0, std::memory_order_relaxed);
+		if (slot_epoch == 0)
+			slot.type.store(type, std::memory_order_relaxed);
+		slot.epoch.store(epoch, std::memory_order_release);
 	}
+	assert(id == OTHER_METRIC_ID || slot.type.load(std::memory_order_relaxed) == type);
+	return slot;
+}
+
+// Only the owning thread writes to a slot, so no read-modify-write is needed
+
+void Profiler::add(const ProfilerMetric &metric, float value)
+{
+	Slot &slot = getSlot(metric.getId(), SPT_ADD);
+	slot.value.store(slot.value.load(std::memory_order_relaxed) + value,
+			std::memory_order_relaxed);
+	slot.count.store(slot.count.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+}
+
+void Profiler::max(const ProfilerMetric &metric, float value)
+{
+	Slot &slot = getSlot(metric.getId(), SPT_MAX);
+	if (slot.count.load(std::memory_order_relaxed) > 0)
+		value = std::max(value, slot.value.load(std::memory_order_relaxed));
+	slot.value.store(value, std::memory_order_relaxed);
+	slot.count.store(1, std::memory_order_relaxed);
 }
 
-void Profiler::avg(const std::string &name, float value)
+void Profiler::avg(const ProfilerMetric &metric, float value)
 {
+	Slot &slot = getSlot(metric.getId(), SPT_AVG);
+	slot.value.store(slot.value.load(std::memory_order_relaxed) + value,
+			std::memory_order_relaxed);
+	slot.count.store(slot.count.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+}
+
+void Profiler::clear()
+{
+	m_epoch++;
+	m_start_time = porting::getTimeMs();
+}
+
+void Profiler::remove(const std::string &name)
+{
+	const u32 id = ProfilerMetric(name).getId();
 	MutexAutoLock lock(m_mutex);
+	for (auto &it : m_threads) {
+		if (Slot *slot = it.second->find(id))
+			slot->epoch.store(0, std::memory_order_relaxed);
+	}
+	if (Slot *slot = m_retired.find(id))
+		slot->epoch.store(0, std::memory_order_relaxed);
+}
 
-	auto it = m_data.find(name);
-	if (it == m_data.end()) {
-		m_data.emplace(name, DataPair{value, 1});
-	} else {
-		assert(it->second.avgcount >= 0);
-		it->second.value += value;
-		it->second.avgcount++;
+void Profiler::merge(DataPair &result, const Slot &slot, u32 epoch)
+{
+	if (result.type == 0)
+		result.type = slot.type.load(std::memory_order_relaxed);
+	if (slot.epoch.load(std::memory_order_acquire) != epoch)
+		return; // cleared since
+	const u32 count = slot.count.load(std::memory_order_relaxed);
+	if (count == 0)
+		return;
+	const float value = slot.value.load(std::memory_order_relaxed);
+
+	switch (result.type) {
+	case SPT_AVG:
+		result.value += value;
+		result.avgcount += count;
+		break;
+	case SPT_MAX:
+		result.value = result.has_samples ? std::max(result.value, value) : value;
+		break;
+	default:
+		result.value += value;
+		break;
 	}
+	result.has_samples = true;
 }
 
-void Profiler::clear()
+bool Profiler::collect(u32 id, DataPair &result) const
 {
+	const u32 epoch = m_epoch.load();
+	bool found = false;
+	auto merge_counters = [&] (const ThreadCounters &counters) {
+		const Slot *slot = counters.find(id);
+		if (!slot || slot->epoch.load(std::memory_order_relaxed) == 0)
+			return;
+		merge(result, *slot, epoch);
+		found = true;
+	};
 	MutexAutoLock lock(m_mutex);
-	for (auto &it : m_data)
-		it.second.reset();
-	m_start_time = porting::getTimeMs();
+	for (const auto &it : m_threads)
+		merge_counters(*it.second);
+	merge_counters(m_retired);
+	return found;
+}
+
+std::map<std::string, Profiler::DataPair> Profiler::collectAll() const
+{
+	const u32 epoch = m_epoch.load();
+	std::unordered_map<u32, DataPair> by_id;
+	auto merge_counters = [&] (const ThreadCounters &counters) {
+		for (u32 i = 0; i < ThreadCounters::MAX_CHUNKS; i++) {
+			const Slot *chunk = counters.chunks[i].load(std::memory_order_acquire);
+			if (!chunk)
+				continue;
+			for (u32 j = 0; j < ThreadCounters::CHUNK_SIZE; j++) {
+				if (chunk[j].epoch.load(std::memory_order_relaxed) == 0)
+					continue;
+				merge(by_id[i * ThreadCounters::CHUNK_SIZE + j], chunk[j], epoch);
+			}
+		}
+	};
+	{
+		MutexAutoLock lock(m_mutex);
+		for (const auto &it : m_threads)
+			merge_counters(*it.second);
+		merge_counters(m_retired);
+	}
+
+	std::map<std::string, DataPair> result;
+	MetricRegistry &registry = get_metric_registry();
+	std::shared_lock lock(registry.mutex);
+	for (const auto &it : by_id)
+		result.emplace(registry.names[it.first], it.second);
+	return result;
 }
 
 float Profiler::getValue(const std::string &name) const
 {
-	auto it = m_data.find(name);
-	if (it == m_data.end())
+	DataPair data;
+	if (!collect(ProfilerMetric(name).getId(), data))
 		return 0;
-	return it->second.getValue();
+	return data.getValue();
 }
 
 int Profiler::getAvgCount(const std::string &name) const
 {
-	auto it = m_data.find(name);
-	if (it == m_data.end())
+	DataPair data;
+	if (!collect(ProfilerMetric(name).getId(), data))
 		return 1;
-	int denominator = it->second.avgcount;
+	int denominator = data.avgcount;
 	return denominator >= 1 ? denominator : 1;
 }
 
@@ -189,12 +537,12 @@ int Profiler::print(std::ostream &o, u32 page, u32 pagecount)
 
 void Profiler::getPage(GraphValues &o, u32 page, u32 pagecount)
 {
-	MutexAutoLock lock(m_mutex);
+	const auto data = collectAll();
 
 	u32 minindex, maxindex;
-	paging(m_data.size(), page, pagecount, minindex, maxindex);
+	paging(data.size(), page, pagecount, minindex, maxindex);
 
-	for (const auto &i : m_data) {
+	for (const auto &i : data) {
 		if (maxindex == 0)
 			break;
 		maxindex--;
@@ -5,10 +5,15 @@
 #pragma once
 
 #include "irrlichttypes.h"
+#include <atomic>
 #include <cassert>
 #include <string>
 #include <map>
+#include <memory>
 #include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "threading/mutex_auto_lock.h"
 #include "util/timetaker.h"
@@ -18,18 +23,68 @@
 class Profiler;
 extern Profiler *g_profiler;
 
+/*
+	Interned profiler metric name
+
+	Names are interned once for the whole process and map to a small id,
+	so hot code can keep the handle in a static variable instead of passing
+	strings around:
+
+		ScopeProfiler sp(g_profiler, PROFILER_METRIC("Server: foo", PRECISION_MICRO), SPT_AVG);
+
+	Past MAX_METRICS names, all new names share one "other" metric.
+*/
+class ProfilerMetric
+{
+public:
+	static constexpr u32 MAX_METRICS = 1 << 16;
+
+	explicit ProfilerMetric(const std::string &name);
+	/// For timings: appends the unit to the name, e.g. "foo [ms]"
+	ProfilerMetric(const std::string &name, TimePrecision precision);
+
+	u32 getId() const { return m_id; }
+	TimePrecision getPrecision() const { return m_precision; }
+	const std::string &getName() const { return getName(m_id); }
+	static const std::string &getName(u32 id);
+
+private:
+	u32 m_id;
+	TimePrecision m_precision = PRECISION_MILLI;
+};
+
+// Handle for a literal name, interned on first use of this call site
+#define PROFILER_METRIC(...) [] () -> const ProfilerMetric & { \
+		static const ProfilerMetric metric(__VA_ARGS__); \
+		return metric; \
+	}()
+
 /*
 	Time profiler
+
+	Every thread writes into its own counters without taking a lock, the
+	values of all threads are only combined when they are read. A sample
+	added while another thread reads may be missed by that read. When a
+	thread exits, its counters are folded into shared ones and freed.
 */
 
 class Profiler
 {
+	friend class TestProfiler;
+
 public:
 	Profiler();
+	~Profiler();
+
+	DISABLE_CLASS_COPY(Profiler)
+
+	void add(const ProfilerMetric &metric, float value);
+	void avg(const ProfilerMetric &metric, float value);
+	void max(const ProfilerMetric &metric, float value);
 
-	void add(const std::string &name, float value);
-	void avg(const std::string &name, float value);
-	void max(const std::string &name, float value);
+	void add(const std::string &name, float value) { add(ProfilerMetric(name), value); }
+	void avg(const std::string &name, float value) { avg(ProfilerMetric(name), value); }
+	void max(const std::string &name, float value) { max(ProfilerMetric(name), value); }
 	void clear();
 
 	float getValue(const std::string &name) const;
@@ -64,32 +119,65 @@ class Profiler
 		std::swap(result, m_graphvalues);
 	}
 
-	void remove(const std::string& name)
-	{
-		MutexAutoLock lock(m_mutex);
-		m_data.erase(name);
-	}
+	void remove(const std::string &name);
 
 private:
+	// Counters of one metric written by one thread
+	struct Slot {
+		std::atomic<float> value{0.0f};
+		std::atomic<u32> count{0};
+		// 0 = unused, otherwise the value of m_epoch when it was last reset
+		std::atomic<u32> epoch{0};
+		// ScopeProfilerType, for checking that a name is used consistently
+		std::atomic<u8> type{0};
+	};
+
+	// Counters of one thread, grown in chunks so that readers never see
+	// a slot move
+	struct ThreadCounters {
+		static constexpr u32 CHUNK_SIZE = 256;
+		static constexpr u32 MAX_CHUNKS = ProfilerMetric::MAX_METRICS / CHUNK_SIZE;
+
+		std::atomic<Slot *> chunks[MAX_CHUNKS] = {};
+
+		~ThreadCounters();
+		// Only called by the owning thread
+		Slot &get(u32 id);
+		Slot *find(u32 id) const;
+	};
+
+	// Combined values of all threads
 	struct DataPair {
 		float value = 0;
 		int avgcount = 0;
+		u8 type = 0;
+		bool has_samples = false;
 
-		inline void reset() {
-			value = 0;
-			// negative values are used for type checking, so leave them alone
-			if (avgcount >= 1)
-				avgcount = 0;
-		}
 		inline float getValue() const {
 			return avgcount >= 1 ? (value / avgcount) : value;
 		}
 	};
 
-	std::mutex m_mutex;
-	std::map<std::string, DataPair> m_data;
+	Slot &getSlot(u32 id, u8 type);
+	ThreadCounters *getThreadCounters();
+	// Called when a thread that wrote to the profiler with this serial exits
+	static void releaseThread(u64 serial, std::thread::id thread);
+	void retire(const ThreadCounters &counters);
+	static void merge(DataPair &result, const Slot &slot, u32 epoch);
+	bool collect(u32 id, DataPair &result) const;
+	std::map<std::string, DataPair> collectAll() const;
+
+	// Identifies this profiler in the per-thread lookup cache
+	const u64 m_serial;
+	// Incremented by clear(), older samples are ignored
+	std::atomic<u32> m_epoch{1};
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::thread::id, std::unique_ptr<ThreadCounters>> m_threads;
+	// Values of threads that exited, only accessed with m_mutex held
+	ThreadCounters m_retired;
 	std::map<std::string, float> m_graphvalues;
-	u64 m_start_time;
+	std::atomic<u64> m_start_time;
 };
 
 enum ScopeProfilerType : u8
@@ -108,6 +196,8 @@ class ScopeProfiler
 	ScopeProfiler(Profiler *profiler, const std::string &name,
 			ScopeProfilerType type = SPT_ADD,
 			TimePrecision precision = PRECISION_MILLI);
+	ScopeProfiler(Profiler *profiler, const ProfilerMetric &metric,
+			ScopeProfilerType type = SPT_ADD);
 	inline ~ScopeProfiler() { stop(); }
 
 	// End profiled scope early
@@ -117,8 +207,10 @@ class ScopeProfiler
 
 private:
 	Profiler *m_profiler = nullptr;
-	std::string m_name;
+	ProfilerMetric m_metric;
 	u64 m_time1;
+	// start in microseconds if the tracer is enabled, otherwise 0
+	u64 m_trace_start;
 	ScopeProfilerType m_type;
 	TimePrecision m_precision;
 };
@@ -18,6 +18,7 @@ extern "C" {
 #include "filesys.h"
 #include "settings.h"
 #include "porting.h"
+#include "tracer.h"
 #include "common/c_internal.h"
 #include "common/c_packer.h"
 #if CHECK_CLIENT_BUILD()
@@ -370,6 +371,8 @@ void* AsyncWorkerThread::run()
 		FATAL_ERROR("Unable to find core within async environment!");
 	}
 
+	static const ProfilerMetric job_metric("Async environment: job");
+
 	// Main loop
 	LuaJobInfo j;
 	while (!stopRequested()) {
@@ -377,6 +380,8 @@ void* AsyncWorkerThread::run()
 		if (!jobDispatcher->getJob(&j) || stopRequested())
 			continue;
 
+		TraceScope trace(job_metric);
+
 		const bool use_ext = !!j.params_ext;
 
 		lua_getfield(L, -1, "job_processor");
@@ -359,13 +359,44 @@ void ScriptApiBase::runCallbacksRaw(int nargs,
 	// Stack now looks like this:
 	// ... <error handler> <run_callbacks> <table> <mode> <arg#1> <arg#2> ... <arg#n>
 
+	// Time is accounted to the mod of each callback, until a nested run
+	// returns to the callback that started it.
+	std::string outer_mod;
+	if (m_metrics_backend) {
+		outer_mod = m_timed_mod;
+		m_timed_depth++;
+	}
+
 	int result = lua_pcall(L, nargs + 2, 1, error_handler);
+
+	if (m_metrics_backend) {
+		m_timed_depth--;
+		switchTimedMod(outer_mod);
+	}
+
 	if (result != 0)
 		scriptError(result, fxn);
 
 	lua_remove(L, error_handler);
 }
 
+void ScriptApiBase::switchTimedMod(const std::string &mod)
+{
+	const u64 now = porting::getTimeUs();
+	if (!m_timed_mod.empty()) {
+		auto &histogram = m_callback_histograms[m_timed_mod];
+		if (!histogram) {
+			histogram = m_metrics_backend->addHistogram(
+				"minetest_lua_callback_seconds",
+				"Time spent in callbacks registered by a mod",
+				MetricsBackend::durationBuckets(), {{"mod", m_timed_mod}});
+		}
+		histogram->observe((now - m_timed_since_us) / 1e6);
+	}
+	m_timed_mod = mod;
+	m_timed_since_us = now;
+}
+
 void ScriptApiBase::realityCheck()
 {
 	int top = lua_gettop(m_luastack);
@@ -412,6 +443,8 @@ void ScriptApiBase::stackDump(std::ostream &o)
 void ScriptApiBase::setOriginDirect(const char *origin)
 {
 	m_last_run_mod = origin ? origin : "??";
+	if (m_timed_depth > 0)
+		switchTimedMod(m_last_run_mod);
 }
 
 void ScriptApiBase::setOriginFromTableRaw(int index, const char *fxn)
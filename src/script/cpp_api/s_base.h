@@ -8,8 +8,10 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <unordered_map>
 #include "common/helper.h"
 #include "util/basic_macros.h"
+#include "util/metricsbackend.h"
 
 extern "C" {
 #include <lua.h>
@@ -104,6 +106,10 @@ class ScriptApiBase : protected LuaHelper {
 	void setOriginDirect(const char *origin);
 	void setOriginFromTableRaw(int index, const char *fxn);
 
+	// Report the time spent in callbacks per mod. Without a backend, the
+	// callbacks are not timed at all.
+	void setMetricsBackend(MetricsBackend *backend) { m_metrics_backend = backend; }
+
 	/**
 	 * Returns the currently running mod, only during init time.
 	 * The reason this is insecure is that mods can mess with each others code,
@@ -173,6 +179,9 @@ class ScriptApiBase : protected LuaHelper {
 
 	void pushPlayerHPChangeReason(lua_State *L, const PlayerHPChangeReason& reason);
 
+	// Accounts the time since the last switch to the previous mod
+	void switchTimedMod(const std::string &mod);
+
 	std::recursive_mutex m_luastackmutex;
 	std::string     m_last_run_mod;
 
@@ -195,4 +204,11 @@ class ScriptApiBase : protected LuaHelper {
 	EmergeThread     *m_emerge = nullptr;
 
 	ScriptingType     m_type;
+
+	// Callback timing, only while runCallbacks() is running
+	MetricsBackend   *m_metrics_backend = nullptr;
+	std::unordered_map<std::string, MetricHistogramPtr> m_callback_histograms;
+	std::string       m_timed_mod;
+	u64               m_timed_since_us = 0;
+	u32               m_timed_depth = 0;
 };
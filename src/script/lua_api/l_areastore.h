@@ -18,6 +18,7 @@ class LuaAreaStore : public ModApiBase
 	static int l_get_area(lua_State *L);
 
 	static int l_get_areas_for_pos(lua_State *L);
+	static int l_get_areas_for_positions(lua_State *L);
 	static int l_get_areas_in_area(lua_State *L);
 	static int l_insert_area(lua_State *L);
 	static int l_reserve(lua_State *L);
@@ -1062,6 +1062,38 @@ int ModApiEnv::l_line_of_sight(lua_State *L)
 	return 1;
 }
 
+int ModApiEnv::l_bulk_line_of_sight(lua_State *L)
+{
+	GET_PLAIN_ENV_PTR;
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	std::vector<std::pair<v3f, v3f>> lines;
+	s32 len = lua_objlen(L, 1);
+	lines.reserve(len);
+	for (s32 i = 1; i <= len; i++) {
+		lua_rawgeti(L, 1, i);
+		luaL_checktype(L, -1, LUA_TTABLE);
+		lua_rawgeti(L, -1, 1);
+		lua_rawgeti(L, -2, 2);
+		lines.emplace_back(checkFloatPos(L, -2), checkFloatPos(L, -1));
+		lua_pop(L, 3);
+	}
+
+	std::vector<std::optional<v3s16>> results;
+	env->bulk_line_of_sight(lines, results);
+
+	lua_createtable(L, results.size(), 0);
+	for (size_t i = 0; i < results.size(); i++) {
+		if (results[i])
+			push_v3s16(L, *results[i]);
+		else
+			lua_pushboolean(L, true);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
 int ModApiEnv::l_fix_light(lua_State *L)
 {
 	GET_ENV_PTR;
@@ -1211,7 +1243,7 @@ int ModApiEnv::l_find_path(lua_State *L)
 	}
 
 	std::vector<v3s16> path = get_path(&env->getServerMap(), env->getGameDef()->ndef(), pos1, pos2,
-		searchdistance, max_jump, max_drop, algo);
+		searchdistance, max_jump, max_drop, algo, env->getPathfinderCache());
 
 	if (!path.empty()) {
 		lua_createtable(L, path.size(), 0);
@@ -1354,6 +1386,7 @@ void ModApiEnv::Initialize(lua_State *L, int top)
 	API_FCT(spawn_tree);
 	API_FCT(find_path);
 	API_FCT(line_of_sight);
+	API_FCT(bulk_line_of_sight);
 	API_FCT(raycast);
 	API_FCT(transforming_liquid_add);
 	API_FCT(forceload_block);
@@ -1373,6 +1406,7 @@ void ModApiEnv::InitializeClient(lua_State *L, int top)
 	API_FCT(find_nodes_in_area);
 	API_FCT(find_nodes_in_area_under_air);
 	API_FCT(line_of_sight);
+	API_FCT(bulk_line_of_sight);
 	API_FCT(raycast);
 }
 
@@ -202,6 +202,9 @@ class ModApiEnv : public ModApiEnvBase {
 	// line_of_sight(pos1, pos2) -> true/false
 	static int l_line_of_sight(lua_State *L);
 
+	// bulk_line_of_sight({{pos1, pos2}, ...}) -> {true or pos, ...}
+	static int l_bulk_line_of_sight(lua_State *L);
+
 	// raycast(pos1, pos2, objects, liquids) -> Raycast
 	static int l_raycast(lua_State *L);
 
@@ -21,6 +21,7 @@
 #include "nodedef.h"
 #include "particles.h"
 #include "profiler.h"
+#include "tracer.h"
 #include "remoteplayer.h"
 #include "server/ban.h"
 #include "serverenvironment.h"
@@ -68,6 +69,7 @@
 #endif
 #include "database/database-files.h"
 #include "database/database-dummy.h"
+#include "database/database-writebehind.h"
 
 #include <iostream>
 #include <queue>
@@ -134,9 +136,17 @@ void *ServerThread::run()
 
 	float dtime = 0.0f;
 
+	std::unique_ptr<SlowStepTracer> step_tracer;
+	if (u32 threshold = g_settings->getU32("profiler_trace_threshold")) {
+		step_tracer = std::make_unique<SlowStepTracer>(
+				m_server->getWorldPath() + DIR_DELIM + "traces", threshold);
+		g_tracer->setEnabled(true);
+	}
+
 	while (!stopRequested()) {
 		framemarker.start();
-		ScopeProfiler spm(g_profiler, "Server::RunStep() (max)", SPT_MAX);
+		ScopeProfiler spm(g_profiler,
+				PROFILER_METRIC("Server::RunStep() (max)", PRECISION_MILLI), SPT_MAX);
 
 		u64 t0 = porting::getTimeUs();
 
@@ -148,7 +158,16 @@ void *ServerThread::run()
 			if (dtime > step_settings.steplen + 0.001f)
 				m_server->yieldToOtherThreads(dtime);
 
+			const u64 step_start = porting::getTimeUs();
 			m_server->AsyncRunStep(step_settings.pause ? 0.0f : dtime);
+			const u64 step_end = porting::getTimeUs();
+			m_server->m_step_duration_histogram->observe((step_end - step_start) / 1e6);
+			if (step_tracer) {
+				std::string path = step_tracer->step(step_start, step_end);
+				if (!path.empty())
+					warningstream << "Server: slow step, trace saved to "
+						<< path << std::endl;
+			}
 
 			const float remaining_time = step_settings.steplen
 					- 1e-6f * (porting::getTimeUs() - t0);
@@ -170,6 +189,9 @@ void *ServerThread::run()
 		framemarker.end();
 	}
 
+	if (step_tracer)
+		g_tracer->setEnabled(false);
+
 	END_DEBUG_EXCEPTION_HANDLER
 
 	return nullptr;
@@ -316,6 +338,10 @@ Server::Server(
 		m_metrics_backend.reset(createPrometheusMetricsBackend());
 	}
 #endif
+	if (!m_metrics_backend && !simple_singleplayer_mode) {
+		// Note: may return null
+		m_metrics_backend.reset(createBuiltinMetricsBackend());
+	}
 	if (!m_metrics_backend)
 		m_metrics_backend = std::make_unique<MetricsBackend>();
 
@@ -352,6 +378,16 @@ Server::Server(
 			"minetest_core_map_edit_events",
 			"Number of map edit events");
 
+	m_step_duration_histogram = m_metrics_backend->addHistogram(
+			"minetest_core_server_step_duration_seconds",
+			"Duration of server steps, without waiting for packets",
+			MetricsBackend::durationBuckets());
+
+	m_packet_process_histogram = m_metrics_backend->addHistogram(
+			"minetest_core_server_packet_process_seconds",
+			"Time spent handling a received packet",
+			MetricsBackend::durationBuckets());
+
 	m_lag_gauge->set(g_settings->getFloat("dedicated_server_step"));
 
 	m_path_mod_data = porting::path_user + DIR_DELIM "mod_data";
@@ -523,6 +559,9 @@ void Server::init()
 	infostream << "Server: Initializing Lua" << std::endl;
 
 	m_script = std::make_unique<ServerScripting>(this);
+	// Timing every callback is only worth it if the metrics are collected
+	if (m_metrics_backend->isEnabled())
+		m_script->setMetricsBackend(m_metrics_backend.get());
 
 	// Must be created before mod loading because we have some inventory creation
 	m_inventory_mgr = std::make_unique<ServerInventoryManager>();
@@ -683,7 +722,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	if ((dtime == 0.0f) && !initial_step)
 		return;
 
-	ScopeProfiler sp(g_profiler, "Server::AsyncRunStep()", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("Server::AsyncRunStep()", PRECISION_MILLI), SPT_AVG);
 
 	/*
 		Update uptime
@@ -746,7 +786,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	{
 		EnvAutoLock lock(this);
 		// Run Map's timers and unload unused data
-		ScopeProfiler sp(g_profiler, "Server: map timer and unload");
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("Server: map timer and unload", PRECISION_MILLI));
 		m_env->getMap().timerUpdate(map_timer_and_unload_dtime,
 			std::max(g_settings->getFloat("server_unload_unused_data_timeout"), 0.0f),
 			-1);
@@ -785,7 +826,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 
 		EnvAutoLock lock(this);
 
-		ScopeProfiler sp(g_profiler, "Server: liquid transform");
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("Server: liquid transform", PRECISION_MILLI));
 
 		std::map<v3s16, MapBlock*> modified_blocks;
 		m_env->getServerMap().transformLiquids(modified_blocks, m_env);
@@ -862,7 +904,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 		{
 			ClientInterface::AutoLock clientlock(m_clients);
 			const RemoteClientMap &clients = m_clients.getClientList();
-			ScopeProfiler sp(g_profiler, "Server: update objects within range");
+			ScopeProfiler sp(g_profiler,
+					PROFILER_METRIC("Server: update objects within range", PRECISION_MILLI));
 
 			m_player_gauge->set(clients.size());
 			for (const auto &client_it : clients) {
@@ -897,7 +940,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 	*/
 	{
 		EnvAutoLock envlock(this);
-		ScopeProfiler sp(g_profiler, "Server: send SAO messages");
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("Server: send SAO messages", PRECISION_MILLI));
 
 		// Key = object id
 		// Value = data sent by object
@@ -1108,7 +1152,8 @@ void Server::AsyncRunStep(float dtime, bool initial_step)
 			counter = 0.0;
 			EnvAutoLock lock(this);
 
-			ScopeProfiler sp(g_profiler, "Server: map saving (sum)");
+			ScopeProfiler sp(g_profiler,
+					PROFILER_METRIC("Server: map saving (sum)", PRECISION_MILLI));
 
 			// Save ban file
 			if (m_banmanager->isModified()) {
@@ -1219,7 +1264,8 @@ void Server::yieldToOtherThreads(float dtime)
 
 	int sleep_count = std::clamp<int>(dtime / QUANTUM, 1, SLEEP_MAX);
 
-	ScopeProfiler sp(g_profiler, "Server::yieldTo...() sleep", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("Server::yieldTo...() sleep", PRECISION_MILLI), SPT_AVG);
 	size_t qs = qs_initial;
 	while (sleep_count-- > 0) {
 		sleep_ms(1);
@@ -1229,7 +1275,7 @@ void Server::yieldToOtherThreads(float dtime)
 			break;
 		qs = qs2;
 	}
-	g_profiler->avg("Server::yieldTo...() progress [#]", qs_initial - qs);
+	g_profiler->avg(PROFILER_METRIC("Server::yieldTo...() progress [#]"), qs_initial - qs);
 }
 
 PlayerSAO *Server::StageTwoClientInit(session_t peer_id)
@@ -1326,7 +1372,10 @@ void Server::ProcessData(NetworkPacket *pkt)
 	// Environment is locked first.
 	EnvAutoLock envlock(this);
 
-	ScopeProfiler sp(g_profiler, "Server: Process network packet (sum)");
+	static const ProfilerMetric metric("Server: Process network packet (sum)",
+			PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, metric);
+	ScopeMetricTimer timer(m_packet_process_histogram.get());
 	u32 peer_id = pkt->getPeerId();
 
 	try {
@@ -1598,7 +1647,10 @@ void Server::SendInventory(RemotePlayer *player, bool incremental)
 	NetworkPacket pkt(TOCLIENT_INVENTORY, 0, player->getPeerId());
 
 	std::ostringstream os(std::ios::binary);
-	player->inventory.serialize(os, incremental);
+	if (player->protocol_version >= 52)
+		player->inventory.serializeBinary(os, incremental);
+	else
+		player->inventory.serialize(os, incremental);
 	player->inventory.setModified(false);
 	player->setModified(true);
 
@@ -2509,7 +2561,9 @@ void Server::sendMetadataChanged(const std::unordered_set<v3s16> &positions, flo
 		if (meta_updates_list.size() == 0)
 			continue;
 
-		// Send the meta changes
+		// Send the meta changes. Inventories are included in full, as the
+		// clients in range do not necessarily share the previous state that
+		// a delta would be based on.
 		os.str("");
 		meta_updates_list.serialize(os, client->serialization_version, false, true, true);
 		std::string raw = os.str();
@@ -2564,7 +2618,9 @@ void Server::SendBlocks(float dtime)
 	u32 total_sending = 0, unique_clients = 0;
 
 	{
-		ScopeProfiler sp2(g_profiler, "Server::SendBlocks(): Collect list");
+		static const ProfilerMetric metric("Server::SendBlocks(): Collect list",
+				PRECISION_MILLI);
+		ScopeProfiler sp2(g_profiler, metric);
 
 		std::vector<session_t> clients = m_clients.getClientIDs();
 
@@ -2594,7 +2650,9 @@ void Server::SendBlocks(float dtime)
 	u32 max_blocks_to_send = (m_env->getPlayerCount() + g_settings->getU32("max_users")) *
 		g_settings->getU32("max_simultaneous_block_sends_per_client") / 4 + 1;
 
-	ScopeProfiler sp(g_profiler, "Server::SendBlocks(): Send to clients");
+	static const ProfilerMetric send_metric("Server::SendBlocks(): Send to clients",
+			PRECISION_MILLI);
+	ScopeProfiler sp(g_profiler, send_metric);
 	Map &map = m_env->getMap();
 
 	SerializedBlockCache cache, *cache_ptr = nullptr;
@@ -2983,30 +3041,67 @@ void Server::SendMinimapModes(session_t peer_id,
 	Send(&pkt);
 }
 
-void Server::sendDetachedInventory(Inventory *inventory, const std::string &name, session_t peer_id)
+static void make_detached_inventory_packet(NetworkPacket &pkt, Inventory *inventory,
+		const std::string &name, bool binary, bool incremental)
 {
-	NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
 	pkt << name;
 
 	if (!inventory) {
 		pkt << false; // Remove inventory
-	} else {
-		pkt << true; // Update inventory
+		return;
+	}
+	pkt << true; // Update inventory
 
-		// Serialization & NetworkPacket isn't a love story
-		std::ostringstream os(std::ios_base::binary);
+	// Serialization & NetworkPacket isn't a love story
+	std::ostringstream os(std::ios_base::binary);
+	if (binary)
+		inventory->serializeBinary(os, incremental);
+	else
 		inventory->serialize(os);
-		inventory->setModified(false);
 
-		const std::string &os_str = os.str();
-		pkt << static_cast<u16>(os_str.size()); // HACK: to keep compatibility with 5.0.0 clients
-		pkt.putRawString(os_str);
-	}
+	const std::string &os_str = os.str();
+	pkt << static_cast<u16>(os_str.size()); // HACK: to keep compatibility with 5.0.0 clients
+	pkt.putRawString(os_str);
+}
 
-	if (peer_id == PEER_ID_INEXISTENT)
-		m_clients.sendToAll(&pkt);
-	else
+void Server::sendDetachedInventory(Inventory *inventory, const std::string &name,
+		session_t peer_id, bool incremental)
+{
+	if (peer_id != PEER_ID_INEXISTENT) {
+		NetworkPacket pkt(TOCLIENT_DETACHED_INVENTORY, 0, peer_id);
+		make_detached_inventory_packet(pkt, inventory, name,
+				m_clients.getProtocolVersion(peer_id) >= 52, incremental);
 		Send(&pkt);
+		// Others may still need the changes, unless this peer is the owner
+		if (inventory && incremental)
+			inventory->setModified(false);
+		return;
+	}
+
+	/*
+		Clients with protocol version >= 52 get the modified slots only.
+		Deltas are sent from CS_DefinitionsSent onwards, which is when the
+		full inventory is sent to a joining client, so no update is missed.
+	*/
+	NetworkPacket pkt_binary(TOCLIENT_DETACHED_INVENTORY, 0);
+	NetworkPacket pkt_text(TOCLIENT_DETACHED_INVENTORY, 0);
+	make_detached_inventory_packet(pkt_binary, inventory, name, true, incremental);
+	bool have_text = false;
+
+	for (session_t client_id : m_clients.getClientIDs(CS_DefinitionsSent)) {
+		if (m_clients.getProtocolVersion(client_id) >= 52) {
+			m_clients.send(client_id, &pkt_binary);
+			continue;
+		}
+		if (!have_text) {
+			make_detached_inventory_packet(pkt_text, inventory, name, false, false);
+			have_text = true;
+		}
+		m_clients.send(client_id, &pkt_text);
+	}
+
+	if (inventory)
+		inventory->setModified(false);
 }
 
 void Server::sendDetachedInventories(session_t peer_id, bool incremental)
@@ -3017,8 +3112,17 @@ void Server::sendDetachedInventories(session_t peer_id, bool incremental)
 		peer_name = getClient(peer_id, CS_Created)->getName();
 	}
 
-	auto send_cb = [this, peer_id](const std::string &name, Inventory *inv) {
-		sendDetachedInventory(inv, name, peer_id);
+	auto send_cb = [this, peer_id, incremental](const std::string &name,
+			Inventory *inv, const std::string &owner) {
+		session_t target = peer_id;
+		if (target == PEER_ID_INEXISTENT && !owner.empty()) {
+			// Only the owner knows about this inventory
+			RemotePlayer *player = m_env->getPlayer(owner.c_str());
+			if (!player || player->getPeerId() == PEER_ID_INEXISTENT)
+				return;
+			target = player->getPeerId();
+		}
+		sendDetachedInventory(inv, name, target, incremental);
 	};
 
 	m_inventory_mgr->sendDetachedInventories(peer_name, incremental, send_cb);
@@ -4403,7 +4507,10 @@ ModStorageDatabase *Server::openModStorageDatabase(const std::string &world_path
 			"please read https://docs.luanti.org/for-server-hosts/database-backends." << std::endl;
 	}
 
-	return openModStorageDatabase(backend, world_path, world_mt);
+	ModStorageDatabase *db = openModStorageDatabase(backend, world_path, world_mt);
+	if (backend != "dummy" && g_settings->getBool("mod_storage_write_behind"))
+		db = new ModStorageDatabaseWriteBehind(db);
+	return db;
 }
 
 std::vector<std::string> Server::getModStorageDatabaseBackends()
@@ -4413,6 +4520,7 @@ std::vector<std::string> Server::getModStorageDatabaseBackends()
 #if USE_POSTGRESQL
 	ret.emplace_back("postgresql");
 #endif
+	ret.emplace_back("binary");
 	ret.emplace_back("files");
 	ret.emplace_back("dummy");
 	return ret;
@@ -4432,6 +4540,9 @@ ModStorageDatabase *Server::openModStorageDatabase(const std::string &backend,
 	}
 #endif // USE_POSTGRESQL
 
+	if (backend == "binary")
+		return new ModStorageDatabaseBinary(world_path);
+
 	if (backend == "files")
 		return new ModStorageDatabaseFiles(world_path);
 
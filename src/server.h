@@ -314,7 +314,9 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	bool dynamicAddMedia(const DynamicMediaArgs &args);
 
 	ServerInventoryManager *getInventoryMgr() const { return m_inventory_mgr.get(); }
-	void sendDetachedInventory(Inventory *inventory, const std::string &name, session_t peer_id);
+	// Incremental updates must reach every client that has the inventory
+	void sendDetachedInventory(Inventory *inventory, const std::string &name,
+			session_t peer_id, bool incremental = false);
 
 	// Envlock and conlock should be locked when using scriptapi
 	inline ServerScripting *getScriptIface() { return m_script.get(); }
@@ -491,6 +493,7 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 private:
 	friend class EmergeThread;
 	friend class RemoteClient;
+	friend class ServerThread;
 
 	// unittest classes
 	friend class TestServerShutdownState;
@@ -814,6 +817,8 @@ class Server : public con::PeerHandler, public MapEventReceiver,
 	MetricCounterPtr m_packet_recv_counter;
 	MetricCounterPtr m_packet_recv_processed_counter;
 	MetricCounterPtr m_map_edit_event_counter;
+	MetricHistogramPtr m_step_duration_histogram;
+	MetricHistogramPtr m_packet_process_histogram;
 
 	// Particles to send this server step
 	// [playername] = list of params, empty playername for broadcast
@@ -43,7 +43,7 @@ void ActiveObjectMgr::step(
 		f(ao_it.second.get());
 	}
 
-	g_profiler->avg("ActiveObjectMgr: SAO count [#]", count);
+	g_profiler->avg(PROFILER_METRIC("ActiveObjectMgr: SAO count [#]"), count);
 }
 
 bool ActiveObjectMgr::registerObject(std::unique_ptr<ServerActiveObject> obj)
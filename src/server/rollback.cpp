@@ -13,8 +13,11 @@
 #include "inventorymanager.h" // deserializing InventoryLocations
 #include "sqlite3.h"
 #include "filesys.h"
+#include "util/thread.h"
 
 #define POINTS_PER_NODE (16.0f)
+// Actions written per transaction
+#define WRITE_BATCH_SIZE 500
 
 #define SQLRES(f, good) \
 	if ((f) != (good)) {\
@@ -64,11 +67,30 @@ struct ActionRow {
 };
 
 
-struct Entity {
-	int         id;
-	std::string name;
-};
+// Writes the queued actions, so that the server thread does not wait for SQLite
+class RollbackWriteThread : public UpdateThread
+{
+public:
+	RollbackWriteThread(RollbackManager *manager) :
+		UpdateThread("Rollback"),
+		m_manager(manager)
+	{}
 
+protected:
+	void doUpdate() override
+	{
+		std::lock_guard<std::mutex> lock(m_manager->db_mutex);
+		try {
+			m_manager->writeQueued();
+		} catch (BaseException &e) {
+			// The actions stay queued for the next write
+			errorstream << e.what() << std::endl;
+		}
+	}
+
+private:
+	RollbackManager *m_manager;
+};
 
 
 RollbackManager::RollbackManager(const std::string & world_path,
@@ -81,12 +103,29 @@ RollbackManager::RollbackManager(const std::string & world_path,
 	database_path = world_path + DIR_DELIM "rollback.sqlite";
 
 	initDatabase();
+
+	write_thread = std::make_unique<RollbackWriteThread>(this);
+	write_thread->start();
 }
 
 
 RollbackManager::~RollbackManager()
 {
-	flush();
+	write_thread->stop();
+	write_thread->wait();
+	write_thread.reset();
+
+	try {
+		flush();
+	} catch (BaseException &e) {
+		errorstream << e.what() << std::endl;
+		errorstream << "RollbackManager: " << action_todisk_buffer.size()
+			<< " actions were not saved" << std::endl;
+	}
+
+	// Keep the query planner statistics up to date
+	SQLOK_ERRSTREAM(sqlite3_exec(db, "PRAGMA analysis_limit = 1000; PRAGMA optimize;",
+			NULL, NULL, NULL), "Failed to optimize");
 
 	FINALIZE_STATEMENT(stmt_insert);
 	FINALIZE_STATEMENT(stmt_replace);
@@ -104,26 +143,23 @@ RollbackManager::~RollbackManager()
 
 void RollbackManager::registerNewActor(const int id, const std::string &name)
 {
-	Entity actor = {id, name};
-	knownActors.push_back(actor);
+	knownActorIds[name] = id;
+	knownActorNames[id] = name;
 }
 
 
 void RollbackManager::registerNewNode(const int id, const std::string &name)
 {
-	Entity node = {id, name};
-	knownNodes.push_back(node);
+	knownNodeIds[name] = id;
+	knownNodeNames[id] = name;
 }
 
 
 int RollbackManager::getActorId(const std::string &name)
 {
-	for (auto iter = knownActors.begin();
-			iter != knownActors.end(); ++iter) {
-		if (iter->name == name) {
-			return iter->id;
-		}
-	}
+	auto it = knownActorIds.find(name);
+	if (it != knownActorIds.end())
+		return it->second;
 
 	SQLOK(sqlite3_bind_text(stmt_knownActor_insert, 1, name.c_str(), name.size(), NULL));
 	SQLRES(sqlite3_step(stmt_knownActor_insert), SQLITE_DONE);
@@ -131,6 +167,7 @@ int RollbackManager::getActorId(const std::string &name)
 
 	int id = sqlite3_last_insert_rowid(db);
 	registerNewActor(id, name);
+	uncommitted_actors.push_back(name);
 
 	return id;
 }
@@ -138,12 +175,9 @@ int RollbackManager::getActorId(const std::string &name)
 
 int RollbackManager::getNodeId(const std::string &name)
 {
-	for (auto iter = knownNodes.begin();
-			iter != knownNodes.end(); ++iter) {
-		if (iter->name == name) {
-			return iter->id;
-		}
-	}
+	auto it = knownNodeIds.find(name);
+	if (it != knownNodeIds.end())
+		return it->second;
 
 	SQLOK(sqlite3_bind_text(stmt_knownNode_insert, 1, name.c_str(), name.size(), NULL));
 	SQLRES(sqlite3_step(stmt_knownNode_insert), SQLITE_DONE);
@@ -151,6 +185,7 @@ int RollbackManager::getNodeId(const std::string &name)
 
 	int id = sqlite3_last_insert_rowid(db);
 	registerNewNode(id, name);
+	uncommitted_nodes.push_back(name);
 
 	return id;
 }
@@ -158,27 +193,15 @@ int RollbackManager::getNodeId(const std::string &name)
 
 const char * RollbackManager::getActorName(const int id)
 {
-	for (auto iter = knownActors.begin();
-			iter != knownActors.end(); ++iter) {
-		if (iter->id == id) {
-			return iter->name.c_str();
-		}
-	}
-
-	return "";
+	auto it = knownActorNames.find(id);
+	return it != knownActorNames.end() ? it->second.c_str() : "";
 }
 
 
 const char * RollbackManager::getNodeName(const int id)
 {
-	for (auto iter = knownNodes.begin();
-			iter != knownNodes.end(); ++iter) {
-		if (iter->id == id) {
-			return iter->name.c_str();
-		}
-	}
-
-	return "";
+	auto it = knownNodeNames.find(id);
+	return it != knownNodeNames.end() ? it->second.c_str() : "";
 }
 
 
@@ -225,8 +248,13 @@ bool RollbackManager::createTables()
 		// - `timestamp` >= ? AND `actor` = ?
 		// - `timestamp` >= ?
 		// - `timestamp` >= ? AND <range query on X, Y, Z>
+		// - `actor` = ? AND `timestamp` >= ?
+		// The planner picks between the position and the time index using
+		// the statistics from PRAGMA optimize: recent actions in a large area
+		// are found by time, old actions in a small area by position.
 		"CREATE INDEX IF NOT EXISTS `actionIndex` ON `action`(`x`,`y`,`z`,`timestamp`,`actor`);\n"
-		"CREATE INDEX IF NOT EXISTS `actionTimestampActorIndex` ON `action`(`timestamp`,`actor`);\n",
+		"CREATE INDEX IF NOT EXISTS `actionTimestampActorIndex` ON `action`(`timestamp`,`actor`);\n"
+		"CREATE INDEX IF NOT EXISTS `actionActorTimestampIndex` ON `action`(`actor`,`timestamp`);\n",
 		NULL, NULL, NULL));
 
 	return true;
@@ -756,33 +784,78 @@ std::string RollbackManager::getSuspect(v3s16 p, float nearness_shortcut,
 }
 
 
-void RollbackManager::flush()
+void RollbackManager::writeQueued()
 {
+	// Taken while holding db_mutex, so that batches are written in order
+	std::vector<RollbackAction> actions;
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		actions.swap(action_todisk_buffer);
+	}
+	if (actions.empty())
+		return;
+
 	sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+	uncommitted_actors.clear();
+	uncommitted_nodes.clear();
 
-	for (auto iter = action_todisk_buffer.begin();
-			iter != action_todisk_buffer.end();
-			++iter) {
-		if (iter->actor.empty()) {
-			continue;
+	try {
+		for (const RollbackAction &action : actions) {
+			if (action.actor.empty()) {
+				continue;
+			}
+
+			registerRow(actionRowFromRollbackAction(action));
 		}
 
-		registerRow(actionRowFromRollbackAction(*iter));
+		SQLOK(sqlite3_exec(db, "COMMIT", NULL, NULL, NULL));
+	} catch (BaseException &e) {
+		sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+		sqlite3_reset(stmt_insert);
+		sqlite3_reset(stmt_replace);
+		sqlite3_reset(stmt_knownActor_insert);
+		sqlite3_reset(stmt_knownNode_insert);
+		// Actors and nodes added in the transaction are gone again
+		for (const std::string &name : uncommitted_actors) {
+			knownActorNames.erase(knownActorIds[name]);
+			knownActorIds.erase(name);
+		}
+		for (const std::string &name : uncommitted_nodes) {
+			knownNodeNames.erase(knownNodeIds[name]);
+			knownNodeIds.erase(name);
+		}
+
+		// Put the batch back in front of the newer actions
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			action_todisk_buffer.insert(action_todisk_buffer.begin(),
+				actions.begin(), actions.end());
+		}
+		throw;
 	}
+}
+
 
-	sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
-	action_todisk_buffer.clear();
+void RollbackManager::flush()
+{
+	std::lock_guard<std::mutex> lock(db_mutex);
+	writeQueued();
 }
 
 
 void RollbackManager::addAction(const RollbackAction & action)
 {
-	action_todisk_buffer.push_back(action);
+	bool write;
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		action_todisk_buffer.push_back(action);
+		write = action_todisk_buffer.size() >= WRITE_BATCH_SIZE;
+	}
 	action_latest_buffer.push_back(action);
 
 	// Flush to disk sometimes
-	if (action_todisk_buffer.size() >= 500) {
-		flush();
+	if (write && write_thread) {
+		write_thread->deferUpdate();
 	}
 	// Cut off latest log sometimes
 	while (action_latest_buffer.size() >= 500) {
@@ -796,7 +869,8 @@ std::list<RollbackAction> RollbackManager::getNodeActors(v3s16 pos, int range,
 	time_t cur_time = time(0);
 	time_t first_time = cur_time - seconds;
 
-	flush();
+	std::lock_guard<std::mutex> lock(db_mutex);
+	writeQueued();
 
 	return getActionsSince_range(first_time, pos, range, limit);
 }
@@ -808,7 +882,8 @@ std::list<RollbackAction> RollbackManager::getRevertActions(
 	time_t cur_time = time(0);
 	time_t first_time = cur_time - seconds;
 
-	flush();
+	std::lock_guard<std::mutex> lock(db_mutex);
+	writeQueued();
 
 	return getActionsSince(first_time, actor_filter);
 }
@@ -8,14 +8,17 @@
 #include "irr_v3d.h"
 #include "rollback_interface.h"
 #include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <deque>
 #include "sqlite3.h"
 
 class IGameDef;
+class RollbackWriteThread;
 
 struct ActionRow;
-struct Entity;
 
 class RollbackManager final : public IRollbackManager
 {
@@ -29,6 +32,7 @@ class RollbackManager final : public IRollbackManager
 	void setActor(const std::string & actor, bool is_guess);
 	std::string getSuspect(v3s16 p, float nearness_shortcut,
 			float min_nearness);
+	// Writes all queued actions, blocking until done
 	void flush();
 
 	void addAction(const RollbackAction & action);
@@ -38,6 +42,11 @@ class RollbackManager final : public IRollbackManager
 			const std::string & actor_filter, time_t seconds);
 
 private:
+	friend class RollbackWriteThread;
+
+	// Caller must hold db_mutex.
+	// On failure the actions are queued again and the exception is rethrown.
+	void writeQueued();
 	void registerNewActor(const int id, const std::string & name);
 	void registerNewNode(const int id, const std::string & name);
 	int getActorId(const std::string & name);
@@ -68,9 +77,14 @@ class RollbackManager final : public IRollbackManager
 	std::string current_actor;
 	bool current_actor_is_guess = false;
 
+	// Filled on the server thread, written to the database by write_thread
+	std::mutex queue_mutex;
 	std::vector<RollbackAction> action_todisk_buffer;
 	std::deque<RollbackAction> action_latest_buffer;
+	std::unique_ptr<RollbackWriteThread> write_thread;
 
+	// Protects the database and the known actors and nodes
+	std::mutex db_mutex;
 	std::string database_path;
 	sqlite3 *db = nullptr;
 	sqlite3_stmt *stmt_insert = nullptr;
@@ -83,6 +97,11 @@ class RollbackManager final : public IRollbackManager
 	sqlite3_stmt *stmt_knownNode_select = nullptr;
 	sqlite3_stmt *stmt_knownNode_insert = nullptr;
 
-	std::vector<Entity> knownActors;
-	std::vector<Entity> knownNodes;
+	std::unordered_map<std::string, int> knownActorIds;
+	std::unordered_map<int, std::string> knownActorNames;
+	std::unordered_map<std::string, int> knownNodeIds;
+	std::unordered_map<int, std::string> knownNodeNames;
+	// added by the transaction in writeQueued()
+	std::vector<std::string> uncommitted_actors;
+	std::vector<std::string> uncommitted_nodes;
 };
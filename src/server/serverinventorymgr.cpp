@@ -166,7 +166,8 @@ bool ServerInventoryManager::checkDetachedInventoryAccess(
 
 void ServerInventoryManager::sendDetachedInventories(const std::string &peer_name,
 		bool incremental,
-		std::function<void(const std::string &, Inventory *)> apply_cb)
+		std::function<void(const std::string &name, Inventory *inv,
+				const std::string &owner)> apply_cb)
 {
 	for (const auto &detached_inventory : m_detached_inventories) {
 		const DetachedInventory &dinv = detached_inventory.second;
@@ -183,6 +184,6 @@ void ServerInventoryManager::sendDetachedInventories(const std::string &peer_nam
 				continue;
 		}
 
-		apply_cb(detached_inventory.first, detached_inventory.second.inventory.get());
+		apply_cb(detached_inventory.first, dinv.inventory.get(), dinv.owner);
 	}
 }
@@ -36,7 +36,8 @@ class ServerInventoryManager : public InventoryManager
 	bool checkDetachedInventoryAccess(const InventoryLocation &loc, const std::string &player) const;
 
 	void sendDetachedInventories(const std::string &peer_name, bool incremental,
-			std::function<void(const std::string &, Inventory *)> apply_cb);
+			std::function<void(const std::string &name, Inventory *inv,
+				const std::string &owner)> apply_cb);
 
 protected:
 	struct DetachedInventory
@@ -13,6 +13,7 @@
 #include "nodedef.h"
 #include "nodemetadata.h"
 #include "gamedef.h"
+#include "pathfinder.h"
 #include "porting.h"
 #include "profiler.h"
 #include "raycast.h"
@@ -28,6 +29,7 @@
 #include "database/database-dummy.h"
 #include "database/database-files.h"
 #include "database/database-sqlite3.h"
+#include "database/database-writebehind.h"
 #if USE_POSTGRESQL
 #include "database/database-postgresql.h"
 #endif
@@ -265,7 +267,8 @@ void ServerEnvironment::init()
 				<< "please read https://docs.luanti.org/for-server-hosts/database-backends." << std::endl;
 	}
 
-	m_player_database = openPlayerDatabase(player_backend_name, world_path, conf);
+	m_player_database = new PlayerDatabaseWriteBehind(
+		openPlayerDatabase(player_backend_name, world_path, conf), m_server->idef());
 	m_auth_database = openAuthDatabase(auth_backend_name, world_path, conf);
 
 	if (m_map && m_script->has_on_mapblocks_changed()) {
@@ -317,6 +320,16 @@ Map & ServerEnvironment::getMap()
 	return *m_map;
 }
 
+PathfinderCache *ServerEnvironment::getPathfinderCache()
+{
+	if (!m_pathfinder_cache) {
+		m_pathfinder_cache = std::make_unique<PathfinderCache>(m_map.get(),
+				m_server->ndef());
+		m_map->addEventReceiver(m_pathfinder_cache.get());
+	}
+	return m_pathfinder_cache.get();
+}
+
 ServerMap & ServerEnvironment::getServerMap()
 {
 	return *m_map;
@@ -378,29 +391,21 @@ bool ServerEnvironment::removePlayerFromDatabase(const std::string &name)
 
 void ServerEnvironment::saveLoadedPlayers(bool force)
 {
+	// Only copies the players, they are written in the background
 	for (RemotePlayer *player : m_players) {
 		if (force || player->checkModified() || (player->getPlayerSAO() &&
 				player->getPlayerSAO()->getMeta().isModified())) {
-			try {
-				m_player_database->savePlayer(player);
-			} catch (DatabaseException &e) {
-				errorstream << "Failed to save player " << player->getName() << " exception: "
-					<< e.what() << std::endl;
-				throw;
-			}
+			m_player_database->savePlayer(player);
 		}
 	}
+
+	if (force && !m_player_database->flush())
+		throw DatabaseException("Failed to save players");
 }
 
 void ServerEnvironment::savePlayer(RemotePlayer *player)
 {
-	try {
-		m_player_database->savePlayer(player);
-	} catch (DatabaseException &e) {
-		errorstream << "Failed to save player " << player->getName() << " exception: "
-			<< e.what() << std::endl;
-		throw;
-	}
+	m_player_database->savePlayer(player);
 }
 
 std::unique_ptr<PlayerSAO> ServerEnvironment::loadPlayer(RemotePlayer *player, session_t peer_id)
@@ -862,7 +867,8 @@ void ServerEnvironment::clearObjects(ClearObjectsMode mode)
 
 void ServerEnvironment::step(float dtime)
 {
-	ScopeProfiler sp2(g_profiler, "ServerEnv::step()", SPT_AVG);
+	ScopeProfiler sp2(g_profiler,
+			PROFILER_METRIC("ServerEnv::step()", PRECISION_MILLI), SPT_AVG);
 	const auto start_time = porting::getTimeUs();
 
 	/* Step time of day */
@@ -889,7 +895,8 @@ void ServerEnvironment::step(float dtime)
 		Manage active block list
 	*/
 	if (m_active_blocks_mgmt_interval.step(dtime, m_cache_active_block_mgmt_interval / m_fast_active_block_divider)) {
-		ScopeProfiler sp(g_profiler, "ServerEnv: update active blocks", SPT_AVG);
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("ServerEnv: update active blocks", PRECISION_MILLI), SPT_AVG);
 
 		/*
 			Get player block positions
@@ -978,7 +985,8 @@ void ServerEnvironment::step(float dtime)
 		Mess around in active blocks
 	*/
 	if (m_active_blocks_nodemetadata_interval.step(dtime, m_cache_nodetimer_interval)) {
-		ScopeProfiler sp(g_profiler, "ServerEnv: Run node timers", SPT_AVG);
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("ServerEnv: Run node timers", PRECISION_MILLI), SPT_AVG);
 
 		// FIXME: this is not actually correct, because the block may have been
 		// activated just moments ago. In practice the intervnal is very small
@@ -1012,7 +1020,8 @@ void ServerEnvironment::step(float dtime)
 	}
 
 	if (m_active_block_modifier_interval.step(dtime, m_cache_abm_interval)) {
-		ScopeProfiler sp(g_profiler, "SEnv: modify in blocks avg per interval", SPT_AVG);
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("SEnv: modify in blocks avg per interval", PRECISION_MILLI), SPT_AVG);
 		TimeTaker timer("modify in active blocks per interval");
 
 		// Shuffle to prevent persistent artifacts of ordering
@@ -1058,10 +1067,12 @@ void ServerEnvironment::step(float dtime)
 				break;
 			}
 		}
-		g_profiler->avg("ServerEnv: active blocks", m_active_blocks.m_abm_list.size());
-		g_profiler->avg("ServerEnv: active blocks cached", blocks_cached);
-		g_profiler->avg("ServerEnv: active blocks scanned for ABMs", blocks_scanned);
-		g_profiler->avg("ServerEnv: ABMs run", abms_run);
+		g_profiler->avg(PROFILER_METRIC("ServerEnv: active blocks"),
+				m_active_blocks.m_abm_list.size());
+		g_profiler->avg(PROFILER_METRIC("ServerEnv: active blocks cached"), blocks_cached);
+		g_profiler->avg(PROFILER_METRIC("ServerEnv: active blocks scanned for ABMs"),
+				blocks_scanned);
+		g_profiler->avg(PROFILER_METRIC("ServerEnv: ABMs run"), abms_run);
 
 		timer.stop(true);
 	}
@@ -1077,7 +1088,8 @@ void ServerEnvironment::step(float dtime)
 		Step active objects
 	*/
 	{
-		ScopeProfiler sp(g_profiler, "ServerEnv: Run SAO::step()", SPT_AVG);
+		static const ProfilerMetric metric("ServerEnv: Run SAO::step()", PRECISION_MILLI);
+		ScopeProfiler sp(g_profiler, metric, SPT_AVG);
 
 		// This helps the objects to send data at the same time
 		bool send_recommended = false;
@@ -1483,7 +1495,8 @@ u16 ServerEnvironment::addActiveObjectRaw(std::unique_ptr<ServerActiveObject> ob
 */
 void ServerEnvironment::removeRemovedObjects()
 {
-	ScopeProfiler sp(g_profiler, "ServerEnvironment::removeRemovedObjects()", SPT_AVG);
+	ScopeProfiler sp(g_profiler,
+			PROFILER_METRIC("ServerEnvironment::removeRemovedObjects()", PRECISION_MILLI), SPT_AVG);
 
 	auto clear_cb = [this](ServerActiveObject *obj, u16 id) {
 		/*
@@ -21,7 +21,9 @@
 class AuthDatabase;
 class ActiveObject;
 class MetricsBackend;
+class PathfinderCache;
 class PlayerDatabase;
+class PlayerDatabaseWriteBehind;
 class PlayerSAO;
 class RemotePlayer;
 class Server;
@@ -121,6 +123,9 @@ class ServerEnvironment final : public Environment
 
 	ServerMap & getServerMap();
 
+	// Shared by all core.find_path calls, created on first use
+	PathfinderCache *getPathfinderCache();
+
 	//TODO find way to remove this fct!
 	ServerScripting* getScriptIface()
 	{ return m_script; }
@@ -371,6 +376,7 @@ class ServerEnvironment final : public Environment
 	server::ActiveObjectMgr m_ao_manager;
 	// on_mapblocks_changed map event receiver
 	OnMapblocksChangedReceiver m_on_mapblocks_changed_receiver;
+	std::unique_ptr<PathfinderCache> m_pathfinder_cache;
 	GUIDGenerator m_guid_generator;
 	// Outgoing network message buffer for active objects
 	std::queue<ActiveObjectMessage> m_active_object_messages;
@@ -417,7 +423,7 @@ class ServerEnvironment final : public Environment
 	// peer_ids in here should be unique, except that there may be many 0s
 	std::vector<RemotePlayer*> m_players;
 
-	PlayerDatabase *m_player_database = nullptr;
+	PlayerDatabaseWriteBehind *m_player_database = nullptr;
 	AuthDatabase *m_auth_database = nullptr;
 
 	// Particles
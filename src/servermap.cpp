@@ -14,6 +14,7 @@
 #include "settings.h"
 #include "log.h"
 #include "profiler.h"
+#include "tracer.h"
 #include "gamedef.h"
 #include "util/directiontables.h"
 #include "util/serialize.h"
@@ -94,10 +95,18 @@ ServerMap::ServerMap(const std::string &savedir, IGameDef *gamedef,
 		"minetest_map_save_time", "Time spent saving blocks (in microseconds)");
 	m_save_count_counter = mb->addCounter(
 		"minetest_map_saved_blocks", "Number of blocks saved");
+	m_save_duration_histogram = mb->addHistogram(
+		"minetest_map_save_duration_seconds",
+		"Duration of map saves that wrote at least one block",
+		MetricsBackend::durationBuckets());
 	m_loaded_blocks_gauge = mb->addGauge(
 		"minetest_map_loaded_blocks", "Number of loaded blocks");
+	m_resident_bytes_gauge = mb->addGauge(
+		"minetest_map_resident_bytes", "Estimated memory usage of loaded blocks (in bytes)");
 
 	m_map_compression_level = rangelim(g_settings->getS16("map_compression_level_disk"), -1, 9);
+	MapBlock::setPaletteCompression(g_settings->getBool("mapblock_palette_compression"));
+	setMemoryBudget((size_t)g_settings->getU32("server_map_memory_budget") << 20);
 
 	try {
 		// If directory exists, check contents and load if possible
@@ -502,8 +511,11 @@ void ServerMap::updateVManip(v3s16 pos)
 void ServerMap::reportMetrics(u64 save_time_us, u32 saved_blocks, u32 all_blocks)
 {
 	m_loaded_blocks_gauge->set(all_blocks);
+	m_resident_bytes_gauge->set(m_resident_bytes);
 	m_save_time_counter->increment(save_time_us);
 	m_save_count_counter->increment(saved_blocks);
+	if (saved_blocks > 0)
+		m_save_duration_histogram->observe(save_time_us / 1e6);
 }
 
 void ServerMap::save(ModifiedState save_level)
@@ -671,12 +683,16 @@ void ServerMap::beginSave()
 
 void ServerMap::endSave()
 {
+	static const ProfilerMetric metric("ServerMap: end save");
+	TraceScope trace(metric);
 	MutexAutoLock dblock(m_db.mutex);
 	m_db.dbase->endSave();
 }
 
 bool ServerMap::saveBlock(MapBlock *block)
 {
+	static const ProfilerMetric metric("ServerMap: save block");
+	TraceScope trace(metric);
 	// FIXME: serialization happens under mutex
 	MutexAutoLock dblock(m_db.mutex);
 	return saveBlock(block, m_db.dbase, m_map_compression_level);
@@ -708,7 +724,8 @@ bool ServerMap::saveBlock(MapBlock *block, MapDatabase *db, int compression_leve
 
 void ServerMap::deSerializeBlock(MapBlock *block, std::istream &is)
 {
-	ScopeProfiler sp(g_profiler, "ServerMap: deSer block", SPT_AVG, PRECISION_MICRO);
+	static const ProfilerMetric metric("ServerMap: deSer block", PRECISION_MICRO);
+	ScopeProfiler sp(g_profiler, metric, SPT_AVG);
 
 	u8 version = readU8(is);
 	if (is.fail())
@@ -719,7 +736,8 @@ void ServerMap::deSerializeBlock(MapBlock *block, std::istream &is)
 
 MapBlock *ServerMap::loadBlock(const std::string &blob, v3s16 p3d, bool save_after_load)
 {
-	ScopeProfiler sp(g_profiler, "ServerMap: load block", SPT_AVG, PRECISION_MICRO);
+	static const ProfilerMetric metric("ServerMap: load block", PRECISION_MICRO);
+	ScopeProfiler sp(g_profiler, metric, SPT_AVG);
 	MapBlock *block = nullptr;
 	bool created_new = false;
 
@@ -791,7 +809,8 @@ MapBlock* ServerMap::loadBlock(v3s16 blockpos)
 {
 	std::string data;
 	{
-		ScopeProfiler sp(g_profiler, "ServerMap: load block - sync (sum)");
+		ScopeProfiler sp(g_profiler,
+				PROFILER_METRIC("ServerMap: load block - sync (sum)", PRECISION_MILLI));
 		MutexAutoLock dblock(m_db.mutex);
 		m_db.loadBlock(blockpos, data);
 	}
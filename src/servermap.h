@@ -204,6 +204,8 @@ class ServerMap : public Map
 
 	// Map metrics
 	MetricGaugePtr m_loaded_blocks_gauge;
+	MetricGaugePtr m_resident_bytes_gauge;
 	MetricCounterPtr m_save_time_counter;
 	MetricCounterPtr m_save_count_counter;
+	MetricHistogramPtr m_save_duration_histogram;
 };
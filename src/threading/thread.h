@@ -120,6 +120,11 @@ class Thread {
 	 */
 	bool setPriority(int prio);
 
+	/*
+	 * Returns the name given to this thread object.
+	 */
+	const std::string &getName() const { return m_name; }
+
 	/*
 	 * Returns the thread object of the current thread if it exists.
 	 */
@@ -0,0 +1,178 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "tracer.h"
+
+#include <algorithm>
+#include <ctime>
+#include <sstream>
+#include "filesys.h"
+#include "log.h"
+#include "threading/thread.h"
+#include "util/serialize.h"
+#include "util/string.h"
+
+static Tracer main_tracer;
+Tracer *g_tracer = &main_tracer;
+
+Tracer::ThreadBuffer *Tracer::getThreadBuffer()
+{
+	// Gives the buffer back when the thread exits
+	struct Holder {
+		ThreadBuffer *buffer = nullptr;
+		~Holder()
+		{
+			if (buffer) {
+				MutexAutoLock lock(g_tracer->m_mutex);
+				buffer->in_use = false;
+			}
+		}
+	};
+	thread_local Holder holder;
+	if (holder.buffer)
+		return holder.buffer;
+
+	Thread *thread = Thread::getCurrentThread();
+	MutexAutoLock lock(m_mutex);
+	ThreadBuffer *buffer = nullptr;
+	for (auto &it : m_threads) {
+		if (!it->in_use) {
+			buffer = it.get();
+			break;
+		}
+	}
+	if (!buffer) {
+		m_threads.push_back(std::make_unique<ThreadBuffer>());
+		buffer = m_threads.back().get();
+	}
+	// New id, so that a reused buffer is not mixed up with its old thread
+	static u32 next_tid = 1;
+	buffer->tid = next_tid++;
+	buffer->thread_name = thread ? thread->getName() : "Thread " + itos(buffer->tid);
+	buffer->in_use = true;
+	buffer->begin.store(0, std::memory_order_relaxed);
+	buffer->head.store(0, std::memory_order_relaxed);
+
+	holder.buffer = buffer;
+	return buffer;
+}
+
+void Tracer::record(u32 metric_id, u64 start_us, u64 end_us)
+{
+	ThreadBuffer *buffer = getThreadBuffer();
+	// Only this thread writes, readers check `begin` again after copying
+	const u64 head = buffer->head.load(std::memory_order_relaxed);
+	buffer->begin.store(head + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Event &event = buffer->events[head % EVENTS_PER_THREAD];
+	event.start.store(start_us, std::memory_order_relaxed);
+	event.duration.store(std::min<u64>(end_us - start_us, U32_MAX),
+			std::memory_order_relaxed);
+	event.metric_id.store(metric_id, std::memory_order_relaxed);
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+size_t Tracer::writeChromeTrace(std::ostream &os, u64 from_us, u64 to_us) const
+{
+	struct Span {
+		u64 start;
+		u32 duration;
+		u32 metric_id;
+		u32 tid;
+		u64 index;
+	};
+	std::vector<Span> spans;
+	std::vector<std::pair<u32, std::string>> thread_names;
+
+	{
+		MutexAutoLock lock(m_mutex);
+		for (const auto &buffer : m_threads) {
+			const u64 head = buffer->head.load(std::memory_order_acquire);
+			const u64 first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+			const size_t old_size = spans.size();
+			for (u64 i = first; i < head; i++) {
+				const Event &event = buffer->events[i % EVENTS_PER_THREAD];
+				Span span;
+				span.start = event.start.load(std::memory_order_relaxed);
+				span.duration = event.duration.load(std::memory_order_relaxed);
+				span.metric_id = event.metric_id.load(std::memory_order_relaxed);
+				span.tid = buffer->tid;
+				span.index = i;
+				if (span.start <= to_us && span.start + span.duration >= from_us)
+					spans.push_back(span);
+			}
+
+			// Drop events that may have been overwritten while copying
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const u64 begin = buffer->begin.load(std::memory_order_relaxed);
+			if (begin - first > EVENTS_PER_THREAD) {
+				const u64 valid = begin - EVENTS_PER_THREAD;
+				auto it = std::remove_if(spans.begin() + old_size, spans.end(),
+					[valid] (const Span &span) { return span.index < valid; });
+				spans.erase(it, spans.end());
+			}
+
+			if (spans.size() > old_size)
+				thread_names.emplace_back(buffer->tid, buffer->thread_name);
+		}
+	}
+
+	std::sort(spans.begin(), spans.end(), [] (const Span &a, const Span &b) {
+		return a.start < b.start;
+	});
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (const auto &it : thread_names) {
+		os << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\","
+			"\"pid\":1,\"tid\":" << it.first << ",\"args\":{\"name\":"
+			<< serializeJsonString(it.second) << "}}";
+		first = false;
+	}
+	for (const Span &span : spans) {
+		os << (first ? "" : ",\n") << "{\"ph\":\"X\",\"name\":"
+			<< serializeJsonString(ProfilerMetric::getName(span.metric_id))
+			<< ",\"pid\":1,\"tid\":" << span.tid
+			<< ",\"ts\":" << span.start << ",\"dur\":" << span.duration << "}";
+		first = false;
+	}
+	os << "\n]}\n";
+	return spans.size();
+}
+
+/*
+	SlowStepTracer
+*/
+
+SlowStepTracer::SlowStepTracer(const std::string &directory, u32 threshold_ms) :
+	m_directory(directory),
+	m_threshold_us((u64)threshold_ms * 1000)
+{
+}
+
+std::string SlowStepTracer::step(u64 start_us, u64 end_us)
+{
+	if (end_us - start_us < m_threshold_us)
+		return "";
+	if (m_last_trace_us != 0 && end_us - m_last_trace_us < COOLDOWN_US)
+		return "";
+	m_last_trace_us = end_us;
+
+	std::ostringstream os;
+	const u64 from = start_us > CONTEXT_US ? start_us - CONTEXT_US : 0;
+	if (g_tracer->writeChromeTrace(os, from, end_us) == 0)
+		return "";
+
+	char timestamp[32];
+	std::time_t now = std::time(nullptr);
+	std::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+	const std::string path = m_directory + DIR_DELIM + "step-" + timestamp + "-" +
+			itos((end_us - start_us) / 1000) + "ms.json";
+
+	if (!fs::CreateAllDirs(m_directory) || !fs::safeWriteToFile(path, os.str())) {
+		errorstream << "SlowStepTracer: failed to write " << path << std::endl;
+		return "";
+	}
+	return path;
+}
@@ -0,0 +1,125 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#pragma once
+
+#include "irrlichttypes.h"
+#include "porting.h"
+#include "profiler.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Global tracer
+class Tracer;
+extern Tracer *g_tracer;
+
+/*
+	Timeline tracer
+
+	Every thread records its spans into its own ring buffer, so the buffers
+	always hold the last few seconds of work. These can be written in the
+	Chrome trace event format (ui.perfetto.dev, chrome://tracing) after
+	something slow happened.
+
+	ScopeProfiler records a span for every profiled scope while the tracer
+	is enabled, TraceScope can be used where no profiler value is wanted.
+	Only the global instance g_tracer may be used.
+*/
+class Tracer
+{
+public:
+	// Older events of a thread are overwritten
+	static constexpr u32 EVENTS_PER_THREAD = 8192;
+
+	Tracer() = default;
+	DISABLE_CLASS_COPY(Tracer)
+
+	void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+	bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	/// Record a span of the current thread, times from porting::getTimeUs()
+	void record(u32 metric_id, u64 start_us, u64 end_us);
+
+	/// Write all spans that overlap [from_us, to_us]
+	/// @return number of spans written
+	size_t writeChromeTrace(std::ostream &os, u64 from_us, u64 to_us) const;
+
+private:
+	struct Event {
+		std::atomic<u64> start{0};
+		std::atomic<u32> duration{0};
+		std::atomic<u32> metric_id{0};
+	};
+
+	struct ThreadBuffer {
+		u32 tid;
+		std::string thread_name;
+		// false once the thread has exited, the buffer is then reused
+		bool in_use = true;
+		// Number of events started and finished writing, like a seqlock
+		std::atomic<u64> begin{0};
+		std::atomic<u64> head{0};
+		Event events[EVENTS_PER_THREAD];
+	};
+
+	ThreadBuffer *getThreadBuffer();
+
+	std::atomic<bool> m_enabled{false};
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+};
+
+// Records the lifetime of this object as a span
+class TraceScope
+{
+public:
+	TraceScope(const ProfilerMetric &metric) :
+		m_metric_id(metric.getId()),
+		m_start(g_tracer->isEnabled() ? porting::getTimeUs() : 0)
+	{}
+
+	~TraceScope()
+	{
+		if (m_start)
+			g_tracer->record(m_metric_id, m_start, porting::getTimeUs());
+	}
+
+	DISABLE_CLASS_COPY(TraceScope)
+
+private:
+	u32 m_metric_id;
+	u64 m_start;
+};
+
+/*
+	Saves a trace when a step of a loop took too long
+
+	The trace covers the slow step and a bit of time before it. To keep
+	a long lag from writing a file every step, there is a cooldown between
+	two traces.
+*/
+class SlowStepTracer
+{
+public:
+	/// @param directory where the traces are saved
+	/// @param threshold_ms minimal step duration that is traced
+	SlowStepTracer(const std::string &directory, u32 threshold_ms);
+
+	/// Call after each step, times from porting::getTimeUs()
+	/// @return path of the saved trace, or empty
+	std::string step(u64 start_us, u64 end_us);
+
+private:
+	// Time before the slow step that is included in the trace
+	static constexpr u64 CONTEXT_US = 500 * 1000;
+	static constexpr u64 COOLDOWN_US = 30 * 1000 * 1000;
+
+	std::string m_directory;
+	u64 m_threshold_us;
+	u64 m_last_trace_us = 0;
+};
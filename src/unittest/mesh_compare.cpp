@@ -50,6 +50,13 @@ bool checkMeshEqual(const std::vector<video::S3DVertex> &vertices, const std::ve
 	return actual == expected;
 }
 
+bool checkMeshEqual(const std::vector<video::S3DVertex> &vertices, const std::vector<u16> &indices,
+		const std::vector<video::S3DVertex> &expected_vertices, const std::vector<u16> &expected_indices)
+{
+	return canonicalizeMesh(vertices, indices) ==
+			canonicalizeMesh(expected_vertices, expected_indices);
+}
+
 bool checkMeshEqual(const std::vector<video::S3DVertex> &vertices, const std::vector<u16> &indices, const std::vector<Quad> &expected)
 {
 	using QuadRefCount = std::array<int, 4>;
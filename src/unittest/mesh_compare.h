@@ -30,3 +30,9 @@ using Quad = std::array<video::S3DVertex, 4>;
 /// @returns Whether the two meshes are equal.
 /// @note There are two ways to split a quad into 2 triangles; either is allowed.
 [[nodiscard]] bool checkMeshEqual(const std::vector<video::S3DVertex> &vertices, const std::vector<u16> &indices, const std::vector<Quad> &expected);
+
+/// Compare two meshes for equality.
+/// @note Vertex and triangle order don’t matter. Vertex order in a triangle only matters for winding.
+/// @returns Whether the two meshes are equal.
+[[nodiscard]] bool checkMeshEqual(const std::vector<video::S3DVertex> &vertices, const std::vector<u16> &indices,
+		const std::vector<video::S3DVertex> &expected_vertices, const std::vector<u16> &expected_indices);
@@ -5,6 +5,8 @@
 #include "test.h"
 
 #include "util/areastore.h"
+#include <algorithm>
+#include <random>
 
 class TestAreaStore : public TestBase {
 public:
@@ -16,6 +18,8 @@ class TestAreaStore : public TestBase {
 	void genericStoreTest(AreaStore *store);
 	void testVectorStore();
 	void testSpatialStore();
+	void testBvhStore();
+	void testBvhStoreRandomized();
 	void testSerialization();
 };
 
@@ -27,6 +31,8 @@ void TestAreaStore::runTests(IGameDef *gamedef)
 #if USE_SPATIAL
 	TEST(testSpatialStore);
 #endif
+	TEST(testBvhStore);
+	TEST(testBvhStoreRandomized);
 	TEST(testSerialization);
 }
 
@@ -46,6 +52,91 @@ void TestAreaStore::testSpatialStore()
 #endif
 }
 
+void TestAreaStore::testBvhStore()
+{
+	BvhAreaStore store;
+	genericStoreTest(&store);
+}
+
+static std::vector<u32> get_sorted_ids(const std::vector<Area *> &areas)
+{
+	std::vector<u32> ids;
+	for (const Area *a : areas)
+		ids.push_back(a->id);
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+void TestAreaStore::testBvhStoreRandomized()
+{
+	// Enough areas for the tree to be rebuilt a few times
+	VectorAreaStore reference;
+	BvhAreaStore store;
+	reference.setCacheParams(false, 16, 20);
+	store.setCacheParams(false, 16, 20);
+
+	std::mt19937 rng(1234);
+	auto random = [&rng] (s16 min, s16 max) -> s16 {
+		return min + rng() % (max - min + 1);
+	};
+	auto random_pos = [&random] () {
+		return v3s16(random(-500, 500), random(-50, 50), random(-500, 500));
+	};
+
+	std::vector<u32> ids;
+	for (int i = 0; i < 3000; i++) {
+		if (rng() % 4 != 0 || ids.empty()) {
+			v3s16 minedge = random_pos();
+			Area a(minedge, minedge + v3s16(random(0, 40), random(0, 40), random(0, 40)));
+			UASSERT(reference.insertArea(&a));
+			UASSERT(store.insertArea(&a));
+			ids.push_back(a.id);
+		} else {
+			size_t k = rng() % ids.size();
+			UASSERT(reference.removeArea(ids[k]));
+			UASSERT(store.removeArea(ids[k]));
+			ids[k] = ids.back();
+			ids.pop_back();
+		}
+		UASSERTEQ(size_t, store.size(), reference.size());
+
+		if (i % 10 != 0)
+			continue;
+
+		std::vector<Area *> res1, res2;
+		v3s16 pos = random_pos();
+		reference.getAreasForPos(&res1, pos);
+		store.getAreasForPos(&res2, pos);
+		UASSERT(get_sorted_ids(res1) == get_sorted_ids(res2));
+
+		res1.clear();
+		res2.clear();
+		v3s16 maxedge = pos + v3s16(random(0, 100), random(0, 100), random(0, 100));
+		const bool accept_overlap = i % 20 == 0;
+		reference.getAreasInArea(&res1, pos, maxedge, accept_overlap);
+		store.getAreasInArea(&res2, pos, maxedge, accept_overlap);
+		UASSERT(get_sorted_ids(res1) == get_sorted_ids(res2));
+
+		// with areas in the main tree, the small tree and the pending list
+		std::vector<std::vector<Area *>> results1, results2;
+		const std::vector<v3s16> positions{pos, maxedge, random_pos()};
+		reference.getAreasForPositions(&results1, positions);
+		store.getAreasForPositions(&results2, positions);
+		for (size_t k = 0; k < positions.size(); k++)
+			UASSERT(get_sorted_ids(results1[k]) == get_sorted_ids(results2[k]));
+	}
+
+	std::vector<v3s16> positions;
+	for (int i = 0; i < 200; i++)
+		positions.push_back(random_pos());
+	std::vector<std::vector<Area *>> results1, results2;
+	reference.getAreasForPositions(&results1, positions);
+	store.getAreasForPositions(&results2, positions);
+	UASSERTEQ(size_t, results2.size(), positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+		UASSERT(get_sorted_ids(results1[i]) == get_sorted_ids(results2[i]));
+}
+
 void TestAreaStore::genericStoreTest(AreaStore *store)
 {
 	Area a(v3s16(-10, -3, 5), v3s16(0, 29, 7));
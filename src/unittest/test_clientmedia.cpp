@@ -0,0 +1,200 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "client/clientmedia.h"
+#include "filesys.h"
+#include "util/base64.h"
+#include "util/hashing.h"
+#include "util/hex.h"
+#include "irrlicht.h"
+#include "IFileSystem.h"
+#include "IReadFile.h"
+#include "IVideoDriver.h"
+#include <atomic>
+
+class TestClientMedia : public TestBase {
+public:
+	TestClientMedia() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestClientMedia"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testPreloader();
+	void testPreloaderMany();
+};
+
+static TestClientMedia g_test_instance;
+
+void TestClientMedia::runTests(IGameDef *gamedef)
+{
+	TEST(testPreloader);
+	TEST(testPreloaderMany);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// A 2x1 PNG with an opaque red and a half transparent blue pixel
+const char *PNG_BASE64 =
+	"iVBORw0KGgoAAAANSUhEUgAAAAIAAAABCAYAAAD0In+KAAAADklEQVR42mP4z8AAQg0AD3oDfmqB"
+	"MeEAAAAASUVORK5CYII=";
+
+// Decodes images with the null driver, like the client does with its own
+class NullDriverDecoder {
+public:
+	NullDriverDecoder()
+	{
+		SIrrlichtCreationParameters p;
+		p.DriverType = video::EDT_NULL;
+		m_device = createDeviceEx(p);
+	}
+
+	~NullDriverDecoder()
+	{
+		if (m_device)
+			m_device->drop();
+	}
+
+	bool ok() const { return m_device != nullptr; }
+
+	video::IImage *decode(const std::string &data, const std::string &name)
+	{
+		m_decoded++;
+		io::IReadFile *rfile = m_device->getFileSystem()->createMemoryReadFile(
+				data.c_str(), data.size(), name.c_str());
+		video::IImage *img = m_device->getVideoDriver()->createImageFromFile(rfile);
+		rfile->drop();
+		return img;
+	}
+
+	u32 getDecodedCount() const { return m_decoded; }
+
+private:
+	IrrlichtDevice *m_device = nullptr;
+	std::atomic<u32> m_decoded{0};
+};
+
+CachedMediaPreloader::File addToCache(FileCache &cache, const std::string &name,
+		const std::string &data)
+{
+	std::string sha1 = hashing::sha1(data);
+	UASSERT(cache.update(hex_encode(sha1), data));
+	return {name, sha1};
+}
+
+}
+
+void TestClientMedia::testPreloader()
+{
+	NullDriverDecoder decoder;
+	UASSERT(decoder.ok());
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "media";
+	fs::RecursiveDelete(dir);
+	FileCache cache(dir);
+
+	const std::string png = base64_decode(PNG_BASE64);
+	const std::string ogg = std::string("OggS\0\2", 6) + std::string(100, 'x');
+	const std::string broken_png = png.substr(0, 16);
+
+	std::vector<CachedMediaPreloader::File> files;
+	files.push_back(addToCache(cache, "a.png", png));
+	files.push_back(addToCache(cache, "b.ogg", ogg));
+	files.push_back(addToCache(cache, "broken.png", broken_png));
+	// Not in the cache
+	files.push_back({"missing.png", hashing::sha1("missing")});
+	// In the cache, but with other contents
+	CachedMediaPreloader::File changed = addToCache(cache, "changed.ogg", ogg + "old");
+	UASSERT(cache.update(hex_encode(changed.sha1), ogg + "new"));
+	files.push_back(changed);
+
+	CachedMediaPreloader preloader(cache,
+		[&] (const std::string &data, const std::string &name) {
+			return decoder.decode(data, name);
+		}, std::move(files));
+
+	// Decoded image
+	{
+		CachedMediaPreloader::Result &result = preloader.get(0);
+		UASSERT(result.ready && result.valid);
+		UASSERT(result.data == png);
+		UASSERT(result.image);
+		UASSERT(result.image->getDimension() == core::dimension2du(2, 1));
+		UASSERTEQ(u32, result.image->getPixel(0, 0).color, 0xffff0000);
+		UASSERTEQ(u32, result.image->getPixel(1, 0).color, 0x800000ff);
+		UASSERT(result.isLoadable("a.png"));
+		preloader.release(0);
+	}
+
+	// Other files are only read
+	{
+		CachedMediaPreloader::Result &result = preloader.get(1);
+		UASSERT(result.ready && result.valid);
+		UASSERT(result.data == ogg);
+		UASSERT(!result.image);
+		UASSERT(result.isLoadable("b.ogg"));
+		preloader.release(1);
+	}
+
+	// An image that fails to decode is fetched again
+	{
+		CachedMediaPreloader::Result &result = preloader.get(2);
+		UASSERT(result.ready && result.valid);
+		UASSERT(!result.image);
+		UASSERT(!result.isLoadable("broken.png"));
+		preloader.release(2);
+	}
+
+	// and so are files that are missing or do not match their hash
+	for (size_t i : {3, 4}) {
+		CachedMediaPreloader::Result &result = preloader.get(i);
+		UASSERT(result.ready && !result.valid);
+		UASSERT(!result.image);
+		UASSERT(!result.isLoadable(i == 3 ? "missing.png" : "changed.ogg"));
+		preloader.release(i);
+	}
+
+	// Only the valid images were decoded
+	UASSERTEQ(u32, decoder.getDecodedCount(), 2);
+}
+
+void TestClientMedia::testPreloaderMany()
+{
+	NullDriverDecoder decoder;
+	UASSERT(decoder.ok());
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "media_many";
+	fs::RecursiveDelete(dir);
+	FileCache cache(dir);
+
+	// More files than the workers may get ahead of the main thread
+	const std::string png = base64_decode(PNG_BASE64);
+	std::vector<CachedMediaPreloader::File> files;
+	std::vector<std::string> contents;
+	for (int i = 0; i < 1000; i++) {
+		const std::string name = "file" + std::to_string(i);
+		if (i % 10 == 0) {
+			files.push_back(addToCache(cache, name + ".png", png));
+			contents.push_back(png);
+		} else {
+			contents.push_back("data " + std::to_string(i));
+			files.push_back(addToCache(cache, name + ".ogg", contents.back()));
+		}
+	}
+
+	CachedMediaPreloader preloader(cache,
+		[&] (const std::string &data, const std::string &name) {
+			return decoder.decode(data, name);
+		}, std::move(files));
+
+	for (size_t i = 0; i < contents.size(); i++) {
+		CachedMediaPreloader::Result &result = preloader.get(i);
+		UASSERT(result.valid);
+		UASSERT(result.data == contents[i]);
+		UASSERT((result.image != nullptr) == (i % 10 == 0));
+		preloader.release(i);
+	}
+	UASSERTEQ(u32, decoder.getDecodedCount(), 100);
+}
@@ -18,6 +18,8 @@ class TestCollision : public TestBase {
 
 	void testAxisAlignedCollision();
 	void testCollisionMoveSimple(IGameDef *gamedef);
+	void testGetFreeMovement(IGameDef *gamedef);
+	void testCachedNodeBoxes(IGameDef *gamedef);
 };
 
 static TestCollision g_test_instance;
@@ -26,6 +28,8 @@ void TestCollision::runTests(IGameDef *gamedef)
 {
 	TEST(testAxisAlignedCollision);
 	TEST(testCollisionMoveSimple, gamedef);
+	TEST(testGetFreeMovement, gamedef);
+	TEST(testCachedNodeBoxes, gamedef);
 }
 
 namespace {
@@ -377,3 +381,103 @@ void TestCollision::testCollisionMoveSimple(IGameDef *gamedef)
 	// No warnings should have been raised during our test.
 	UASSERT(!g_collision_problems_encountered);
 }
+
+void TestCollision::testGetFreeMovement(IGameDef *gamedef)
+{
+	auto env = std::make_unique<TestEnvironment>(gamedef);
+	const aabb3f box(fpos(-0.1f, -0.1f, -0.1f), fpos(0.1f, 0.1f, 0.1f));
+	FreeMovement free;
+
+	/* same result as collisionMoveSimple in the air */
+	const struct {
+		v3f pos, speed, accel;
+		f32 dtime;
+	} moves[] = {
+		{fpos(4, 4, 4), fpos(1, 0, 0), fpos(0, -9.81f, 0), 0.05f},
+		{fpos(-3.3f, 2, 7), fpos(-2, 3, 1.5f), fpos(0, 0, 0), 1/60.0f},
+		{fpos(0, 0, 0), fpos(0, 0, 0), fpos(0.5f, 0, -1), 0.2f},
+		{fpos(10, -8, 3), fpos(0.1f, 0.2f, 0.3f), fpos(0, 2, 0), 0.5f},
+	};
+	for (const auto &move : moves) {
+		UASSERT(getFreeMovement(box, move.dtime, move.pos, move.speed, move.accel, free));
+		v3f pos = move.pos, speed = move.speed;
+		collisionMoveResult res = collisionMoveSimple(env.get(), gamedef, box,
+				0.0f, move.dtime, &pos, &speed, move.accel);
+		UASSERT(!res.collides);
+		UASSERTEQ_V3F(free.pos, pos);
+		UASSERTEQ_V3F(free.speed, speed);
+
+		// the area covers the start and the end
+		aabb3f area(intToFloat(free.area_min, BS), intToFloat(free.area_max, BS));
+		UASSERT(area.isPointInside(move.pos) && area.isPointInside(free.pos));
+	}
+
+	/* not moving needs no free nodes */
+	UASSERT(getFreeMovement(box, 0.1f, fpos(1, 1, 1), v3f(), v3f(), free));
+	UASSERTEQ_V3F(free.pos, fpos(1, 1, 1));
+	UASSERT(free.area_min.X > free.area_max.X);
+
+	/* too long steps are left to collisionMoveSimple */
+	UASSERT(!getFreeMovement(box, 10.0f, fpos(1, 1, 1), fpos(1, 0, 0), v3f(), free));
+}
+
+void TestCollision::testCachedNodeBoxes(IGameDef *gamedef)
+{
+	auto env = std::make_unique<TestEnvironment>(gamedef);
+	Map &map = env->getMap();
+	const aabb3f box(fpos(-0.1f, -0.1f, -0.1f), fpos(0.1f, 0.1f, 0.1f));
+
+	// so that the block is not skipped as air
+	map.setNode({0, 0, 0}, MapNode(t_CONTENT_STONE));
+
+	// fills the cache of the block
+	UASSERT(!collision_check_intersection(env.get(), gamedef, box, fpos(2, 2, 2)));
+	UASSERT(collision_check_intersection(env.get(), gamedef, box, fpos(0, 0, 0)));
+
+	/* changed nodes are seen */
+	map.setNode({2, 2, 2}, MapNode(t_CONTENT_STONE));
+	UASSERT(collision_check_intersection(env.get(), gamedef, box, fpos(2, 2, 2)));
+
+	map.setNode({2, 2, 2}, MapNode(CONTENT_AIR));
+	UASSERT(!collision_check_intersection(env.get(), gamedef, box, fpos(2, 2, 2)));
+
+	// the map refuses this, so go through the block
+	map.getBlockNoCreate({0, 0, 0})->setNode({2, 2, 2}, MapNode(CONTENT_IGNORE));
+	UASSERT(collision_check_intersection(env.get(), gamedef, box, fpos(2, 2, 2)));
+
+	/* same for movement */
+	map.setNode({2, 2, 2}, MapNode(CONTENT_AIR));
+	v3f pos = fpos(2, 2.5f, 2), speed = fpos(0, -2, 0);
+	collisionMoveResult res = collisionMoveSimple(env.get(), gamedef, box,
+			0.0f, 1.0f, &pos, &speed, v3f());
+	UASSERT(!res.collides);
+
+	map.setNode({2, 1, 2}, MapNode(t_CONTENT_STONE));
+	pos = fpos(2, 2.5f, 2), speed = fpos(0, -2, 0);
+	res = collisionMoveSimple(env.get(), gamedef, box,
+			0.0f, 1.0f, &pos, &speed, v3f());
+	UASSERT(res.collides);
+	UASSERTEQ(v3s16, res.collisions.at(0).node_p, v3s16(2, 1, 2));
+
+	/* nodes with the same content and param2 share their boxes */
+	MapBlock *block = map.getBlockNoCreate({0, 0, 0});
+	map.setNode({3, 1, 2}, MapNode(t_CONTENT_STONE));
+	UASSERT(collision_check_intersection(env.get(), gamedef, box, fpos(2.5f, 1, 2)));
+	const MapBlockCollisionCache *cache = block->getCollisionCache();
+	UASSERTEQ(int, cache->shape[2 * 256 + 1 * 16 + 2], cache->shape[2 * 256 + 1 * 16 + 3]);
+	size_t stone_shapes = 0;
+	for (const auto &shape : cache->shapes)
+		stone_shapes += shape.key >> 8 == t_CONTENT_STONE;
+	UASSERTEQ(size_t, stone_shapes, 1);
+
+	/* caches that are no longer used are dropped */
+	const size_t cached_bytes = block->getMemoryUsage();
+	const float timeout = MapBlockCollisionCache::UNUSED_TIMEOUT;
+	block->incrementUsageTimer(timeout * 0.75f);
+	UASSERT(collision_check_intersection(env.get(), gamedef, box, fpos(2.5f, 1, 2)));
+	block->incrementUsageTimer(timeout * 0.75f);
+	UASSERTEQ(size_t, block->getMemoryUsage(), cached_bytes);
+	block->incrementUsageTimer(timeout * 0.75f);
+	UASSERT(block->getMemoryUsage() < cached_bytes);
+	UASSERT(collision_check_intersection(env.get(), gamedef, box, fpos(2.5f, 1, 2)));
+}
@@ -10,6 +10,7 @@
 #include "client/content_mapblock.h"
 #include "client/mapblock_mesh.h"
 #include "client/meshgen/collector.h"
+#include "client/meshgen/geometry_cache.h"
 #include "client/node_visuals.h"
 #include <memory>
 #include "mesh_compare.h"
@@ -53,14 +54,19 @@ class MockGameDef : public DummyGameDef {
 
 	MeshMakeData makeSingleNodeMMD(bool smooth_lighting = true)
 	{
-		MeshMakeData data{ndef(), 1, MeshGrid{1}};
+		return makeMMD(1, smooth_lighting);
+	}
+
+	MeshMakeData makeMMD(u16 side_length, bool smooth_lighting = true)
+	{
+		MeshMakeData data{ndef(), side_length, MeshGrid{1}};
 		data.m_generate_minimap = false;
 		data.m_smooth_lighting = smooth_lighting;
 		data.m_enable_water_reflections = false;
 		data.m_blockpos = {0, 0, 0};
-		for (s16 x = -1; x <= 1; x++)
-		for (s16 y = -1; y <= 1; y++)
-		for (s16 z = -1; z <= 1; z++)
+		for (s16 x = -1; x <= side_length; x++)
+		for (s16 y = -1; y <= side_length; y++)
+		for (s16 z = -1; z <= side_length; z++)
 			data.m_vmanip.setNode({x, y, z}, {CONTENT_AIR, 0, 0});
 		return data;
 	}
@@ -162,6 +168,8 @@ class TestMapblockMeshGenerator : public TestBase {
 	void testSurroundedNode();
 	void testInterliquidSame();
 	void testInterliquidDifferent();
+	void testGreedyMerge();
+	void testGeometryReuse();
 };
 
 static TestMapblockMeshGenerator g_test_instance;
@@ -173,6 +181,8 @@ void TestMapblockMeshGenerator::runTests(IGameDef *gamedef)
 	TEST(testSurroundedNode);
 	TEST(testInterliquidSame);
 	TEST(testInterliquidDifferent);
+	TEST(testGreedyMerge);
+	TEST(testGeometryReuse);
 }
 
 namespace quad {
@@ -270,4 +280,84 @@ void TestMapblockMeshGenerator::testInterliquidDifferent()
 	UASSERT(checkMeshEqual(buf.vertices, buf.indices, {quad::xn, quad::xp, quad::yn, quad::yp, quad::zn, quad::zp}));
 }
 
+void TestMapblockMeshGenerator::testGreedyMerge()
+{
+	MockGameDef gamedef;
+	content_t stone = gamedef.addSimpleNode("stone", 42);
+	gamedef.finalize();
+
+	MeshMakeData data = gamedef.makeMMD(2);
+	data.m_greedy_meshing = true;
+	data.m_vmanip.setNode({0, 0, 0}, {stone, 0, 0});
+	data.m_vmanip.setNode({1, 0, 0}, {stone, 0, 0});
+
+	MeshCollector col{{}};
+	MapblockMeshGenerator mg{&data, &col};
+	mg.generate();
+	UASSERTEQ(std::size_t, col.prebuffers[0].size(), 1);
+	UASSERTEQ(std::size_t, col.prebuffers[1].size(), 0);
+
+	// Faces along X are stretched over both nodes, the texture repeats
+	constexpr float h = BS / 2.0f, e = h + BS;
+	auto make_quad = [] (v3f normal, std::array<std::pair<v3f, v2f>, 4> corners) {
+		Quad q;
+		for (int i = 0; i < 4; i++)
+			q[i] = video::S3DVertex(corners[i].first, normal, 0, corners[i].second);
+		return q;
+	};
+	const Quad zp = make_quad({0, 0, 1}, {{{{-h, -h, h}, {1, 1}}, {{e, -h, h}, {-1, 1}}, {{e, h, h}, {-1, 0}}, {{-h, h, h}, {1, 0}}}});
+	const Quad zn = make_quad({0, 0, -1}, {{{{-h, -h, -h}, {0, 1}}, {{-h, h, -h}, {0, 0}}, {{e, h, -h}, {2, 0}}, {{e, -h, -h}, {2, 1}}}});
+	const Quad yp = make_quad({0, 1, 0}, {{{{-h, h, -h}, {0, 1}}, {{-h, h, h}, {0, 0}}, {{e, h, h}, {2, 0}}, {{e, h, -h}, {2, 1}}}});
+	const Quad yn = make_quad({0, -1, 0}, {{{{-h, -h, -h}, {0, 0}}, {{e, -h, -h}, {2, 0}}, {{e, -h, h}, {2, 1}}, {{-h, -h, h}, {0, 1}}}});
+	const Quad xp = make_quad({1, 0, 0}, {{{{e, -h, -h}, {0, 1}}, {{e, h, -h}, {0, 0}}, {{e, h, h}, {1, 0}}, {{e, -h, h}, {1, 1}}}});
+
+	auto &&buf = col.prebuffers[0][0];
+	UASSERTEQ(u32, buf.layer.texture_id, 42);
+	UASSERTEQ(std::size_t, buf.vertices.size(), 6 * 4);
+	UASSERT(checkMeshEqual(buf.vertices, buf.indices, {quad::xn, xp, yn, yp, zn, zp}));
+}
+
+void TestMapblockMeshGenerator::testGeometryReuse()
+{
+	MockGameDef gamedef;
+	content_t stone = gamedef.addSimpleNode("stone", 42);
+	gamedef.finalize();
+
+	MeshMakeData data = gamedef.makeMMD(4);
+	for (s16 x = 0; x < 4; x++)
+	for (s16 z = 0; z < 4; z++)
+		data.m_vmanip.setNode({x, 0, z}, {stone, 0, 0});
+	data.m_vmanip.setNode({1, 1, 1}, {stone, 0, 0});
+
+	auto cache = std::make_shared<MeshGeometryCache>(&data);
+	MeshCollector col{{}};
+	col.node_ranges = &cache->node_ranges;
+	MapblockMeshGenerator(&data, &col).generate();
+	cache->prebuffers = col.prebuffers;
+
+	UASSERTEQ(u32, cache->findChangedNodes(&data, data.m_regenerate), 0);
+
+	// dig one node and place another one
+	data.m_vmanip.setNode({1, 1, 1}, {CONTENT_AIR, 0, 0});
+	data.m_vmanip.setNode({3, 1, 3}, {stone, 0, 0});
+	const u32 changed = cache->findChangedNodes(&data, data.m_regenerate);
+	UASSERTCMP(u32, >, changed, 0);
+	UASSERTCMP(u32, <, changed, 4 * 4 * 4);
+
+	data.m_previous_geometry = cache;
+	MeshCollector patched{{}};
+	MapblockMeshGenerator(&data, &patched).generate();
+
+	data.m_previous_geometry.reset();
+	MeshCollector full{{}};
+	MapblockMeshGenerator(&data, &full).generate();
+
+	// same result as generating everything
+	UASSERTEQ(std::size_t, patched.prebuffers[0].size(), 1);
+	UASSERTEQ(std::size_t, full.prebuffers[0].size(), 1);
+	auto &&buf = patched.prebuffers[0][0], &&expected = full.prebuffers[0][0];
+	UASSERTEQ(std::size_t, buf.vertices.size(), expected.vertices.size());
+	UASSERT(checkMeshEqual(buf.vertices, buf.indices, expected.vertices, expected.indices));
+}
+
 }
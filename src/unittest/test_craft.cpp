@@ -21,6 +21,7 @@ class TestCraft : public TestBase
 			const std::vector<std::string> &groups, IGameDef *gamedef);
 
 	void testShapeless(IGameDef *gamedef);
+	void testGroupIndex(IGameDef *gamedef);
 };
 
 static TestCraft g_test_instance;
@@ -28,6 +29,7 @@ static TestCraft g_test_instance;
 void TestCraft::runTests(IGameDef *gamedef)
 {
 	TEST(testShapeless, gamedef);
+	TEST(testGroupIndex, gamedef);
 }
 
 std::string TestCraft::getDumpedCraftResult(CraftInput input, IGameDef *gamedef)
@@ -260,3 +262,93 @@ void TestCraft::testShapeless(IGameDef *gamedef)
 			}), gamedef),
 			"(item=\"crafttest:i4\", time=0)");
 }
+
+void TestCraft::testGroupIndex(IGameDef *gamedef)
+{
+	IWritableItemDefManager *idef = (IWritableItemDefManager *)gamedef->getItemDefManager();
+	IWritableCraftDefManager *cdef = (IWritableCraftDefManager *)gamedef->getCraftDefManager();
+
+	auto grid = [&](unsigned int width, const std::vector<std::string> &names) {
+		std::vector<ItemStack> items;
+		for (const auto &name : names) {
+			ItemStack item;
+			item.deSerialize(name, idef);
+			items.push_back(item);
+		}
+		return CraftInput(CRAFT_METHOD_NORMAL, width, items);
+	};
+
+	cdef->clear();
+
+	registerItemWithGroups("crafttest:i1", {}, gamedef);
+	registerItemWithGroups("crafttest:i2", {}, gamedef);
+	registerItemWithGroups("crafttest:i3", {}, gamedef);
+	registerItemWithGroups("crafttest:i4", {}, gamedef);
+	registerItemWithGroups("crafttest:g1g2", {"crafttest_g1", "crafttest_g2"}, gamedef);
+	registerItemWithGroups("crafttest:g3", {"crafttest_g3"}, gamedef);
+
+	// Stick-like shape with a hole, found anywhere in the grid
+	cdef->registerCraft(new CraftDefinitionShaped(
+				"crafttest:i1", 2,
+				{
+					"", "group:crafttest_g1",
+					"group:crafttest_g3", "",
+				},
+				CraftReplacements{}
+			), gamedef);
+	// Needs both groups
+	cdef->registerCraft(new CraftDefinitionShaped(
+				"crafttest:i2", 1,
+				{
+					"group:crafttest_g1,crafttest_g2",
+					"crafttest:i1",
+				},
+				CraftReplacements{}
+			), gamedef);
+	// Same pattern as above, registered later and overrides it
+	cdef->registerCraft(new CraftDefinitionShaped(
+				"crafttest:i3", 1,
+				{
+					"group:crafttest_g2",
+					"crafttest:i1",
+				},
+				CraftReplacements{}
+			), gamedef);
+	cdef->registerCraft(new CraftDefinitionCooking(
+				"crafttest:i4", "group:crafttest_g3", 3.0f,
+				CraftReplacements{}
+			), gamedef);
+
+	cdef->initHashes(gamedef);
+
+	UASSERTEQ(std::string, getDumpedCraftResult(grid(3, {
+				"", "", "",
+				"", "", "crafttest:g1g2",
+				"", "crafttest:g3", "",
+			}), gamedef),
+			"(item=\"crafttest:i1\", time=0)");
+	// The hole has to stay empty
+	UASSERTEQ(std::string, getDumpedCraftResult(grid(3, {
+				"crafttest:i1", "crafttest:g1g2", "",
+				"crafttest:g3", "", "",
+			}), gamedef),
+			"(item=\"\", time=0)");
+	// Wrong group
+	UASSERTEQ(std::string, getDumpedCraftResult(grid(2, {
+				"", "crafttest:g3",
+				"crafttest:g3", "",
+			}), gamedef),
+			"(item=\"\", time=0)");
+	UASSERTEQ(std::string, getDumpedCraftResult(grid(3, {
+				"", "crafttest:g1g2", "",
+				"", "crafttest:i1", "",
+				"", "", "",
+			}), gamedef),
+			"(item=\"crafttest:i3\", time=0)");
+	UASSERTEQ(std::string, getDumpedCraftResult(CraftInput(CRAFT_METHOD_COOKING, 1,
+			{ItemStack("crafttest:g3", 1, 0, idef)}), gamedef),
+			"(item=\"crafttest:i4\", time=3)");
+	UASSERTEQ(std::string, getDumpedCraftResult(CraftInput(CRAFT_METHOD_COOKING, 1,
+			{ItemStack("crafttest:g1g2", 1, 0, idef)}), gamedef),
+			"(item=\"\", time=0)");
+}
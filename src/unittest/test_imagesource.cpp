@@ -0,0 +1,580 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "client/imagesource.h"
+#include "filesys.h"
+#include "noise.h"
+#include "util/numeric.h"
+
+class TestImageSource : public TestBase {
+public:
+	TestImageSource() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestImageSource"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testColorize();
+	void testMultiplyScreen();
+	void testBrightnessContrast();
+	void testOverlay();
+	void testMask();
+	void testGeneratedCache();
+	void testGeneratedCacheInvalidate();
+	void testGeneratedCacheLimit();
+	void testPersistentKey();
+	void testPersistentRoundTrip();
+	void testPersistentBrokenFile();
+	void testPersistentEviction();
+	void testPersistentShared();
+};
+
+static TestImageSource g_test_instance;
+
+void TestImageSource::runTests(IGameDef *gamedef)
+{
+	TEST(testColorize);
+	TEST(testMultiplyScreen);
+	TEST(testBrightnessContrast);
+	TEST(testOverlay);
+	TEST(testMask);
+	TEST(testGeneratedCache);
+	TEST(testGeneratedCacheInvalidate);
+	TEST(testGeneratedCacheLimit);
+	TEST(testPersistentKey);
+	TEST(testPersistentRoundTrip);
+	TEST(testPersistentBrokenFile);
+	TEST(testPersistentEviction);
+	TEST(testPersistentShared);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// In-memory ECF_A8R8G8B8 image, as the video driver is not available here
+class TestImage : public video::IImage {
+public:
+	TestImage(core::dimension2du size) :
+		video::IImage(video::ECF_A8R8G8B8, size, true)
+	{
+		Data = new u8[getImageDataSizeInBytes()]();
+	}
+
+	video::SColor getPixel(u32 x, u32 y) const override
+	{
+		return pixels()[y * Size.Width + x];
+	}
+
+	void setPixel(u32 x, u32 y, const video::SColor &color, bool blend = false) override
+	{
+		pixels()[y * Size.Width + x] = color;
+	}
+
+	void fill(const video::SColor &color) override
+	{
+		for (u32 i = 0; i < Size.getArea(); i++)
+			pixels()[i] = color;
+	}
+
+	// Not needed by the tests
+	bool copyToNoScaling(void *target, u32 width, u32 height,
+			video::ECOLOR_FORMAT format, u32 pitch) const override { return false; }
+	void copyToScaling(void *target, u32 width, u32 height,
+			video::ECOLOR_FORMAT format, u32 pitch) override {}
+	void copyToScaling(video::IImage *target) override {}
+	void copyTo(video::IImage *target, const core::position2d<s32> &pos) override {}
+	void copyTo(video::IImage *target, const core::position2d<s32> &pos,
+			const core::rect<s32> &sourceRect, const core::rect<s32> *clipRect) override {}
+	void copyToScalingBoxFilter(video::IImage *target, s32 bias, bool blend) override {}
+
+private:
+	video::SColor *pixels() const { return reinterpret_cast<video::SColor *>(Data); }
+};
+
+class TestPersistentCache : public PersistentImageCache {
+public:
+	using PersistentImageCache::PersistentImageCache;
+	using PersistentImageCache::getFileName;
+
+protected:
+	video::IImage *createImage(core::dimension2du dim) override
+	{
+		return new TestImage(dim);
+	}
+};
+
+// Random pixels, a quarter of them fully transparent
+TestImage *makeImage(u32 w, u32 h, s32 seed)
+{
+	PcgRandom pr(seed);
+	auto *img = new TestImage({w, h});
+	for (u32 y = 0; y < h; y++)
+	for (u32 x = 0; x < w; x++) {
+		u32 alpha = pr.range(0, 3) == 0 ? 0 : pr.range(1, 255);
+		img->setPixel(x, y, video::SColor(alpha,
+				pr.range(0, 255), pr.range(0, 255), pr.range(0, 255)));
+	}
+	return img;
+}
+
+bool imagesEqual(video::IImage *a, video::IImage *b)
+{
+	return a->getDimension() == b->getDimension() &&
+		memcmp(a->getData(), b->getData(), a->getImageDataSizeInBytes()) == 0;
+}
+
+// Adds a random source image, which replaces the previous one
+void insertSource(SourceImageCache &sources, const std::string &name, s32 seed)
+{
+	auto *img = makeImage(4, 4, seed);
+	sources.insert(name, img, false);
+	img->drop();
+}
+
+// Image with the given ARGB pixels, row by row
+TestImage *makePixels(u32 w, u32 h, std::initializer_list<u32> pixels)
+{
+	auto *img = new TestImage({w, h});
+	u32 i = 0;
+	for (u32 c : pixels) {
+		img->setPixel(i % w, i / w, video::SColor(c));
+		i++;
+	}
+	return img;
+}
+
+u32 pixel(video::IImage *img, u32 x, u32 y)
+{
+	return img->getPixel(x, y).color;
+}
+
+} // namespace
+
+void TestImageSource::testColorize()
+{
+	// Fully transparent pixels are never changed
+	auto *img = makePixels(3, 1, {0x00112233, 0x80643296, 0xff643296});
+	apply_colorize(img, {0, 0}, {3, 1}, video::SColor(0xff0a141e), -1, false);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x00112233);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0xff0a141e);
+	UASSERTEQ(u32, pixel(img, 2, 0), 0xff0a141e);
+	img->drop();
+
+	// keep_alpha multiplies the alpha values
+	img = makePixels(3, 1, {0x00112233, 0x80643296, 0xff643296});
+	apply_colorize(img, {0, 0}, {3, 1}, video::SColor(0x800a141e), 255, true);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x00112233);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x400a141e);
+	UASSERTEQ(u32, pixel(img, 2, 0), 0x800a141e);
+	img->drop();
+
+	// Other ratios interpolate, only inside of the given area
+	const video::SColor color(0x33fa0064);
+	img = makePixels(3, 1, {0x80643296, 0x80643296, 0x80643296});
+	apply_colorize(img, {1, 0}, {1, 1}, color, -1, false);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x80643296);
+	UASSERTEQ(u32, pixel(img, 1, 0),
+			color.getInterpolated(video::SColor(0x80643296), 0.2f).color);
+	UASSERTEQ(u32, pixel(img, 2, 0), 0x80643296);
+	apply_colorize(img, {0, 0}, {1, 1}, color, 0, false);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x80643296);
+	img->drop();
+}
+
+void TestImageSource::testMultiplyScreen()
+{
+	// The alpha value is kept
+	auto *img = makePixels(2, 1, {0x64c86432, 0x64c86432});
+	apply_multiplication(img, {0, 0}, {1, 1}, video::SColor(0x0080ff00));
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x64646400);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x64c86432);
+
+	apply_screen(img, {1, 0}, {1, 1}, video::SColor(0xff8000ff));
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x64646400);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x64e464ff);
+
+	// Areas outside of the image are skipped
+	apply_multiplication(img, {1, 0}, {5, 5}, video::SColor(0));
+	apply_screen(img, {2, 0}, {1, 1}, video::SColor(0xffffffff));
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x64646400);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x64000000);
+	img->drop();
+}
+
+void TestImageSource::testBrightnessContrast()
+{
+	const u32 pixels[] = {0x80000000, 0x80c83214, 0xffffffff};
+	auto *img = makePixels(3, 1, {pixels[0], pixels[1], pixels[2]});
+
+	// No change, also not by rounding
+	apply_brightness_contrast(img, {0, 0}, {3, 1}, 0, 0);
+	for (u32 x = 0; x < 3; x++)
+		UASSERTEQ(u32, pixel(img, x, 0), pixels[x]);
+
+	// Full contrast, values above and below the middle go to the ends
+	apply_brightness_contrast(img, {1, 0}, {1, 1}, 0, 127);
+	UASSERTEQ(u32, pixel(img, 0, 0), pixels[0]);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x80ff0000);
+	UASSERTEQ(u32, pixel(img, 2, 0), pixels[2]);
+
+	// Full brightness gives white, the lowest one black
+	apply_brightness_contrast(img, {0, 0}, {2, 1}, 127, 0);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x80ffffff);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x80ffffff);
+	apply_brightness_contrast(img, {0, 0}, {3, 1}, -127, 0);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x80000000);
+	UASSERTEQ(u32, pixel(img, 2, 0), 0xff000000);
+	img->drop();
+}
+
+void TestImageSource::testOverlay()
+{
+	// Dark parts of the base get darker, light parts lighter
+	auto *top = makePixels(2, 1, {0xff648000, 0xff0000ff});
+	auto *img = makePixels(2, 1, {0xffc83264, 0xff000000});
+	apply_overlay(top, img, {0, 0}, {0, 0}, {2, 1}, false);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0xffbc3200);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0xff000000);
+	img->drop();
+
+	// Hardlight swaps the layers
+	img = makePixels(2, 1, {0xffc83264, 0xff000000});
+	apply_overlay(top, img, {0, 0}, {0, 0}, {2, 1}, true);
+	UASSERTEQ(u32, pixel(img, 0, 0), 0xff9c3200);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0xff0000ff);
+	img->drop();
+
+	// The result goes to dst_pos, also for hardlight
+	for (bool hardlight : {false, true}) {
+		img = makePixels(3, 1, {0xff643296, 0xff643296, 0xff643296});
+		apply_overlay(top, img, {1, 0}, {2, 0}, {5, 5}, hardlight);
+		UASSERTEQ(u32, pixel(img, 0, 0), 0xff643296);
+		UASSERTEQ(u32, pixel(img, 1, 0), 0xff643296);
+		UASSERTEQ(u32, pixel(img, 2, 0), 0xff0000ff);
+		img->drop();
+	}
+	top->drop();
+}
+
+void TestImageSource::testMask()
+{
+	auto *mask = makePixels(2, 2, {0x0fff00f0, 0xffffffff, 0, 0xff00ff00});
+	auto *img = makePixels(2, 2, {0xff8040c0, 0xff8040c0, 0xff8040c0, 0xff8040c0});
+	apply_mask(mask, img, {0, 0}, {0, 0}, {2, 2});
+	UASSERTEQ(u32, pixel(img, 0, 0), 0x0f8000c0);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0xff8040c0);
+	UASSERTEQ(u32, pixel(img, 0, 1), 0);
+	UASSERTEQ(u32, pixel(img, 1, 1), 0xff004000);
+	img->drop();
+
+	// Only the overlapping part is masked
+	img = makePixels(2, 2, {0xff8040c0, 0xff8040c0, 0xff8040c0, 0xff8040c0});
+	apply_mask(mask, img, {1, 1}, {0, 0}, {5, 5});
+	UASSERTEQ(u32, pixel(img, 0, 0), 0xff004000);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0xff8040c0);
+	UASSERTEQ(u32, pixel(img, 0, 1), 0xff8040c0);
+	apply_mask(mask, img, {0, 0}, {1, 1}, {5, 5});
+	UASSERTEQ(u32, pixel(img, 1, 1), 0x0f8000c0);
+	apply_mask(mask, img, {-1, 0}, {0, 0}, {2, 1});
+	UASSERTEQ(u32, pixel(img, 0, 0), 0xff004000);
+	UASSERTEQ(u32, pixel(img, 1, 0), 0x0f8000c0);
+	img->drop();
+	mask->drop();
+}
+
+void TestImageSource::testGeneratedCache()
+{
+	GeneratedImageCache cache(1024 * 1024);
+	std::set<std::string> names;
+	UASSERT(!cache.get("a.png^[invert:rgb", names));
+	UASSERT(names.empty());
+
+	auto *img = makeImage(4, 4, 1);
+	cache.insert("a.png^[invert:rgb", img, {"a.png"});
+	UASSERTEQ(size_t, cache.getSize(), 4 * 4 * 4);
+
+	// The cached image is shared, not copied
+	video::IImage *cached = cache.get("a.png^[invert:rgb", names);
+	UASSERT(cached == img);
+	UASSERT(names == std::set<std::string>{"a.png"});
+	UASSERTEQ(s32, img->getReferenceCount(), 3);
+	cached->drop();
+
+	// Replacing an entry releases the old image
+	auto *img2 = makeImage(2, 2, 2);
+	cache.insert("a.png^[invert:rgb", img2, {"a.png", "b.png"});
+	UASSERTEQ(s32, img->getReferenceCount(), 1);
+	UASSERTEQ(size_t, cache.getSize(), 2 * 2 * 4);
+	names.clear();
+	cached = cache.get("a.png^[invert:rgb", names);
+	UASSERT(cached == img2);
+	UASSERTEQ(size_t, names.size(), 2);
+	cached->drop();
+
+	img->drop();
+	img2->drop();
+}
+
+void TestImageSource::testGeneratedCacheInvalidate()
+{
+	GeneratedImageCache cache(1024 * 1024);
+	auto *img = makeImage(4, 4, 1);
+	cache.insert("a.png^b.png", img, {"a.png", "b.png"});
+	cache.insert("a.png^[invert:rgb", img, {"a.png"});
+	cache.insert("c.png^[invert:rgb", img, {"c.png"});
+	UASSERTEQ(s32, img->getReferenceCount(), 4);
+
+	cache.invalidate("other.png");
+	UASSERTEQ(size_t, cache.getSize(), 3 * 4 * 4 * 4);
+
+	cache.invalidate("a.png");
+	UASSERTEQ(size_t, cache.getSize(), 4 * 4 * 4);
+	UASSERTEQ(s32, img->getReferenceCount(), 2);
+	std::set<std::string> names;
+	UASSERT(!cache.get("a.png^b.png", names));
+	UASSERT(!cache.get("a.png^[invert:rgb", names));
+	video::IImage *cached = cache.get("c.png^[invert:rgb", names);
+	UASSERT(cached == img);
+	cached->drop();
+
+	cache.invalidate("c.png");
+	UASSERTEQ(size_t, cache.getSize(), 0);
+	UASSERTEQ(s32, img->getReferenceCount(), 1);
+	img->drop();
+}
+
+void TestImageSource::testGeneratedCacheLimit()
+{
+	// Room for four 8x8 images
+	GeneratedImageCache cache(4 * 8 * 8 * 4);
+	std::set<std::string> names;
+	for (int i = 0; i < 4; i++) {
+		auto *img = makeImage(8, 8, i);
+		cache.insert("img" + std::to_string(i), img, {});
+		img->drop();
+	}
+	// Make img0 the most recently used one
+	cache.get("img0", names)->drop();
+
+	auto *img = makeImage(8, 8, 4);
+	cache.insert("img4", img, {});
+	img->drop();
+	UASSERTEQ(size_t, cache.getSize(), 4 * 8 * 8 * 4);
+	video::IImage *cached = cache.get("img0", names);
+	UASSERT(cached);
+	cached->drop();
+	UASSERT(!cache.get("img1", names));
+
+	// Too large images are not cached at all
+	img = makeImage(16, 16, 5);
+	cache.insert("large", img, {});
+	UASSERTEQ(s32, img->getReferenceCount(), 1);
+	UASSERT(!cache.get("large", names));
+	img->drop();
+}
+
+void TestImageSource::testPersistentKey()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "images_key";
+	TestPersistentCache cache(dir, "filter=0;");
+	TestPersistentCache other(dir, "filter=1;");
+
+	const std::string name = "[inventorycube{a.png{b.png{c.png";
+	const std::string file_name = cache.getFileName(name);
+	UASSERTEQ(size_t, file_name.size(), 40);
+	UASSERT(file_name.find_first_not_of("0123456789abcdef") == std::string::npos);
+	UASSERT(file_name == cache.getFileName(name));
+	UASSERT(file_name != cache.getFileName("[inventorycube{a.png{b.png{d.png"));
+	// Settings that affect image generation give different files
+	UASSERT(file_name != other.getFileName(name));
+
+	// Only images that are slower to make than to read back are kept
+	UASSERT(!PersistentImageCache::isWorthKeeping({576, 576}, 500));
+	UASSERT(PersistentImageCache::isWorthKeeping({576, 576}, 50000));
+	UASSERT(!PersistentImageCache::isWorthKeeping({16, 16}, 5));
+}
+
+void TestImageSource::testPersistentRoundTrip()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "images_round_trip";
+	const std::string name = "[inventorycube{a.png{b.png{a.png";
+	SourceImageCache sources;
+	insertSource(sources, "a.png", 1);
+	insertSource(sources, "b.png", 2);
+
+	auto *img = makeImage(9, 7, 3);
+	{
+		TestPersistentCache cache(dir, "filter=0;");
+		std::set<std::string> names;
+		UASSERT(!cache.get(name, sources, names));
+		cache.insert(name, img, sources, {"a.png", "b.png"});
+		UASSERT(cache.getSize() > 0);
+	}
+	UASSERT(fs::PathExists(dir + DIR_DELIM + PersistentImageCache::INDEX_FILE));
+
+	{
+		// The next session finds the image
+		TestPersistentCache cache(dir, "filter=0;");
+		std::set<std::string> names;
+		video::IImage *cached = cache.get(name, sources, names);
+		UASSERT(cached);
+		UASSERT(imagesEqual(cached, img));
+		UASSERT(names == (std::set<std::string>{"a.png", "b.png"}));
+		cached->drop();
+
+		// but not with other settings
+		TestPersistentCache other(dir, "filter=1;");
+		UASSERT(!other.get(name, sources, names));
+	}
+
+	{
+		// nor once a source image has changed
+		insertSource(sources, "b.png", 4);
+		TestPersistentCache cache(dir, "filter=0;");
+		std::set<std::string> names;
+		UASSERT(!cache.get(name, sources, names));
+		UASSERT(names.empty());
+	}
+
+	// Media files are known by the hash of the file, not of the pixels
+	auto *face = makeImage(4, 4, 5);
+	sources.insert("b.png", face, false, "hash1");
+	{
+		TestPersistentCache cache(dir, "filter=0;");
+		cache.insert(name, img, sources, {"a.png", "b.png"});
+	}
+	{
+		// Same file
+		auto *face2 = makeImage(4, 4, 6);
+		sources.insert("b.png", face2, false, "hash1");
+		face2->drop();
+		TestPersistentCache cache(dir, "filter=0;");
+		std::set<std::string> names;
+		video::IImage *cached = cache.get(name, sources, names);
+		UASSERT(cached);
+		cached->drop();
+	}
+	{
+		// Other file with the same pixels
+		sources.insert("b.png", face, false, "hash2");
+		TestPersistentCache cache(dir, "filter=0;");
+		std::set<std::string> names;
+		UASSERT(!cache.get(name, sources, names));
+	}
+	face->drop();
+	img->drop();
+}
+
+void TestImageSource::testPersistentBrokenFile()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "images_broken";
+	const std::string name = "[inventorycube{a.png{a.png{a.png";
+	SourceImageCache sources;
+	insertSource(sources, "a.png", 1);
+
+	auto *img = makeImage(9, 7, 3);
+	std::string path;
+	{
+		TestPersistentCache cache(dir, "filter=0;");
+		cache.insert(name, img, sources, {"a.png"});
+		path = dir + DIR_DELIM + cache.getFileName(name);
+	}
+	img->drop();
+	std::string data;
+	UASSERT(fs::ReadFile(path, data));
+
+	const std::string broken[] = {
+		data.substr(0, data.size() / 2), // truncated
+		data.substr(0, data.size() - 8) + std::string(8, '\xff'), // bad compressed data
+		"", // empty
+	};
+	for (const std::string &contents : broken) {
+		UASSERT(fs::safeWriteToFile(path, contents));
+		TestPersistentCache cache(dir, "filter=0;");
+		std::set<std::string> names;
+		UASSERT(!cache.get(name, sources, names));
+		UASSERT(names.empty());
+	}
+}
+
+void TestImageSource::testPersistentEviction()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "images_eviction";
+	SourceImageCache sources;
+	insertSource(sources, "a.png", 1);
+
+	// Random pixels do not compress, so each file is a bit over 1 KiB
+	auto *img = makeImage(16, 16, 3);
+	std::vector<std::string> file_names;
+	{
+		TestPersistentCache cache(dir, "", 3 * 1024);
+		for (int i = 0; i < 4; i++) {
+			std::string name = "img" + std::to_string(i);
+			cache.insert(name, img, sources, {"a.png"});
+			file_names.push_back(cache.getFileName(name));
+		}
+		// Older files were deleted, but not the one just written
+		UASSERT(cache.getSize() <= 3 * 1024);
+		UASSERT(cache.getSize() > 0);
+		UASSERT(fs::PathExists(dir + DIR_DELIM + file_names[3]));
+		int left = 0;
+		for (const std::string &file_name : file_names)
+			left += fs::PathExists(dir + DIR_DELIM + file_name);
+		UASSERT(left < 4);
+	}
+	img->drop();
+
+	// Files that have not been used for a while are deleted on startup
+	{
+		TestPersistentCache cache(dir, "", 1024 * 1024);
+		UASSERT(cache.getSize() > 0);
+	}
+	UASSERT(fs::PathExists(dir + DIR_DELIM + file_names[3]));
+	{
+		TestPersistentCache cache(dir, "", 1024 * 1024, 0);
+	}
+	UASSERT(!fs::PathExists(dir + DIR_DELIM + file_names[3]));
+	{
+		TestPersistentCache cache(dir, "", 1024 * 1024);
+		UASSERTEQ(size_t, cache.getSize(), 0);
+	}
+
+	// but not files that are missing from the index
+	const std::string stray = dir + DIR_DELIM + "stray";
+	UASSERT(fs::safeWriteToFile(stray, "data"));
+	{
+		TestPersistentCache cache(dir, "", 0, 0);
+		UASSERTEQ(size_t, cache.getSize(), 0);
+	}
+	UASSERT(fs::PathExists(stray));
+}
+
+void TestImageSource::testPersistentShared()
+{
+	// Two clients using the same directory at the same time
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "images_shared";
+	SourceImageCache sources;
+	insertSource(sources, "a.png", 1);
+
+	auto *img = makeImage(9, 7, 3);
+	{
+		TestPersistentCache first(dir, "");
+		TestPersistentCache second(dir, "");
+		first.insert("first", img, sources, {"a.png"});
+		second.insert("second", img, sources, {"a.png"});
+		// Each writes its index on exit, the last one keeps the other's entry
+	}
+	{
+		TestPersistentCache cache(dir, "");
+		std::set<std::string> names;
+		for (const char *name : {"first", "second"}) {
+			video::IImage *cached = cache.get(name, sources, names);
+			UASSERT(cached);
+			cached->drop();
+		}
+	}
+	img->drop();
+}
@@ -17,6 +17,7 @@ class TestInventory : public TestBase {
 	void runTests(IGameDef *gamedef);
 
 	void testSerializeDeserialize(IItemDefManager *idef);
+	void testBinaryDelta(IItemDefManager *idef);
 
 	static const char *serialized_inventory_in;
 	static const char *serialized_inventory_out;
@@ -28,6 +29,7 @@ static TestInventory g_test_instance;
 void TestInventory::runTests(IGameDef *gamedef)
 {
 	TEST(testSerializeDeserialize, gamedef->getItemDefManager());
+	TEST(testBinaryDelta, gamedef->getItemDefManager());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -65,6 +67,92 @@ void TestInventory::testSerializeDeserialize(IItemDefManager *idef)
 	UASSERT(leftover == wanted);
 }
 
+static std::string serialize_binary(const Inventory &inv, bool incremental)
+{
+	std::ostringstream os(std::ios::binary);
+	inv.serializeBinary(os, incremental);
+	return os.str();
+}
+
+static std::string serialize_text(const Inventory &inv, bool incremental)
+{
+	std::ostringstream os(std::ios::binary);
+	inv.serialize(os, incremental);
+	return os.str();
+}
+
+static void apply_binary(Inventory &inv, const std::string &data)
+{
+	std::istringstream is(data, std::ios::binary);
+	inv.deSerializeBinary(is);
+}
+
+void TestInventory::testBinaryDelta(IItemDefManager *idef)
+{
+	Inventory server(idef);
+	InventoryList *main = server.addList("main", 32);
+	main->setWidth(8);
+	server.addList("craft", 9)->setWidth(3);
+	server.addList("craftpreview", 1);
+	for (u32 i = 0; i < 32; i += 2)
+		main->changeItem(i, ItemStack("default:dirt", 1 + i, 0, idef));
+
+	// The first update contains everything
+	Inventory client(idef);
+	apply_binary(client, serialize_binary(server, true));
+	UASSERT(client == server);
+	UASSERTEQ(u32, client.getList("main")->getWidth(), 8);
+	server.setModified(false);
+	client.setModified(false);
+
+	// Nothing changed
+	UASSERT(!main->checkSlotModified(4));
+	apply_binary(client, serialize_binary(server, true));
+	UASSERT(client == server);
+	UASSERT(!client.checkModified());
+
+	// A single slot, like picking up an item
+	main->addItem(4, ItemStack("default:dirt", 3, 0, idef));
+	UASSERT(main->checkSlotModified(4));
+	UASSERT(!main->checkSlotModified(5));
+	const std::string delta = serialize_binary(server, true);
+	const std::string text = serialize_text(server, true);
+	infostream << "Inventory update for one slot: " << delta.size()
+		<< " bytes, text format " << text.size() << " bytes" << std::endl;
+	UASSERT(delta.size() < 80);
+	UASSERT(delta.size() * 5 < text.size());
+
+	apply_binary(client, delta);
+	UASSERT(client == server);
+	UASSERT(client.getList("main")->checkSlotModified(4));
+	UASSERT(!client.getList("main")->checkSlotModified(5));
+	UASSERT(!client.getList("craft")->checkModified());
+	server.setModified(false);
+
+	// Slots touched by removeItem, which walks the list in reverse
+	main->removeItem(ItemStack("default:dirt", 31 + 29, 0, idef), false);
+	UASSERT(main->checkSlotModified(30));
+	UASSERT(main->checkSlotModified(28));
+	UASSERT(!main->checkSlotModified(26));
+	apply_binary(client, serialize_binary(server, true));
+	UASSERT(client == server);
+	server.setModified(false);
+
+	// Resizing sends the whole list, dropping a list removes it
+	server.getList("craft")->setSize(4);
+	server.deleteList("craftpreview");
+	apply_binary(client, serialize_binary(server, true));
+	UASSERT(client == server);
+	UASSERT(!client.getList("craftpreview"));
+	UASSERTEQ(u32, client.getList("craft")->getWidth(), 3);
+
+	// A non-incremental update does not depend on the previous state
+	Inventory other(idef);
+	other.addList("junk", 3);
+	apply_binary(other, serialize_binary(server, false));
+	UASSERT(other == server);
+}
+
 const char *TestInventory::serialized_inventory_in =
 	"List 0 10\n"
 	"Width 3\n"
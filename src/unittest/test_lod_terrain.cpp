@@ -0,0 +1,228 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "client/lod_terrain.h"
+#include "util/numeric.h"
+#include <map>
+
+class TestLodTerrain : public TestBase {
+public:
+	TestLodTerrain() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestLodTerrain"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testSelectLevel();
+	void testMerge();
+	void testBuildMesh();
+	void testSelect();
+	void testInvalidate();
+	void testEvict();
+};
+
+static TestLodTerrain g_test_instance;
+
+void TestLodTerrain::runTests(IGameDef *gamedef)
+{
+	TEST(testSelectLevel);
+	TEST(testMerge);
+	TEST(testBuildMesh);
+	TEST(testSelect);
+	TEST(testInvalidate);
+	TEST(testEvict);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Flat ground at the given height above the block bottom
+static std::unique_ptr<LodSummary> makeFlat(u16 height,
+		video::SColor color = video::SColor(0xff00ff00))
+{
+	auto s = std::make_unique<LodSummary>();
+	for (u16 i = 0; i < LodSummary::SIZE * LodSummary::SIZE; i++) {
+		s->height[i] = height;
+		s->color[i] = color;
+	}
+	return s;
+}
+
+void TestLodTerrain::testSelectLevel()
+{
+	UASSERTEQ(int, LodTerrain::selectLevel(50, 100), 0);
+	UASSERTEQ(int, LodTerrain::selectLevel(100, 100), 1);
+	UASSERTEQ(int, LodTerrain::selectLevel(199, 100), 1);
+	UASSERTEQ(int, LodTerrain::selectLevel(200, 100), 2);
+	UASSERTEQ(int, LodTerrain::selectLevel(450, 100), 3);
+	UASSERTEQ(int, LodTerrain::selectLevel(1e6f, 100), LodTerrain::MAX_LEVEL);
+}
+
+void TestLodTerrain::testMerge()
+{
+	const video::SColor green(0xff00ff00), white(0xffffffff);
+	auto bottom = makeFlat(4, green);
+	auto top = makeFlat(3, white);
+	auto side = std::make_unique<LodSummary>();
+	side->height[LodSummary::index(1, 0)] = 5;
+	side->color[LodSummary::index(1, 0)] = green;
+
+	const LodSummary *children[8] = {};
+	children[0] = bottom.get(); // x=0 y=0 z=0
+	children[1] = side.get(); // x=1 y=0 z=0
+	children[2] = top.get(); // x=0 y=1 z=0
+
+	LodSummary merged;
+	merged.merge(children, 0);
+
+	// the upper child covers the lower one
+	UASSERTEQ(int, merged.height[LodSummary::index(0, 0)], 16 + 3);
+	UASSERT(merged.color[LodSummary::index(0, 0)] == white);
+	UASSERTEQ(int, merged.height[LodSummary::index(7, 7)], 16 + 3);
+	// highest of the 2x2 child columns
+	UASSERTEQ(int, merged.height[LodSummary::index(8, 0)], 5);
+	UASSERT(merged.color[LodSummary::index(8, 0)] == green);
+	UASSERTEQ(int, merged.height[LodSummary::index(9, 0)], 0);
+	// nothing in the children at z=1
+	UASSERTEQ(int, merged.height[LodSummary::index(0, 8)], 0);
+	UASSERT(!merged.isEmpty());
+}
+
+void TestLodTerrain::testBuildMesh()
+{
+	auto flat = makeFlat(1);
+	{
+		scene::SMeshBuffer buf;
+		buildLodMesh(*flat, 0, &buf);
+		// one top per column and walls around the cell border
+		UASSERTEQ(u32, buf.getVertexCount(), (16 * 16 + 4 * 16) * 4);
+		UASSERTEQ(u32, buf.getIndexCount(), (16 * 16 + 4 * 16) * 6);
+		aabb3f box = buf.getBoundingBox();
+		UASSERT(box.MinEdge.equals(v3f(-0.5f * BS)));
+		UASSERT(box.MaxEdge.equals(v3f(15.5f * BS, 0.5f * BS, 15.5f * BS)));
+	}
+	{
+		// columns are twice as wide at level 1
+		scene::SMeshBuffer buf;
+		buildLodMesh(*flat, 1, &buf);
+		UASSERT(buf.getBoundingBox().MaxEdge.equals(v3f(31.5f * BS, 0.5f * BS, 31.5f * BS)));
+	}
+	{
+		// a single higher column adds four walls
+		flat->height[LodSummary::index(5, 5)] = 3;
+		scene::SMeshBuffer buf;
+		buildLodMesh(*flat, 0, &buf);
+		UASSERTEQ(u32, buf.getVertexCount(), (16 * 16 + 4 * 16 + 4) * 4);
+	}
+	{
+		scene::SMeshBuffer buf;
+		buildLodMesh(LodSummary(), 0, &buf);
+		UASSERTEQ(u32, buf.getVertexCount(), 0);
+	}
+}
+
+void TestLodTerrain::testSelect()
+{
+	LodTerrain lod;
+	const s16 count = 64;
+	for (s16 x = 0; x < count; x++)
+		lod.addBlock(v3s16(x, 0, 0), makeFlat(1));
+	// empty blocks are not kept
+	lod.addBlock(v3s16(0, 1, 0), std::make_unique<LodSummary>());
+	UASSERTEQ(size_t, lod.getBlockCount(), count);
+
+	const v3f camera(0, 8, 8);
+	const f32 full_range = 100;
+	std::vector<LodCellKey> cells;
+	UASSERT(lod.select(camera, full_range, 2000, cells));
+
+	// every block outside of the full detail range must be drawn exactly once
+	std::map<s16, int> covered;
+	for (const LodCellKey &key : cells) {
+		v3s16 bp = key.getBlockPos();
+		UASSERTEQ(s16, bp.Y, 0);
+		UASSERTEQ(s16, bp.Z, 0);
+		for (s16 x = bp.X; x < bp.X + (1 << key.level); x++)
+			covered[x]++;
+	}
+	for (s16 x = 0; x < count; x++) {
+		bool full_detail = x * MAP_BLOCKSIZE - 0.5f < full_range;
+		UASSERTEQ(int, covered[x], full_detail ? 0 : 1);
+	}
+
+	// nothing is drawn past lod_range
+	cells.clear();
+	lod.select(camera, full_range, 200, cells);
+	for (const LodCellKey &key : cells)
+		UASSERT(key.getBlockPos().X * MAP_BLOCKSIZE < 200);
+
+	// meshes are built incrementally if limited
+	LodTerrain lod2;
+	for (s16 x = 0; x < count; x++)
+		lod2.addBlock(v3s16(x, 0, 0), makeFlat(1));
+	cells.clear();
+	UASSERT(!lod2.select(camera, full_range, 2000, cells, 1));
+	UASSERTEQ(u32, lod2.getMeshBuildCount(), 1);
+}
+
+void TestLodTerrain::testInvalidate()
+{
+	LodTerrain lod;
+	const v3s16 bp(3, -1, 2);
+	lod.addBlock(bp, makeFlat(2));
+
+	// bp is at offset (1, 1, 0) in its level 1 cell
+	const LodCellKey key{v3s16(1, -1, 1), 1};
+	const LodSummary *summary = lod.getSummary(key);
+	UASSERT(summary);
+	UASSERTEQ(int, summary->height[LodSummary::index(8, 0)], 16 + 2);
+	UASSERTEQ(int, summary->height[LodSummary::index(0, 0)], 0);
+
+	UASSERT(lod.getMesh(key));
+	UASSERTEQ(u32, lod.getMeshBuildCount(), 1);
+	// cached
+	UASSERT(lod.getMesh(key));
+	UASSERTEQ(u32, lod.getMeshBuildCount(), 1);
+
+	// changing the block updates all levels
+	lod.addBlock(bp, makeFlat(5));
+	UASSERT(lod.getCachedMesh(key));
+	UASSERT(lod.getMesh(key));
+	UASSERTEQ(u32, lod.getMeshBuildCount(), 2);
+	UASSERTEQ(int, lod.getSummary(key)->height[LodSummary::index(8, 0)], 16 + 5);
+	const LodCellKey top{getContainerPos(bp, 1 << LodTerrain::MAX_LEVEL),
+			LodTerrain::MAX_LEVEL};
+	UASSERT(lod.getSummary(top));
+
+	// removing it leaves nothing to draw
+	lod.addBlock(bp, nullptr);
+	UASSERTEQ(size_t, lod.getBlockCount(), 0);
+	UASSERT(!lod.getSummary(key));
+	UASSERT(!lod.getMesh(key));
+	UASSERT(!lod.getSummary(top));
+}
+
+void TestLodTerrain::testEvict()
+{
+	LodTerrain lod;
+	// top level cells are 512 nodes wide
+	lod.addBlock(v3s16(0, 0, 0), makeFlat(1));
+	lod.addBlock(v3s16(31, 0, 0), makeFlat(1));
+	lod.addBlock(v3s16(100, 0, 0), makeFlat(1));
+	UASSERT(lod.getSummary({v3s16(0, 0, 0), LodTerrain::MAX_LEVEL}));
+	UASSERT(lod.getSummary({v3s16(3, 0, 0), LodTerrain::MAX_LEVEL}));
+
+	UASSERTEQ(size_t, lod.evict(v3f(0, 0, 0), 1000), 1);
+	UASSERTEQ(size_t, lod.getBlockCount(), 2);
+	// the near top level cell keeps all of its blocks, even the one
+	// beyond the range
+	UASSERT(lod.getSummary({v3s16(31, 0, 0), 0}));
+	UASSERT(lod.getSummary({v3s16(0, 0, 0), LodTerrain::MAX_LEVEL}));
+	UASSERT(!lod.getSummary({v3s16(100, 0, 0), 0}));
+	UASSERT(!lod.getSummary({v3s16(3, 0, 0), LodTerrain::MAX_LEVEL}));
+	UASSERT(!lod.getCachedMesh({v3s16(3, 0, 0), LodTerrain::MAX_LEVEL}));
+
+	UASSERTEQ(size_t, lod.evict(v3f(5000, 0, 0), 0), 2);
+	UASSERTEQ(size_t, lod.getBlockCount(), 0);
+}
@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <unordered_set>
 #include <unordered_map>
 #include "mapblock.h"
+#include "mapblockindex.h"
 #include "dummymap.h"
 
 class TestMap : public TestBase
@@ -36,6 +37,9 @@ class TestMap : public TestBase
 	void testForEachNodeInArea(IGameDef *gamedef);
 	void testForEachNodeInAreaBlank(IGameDef *gamedef);
 	void testForEachNodeInAreaEmpty(IGameDef *gamedef);
+	void testBlockIndex();
+	void testMemoryBudget(IGameDef *gamedef);
+	void testMemoryBudgetDirty(IGameDef *gamedef);
 };
 
 static TestMap g_test_instance;
@@ -46,6 +50,9 @@ void TestMap::runTests(IGameDef *gamedef)
 	TEST(testForEachNodeInArea, gamedef);
 	TEST(testForEachNodeInAreaBlank, gamedef);
 	TEST(testForEachNodeInAreaEmpty, gamedef);
+	TEST(testBlockIndex);
+	TEST(testMemoryBudget, gamedef);
+	TEST(testMemoryBudgetDirty, gamedef);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -169,3 +176,126 @@ void TestMap::testForEachNodeInAreaEmpty(IGameDef *gamedef)
 		return true;
 	});
 }
+
+void TestMap::testBlockIndex()
+{
+	MapBlockIndex index;
+	// Fake pointers, they are never dereferenced
+	auto fake_block = [] (v3s16 p) {
+		return reinterpret_cast<MapBlock *>(
+			(uintptr_t)(((p.X + 100) * 1000 + (p.Y + 100)) * 1000 + p.Z + 100) * 8);
+	};
+
+	// Enough to grow the table several times
+	std::vector<v3s16> positions;
+	for (s16 z = -10; z < 10; z++)
+	for (s16 y = -5; y < 5; y++)
+	for (s16 x = -10; x < 10; x++)
+		positions.emplace_back(x, y, z);
+	for (v3s16 p : positions)
+		index.insert(p, fake_block(p));
+	UASSERTEQ(size_t, index.size(), positions.size());
+
+	for (v3s16 p : positions)
+		UASSERT(index.get(p) == fake_block(p));
+	UASSERT(index.get({10, 0, 0}) == nullptr);
+	UASSERT(index.get({S16_MIN, S16_MIN, S16_MIN}) == nullptr);
+
+	// Remove every other block, the rest must stay reachable
+	for (size_t i = 0; i < positions.size(); i += 2)
+		UASSERT(index.erase(positions[i]));
+	UASSERT(!index.erase(positions[0]));
+	UASSERTEQ(size_t, index.size(), positions.size() / 2);
+	for (size_t i = 0; i < positions.size(); i++) {
+		MapBlock *expected = i % 2 == 0 ? nullptr : fake_block(positions[i]);
+		UASSERT(index.get(positions[i]) == expected);
+	}
+
+	size_t count = 0;
+	index.forEach([&count] (MapBlock *) { count++; });
+	UASSERTEQ(size_t, count, index.size());
+
+	index.clear();
+	UASSERT(index.empty());
+	UASSERT(index.get(positions[1]) == nullptr);
+}
+
+void TestMap::testMemoryBudget(IGameDef *gamedef)
+{
+	DummyMap map(gamedef, {0, 0, 0}, {3, 0, 0});
+	MapBlock *locked = map.getBlockNoCreateNoEx({0, 0, 0});
+	MapBlock *recent = map.getBlockNoCreateNoEx({3, 0, 0});
+
+	// Without a budget nothing is unloaded before the timeout
+	std::vector<v3s16> unloaded;
+	map.timerUpdate(1.0f, 100.0f, -1, &unloaded);
+	UASSERT(unloaded.empty());
+	const u64 all_bytes = map.getResidentBytes();
+	UASSERT(all_bytes > 4 * sizeof(MapBlock));
+
+	locked->refGrab();
+	recent->resetUsageTimer();
+	const size_t budget = locked->getMemoryUsage() + recent->getMemoryUsage();
+	map.setMemoryBudget(budget);
+
+	// The two least recently used blocks must go, the locked one stays
+	map.timerUpdate(0.0f, 100.0f, -1, &unloaded);
+	UASSERTEQ(size_t, unloaded.size(), 2);
+	UASSERT(map.getBlockNoCreateNoEx({0, 0, 0}) == locked);
+	UASSERT(map.getBlockNoCreateNoEx({1, 0, 0}) == nullptr);
+	UASSERT(map.getBlockNoCreateNoEx({2, 0, 0}) == nullptr);
+	UASSERT(map.getBlockNoCreateNoEx({3, 0, 0}) == recent);
+	UASSERT(map.getResidentBytes() <= budget);
+	UASSERT(map.getResidentBytes() < all_bytes);
+
+	locked->refDrop();
+}
+
+namespace {
+
+class SavingDummyMap : public DummyMap
+{
+public:
+	using DummyMap::DummyMap;
+
+	bool maySaveBlocks() override { return true; }
+
+	bool saveBlock(MapBlock *block) override
+	{
+		block->resetModified();
+		saved.push_back(block->getPos());
+		return true;
+	}
+
+	std::vector<v3s16> saved;
+};
+
+}
+
+void TestMap::testMemoryBudgetDirty(IGameDef *gamedef)
+{
+	// Block 0 is the least recently used one, the first ten are modified
+	SavingDummyMap map(gamedef, {0, 0, 0}, {199, 0, 0});
+	for (s16 x = 0; x < 200; x++) {
+		MapBlock *block = map.getBlockNoCreateNoEx({x, 0, 0});
+		block->resetModified();
+		block->resetUsageTimer();
+		block->incrementUsageTimer(200 - x);
+		if (x < 10)
+			block->raiseModified(MOD_STATE_WRITE_NEEDED);
+	}
+	std::vector<v3s16> unloaded;
+	map.timerUpdate(0.0f, 1000.0f, -1, &unloaded);
+	UASSERT(unloaded.empty());
+
+	// Half of the blocks must go. The old modified blocks are saved and
+	// unloaded before recently used clean ones.
+	map.setMemoryBudget(map.getResidentBytes() / 2);
+	map.timerUpdate(0.0f, 1000.0f, -1, &unloaded);
+	UASSERTEQ(size_t, unloaded.size(), 100);
+	UASSERTEQ(size_t, map.saved.size(), 10);
+	for (s16 x = 0; x < 100; x++)
+		UASSERT(map.getBlockNoCreateNoEx({x, 0, 0}) == nullptr);
+	for (s16 x = 100; x < 200; x++)
+		UASSERT(map.getBlockNoCreateNoEx({x, 0, 0}) != nullptr);
+}
@@ -38,6 +38,7 @@ class TestMapBlock : public TestBase
 
 	// Tests blocks with a single recurring node
 	void testMonoblock(IGameDef *gamedef);
+	void testPalette(IGameDef *gamedef);
 };
 
 static TestMapBlock g_test_instance;
@@ -51,6 +52,7 @@ void TestMapBlock::runTests(IGameDef *gamedef)
 	TEST(testLoad20, gamedef);
 	TEST(testLoadNonStd, gamedef);
 	TEST(testMonoblock, gamedef);
+	TEST(testPalette, gamedef);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -471,3 +473,68 @@ void TestMapBlock::testLoadNonStd(IGameDef *gamedef)
 	for (s16 i = 0; i < 16; i++)
 		UASSERTEQ(int, block.getNodeNoEx({i, 1, 0}).param2, data_lo[i]);
 }
+
+void TestMapBlock::testPalette(IGameDef *gamedef)
+{
+	MapBlock::setPaletteCompression(true);
+
+	MapBlock block({}, gamedef);
+	block.tryShrinkNodes();
+	UASSERT(block.m_is_mono_block);
+
+	// a mono block changed in one node becomes paletted
+	block.setNode(1, 2, 3, MapNode(42));
+	UASSERT(!block.m_is_mono_block);
+	UASSERTEQ(int, block.m_palette_bits, 1);
+	UASSERT(block.getNodeNoCheck(1, 2, 3) == MapNode(42));
+	UASSERT(block.getNodeNoCheck(3, 2, 1) == MapNode(CONTENT_IGNORE));
+
+	// more distinct nodes widen the indices
+	for (u16 i = 0; i < 20; i++)
+		block.setNode(i % MAP_BLOCKSIZE, i / MAP_BLOCKSIZE, 7, MapNode(100 + i, i, 0));
+	UASSERTEQ(int, block.m_palette_bits, 8);
+	for (u16 i = 0; i < 20; i++)
+		UASSERT(block.getNodeNoCheck(i % MAP_BLOCKSIZE, i / MAP_BLOCKSIZE, 7) ==
+				MapNode(100 + i, i, 0));
+	UASSERT(block.getNodeNoCheck(1, 2, 3) == MapNode(42));
+	UASSERT(block.getNodeNoCheck(15, 15, 15) == MapNode(CONTENT_IGNORE));
+
+	// all nodes survive a round trip through a VoxelManipulator
+	VoxelManipulator vm;
+	vm.addArea(VoxelArea(block.getPosRelative(),
+			block.getPosRelative() + v3s16(MAP_BLOCKSIZE - 1)));
+	block.copyTo(vm);
+	UASSERT(vm.getNode({1, 2, 3}) == MapNode(42));
+	UASSERT(vm.getNode({3, 1, 7}) == MapNode(119, 19, 0));
+	UASSERT(vm.getNode({4, 1, 7}) == MapNode(CONTENT_IGNORE));
+
+	// copyFrom() packs the block again, with fewer bits
+	vm.setNode({4, 1, 7}, MapNode(42));
+	for (u16 i = 0; i < 20; i++)
+		vm.setNode({(s16)(i % MAP_BLOCKSIZE), (s16)(i / MAP_BLOCKSIZE), 7}, MapNode(43));
+	block.copyFrom(vm);
+	UASSERTEQ(int, block.m_palette_bits, 2);
+	UASSERT(block.getNodeNoCheck(0, 0, 7) == MapNode(43));
+	UASSERT(block.getNodeNoCheck(1, 2, 3) == MapNode(42));
+
+	// serialization sees the same nodes
+	std::ostringstream os(std::ios_base::binary);
+	block.serialize(os, SER_FMT_VER_HIGHEST_WRITE, false, -1);
+	MapBlock block2({}, gamedef);
+	std::istringstream is(os.str(), std::ios_base::binary);
+	block2.deSerialize(is, SER_FMT_VER_HIGHEST_WRITE, false);
+	for (s16 z = 0; z < MAP_BLOCKSIZE; z++)
+	for (s16 y = 0; y < MAP_BLOCKSIZE; y++)
+	for (s16 x = 0; x < MAP_BLOCKSIZE; x++)
+		UASSERT(block2.getNodeNoCheck(x, y, z) == block.getNodeNoCheck(x, y, z));
+
+	// too many distinct nodes stay unpacked
+	block.expandNodesIfNeeded();
+	for (u32 i = 0; i < MapBlock::nodecount; i++)
+		block.data[i] = MapNode(i % 300);
+	block.tryShrinkNodes();
+	UASSERTEQ(int, block.m_palette_bits, 0);
+	UASSERT(!block.m_is_mono_block);
+
+	MapBlock::setPaletteCompression(false);
+}
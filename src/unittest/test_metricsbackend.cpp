@@ -0,0 +1,235 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "network/metricsserver.h"
+#include "util/metricsbackend.h"
+#include "util/string.h"
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+class TestMetricsBackend : public TestBase
+{
+public:
+	TestMetricsBackend() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMetricsBackend"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testCounterGauge();
+	void testHistogram();
+	void testSummary();
+	void testLabelEscaping();
+	void testHttpScrape();
+	void testHttpClientGone();
+};
+
+static TestMetricsBackend g_test_instance;
+
+void TestMetricsBackend::runTests(IGameDef *gamedef)
+{
+	TEST(testCounterGauge);
+	TEST(testHistogram);
+	TEST(testSummary);
+	TEST(testLabelEscaping);
+	TEST(testHttpScrape);
+	TEST(testHttpClientGone);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static std::string get_text(const TextMetricsBackend &backend)
+{
+	std::ostringstream os;
+	backend.writeText(os);
+	return os.str();
+}
+
+static bool contains(const std::string &text, const std::string &part)
+{
+	return text.find(part) != std::string::npos;
+}
+
+void TestMetricsBackend::testCounterGauge()
+{
+	UASSERT(!MetricsBackend().isEnabled());
+
+	TextMetricsBackend backend;
+	UASSERT(backend.isEnabled());
+	auto counter = backend.addCounter("test_counter", "A counter");
+	auto gauge_x = backend.addGauge("test_gauge", "A gauge", {{"axis", "x"}});
+	auto gauge_y = backend.addGauge("test_gauge", "A gauge", {{"axis", "y"}});
+
+	counter->increment();
+	counter->increment(2.5);
+	gauge_x->set(-4);
+	gauge_y->set(1e20);
+
+	UASSERTEQ(double, counter->get(), 3.5);
+	UASSERTEQ(std::string, get_text(backend),
+		"# HELP test_counter A counter\n"
+		"# TYPE test_counter counter\n"
+		"test_counter 3.5\n"
+		"# HELP test_gauge A gauge\n"
+		"# TYPE test_gauge gauge\n"
+		"test_gauge{axis=\"x\"} -4\n"
+		"test_gauge{axis=\"y\"} 1e+20\n");
+}
+
+void TestMetricsBackend::testHistogram()
+{
+	TextMetricsBackend backend;
+	auto histogram = backend.addHistogram("test_seconds", "Durations",
+			{0.5, 0.1, 1}, {{"kind", "step"}});
+
+	histogram->observe(0.05);
+	histogram->observe(0.1);
+	histogram->observe(0.7);
+	histogram->observe(3);
+
+	// buckets are sorted and cumulative, a value on a bound is counted in it
+	const std::string text = get_text(backend);
+	UASSERT(contains(text, "# TYPE test_seconds histogram\n"));
+	UASSERT(contains(text,
+		"test_seconds_bucket{kind=\"step\",le=\"0.1\"} 2\n"
+		"test_seconds_bucket{kind=\"step\",le=\"0.5\"} 2\n"
+		"test_seconds_bucket{kind=\"step\",le=\"1\"} 3\n"
+		"test_seconds_bucket{kind=\"step\",le=\"+Inf\"} 4\n"
+		"test_seconds_sum{kind=\"step\"} 3.85\n"
+		"test_seconds_count{kind=\"step\"} 4\n"));
+
+	auto buckets = MetricsBackend::exponentialBuckets(0.001, 10, 4);
+	UASSERTEQ(size_t, buckets.size(), 4);
+	UASSERT(std::abs(buckets[3] - 1.0) < 1e-9);
+}
+
+void TestMetricsBackend::testSummary()
+{
+	TextMetricsBackend backend;
+	auto summary = backend.addSummary("test_latency", "Latency", {0.5, 0.9});
+
+	// no values yet
+	UASSERT(contains(get_text(backend), "test_latency{quantile=\"0.5\"} NaN\n"));
+
+	for (int i = 1; i <= 100; i++)
+		summary->observe(i);
+	const std::string text = get_text(backend);
+	UASSERT(contains(text, "# TYPE test_latency summary\n"));
+	UASSERT(contains(text, "test_latency{quantile=\"0.5\"} 51\n"));
+	UASSERT(contains(text, "test_latency{quantile=\"0.9\"} 91\n"));
+	UASSERT(contains(text, "test_latency_sum 5050\n"));
+	UASSERT(contains(text, "test_latency_count 100\n"));
+
+	// only recent values are used for the quantiles
+	for (int i = 0; i < 5000; i++)
+		summary->observe(1000);
+	UASSERT(contains(get_text(backend), "test_latency{quantile=\"0.5\"} 1000\n"));
+}
+
+void TestMetricsBackend::testLabelEscaping()
+{
+	TextMetricsBackend backend;
+	backend.addCounter("test_escape", "Help with \\ and\nnewline",
+			{{"mod", "a\"b\\c\nd"}});
+
+	const std::string text = get_text(backend);
+	UASSERT(contains(text, "# HELP test_escape Help with \\\\ and\\nnewline\n"));
+	UASSERT(contains(text, "test_escape{mod=\"a\\\"b\\\\c\\nd\"} 0\n"));
+}
+
+#ifndef _WIN32
+static int connect_local(u16 port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	UASSERT(fd >= 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	UASSERT(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+	return fd;
+}
+
+static std::string http_get(u16 port, const std::string &path)
+{
+	int fd = connect_local(port);
+
+	const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	UASSERT(send(fd, request.data(), request.size(), 0) == (ssize_t)request.size());
+
+	std::string response;
+	char buf[1024];
+	ssize_t n;
+	while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+		response.append(buf, n);
+	close(fd);
+	return response;
+}
+#endif
+
+void TestMetricsBackend::testHttpScrape()
+{
+#ifndef _WIN32
+	TextMetricsBackend backend;
+	auto counter = backend.addCounter("test_scraped", "Scraped counter");
+	counter->increment(7);
+
+	// port 0 picks a free port
+	MetricsHttpServer server("127.0.0.1:0", [&backend] () {
+		std::ostringstream os;
+		backend.writeText(os);
+		return os.str();
+	});
+	UASSERT(server.getPort() != 0);
+	server.start();
+
+	std::string response = http_get(server.getPort(), "/metrics");
+	UASSERT(str_starts_with(response, "HTTP/1.1 200 OK\r\n"));
+	UASSERT(contains(response, "Content-Type: text/plain; version=0.0.4"));
+	UASSERT(contains(response, "\r\n\r\n# HELP test_scraped Scraped counter\n"));
+	UASSERT(contains(response, "test_scraped 7\n"));
+
+	response = http_get(server.getPort(), "/other");
+	UASSERT(str_starts_with(response, "HTTP/1.1 404 Not Found\r\n"));
+#endif
+}
+
+void TestMetricsBackend::testHttpClientGone()
+{
+#ifndef _WIN32
+	// Big enough that the server is still sending when the reset arrives
+	const std::string content(4 << 20, 'x');
+	MetricsHttpServer server("127.0.0.1:0", [&content] () {
+		return content;
+	});
+	server.start();
+
+	// Send a request and reset the connection right away
+	const std::string request = "GET /metrics HTTP/1.1\r\n\r\n";
+	for (int i = 0; i < 3; i++) {
+		int fd = connect_local(server.getPort());
+		UASSERT(send(fd, request.data(), request.size(), 0) == (ssize_t)request.size());
+		struct linger lg;
+		lg.l_onoff = 1;
+		lg.l_linger = 0;
+		setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+		close(fd);
+	}
+
+	// The server must still be alive
+	std::string response = http_get(server.getPort(), "/metrics");
+	UASSERT(str_starts_with(response, "HTTP/1.1 200 OK\r\n"));
+	UASSERT(response.size() > content.size());
+#endif
+}
@@ -0,0 +1,164 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "client/minimap.h"
+#include "mapblock.h" // getNodeBlockPos
+#include "noise.h"
+#include <map>
+
+class TestMinimap : public TestBase {
+public:
+	TestMinimap() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestMinimap"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testStacked();
+	void testMoving();
+	void testForgetTiles();
+};
+
+static TestMinimap g_test_instance;
+
+void TestMinimap::runTests(IGameDef *gamedef)
+{
+	TEST(testStacked);
+	TEST(testMoving);
+	TEST(testForgetTiles);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const content_t STONE = 10;
+static const content_t DIRT = 11;
+
+// Block with a surface at the given height in every column, or only air
+static MinimapMapblock *makeBlock(content_t c, s16 height)
+{
+	auto block = new MinimapMapblock;
+	for (auto &pixel : block->data) {
+		pixel.n = MapNode(c);
+		pixel.height = c == CONTENT_AIR ? 0 : height;
+		pixel.air_count = c == CONTENT_AIR ? MAP_BLOCKSIZE : MAP_BLOCKSIZE - 1 - height;
+	}
+	return block;
+}
+
+// Merges all blocks in the range again, like the minimap used to do
+static void referenceScan(const std::map<v3s16, MinimapMapblock> &blocks,
+		v3s16 pos, s16 size, s16 height, MinimapPixel *out)
+{
+	v3s16 pos_min(pos.X - size / 2, pos.Y - height / 2, pos.Z - size / 2);
+	v3s16 pos_max(pos_min.X + size - 1, pos.Y + height / 2, pos_min.Z + size - 1);
+	v3s16 blockpos_min = getNodeBlockPos(pos_min);
+	v3s16 blockpos_max = getNodeBlockPos(pos_max);
+
+	for (int i = 0; i < size * size; i++)
+		out[i] = {MapNode(CONTENT_AIR), 0, 0};
+
+	v3s16 blockpos;
+	for (blockpos.Z = blockpos_min.Z; blockpos.Z <= blockpos_max.Z; ++blockpos.Z)
+	for (blockpos.Y = blockpos_min.Y; blockpos.Y <= blockpos_max.Y; ++blockpos.Y)
+	for (blockpos.X = blockpos_min.X; blockpos.X <= blockpos_max.X; ++blockpos.X) {
+		auto it = blocks.find(blockpos);
+		if (it == blocks.end())
+			continue;
+		v3s16 block_node_min(blockpos * MAP_BLOCKSIZE);
+		v3s16 range_min = componentwise_max(block_node_min, pos_min);
+		v3s16 range_max = componentwise_min(block_node_min + (MAP_BLOCKSIZE - 1), pos_max);
+		for (s16 z = range_min.Z; z <= range_max.Z; ++z)
+		for (s16 x = range_min.X; x <= range_max.X; ++x) {
+			const MinimapPixel &in = it->second.data[(z - block_node_min.Z) * MAP_BLOCKSIZE +
+					x - block_node_min.X];
+			MinimapPixel &o = out[(x - pos_min.X) + (z - pos_min.Z) * size];
+			o.air_count += in.air_count;
+			if (in.n.param0 != CONTENT_AIR) {
+				o.n = in.n;
+				o.height = range_min.Y - pos_min.Y + in.height;
+			}
+		}
+	}
+}
+
+static bool pixelsEqual(const MinimapPixel *a, const MinimapPixel *b, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (a[i].n.param0 != b[i].n.param0 || a[i].height != b[i].height ||
+				a[i].air_count != b[i].air_count)
+			return false;
+	}
+	return true;
+}
+
+void TestMinimap::testStacked()
+{
+	MinimapScanCache cache;
+	cache.setBlock(v3s16(0, 0, 0), makeBlock(STONE, 15));
+	cache.setBlock(v3s16(0, 1, 0), makeBlock(DIRT, 3));
+	cache.setBlock(v3s16(0, 2, 0), makeBlock(CONTENT_AIR, 0));
+
+	// Covers blocks 0 to 2 in Y, starting at node 8
+	std::vector<MinimapPixel> out(16 * 16);
+	cache.getMap(v3s16(8, 24, 8), 16, 32, out.data());
+	for (const MinimapPixel &pixel : out) {
+		UASSERTEQ(content_t, pixel.n.param0, DIRT);
+		UASSERTEQ(int, pixel.height, 16 + 3 - 8);
+		UASSERTEQ(int, pixel.air_count, 0 + 12 + 16);
+	}
+
+	// Removing the upper block uncovers the lower one
+	cache.setBlock(v3s16(0, 1, 0), nullptr);
+	cache.getMap(v3s16(8, 24, 8), 16, 32, out.data());
+	UASSERTEQ(content_t, out[0].n.param0, STONE);
+	// the lowest block is only partly scanned
+	UASSERTEQ(int, out[0].height, 15);
+	UASSERTEQ(int, out[0].air_count, 16);
+}
+
+void TestMinimap::testMoving()
+{
+	const s16 size = 64, height = 48;
+	PcgRandom r(1234);
+	MinimapScanCache cache;
+	std::map<v3s16, MinimapMapblock> blocks;
+	auto set_block = [&] (v3s16 p) {
+		content_t c = r.range(0, 2) == 0 ? CONTENT_AIR : r.range(STONE, DIRT);
+		MinimapMapblock *block = makeBlock(c, r.range(0, MAP_BLOCKSIZE - 1));
+		blocks[p] = *block;
+		cache.setBlock(p, block);
+	};
+
+	v3s16 p;
+	for (p.Z = -6; p.Z <= 6; p.Z++)
+	for (p.Y = -3; p.Y <= 3; p.Y++)
+	for (p.X = -6; p.X <= 6; p.X++)
+		set_block(p);
+
+	std::vector<MinimapPixel> expected(size * size), actual(size * size);
+	v3s16 pos(0, 0, 0);
+	for (int step = 0; step < 60; step++) {
+		// Walk around and change some blocks on the way
+		pos += v3s16(r.range(-5, 5), r.range(-5, 5), r.range(-5, 5));
+		pos = componentwise_max(componentwise_min(pos, v3s16(40)), v3s16(-40));
+		if (step % 3 == 0)
+			set_block(v3s16(r.range(-6, 6), r.range(-3, 3), r.range(-6, 6)));
+
+		referenceScan(blocks, pos, size, height, expected.data());
+		cache.getMap(pos, size, height, actual.data());
+		UASSERT(pixelsEqual(expected.data(), actual.data(), size * size));
+	}
+}
+
+void TestMinimap::testForgetTiles()
+{
+	MinimapScanCache cache;
+	std::vector<MinimapPixel> out(64 * 64);
+	for (s16 x = 0; x < 1000; x += 50) {
+		cache.getMap(v3s16(x, 0, 0), 64, 32, out.data());
+		// 64 nodes are at most 5 blocks wide
+		UASSERT(cache.getTileCount() <= 5 * 5);
+	}
+}
@@ -10,10 +10,12 @@
 #include "test.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include "database/database-dummy.h"
 #include "database/database-files.h"
 #include "database/database-sqlite3.h"
+#include "database/database-writebehind.h"
 #if USE_POSTGRESQL
 #include "database/database-postgresql.h"
 #endif
@@ -102,6 +104,103 @@ class SQLite3Provider : public ModStorageDatabaseProvider
 	ModStorageDatabase *m_db = nullptr;
 };
 
+class BinaryProvider : public ModStorageDatabaseProvider
+{
+public:
+	BinaryProvider(const std::string &dir): m_dir(dir) {}
+
+	~BinaryProvider()
+	{
+		if (m_db)
+			m_db->endSave();
+		delete m_db;
+	}
+
+	ModStorageDatabase *getModStorageDatabase() override
+	{
+		if (m_db)
+			m_db->endSave();
+		delete m_db;
+		m_db = new ModStorageDatabaseBinary(m_dir);
+		m_db->beginSave();
+		return m_db;
+	}
+
+private:
+	std::string m_dir;
+	ModStorageDatabase *m_db = nullptr;
+};
+
+class WriteBehindProvider : public ModStorageDatabaseProvider
+{
+public:
+	WriteBehindProvider(const std::string &dir): m_dir(dir) {}
+
+	~WriteBehindProvider()
+	{
+		if (m_db)
+			m_db->endSave();
+		delete m_db;
+	}
+
+	ModStorageDatabase *getModStorageDatabase() override
+	{
+		if (m_db)
+			m_db->endSave();
+		delete m_db;
+		m_db = new ModStorageDatabaseWriteBehind(new ModStorageDatabaseSQLite3(m_dir));
+		m_db->beginSave();
+		return m_db;
+	}
+
+private:
+	std::string m_dir;
+	ModStorageDatabase *m_db = nullptr;
+};
+
+// Binary database whose next write only gets half of its data to the file
+class TornWriteBinaryDatabase : public ModStorageDatabaseBinary
+{
+public:
+	TornWriteBinaryDatabase(const std::string &dir):
+		ModStorageDatabaseBinary(dir),
+		m_path(dir + DIR_DELIM + "mod_storage.bin")
+	{}
+
+	bool fail_next_write = false;
+
+protected:
+	bool writeToLog(std::string_view data) override
+	{
+		if (!fail_next_write)
+			return ModStorageDatabaseBinary::writeToLog(data);
+		fail_next_write = false;
+		auto os = open_ofstream(m_path.c_str(), true, std::ios::app);
+		os.write(data.data(), data.size() / 2);
+		return false;
+	}
+
+private:
+	std::string m_path;
+};
+
+class FailingSQLite3Database : public ModStorageDatabaseSQLite3
+{
+public:
+	using ModStorageDatabaseSQLite3::ModStorageDatabaseSQLite3;
+
+	// Writing this key throws, used from the write-behind thread
+	std::atomic<bool> fail_key2{false};
+
+	bool setModEntry(const std::string &modname,
+		const std::string &key, std::string_view value) override
+	{
+		if (fail_key2 && key == "key2")
+			throw DatabaseException("key2 is not writable");
+		return ModStorageDatabaseSQLite3::setModEntry(modname, key, value);
+	}
+};
+
 #if USE_POSTGRESQL
 void clearPostgreSQLDatabase(const std::string &connect_string)
 {
@@ -159,6 +258,9 @@ class TestModStorageDatabase : public TestBase
 	void testRecallChanged();
 	void testListMods();
 	void testRemove();
+	void testBinaryRecovery(const std::string &dir);
+	void testBinaryFailedWrite(const std::string &dir);
+	void testWriteBehindFailure(const std::string &dir);
 
 private:
 	ModStorageDatabaseProvider *mod_storage_provider;
@@ -231,6 +333,60 @@ void TestModStorageDatabase::runTests(IGameDef *gamedef)
 
 	delete mod_storage_provider;
 
+	// reset database
+	fs::DeleteSingleFileOrEmptyDirectory(test_dir + DIR_DELIM + "mod_storage.sqlite");
+
+	rawstream << "-------- Write-behind SQLite3 database (same object)" << std::endl;
+
+	mod_storage_db = new ModStorageDatabaseWriteBehind(new ModStorageDatabaseSQLite3(test_dir));
+	mod_storage_provider = new FixedProvider(mod_storage_db);
+
+	runTestsForCurrentDB();
+
+	delete mod_storage_db;
+	delete mod_storage_provider;
+
+	// reset database
+	fs::DeleteSingleFileOrEmptyDirectory(test_dir + DIR_DELIM + "mod_storage.sqlite");
+
+	rawstream << "-------- Write-behind SQLite3 database (new objects)" << std::endl;
+
+	mod_storage_provider = new WriteBehindProvider(test_dir);
+
+	runTestsForCurrentDB();
+
+	delete mod_storage_provider;
+
+	rawstream << "-------- Binary database (same object)" << std::endl;
+
+	mod_storage_db = new ModStorageDatabaseBinary(test_dir);
+	mod_storage_provider = new FixedProvider(mod_storage_db);
+
+	runTestsForCurrentDB();
+
+	delete mod_storage_db;
+	delete mod_storage_provider;
+
+	// reset database
+	fs::DeleteSingleFileOrEmptyDirectory(test_dir + DIR_DELIM + "mod_storage.bin");
+
+	rawstream << "-------- Binary database (new objects)" << std::endl;
+
+	mod_storage_provider = new BinaryProvider(test_dir);
+
+	runTestsForCurrentDB();
+
+	delete mod_storage_provider;
+
+	rawstream << "-------- Binary database (recovery)" << std::endl;
+
+	TEST(testBinaryRecovery, test_dir);
+	TEST(testBinaryFailedWrite, test_dir);
+
+	rawstream << "-------- Write-behind SQLite3 database (failure)" << std::endl;
+
+	TEST(testWriteBehindFailure, test_dir);
+
 #if USE_POSTGRESQL
 	const char *env_postgresql_connect_string = getenv("MINETEST_POSTGRESQL_CONNECT_STRING");
 	if (env_postgresql_connect_string) {
@@ -348,3 +504,120 @@ void TestModStorageDatabase::testRemove()
 	UASSERT(!mod_storage_db->removeModEntries("mod1"));
 	UASSERT(mod_storage_db->removeModEntries("mod2"));
 }
+
+void TestModStorageDatabase::testBinaryRecovery(const std::string &dir)
+{
+	const std::string path = dir + DIR_DELIM + "mod_storage.bin";
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+
+	{
+		ModStorageDatabaseBinary db(dir);
+		db.beginSave();
+		UASSERT(db.setModEntry("mod1", "key1", "value1"));
+		UASSERT(db.setModEntry("mod1", "key2", "value2"));
+		UASSERT(db.setModEntry("mod1", "key1", "value3"));
+		db.endSave();
+	}
+
+	// Cut the last record in half, as if the server crashed while writing it
+	std::string data;
+	UASSERT(fs::ReadFile(path, data));
+	UASSERT(fs::safeWriteToFile(path, data.substr(0, data.size() - 3)));
+
+	{
+		ModStorageDatabaseBinary db(dir);
+		StringMap recalled;
+		db.getModEntries("mod1", &recalled);
+		UASSERTCMP(std::size_t, ==, recalled.size(), 2);
+		UASSERTCMP(std::string, ==, recalled["key1"], "value1");
+		UASSERTCMP(std::string, ==, recalled["key2"], "value2");
+
+		// Appending must continue after the last complete record
+		db.beginSave();
+		UASSERT(db.setModEntry("mod1", "key1", "value4"));
+		db.endSave();
+	}
+
+	{
+		ModStorageDatabaseBinary db(dir);
+		std::string value;
+		UASSERT(db.getModEntry("mod1", "key1", &value));
+		UASSERTCMP(std::string, ==, value, "value4");
+	}
+
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+}
+
+void TestModStorageDatabase::testBinaryFailedWrite(const std::string &dir)
+{
+	const std::string path = dir + DIR_DELIM + "mod_storage.bin";
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+
+	{
+		TornWriteBinaryDatabase db(dir);
+		db.beginSave();
+		UASSERT(db.setModEntry("mod1", "key1", "value1"));
+		db.endSave();
+
+		db.fail_next_write = true;
+		db.beginSave();
+		UASSERT(db.setModEntry("mod1", "key2", "value2"));
+		EXCEPTION_CHECK(DatabaseException, db.endSave());
+
+		// The retry must not append after the torn record
+		db.beginSave();
+		UASSERT(db.setModEntry("mod1", "key3", "value3"));
+		db.endSave();
+
+		std::string value;
+		UASSERT(db.getModEntry("mod1", "key2", &value));
+		UASSERTCMP(std::string, ==, value, "value2");
+		UASSERT(db.getModEntry("mod1", "key3", &value));
+		UASSERTCMP(std::string, ==, value, "value3");
+	}
+
+	{
+		ModStorageDatabaseBinary db(dir);
+		StringMap recalled;
+		db.getModEntries("mod1", &recalled);
+		UASSERTCMP(std::size_t, ==, recalled.size(), 3);
+		UASSERTCMP(std::string, ==, recalled["key1"], "value1");
+		UASSERTCMP(std::string, ==, recalled["key2"], "value2");
+		UASSERTCMP(std::string, ==, recalled["key3"], "value3");
+	}
+
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+}
+
+void TestModStorageDatabase::testWriteBehindFailure(const std::string &dir)
+{
+	const std::string path = dir + DIR_DELIM + "mod_storage.sqlite";
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+
+	{
+		auto *backend = new FailingSQLite3Database(dir);
+		ModStorageDatabaseWriteBehind db(backend);
+
+		backend->fail_key2 = true;
+		db.beginSave();
+		UASSERT(db.setModEntry("mod1", "key1", "value1"));
+		UASSERT(db.setModEntry("mod1", "key2", "value2"));
+		db.endSave();
+		UASSERT(!db.flush());
+
+		// The failed transaction must be closed for the retry to begin a new one
+		backend->fail_key2 = false;
+		UASSERT(db.flush());
+	}
+
+	{
+		ModStorageDatabaseSQLite3 db(dir);
+		StringMap recalled;
+		db.getModEntries("mod1", &recalled);
+		UASSERTCMP(std::size_t, ==, recalled.size(), 2);
+		UASSERTCMP(std::string, ==, recalled["key1"], "value1");
+		UASSERTCMP(std::string, ==, recalled["key2"], "value2");
+	}
+
+	fs::DeleteSingleFileOrEmptyDirectory(path);
+}
@@ -0,0 +1,127 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "client/occlusion_raster.h"
+
+class TestOcclusionRaster : public TestBase {
+public:
+	TestOcclusionRaster() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestOcclusionRaster"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testEmpty();
+	void testCameraPath();
+	void testGap();
+	void testNearPlane();
+	void testSelfOcclusion();
+};
+
+static TestOcclusionRaster g_test_instance;
+
+void TestOcclusionRaster::runTests(IGameDef *gamedef)
+{
+	TEST(testEmpty);
+	TEST(testCameraPath);
+	TEST(testGap);
+	TEST(testNearPlane);
+	TEST(testSelfOcclusion);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const f32 FOV = 90.0f * core::DEGTORAD;
+
+// A wall in the XY plane at z = 20
+static const aabb3f WALL(-50, 0, 20, 50, 40, 20);
+
+void TestOcclusionRaster::testEmpty()
+{
+	OcclusionRaster raster(64);
+	raster.begin(v3f(0, 10, 0), v3f(0, 0, 1), FOV);
+	raster.finish();
+	UASSERT(!raster.isOccluded(aabb3f(-1, 9, 30, 1, 11, 32)));
+	UASSERTEQ(f32, raster.getDepth(32, 32), 0.0f);
+}
+
+void TestOcclusionRaster::testCameraPath()
+{
+	// Walking along the wall and looking around
+	static const struct {
+		v3f position, direction;
+	} path[] = {
+		{{-30, 10, 0}, {0, 0, 1}},
+		{{-20, 12, 2}, {0.3f, 0, 1}},
+		{{-10, 15, 4}, {0.2f, -0.3f, 1}},
+		{{0, 10, 6}, {-0.4f, 0.1f, 1}},
+		{{10, 5, 8}, {0, 0.2f, 1}},
+		{{20, 10, 10}, {-0.2f, 0, 1}},
+		{{30, 10, 5}, {0, 0, 1}},
+		{{30, 10, 5}, {0, 0, -1}},
+	};
+
+	OcclusionRaster raster(128);
+	for (const auto &pose : path) {
+		raster.begin(pose.position, pose.direction, FOV);
+		raster.addOccluder(WALL);
+		raster.finish();
+		const bool looking_at_wall = pose.direction.Z > 0;
+		const f32 x = pose.position.X;
+
+		// straight behind the wall
+		UASSERTEQ(bool, raster.isOccluded(aabb3f(x - 2, 8, 40, x + 2, 12, 45)),
+				looking_at_wall);
+		// in front of the wall
+		UASSERT(!raster.isOccluded(aabb3f(x - 2, 8, 15, x + 2, 12, 18)));
+		// behind the wall, but high enough to be seen over it
+		UASSERT(!raster.isOccluded(aabb3f(x - 2, 100, 40, x + 2, 110, 45)));
+		// reaching around the side of the wall
+		UASSERT(!raster.isOccluded(aabb3f(40, 8, 30, 100, 12, 35)));
+	}
+}
+
+void TestOcclusionRaster::testGap()
+{
+	OcclusionRaster raster(128);
+	raster.begin(v3f(0, 10, 0), v3f(0, 0, 1), FOV);
+	raster.addOccluder(aabb3f(-50, 0, 20, -1, 40, 20));
+	raster.addOccluder(aabb3f(1, 0, 20, 50, 40, 20));
+	raster.finish();
+
+	// seen through the gap
+	UASSERT(!raster.isOccluded(aabb3f(-0.5f, 9, 40, 0.5f, 11, 41)));
+	// hidden on both sides of it
+	UASSERT(raster.isOccluded(aabb3f(-10, 9, 40, -8, 11, 41)));
+	UASSERT(raster.isOccluded(aabb3f(8, 9, 40, 10, 11, 41)));
+	// large boxes are tested at coarser levels of the pyramid
+	UASSERT(!raster.isOccluded(aabb3f(-20, 5, 40, 20, 15, 41)));
+}
+
+void TestOcclusionRaster::testNearPlane()
+{
+	// Standing right in front of the wall, looking along it
+	OcclusionRaster raster(128);
+	raster.begin(v3f(0, 10, 19.5f), v3f(1, 0, 1), FOV);
+	raster.addOccluder(WALL);
+	raster.finish();
+
+	UASSERT(raster.isOccluded(aabb3f(10, 8, 30, 12, 12, 32)));
+	UASSERT(!raster.isOccluded(aabb3f(10, 8, 19.6f, 12, 12, 19.9f)));
+	// boxes crossing the near plane are never occluded
+	UASSERT(!raster.isOccluded(aabb3f(-1, 9, 19, 1, 11, 25)));
+}
+
+void TestOcclusionRaster::testSelfOcclusion()
+{
+	const aabb3f block(-8, -8, 30, 8, 8, 46);
+	OcclusionRaster raster(128);
+	raster.begin(v3f(3, 2, 0), v3f(0, 0, 1), FOV);
+	raster.addOccluder(block);
+	raster.finish();
+
+	UASSERT(!raster.isOccluded(block));
+	UASSERT(raster.isOccluded(aabb3f(-2, -2, 50, 2, 2, 54)));
+}
@@ -0,0 +1,75 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "dummymap.h"
+#include "gamedef.h"
+#include "pathfinder.h"
+
+class TestPathfinder : public TestBase
+{
+public:
+	TestPathfinder() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestPathfinder"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testCachedPath(IGameDef *gamedef);
+};
+
+static TestPathfinder g_test_instance;
+
+void TestPathfinder::runTests(IGameDef *gamedef)
+{
+	TEST(testCachedPath, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestPathfinder::testCachedPath(IGameDef *gamedef)
+{
+	DummyMap map(gamedef, v3s16(-1, 0, -1), v3s16(1, 1, 1));
+	map.fill(v3s16(-1, 0, -1), v3s16(1, 1, 1), MapNode(CONTENT_AIR));
+
+	// A floor with a wall that is too high to jump over
+	for (s16 z = -16; z < 32; z++)
+	for (s16 x = -16; x < 32; x++)
+		map.setNode(v3s16(x, 0, z), MapNode(t_CONTENT_STONE));
+	for (s16 z = -8; z <= 8; z++)
+	for (s16 y = 1; y <= 3; y++)
+		map.setNode(v3s16(5, y, z), MapNode(t_CONTENT_STONE));
+
+	PathfinderCache cache(&map, gamedef->ndef());
+	map.addEventReceiver(&cache);
+
+	const v3s16 source(0, 1, 0), destination(10, 1, 0);
+	for (PathAlgorithm algo : {PA_PLAIN, PA_PLAIN_NP, PA_DIJKSTRA}) {
+		auto uncached = get_path(&map, gamedef->ndef(), source, destination,
+				12, 1, 3, algo);
+		auto cached = get_path(&map, gamedef->ndef(), source, destination,
+				12, 1, 3, algo, &cache);
+		UASSERT(cached == uncached);
+		UASSERT(!cached.empty());
+		UASSERT(cached.front() == source);
+		UASSERT(cached.back() == destination);
+		// around the wall
+		UASSERT(cached.size() > 11);
+	}
+	UASSERT(cache.size() > 0);
+
+	// Open a gap, the cached blocks must be updated
+	for (s16 y = 1; y <= 3; y++)
+		map.removeNodeWithEvent(v3s16(5, y, 0));
+	auto cached = get_path(&map, gamedef->ndef(), source, destination,
+			12, 1, 3, PA_PLAIN, &cache);
+	UASSERTEQ(size_t, cached.size(), 11);
+
+	// Unloaded areas cannot be walked through
+	auto outside = get_path(&map, gamedef->ndef(), source, v3s16(40, 1, 0),
+			12, 1, 3, PA_PLAIN, &cache);
+	UASSERT(outside.empty());
+
+	map.removeEventReceiver(&cache);
+}
@@ -0,0 +1,195 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include <algorithm>
+#include "database/database-sqlite3.h"
+#include "database/database-writebehind.h"
+#include "remoteplayer.h"
+#include "server/player_sao.h"
+#include "filesys.h"
+#include "gamedef.h"
+#include "exceptions.h"
+#include <atomic>
+
+namespace
+{
+
+// Fails to save players while the flag is set
+class FailingPlayerDatabase : public PlayerDatabase
+{
+public:
+	FailingPlayerDatabase(PlayerDatabase *backend, const std::atomic<bool> &fail) :
+		m_backend(backend), m_fail(fail)
+	{}
+
+	void savePlayer(RemotePlayer *player) override
+	{
+		if (m_fail)
+			throw DatabaseException("test failure");
+		m_backend->savePlayer(player);
+	}
+	bool loadPlayer(RemotePlayer *player, PlayerSAO *sao) override
+	{
+		return m_backend->loadPlayer(player, sao);
+	}
+	bool removePlayer(const std::string &name) override
+	{
+		return m_backend->removePlayer(name);
+	}
+	void listPlayers(std::vector<std::string> &res) override
+	{
+		m_backend->listPlayers(res);
+	}
+
+private:
+	std::unique_ptr<PlayerDatabase> m_backend;
+	const std::atomic<bool> &m_fail;
+};
+
+}
+
+class TestPlayerDatabase : public TestBase
+{
+public:
+	TestPlayerDatabase() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestPlayerDatabase"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testWriteBehind(IGameDef *gamedef);
+	void testWriteBehindFailure(IGameDef *gamedef);
+};
+
+static TestPlayerDatabase g_test_instance;
+
+void TestPlayerDatabase::runTests(IGameDef *gamedef)
+{
+	TEST(testWriteBehind, gamedef);
+	TEST(testWriteBehindFailure, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TestPlayerDatabase::testWriteBehind(IGameDef *gamedef)
+{
+	const std::string dir = getTestTempDirectory();
+	IItemDefManager *idef = gamedef->idef();
+
+	auto *db = new PlayerDatabaseWriteBehind(new PlayerDatabaseSQLite3(dir), idef);
+
+	{
+		// Same setup as for player database migration
+		RemotePlayer player("player1", idef);
+		PlayerSAO sao(nullptr, &player, 15000, false);
+		sao.finalize(&player, {});
+		player.setPlayerSAO(&sao);
+
+		sao.setHPRaw(12);
+		sao.setBasePosition(v3f(1, 2, 3));
+		sao.getMeta().setString("key", "value");
+		player.inventory.addList("main", 4)->addItem(1,
+			ItemStack("default:stone", 5, 0, idef));
+		player.setModified(true);
+
+		db->savePlayer(&player);
+		UASSERT(!sao.getMeta().isModified());
+
+		// Later changes must not end up in the saved copy
+		sao.setHPRaw(1);
+		player.inventory.getList("main")->clearItems();
+
+		player.setPlayerSAO(nullptr);
+	}
+
+	std::vector<std::string> players;
+	db->listPlayers(players);
+	UASSERT(std::find(players.begin(), players.end(), "player1") != players.end());
+
+	// Must be written before loading, even if the thread did not get to it
+	for (int i = 0; i < 2; i++) {
+		RemotePlayer player("player1", idef);
+		PlayerSAO sao(nullptr, &player, 15000, false);
+		UASSERT(db->loadPlayer(&player, &sao));
+		UASSERTEQ(u16, sao.getHP(), 12);
+		UASSERT(sao.getBasePosition() == v3f(1, 2, 3));
+		UASSERTEQ(std::string, sao.getMeta().getString("key"), "value");
+		const InventoryList *list = player.inventory.getList("main");
+		UASSERT(list);
+		UASSERTEQ(std::string, list->getItem(1).name, "default:stone");
+		UASSERTEQ(u16, list->getItem(1).count, 5);
+
+		// Second round uses a fresh database
+		delete db;
+		db = new PlayerDatabaseWriteBehind(new PlayerDatabaseSQLite3(dir), idef);
+	}
+
+	UASSERT(db->removePlayer("player1"));
+	delete db;
+
+	fs::DeleteSingleFileOrEmptyDirectory(dir + DIR_DELIM + "players.sqlite");
+}
+
+void TestPlayerDatabase::testWriteBehindFailure(IGameDef *gamedef)
+{
+	const std::string dir = getTestTempDirectory();
+	IItemDefManager *idef = gamedef->idef();
+
+	std::atomic<bool> fail{false};
+	auto *db = new PlayerDatabaseWriteBehind(
+		new FailingPlayerDatabase(new PlayerDatabaseSQLite3(dir), fail), idef);
+
+	RemotePlayer player("player1", idef);
+	PlayerSAO sao(nullptr, &player, 15000, false);
+	sao.finalize(&player, {});
+	player.setPlayerSAO(&sao);
+
+	sao.setHPRaw(12);
+	db->savePlayer(&player);
+	UASSERT(db->flush());
+
+	fail = true;
+	sao.setHPRaw(5);
+	player.inventory.addList("main", 4)->addItem(1,
+		ItemStack("default:stone", 5, 0, idef));
+	db->savePlayer(&player);
+
+	// The newer copy could not be written, so it must be loaded instead
+	// of the older data in the backend
+	{
+		RemotePlayer player2("player1", idef);
+		PlayerSAO sao2(nullptr, &player2, 15000, false);
+		UASSERT(db->loadPlayer(&player2, &sao2));
+		UASSERTEQ(u16, sao2.getHP(), 5);
+		const InventoryList *list = player2.inventory.getList("main");
+		UASSERT(list);
+		UASSERTEQ(u16, list->getItem(1).count, 5);
+	}
+
+	// Saving reports the failure and keeps the player modified
+	sao.getMeta().setString("key", "value");
+	EXCEPTION_CHECK(DatabaseException, db->savePlayer(&player));
+	UASSERT(sao.getMeta().isModified());
+
+	fail = false;
+	UASSERT(db->flush());
+	db->savePlayer(&player);
+	UASSERT(!sao.getMeta().isModified());
+
+	player.setPlayerSAO(nullptr);
+	delete db;
+
+	db = new PlayerDatabaseWriteBehind(new PlayerDatabaseSQLite3(dir), idef);
+	{
+		RemotePlayer player2("player1", idef);
+		PlayerSAO sao2(nullptr, &player2, 15000, false);
+		UASSERT(db->loadPlayer(&player2, &sao2));
+		UASSERTEQ(u16, sao2.getHP(), 5);
+	}
+	UASSERT(db->removePlayer("player1"));
+	delete db;
+
+	fs::DeleteSingleFileOrEmptyDirectory(dir + DIR_DELIM + "players.sqlite");
+}
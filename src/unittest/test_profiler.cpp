@@ -5,6 +5,8 @@
 #include "test.h"
 
 #include "profiler.h"
+#include <thread>
+#include <vector>
 
 class TestProfiler : public TestBase
 {
@@ -15,6 +17,10 @@ class TestProfiler : public TestBase
 	void runTests(IGameDef *gamedef);
 
 	void testProfilerAverage();
+	void testProfilerTypes();
+	void testProfilerClear();
+	void testProfilerThreads();
+	void testProfilerMetric();
 };
 
 static TestProfiler g_test_instance;
@@ -22,6 +28,10 @@ static TestProfiler g_test_instance;
 void TestProfiler::runTests(IGameDef *gamedef)
 {
 	TEST(testProfilerAverage);
+	TEST(testProfilerTypes);
+	TEST(testProfilerClear);
+	TEST(testProfilerThreads);
+	TEST(testProfilerMetric);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,3 +66,115 @@ void TestProfiler::testProfilerAverage()
 
 	UASSERT(p.getValue("Test2") == 123.57f);
 }
+
+void TestProfiler::testProfilerTypes()
+{
+	Profiler p;
+
+	p.add("Add", 2.f);
+	p.add("Add", 3.f);
+	UASSERTEQ(float, p.getValue("Add"), 5.f);
+	UASSERTEQ(int, p.getAvgCount("Add"), 1);
+
+	p.max("Max", -4.f);
+	UASSERTEQ(float, p.getValue("Max"), -4.f);
+	p.max("Max", 7.f);
+	p.max("Max", 1.f);
+	UASSERTEQ(float, p.getValue("Max"), 7.f);
+
+	UASSERTEQ(float, p.getValue("Unused"), 0.f);
+
+	Profiler::GraphValues values;
+	p.getPage(values, 1, 1);
+	UASSERTEQ(size_t, values.size(), 2);
+	UASSERTEQ(float, values["Add"], 5.f);
+	UASSERTEQ(float, values["Max"], 7.f);
+
+	p.remove("Add");
+	values.clear();
+	p.getPage(values, 1, 1);
+	UASSERTEQ(size_t, values.size(), 1);
+	UASSERT(values.count("Max"));
+}
+
+void TestProfiler::testProfilerClear()
+{
+	Profiler p;
+
+	p.avg("Avg", 4.f);
+	p.add("Add", 4.f);
+	p.clear();
+
+	// Names are kept, values start over
+	Profiler::GraphValues values;
+	p.getPage(values, 1, 1);
+	UASSERTEQ(size_t, values.size(), 2);
+	UASSERTEQ(float, values["Avg"], 0.f);
+	UASSERTEQ(float, values["Add"], 0.f);
+
+	p.avg("Avg", 2.f);
+	p.add("Add", 1.f);
+	UASSERTEQ(float, p.getValue("Avg"), 2.f);
+	UASSERTEQ(int, p.getAvgCount("Avg"), 1);
+	UASSERTEQ(float, p.getValue("Add"), 1.f);
+}
+
+void TestProfiler::testProfilerThreads()
+{
+	Profiler p;
+	const ProfilerMetric add_metric("TestProfiler: add");
+	const ProfilerMetric max_metric("TestProfiler: max");
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++) {
+		threads.emplace_back([&, t] () {
+			for (int i = 0; i < 1000; i++) {
+				p.add(add_metric, 1.f);
+				p.avg("TestProfiler: avg", t);
+			}
+			p.max(max_metric, t * 10.f);
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+
+	UASSERTEQ(float, p.getValue("TestProfiler: add"), 4000.f);
+	UASSERTEQ(float, p.getValue("TestProfiler: avg"), 1.5f);
+	UASSERTEQ(int, p.getAvgCount("TestProfiler: avg"), 4000);
+	UASSERTEQ(float, p.getValue("TestProfiler: max"), 30.f);
+
+	// The counters of the threads were folded together when they exited
+	UASSERTEQ(size_t, p.m_threads.size(), 0);
+	std::thread([&] () {
+		p.add(add_metric, 1.f);
+		p.max(max_metric, 50.f);
+	}).join();
+	UASSERTEQ(size_t, p.m_threads.size(), 0);
+	UASSERTEQ(float, p.getValue("TestProfiler: add"), 4001.f);
+	UASSERTEQ(float, p.getValue("TestProfiler: max"), 50.f);
+
+	p.clear();
+	UASSERTEQ(float, p.getValue("TestProfiler: add"), 0.f);
+	std::thread([&] () { p.add(add_metric, 2.f); }).join();
+	UASSERTEQ(float, p.getValue("TestProfiler: add"), 2.f);
+}
+
+void TestProfiler::testProfilerMetric()
+{
+	const ProfilerMetric metric("TestProfiler: metric");
+	const ProfilerMetric same("TestProfiler: metric");
+	const ProfilerMetric other("TestProfiler: other metric");
+	UASSERTEQ(u32, metric.getId(), same.getId());
+	UASSERT(metric.getId() != other.getId());
+	UASSERTEQ(const std::string &, metric.getName(), "TestProfiler: metric");
+
+	const ProfilerMetric timed("TestProfiler: metric", PRECISION_MICRO);
+	UASSERTEQ(const std::string &, timed.getName(), "TestProfiler: metric [us]");
+	UASSERTEQ(int, timed.getPrecision(), PRECISION_MICRO);
+
+	Profiler p;
+	{
+		ScopeProfiler sp(&p, timed, SPT_AVG);
+	}
+	UASSERTEQ(int, p.getAvgCount("TestProfiler: metric [us]"), 1);
+}
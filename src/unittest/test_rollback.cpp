@@ -0,0 +1,150 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "exceptions.h"
+#include "filesys.h"
+#include "server/rollback.h"
+#include "sqlite3.h"
+
+class TestRollback : public TestBase
+{
+public:
+	TestRollback() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestRollback"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testRecordAndQuery(IGameDef *gamedef);
+	void testPersistence(IGameDef *gamedef);
+	void testWriteFailure(IGameDef *gamedef);
+};
+
+static TestRollback g_test_instance;
+
+void TestRollback::runTests(IGameDef *gamedef)
+{
+	TEST(testRecordAndQuery, gamedef);
+	TEST(testPersistence, gamedef);
+	TEST(testWriteFailure, gamedef);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static RollbackAction set_node_action(const std::string &actor, v3s16 p,
+		const std::string &node)
+{
+	RollbackNode n_old, n_new;
+	n_old.name = "air";
+	n_new.name = node;
+	RollbackAction action;
+	action.actor = actor;
+	action.unix_time = time(0);
+	action.setSetNode(p, n_old, n_new);
+	return action;
+}
+
+static void add_actions(RollbackManager &rollback, u32 count)
+{
+	// More than one write batch, so that the writer thread takes part
+	for (u32 i = 0; i < count; i++) {
+		const std::string actor = i % 3 == 0 ? "alice" : "bob";
+		const std::string node = i % 2 == 0 ? "default:stone" : "default:dirt";
+		rollback.addAction(set_node_action(actor, v3s16(i % 40, 0, i / 40), node));
+	}
+}
+
+void TestRollback::testRecordAndQuery(IGameDef *gamedef)
+{
+	const std::string path = getTestTempDirectory() + DIR_DELIM "rollback_query";
+	fs::CreateAllDirs(path);
+
+	{
+		RollbackManager rollback(path, gamedef);
+		add_actions(rollback, 1200);
+
+		auto actions = rollback.getRevertActions("alice", 3600);
+		UASSERTEQ(size_t, actions.size(), 400);
+		for (const RollbackAction &action : actions)
+			UASSERTEQ(std::string, action.actor, "alice");
+
+		// The 3x3 area around (10, 0, 10) holds one action per position
+		actions = rollback.getNodeActors(v3s16(10, 0, 10), 1, 3600, 100);
+		UASSERTEQ(size_t, actions.size(), 9);
+		for (const RollbackAction &action : actions) {
+			UASSERT(action.p.X >= 9 && action.p.X <= 11);
+			UASSERT(action.p.Z >= 9 && action.p.Z <= 11);
+			const u32 i = action.p.Z * 40 + action.p.X;
+			UASSERTEQ(std::string, action.n_new.name,
+				i % 2 == 0 ? "default:stone" : "default:dirt");
+		}
+
+		// The limit is applied
+		actions = rollback.getNodeActors(v3s16(20, 0, 15), 30, 3600, 50);
+		UASSERTEQ(size_t, actions.size(), 50);
+	}
+
+	fs::RecursiveDelete(path);
+}
+
+void TestRollback::testPersistence(IGameDef *gamedef)
+{
+	const std::string path = getTestTempDirectory() + DIR_DELIM "rollback_persist";
+	fs::CreateAllDirs(path);
+
+	{
+		RollbackManager rollback(path, gamedef);
+		add_actions(rollback, 700);
+		// Destruction writes the remaining actions
+	}
+	{
+		RollbackManager rollback(path, gamedef);
+		UASSERTEQ(size_t, rollback.getRevertActions("", 3600).size(), 700);
+		UASSERTEQ(size_t, rollback.getRevertActions("bob", 3600).size(), 466);
+	}
+
+	fs::RecursiveDelete(path);
+}
+
+void TestRollback::testWriteFailure(IGameDef *gamedef)
+{
+	const std::string path = getTestTempDirectory() + DIR_DELIM "rollback_failure";
+	fs::CreateAllDirs(path);
+
+	{
+		RollbackManager rollback(path, gamedef);
+		rollback.addAction(set_node_action("alice", v3s16(0, 0, 0), "default:stone"));
+		rollback.flush();
+
+		// Another connection locks the database, so that writing fails
+		sqlite3 *db = nullptr;
+		UASSERTEQ(int, sqlite3_open_v2((path + DIR_DELIM "rollback.sqlite").c_str(),
+			&db, SQLITE_OPEN_READWRITE, NULL), SQLITE_OK);
+		UASSERTEQ(int, sqlite3_exec(db, "BEGIN EXCLUSIVE", NULL, NULL, NULL), SQLITE_OK);
+
+		// A new actor and node are added in the failing transaction
+		rollback.addAction(set_node_action("alice", v3s16(1, 0, 0), "default:stone"));
+		rollback.addAction(set_node_action("carol", v3s16(2, 0, 0), "default:gold"));
+		EXCEPTION_CHECK(BaseException, rollback.flush());
+
+		UASSERTEQ(int, sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL), SQLITE_OK);
+		sqlite3_close(db);
+
+		// The failed batch is written with the next one
+		rollback.addAction(set_node_action("carol", v3s16(3, 0, 0), "default:gold"));
+		rollback.flush();
+		UASSERTEQ(size_t, rollback.getRevertActions("", 3600).size(), 4);
+		auto actions = rollback.getRevertActions("carol", 3600);
+		UASSERTEQ(size_t, actions.size(), 2);
+		for (const RollbackAction &action : actions)
+			UASSERTEQ(std::string, action.n_new.name, "default:gold");
+	}
+	{
+		RollbackManager rollback(path, gamedef);
+		UASSERTEQ(size_t, rollback.getRevertActions("carol", 3600).size(), 2);
+	}
+
+	fs::RecursiveDelete(path);
+}
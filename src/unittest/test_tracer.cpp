@@ -0,0 +1,122 @@
+// Luanti
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// Copyright (C) 2026 Luanti Authors
+
+#include "test.h"
+
+#include "filesys.h"
+#include "tracer.h"
+#include <json/json.h>
+#include <sstream>
+#include <thread>
+
+class TestTracer : public TestBase
+{
+public:
+	TestTracer() { TestManager::registerTestModule(this); }
+	const char *getName() { return "TestTracer"; }
+
+	void runTests(IGameDef *gamedef);
+
+	void testChromeTrace();
+	void testOverwrite();
+	void testSlowStep();
+};
+
+static TestTracer g_test_instance;
+
+void TestTracer::runTests(IGameDef *gamedef)
+{
+	TEST(testChromeTrace);
+	TEST(testOverwrite);
+	TEST(testSlowStep);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Far in the future, so that no other events are in the traced time range
+static const u64 BASE_US = 1000000000000000ULL;
+
+static Json::Value parse_trace(u64 from_us, u64 to_us, size_t *count = nullptr)
+{
+	std::ostringstream os;
+	size_t written = g_tracer->writeChromeTrace(os, from_us, to_us);
+	if (count)
+		*count = written;
+	std::istringstream is(os.str());
+	Json::Value root;
+	is >> root;
+	return root;
+}
+
+void TestTracer::testChromeTrace()
+{
+	const ProfilerMetric outer("TestTracer: \"outer\"");
+	const ProfilerMetric inner("TestTracer: inner");
+
+	std::thread thread([&] () {
+		g_tracer->record(inner.getId(), BASE_US + 10, BASE_US + 20);
+		g_tracer->record(outer.getId(), BASE_US, BASE_US + 100);
+		g_tracer->record(inner.getId(), BASE_US + 500, BASE_US + 600);
+	});
+	thread.join();
+
+	size_t count;
+	Json::Value root = parse_trace(BASE_US, BASE_US + 100, &count);
+	UASSERTEQ(size_t, count, 2);
+	const Json::Value &events = root["traceEvents"];
+	UASSERT(events.isArray());
+	UASSERTEQ(u32, events.size(), 3);
+
+	// thread name first, then the spans sorted by start
+	UASSERTEQ(std::string, events[0]["ph"].asString(), "M");
+	UASSERTEQ(std::string, events[1]["ph"].asString(), "X");
+	UASSERTEQ(std::string, events[1]["name"].asString(), "TestTracer: \"outer\"");
+	UASSERTEQ(u64, events[1]["ts"].asUInt64(), BASE_US);
+	UASSERTEQ(u64, events[1]["dur"].asUInt64(), 100);
+	UASSERTEQ(std::string, events[2]["name"].asString(), "TestTracer: inner");
+	UASSERTEQ(u64, events[2]["ts"].asUInt64(), BASE_US + 10);
+	UASSERTEQ(u32, events[1]["tid"].asUInt(), events[0]["tid"].asUInt());
+}
+
+void TestTracer::testOverwrite()
+{
+	const ProfilerMetric metric("TestTracer: overwrite");
+	const u64 base = BASE_US + 1000000;
+	const u32 total = Tracer::EVENTS_PER_THREAD + 100;
+
+	std::thread thread([&] () {
+		for (u32 i = 0; i < total; i++)
+			g_tracer->record(metric.getId(), base + i, base + i);
+	});
+	thread.join();
+
+	// only the newest events are kept
+	size_t count;
+	Json::Value root = parse_trace(base, base + total, &count);
+	UASSERTEQ(size_t, count, Tracer::EVENTS_PER_THREAD);
+	const Json::Value &events = root["traceEvents"];
+	UASSERTEQ(u64, events[1]["ts"].asUInt64(), base + 100);
+}
+
+void TestTracer::testSlowStep()
+{
+	const std::string dir = getTestTempDirectory() + DIR_DELIM + "traces";
+	const ProfilerMetric metric("TestTracer: slow step");
+	const u64 base = BASE_US + 100000000;
+
+	std::thread thread([&] () {
+		g_tracer->record(metric.getId(), base, base + 50000);
+	});
+	thread.join();
+
+	SlowStepTracer tracer(dir, 20);
+	UASSERT(tracer.step(base, base + 10000).empty());
+	std::string path = tracer.step(base, base + 50000);
+	UASSERT(!path.empty());
+	UASSERT(fs::PathExists(path));
+	// cooldown
+	UASSERT(tracer.step(base + 60000, base + 90000).empty());
+
+	fs::RecursiveDelete(dir);
+}
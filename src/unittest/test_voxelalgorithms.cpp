@@ -4,6 +4,7 @@
 
 #include "test.h"
 
+#include "environment.h"
 #include "gamedef.h"
 #include "voxelalgorithms.h"
 #include "util/numeric.h"
@@ -19,6 +20,7 @@ class TestVoxelAlgorithms : public TestBase {
 
 	void testVoxelLineIterator();
 	void testLighting(IGameDef *gamedef);
+	void testLineOfSight(IGameDef *gamedef);
 };
 
 static TestVoxelAlgorithms g_test_instance;
@@ -27,6 +29,7 @@ void TestVoxelAlgorithms::runTests(IGameDef *gamedef)
 {
 	TEST(testVoxelLineIterator);
 	TEST(testLighting, gamedef);
+	TEST(testLineOfSight, gamedef);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -153,3 +156,62 @@ void TestVoxelAlgorithms::testLighting(IGameDef *gamedef)
 		UASSERTEQ(int, n.getParam1(), 153);
 	}
 }
+
+namespace {
+	class LineOfSightEnvironment : public Environment {
+		DummyMap map;
+	public:
+		LineOfSightEnvironment(IGameDef *gamedef)
+			: Environment(gamedef), map(gamedef, {-2, -1, -2}, {1, 0, 1})
+		{
+			map.fill({-2, -1, -2}, {1, 0, 1}, MapNode(CONTENT_AIR));
+		}
+
+		void step(f32 dtime) override {}
+
+		Map &getMap() override { return map; }
+
+		void getSelectedActiveObjects(const core::line3d<f32> &shootline_on_map,
+			std::vector<PointedThing> &objects,
+			const std::optional<Pointabilities> &pointabilities) override {}
+	};
+}
+
+void TestVoxelAlgorithms::testLineOfSight(IGameDef *gamedef)
+{
+	LineOfSightEnvironment env(gamedef);
+	Map &map = env.getMap();
+	// A wall at x = 5, through several blocks
+	for (s16 z = -20; z <= 20; z++)
+	for (s16 y = -10; y <= 10; y++)
+		map.setNode({5, y, z}, MapNode(t_CONTENT_STONE));
+
+	v3s16 p;
+	// Across air-only blocks
+	UASSERT(env.line_of_sight(v3f(-30, -10, -30) * BS, v3f(-17, 10, 30) * BS));
+	UASSERT(env.line_of_sight(v3f(-30, 0, 0) * BS, v3f(4, 0, 0) * BS));
+	UASSERT(!env.line_of_sight(v3f(-30, 0, 0) * BS, v3f(30, 0, 0) * BS, &p));
+	UASSERTEQ(v3s16, p, v3s16(5, 0, 0));
+	UASSERT(!env.line_of_sight(v3f(20, 3, 15) * BS, v3f(-20, -3, -15) * BS, &p));
+	UASSERTEQ(s16, p.X, 5);
+	// Unloaded blocks block the sight
+	UASSERT(!env.line_of_sight(v3f(-30, 0, 0) * BS, v3f(-40, 0, 0) * BS, &p));
+	UASSERTEQ(v3s16, p, v3s16(-33, 0, 0));
+
+	std::vector<std::pair<v3f, v3f>> lines = {
+		{v3f(-30, 0, 0) * BS, v3f(4, 0, 0) * BS},
+		{v3f(-30, 0, 0) * BS, v3f(30, 0, 0) * BS},
+		{v3f(20, 3, 15) * BS, v3f(-20, -3, -15) * BS},
+	};
+	std::vector<std::optional<v3s16>> results;
+	env.bulk_line_of_sight(lines, results);
+	UASSERTEQ(size_t, results.size(), lines.size());
+	UASSERT(!results[0]);
+	UASSERT(results[1] && *results[1] == v3s16(5, 0, 0));
+	for (size_t i = 0; i < lines.size(); i++) {
+		UASSERTEQ(bool, env.line_of_sight(lines[i].first, lines[i].second, &p),
+				!results[i]);
+		if (results[i])
+			UASSERTEQ(v3s16, p, *results[i]);
+	}
+}
@@ -5,6 +5,8 @@
 #include "util/areastore.h"
 #include "util/serialize.h"
 #include "util/container.h"
+#include <algorithm>
+#include <cmath>
 
 #if USE_SPATIAL
 	#include <spatialindex/SpatialIndex.h>
@@ -32,11 +34,7 @@
 
 AreaStore *AreaStore::getOptimalImplementation()
 {
-#if USE_SPATIAL
-	return new SpatialAreaStore();
-#else
-	return new VectorAreaStore();
-#endif
+	return new BvhAreaStore();
 }
 
 const Area *AreaStore::getArea(u32 id) const
@@ -168,6 +166,13 @@ void AreaStore::getAreasForPos(std::vector<Area *> *result, v3s16 pos)
 	}
 }
 
+void AreaStore::getAreasForPositions(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions)
+{
+	results->resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+		getAreasForPos(&(*results)[i], positions[i]);
+}
 
 ////
 // VectorAreaStore
@@ -225,6 +230,307 @@ void VectorAreaStore::getAreasInArea(std::vector<Area *> *result,
 	}
 }
 
+////
+// BvhAreaStore
+////
+
+// Sorts boxes so that each run of `capacity` boxes is spatially close,
+// see "STR: A Simple and Efficient Algorithm for R-Tree Packing"
+template <typename T>
+static void str_sort(std::vector<T> &items, size_t capacity)
+{
+	auto by_center = [] (auto member) {
+		return [member] (const T &a, const T &b) {
+			return a.minedge.*member + a.maxedge.*member <
+				b.minedge.*member + b.maxedge.*member;
+		};
+	};
+
+	const size_t leaf_count = (items.size() + capacity - 1) / capacity;
+	const size_t slices = std::ceil(std::cbrt((double)leaf_count));
+	const size_t slab_size = capacity * slices * slices;
+	const size_t slice_size = capacity * slices;
+
+	std::sort(items.begin(), items.end(), by_center(&v3s16::X));
+	for (size_t i = 0; i < items.size(); i += slab_size) {
+		auto slab_end = items.begin() + std::min(i + slab_size, items.size());
+		std::sort(items.begin() + i, slab_end, by_center(&v3s16::Y));
+		for (size_t j = i; j < (size_t)(slab_end - items.begin()); j += slice_size) {
+			auto slice_end = items.begin() +
+				std::min(j + slice_size, (size_t)(slab_end - items.begin()));
+			std::sort(items.begin() + j, slice_end, by_center(&v3s16::Z));
+		}
+	}
+}
+
+// Groups runs of `capacity` items into nodes
+template <typename T, typename Node>
+static void str_pack(const std::vector<T> &items, size_t capacity,
+		std::vector<Node> &nodes)
+{
+	nodes.clear();
+	nodes.reserve((items.size() + capacity - 1) / capacity);
+	for (size_t i = 0; i < items.size(); i += capacity) {
+		Node node;
+		node.first = i;
+		node.count = std::min(capacity, items.size() - i);
+		node.minedge = items[i].minedge;
+		node.maxedge = items[i].maxedge;
+		for (size_t j = i + 1; j < i + node.count; j++) {
+			node.minedge = componentwise_min(node.minedge, items[j].minedge);
+			node.maxedge = componentwise_max(node.maxedge, items[j].maxedge);
+		}
+		nodes.push_back(node);
+	}
+}
+
+void BvhAreaStore::Tree::build()
+{
+	str_sort(entries, NODE_CAPACITY);
+
+	ids.clear();
+	for (u32 i = 0; i < entries.size(); i++)
+		ids.emplace(entries[i].area->id, i);
+	removed_count = 0;
+
+	// Build the levels bottom up until there are few enough roots
+	levels.clear();
+	levels.emplace_back();
+	str_pack(entries, NODE_CAPACITY, levels.back());
+	while (levels.back().size() > NODE_CAPACITY) {
+		str_sort(levels.back(), NODE_CAPACITY);
+		std::vector<Node> parents;
+		str_pack(levels.back(), NODE_CAPACITY, parents);
+		levels.push_back(std::move(parents));
+	}
+}
+
+bool BvhAreaStore::Tree::remove(u32 id)
+{
+	auto it = ids.find(id);
+	if (it == ids.end())
+		return false;
+	entries[it->second].area = nullptr;
+	ids.erase(it);
+	removed_count++;
+	return true;
+}
+
+void BvhAreaStore::Tree::clear()
+{
+	entries.clear();
+	levels.clear();
+	ids.clear();
+	removed_count = 0;
+}
+
+void BvhAreaStore::reserve(size_t count)
+{
+	m_tree.entries.reserve(count);
+	m_tree.ids.reserve(count);
+}
+
+bool BvhAreaStore::insertArea(Area *a)
+{
+	if (a->id == U32_MAX)
+		a->id = getNextId();
+	auto res = areas_map.emplace(a->id, *a);
+	if (!res.second)
+		// ID is not unique
+		return false;
+	m_pending.push_back(&res.first->second);
+	if (m_pending.size() > PENDING_LIMIT) {
+		// The small tree is rebuilt every PENDING_LIMIT insertions and the
+		// main one when the small one gets full. A limit of about
+		// sqrt(2 * PENDING_LIMIT * n) keeps the cost per insertion lowest.
+		// Inserting many areas at once (e.g. deserialize()) ends up in a bulk load.
+		const size_t recent_limit = std::max<size_t>(64,
+				std::sqrt(2.0 * PENDING_LIMIT * m_tree.entries.size()));
+		if (m_recent.entries.size() + m_pending.size() > recent_limit)
+			m_needs_rebuild = true;
+		else
+			m_recent_needs_rebuild = true;
+	}
+	invalidateCache();
+	return true;
+}
+
+bool BvhAreaStore::removeArea(u32 id)
+{
+	AreaMap::iterator it = areas_map.find(id);
+	if (it == areas_map.end())
+		return false;
+
+	if (m_tree.remove(id)) {
+		if (m_tree.removed_count > m_tree.entries.size() / 4)
+			m_needs_rebuild = true;
+	} else if (m_recent.remove(id)) {
+		if (m_recent.removed_count > m_recent.entries.size() / 4)
+			m_recent_needs_rebuild = true;
+	} else {
+		auto p_it = std::find(m_pending.begin(), m_pending.end(), &it->second);
+		assert(p_it != m_pending.end());
+		*p_it = m_pending.back();
+		m_pending.pop_back();
+	}
+	areas_map.erase(it);
+	invalidateCache();
+	return true;
+}
+
+void BvhAreaStore::update()
+{
+	if (m_needs_rebuild) {
+		m_needs_rebuild = false;
+		m_recent_needs_rebuild = false;
+		m_pending.clear();
+		m_recent.clear();
+
+		m_tree.entries.clear();
+		for (auto &it : areas_map)
+			m_tree.entries.push_back({it.second.minedge, it.second.maxedge, &it.second});
+		m_tree.build();
+	} else if (m_recent_needs_rebuild) {
+		m_recent_needs_rebuild = false;
+
+		auto &entries = m_recent.entries;
+		entries.erase(std::remove_if(entries.begin(), entries.end(),
+			[] (const Entry &entry) { return !entry.area; }), entries.end());
+		for (Area *area : m_pending)
+			entries.push_back({area->minedge, area->maxedge, area});
+		m_pending.clear();
+		m_recent.build();
+	}
+}
+
+template <typename NodeTest, typename OnEntry>
+void BvhAreaStore::visit(NodeTest node_test, OnEntry on_entry)
+{
+	update();
+
+	visit(m_tree, node_test, on_entry);
+	visit(m_recent, node_test, on_entry);
+	for (Area *area : m_pending)
+		on_entry(area);
+}
+
+template <typename NodeTest, typename OnEntry>
+void BvhAreaStore::visit(const Tree &tree, NodeTest node_test, OnEntry on_entry)
+{
+	if (tree.levels.empty())
+		return;
+
+	// (level, node index)
+	thread_local std::vector<std::pair<size_t, u32>> stack;
+	stack.clear();
+	const auto &roots = tree.levels.back();
+	for (u32 i = 0; i < roots.size(); i++) {
+		if (node_test(roots[i].minedge, roots[i].maxedge))
+			stack.emplace_back(tree.levels.size() - 1, i);
+	}
+
+	while (!stack.empty()) {
+		auto [level, index] = stack.back();
+		stack.pop_back();
+		const Node &node = tree.levels[level][index];
+		for (u32 i = node.first; i < node.first + node.count; i++) {
+			if (level == 0) {
+				const Entry &entry = tree.entries[i];
+				if (entry.area)
+					on_entry(entry.area);
+			} else {
+				const Node &child = tree.levels[level - 1][i];
+				if (node_test(child.minedge, child.maxedge))
+					stack.emplace_back(level - 1, i);
+			}
+		}
+	}
+}
+
+void BvhAreaStore::getAreasForPosImpl(std::vector<Area *> *result, v3s16 pos)
+{
+	visit([pos] (v3s16 minedge, v3s16 maxedge) {
+		return AST_SMALLER_EQ_AS(minedge, pos) && AST_SMALLER_EQ_AS(pos, maxedge);
+	}, [result, pos] (Area *area) {
+		if (AST_CONTAINS_PT(area, pos))
+			result->push_back(area);
+	});
+}
+
+void BvhAreaStore::getAreasInArea(std::vector<Area *> *result,
+		v3s16 minedge, v3s16 maxedge, bool accept_overlap)
+{
+	visit([minedge, maxedge] (v3s16 n_minedge, v3s16 n_maxedge) {
+		const struct { v3s16 minedge, maxedge; } node{n_minedge, n_maxedge};
+		return AST_AREAS_OVERLAP(minedge, maxedge, &node);
+	}, [=] (Area *area) {
+		if (accept_overlap ? AST_AREAS_OVERLAP(minedge, maxedge, area) :
+				AST_CONTAINS_AREA(minedge, maxedge, area))
+			result->push_back(area);
+	});
+}
+
+void BvhAreaStore::getAreasForPositions(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions)
+{
+	update();
+	results->resize(positions.size());
+
+	getAreasForPositionsInTree(results, positions, m_tree);
+	getAreasForPositionsInTree(results, positions, m_recent);
+
+	for (Area *area : m_pending) {
+		for (size_t i = 0; i < positions.size(); i++) {
+			if (AST_CONTAINS_PT(area, positions[i]))
+				(*results)[i].push_back(area);
+		}
+	}
+}
+
+void BvhAreaStore::getAreasForPositionsInTree(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions, const Tree &tree)
+{
+	if (tree.levels.empty())
+		return;
+
+	// Walk the tree once, taking along the positions inside each node
+	std::vector<u32> all(positions.size());
+	for (u32 i = 0; i < all.size(); i++)
+		all[i] = i;
+	for (const Node &root : tree.levels.back())
+		getAreasForPositionsImpl(results, positions, all, tree,
+			tree.levels.size() - 1, root);
+}
+
+void BvhAreaStore::getAreasForPositionsImpl(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions, const std::vector<u32> &subset,
+		const Tree &tree, size_t level, const Node &node)
+{
+	std::vector<u32> inside;
+	for (u32 i : subset) {
+		if (AST_SMALLER_EQ_AS(node.minedge, positions[i]) &&
+				AST_SMALLER_EQ_AS(positions[i], node.maxedge))
+			inside.push_back(i);
+	}
+	if (inside.empty())
+		return;
+
+	for (u32 c = node.first; c < node.first + node.count; c++) {
+		if (level > 0) {
+			getAreasForPositionsImpl(results, positions, inside, tree,
+				level - 1, tree.levels[level - 1][c]);
+			continue;
+		}
+		Area *area = tree.entries[c].area;
+		if (!area)
+			continue;
+		for (u32 i : inside) {
+			if (AST_CONTAINS_PT(area, positions[i]))
+				(*results)[i].push_back(area);
+		}
+	}
+}
+
 #if USE_SPATIAL
 
 static inline SpatialIndex::Region get_spatial_region(const v3s16 minedge,
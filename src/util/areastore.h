@@ -6,6 +6,7 @@
 
 #include "irr_v3d.h"
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <istream>
 #include "util/container.h"
@@ -59,6 +60,11 @@ class AreaStore {
 	/// Stores output in passed vector.
 	void getAreasForPos(std::vector<Area *> *result, v3s16 pos);
 
+	/// Finds areas for many positions at once. Stores the areas of
+	/// positions[i] in (*results)[i].
+	virtual void getAreasForPositions(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions);
+
 	/// Finds areas that are completely contained inside the area defined
 	/// by the passed edges.  If @p accept_overlap is true this finds any
 	/// areas that intersect with the passed area at any point.
@@ -126,6 +132,82 @@ class VectorAreaStore : public AreaStore {
 };
 
 
+/// Bounding volume hierarchy packed with Sort-Tile-Recursive.
+/// Inserted areas are kept in a short list, then in a second small tree,
+/// until the main tree is rebuilt. Removed ones are left as holes until then.
+class BvhAreaStore : public AreaStore {
+public:
+	virtual void reserve(size_t count);
+	virtual bool insertArea(Area *a);
+	virtual bool removeArea(u32 id);
+	virtual void getAreasInArea(std::vector<Area *> *result,
+		v3s16 minedge, v3s16 maxedge, bool accept_overlap);
+	virtual void getAreasForPositions(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions);
+
+protected:
+	virtual void getAreasForPosImpl(std::vector<Area *> *result, v3s16 pos);
+
+private:
+	/// Children of a tree node per level
+	static constexpr u32 NODE_CAPACITY = 8;
+	/// Inserted areas that are only looked at one by one
+	static constexpr u32 PENDING_LIMIT = 16;
+
+	struct Entry {
+		v3s16 minedge, maxedge;
+		Area *area; // nullptr if removed
+	};
+
+	struct Node {
+		v3s16 minedge, maxedge;
+		// range of the children in the level below, or in entries
+		u32 first, count;
+	};
+
+	struct Tree {
+		/// Leaves of the tree
+		std::vector<Entry> entries;
+		/// levels[0] indexes entries, levels[i] indexes levels[i - 1].
+		/// All nodes of the last level are roots.
+		std::vector<std::vector<Node>> levels;
+		/// Area ID -> index in entries
+		std::unordered_map<u32, u32> ids;
+		size_t removed_count = 0;
+
+		/// Builds the tree from the areas in entries.
+		void build();
+		/// Leaves a hole for the area, returns false if it is not in the tree.
+		bool remove(u32 id);
+		void clear();
+	};
+
+	/// Rebuilds the trees from areas_map and m_pending if they are outdated.
+	void update();
+
+	/// Calls on_entry for every area whose tree node boxes pass node_test.
+	template <typename NodeTest, typename OnEntry>
+	void visit(NodeTest node_test, OnEntry on_entry);
+	template <typename NodeTest, typename OnEntry>
+	static void visit(const Tree &tree, NodeTest node_test, OnEntry on_entry);
+
+	static void getAreasForPositionsInTree(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions, const Tree &tree);
+	static void getAreasForPositionsImpl(std::vector<std::vector<Area *>> *results,
+		const std::vector<v3s16> &positions, const std::vector<u32> &subset,
+		const Tree &tree, size_t level, const Node &node);
+
+	/// All areas at the time of the last full rebuild
+	Tree m_tree;
+	/// Areas inserted since then, rebuilt every PENDING_LIMIT insertions
+	Tree m_recent;
+	/// Areas inserted since m_recent was built
+	std::vector<Area *> m_pending;
+	bool m_needs_rebuild = false;
+	bool m_recent_needs_rebuild = false;
+};
+
+
 #if USE_SPATIAL
 
 class SpatialAreaStore : public AreaStore {
@@ -4,19 +4,74 @@
 
 #include "metricsbackend.h"
 #include "util/thread.h"
+#include "log.h"
+#include "porting.h"
+#include "settings.h"
+#include "network/metricsserver.h"
+#include "network/networkexceptions.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
 #if USE_PROMETHEUS
 #include <prometheus/exposer.h>
 #include <prometheus/registry.h>
 #include <prometheus/counter.h>
 #include <prometheus/gauge.h>
-#include "log.h"
-#include "settings.h"
+#include <prometheus/histogram.h>
+#include <prometheus/summary.h>
 #include "exceptions.h"
 #endif
 
 /* Plain implementation */
 
-class SimpleMetricCounter : public MetricCounter
+// Metrics that can be written in the Prometheus text format
+class TextMetric
+{
+public:
+	virtual ~TextMetric() {}
+
+	/// @param labels inner part of the label set, may be empty
+	virtual void writeText(std::ostream &os, const std::string &name,
+			const std::string &labels) const = 0;
+};
+
+static void write_sample(std::ostream &os, const std::string &name,
+		const std::string &labels, double value)
+{
+	os << name;
+	if (!labels.empty())
+		os << '{' << labels << '}';
+	os << ' ';
+	if (std::isnan(value)) {
+		os << "NaN";
+	} else if (std::isinf(value)) {
+		os << (value > 0 ? "+Inf" : "-Inf");
+	} else {
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "%.15g", value);
+		os << buf;
+	}
+	os << '\n';
+}
+
+static std::string add_label(const std::string &labels, const std::string &label)
+{
+	return labels.empty() ? label : labels + "," + label;
+}
+
+static std::string format_bound(double bound)
+{
+	if (std::isinf(bound))
+		return "+Inf";
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%.15g", bound);
+	return buf;
+}
+
+class SimpleMetricCounter : public MetricCounter, public TextMetric
 {
 public:
 	SimpleMetricCounter() : MetricCounter(), m_counter(0.0) {}
@@ -34,12 +89,18 @@ class SimpleMetricCounter : public MetricCounter
 		return m_counter;
 	}
 
+	void writeText(std::ostream &os, const std::string &name,
+			const std::string &labels) const override
+	{
+		write_sample(os, name, labels, get());
+	}
+
 private:
 	mutable std::mutex m_mutex;
 	double m_counter;
 };
 
-class SimpleMetricGauge : public MetricGauge
+class SimpleMetricGauge : public MetricGauge, public TextMetric
 {
 public:
 	SimpleMetricGauge() : MetricGauge(), m_gauge(0.0) {}
@@ -67,11 +128,126 @@ class SimpleMetricGauge : public MetricGauge
 		return m_gauge;
 	}
 
+	void writeText(std::ostream &os, const std::string &name,
+			const std::string &labels) const override
+	{
+		write_sample(os, name, labels, get());
+	}
+
 private:
 	mutable std::mutex m_mutex;
 	double m_gauge;
 };
 
+class SimpleMetricHistogram : public MetricHistogram, public TextMetric
+{
+public:
+	SimpleMetricHistogram(const std::vector<double> &buckets) :
+		MetricHistogram(), m_bounds(buckets), m_counts(buckets.size() + 1, 0)
+	{
+		std::sort(m_bounds.begin(), m_bounds.end());
+	}
+
+	virtual ~SimpleMetricHistogram() {}
+
+	void observe(double value) override
+	{
+		// first bucket whose upper bound is >= value, the last one is +Inf
+		size_t i = std::lower_bound(m_bounds.begin(), m_bounds.end(), value)
+				- m_bounds.begin();
+		MutexAutoLock lock(m_mutex);
+		m_counts[i]++;
+		m_sum += value;
+	}
+
+	void writeText(std::ostream &os, const std::string &name,
+			const std::string &labels) const override
+	{
+		std::vector<u64> counts;
+		double sum;
+		{
+			MutexAutoLock lock(m_mutex);
+			counts = m_counts;
+			sum = m_sum;
+		}
+		// buckets are cumulative in the output
+		u64 total = 0;
+		for (size_t i = 0; i < counts.size(); i++) {
+			total += counts[i];
+			double bound = i < m_bounds.size() ? m_bounds[i] : INFINITY;
+			write_sample(os, name + "_bucket",
+					add_label(labels, "le=\"" + format_bound(bound) + "\""), total);
+		}
+		write_sample(os, name + "_sum", labels, sum);
+		write_sample(os, name + "_count", labels, total);
+	}
+
+private:
+	std::vector<double> m_bounds;
+	mutable std::mutex m_mutex;
+	std::vector<u64> m_counts;
+	double m_sum = 0.0;
+};
+
+// Quantiles over the most recent observations
+class SimpleMetricSummary : public MetricSummary, public TextMetric
+{
+public:
+	static constexpr size_t WINDOW_SIZE = 1024;
+
+	SimpleMetricSummary(const std::vector<double> &quantiles) :
+		MetricSummary(), m_quantiles(quantiles)
+	{
+		m_window.reserve(WINDOW_SIZE);
+	}
+
+	virtual ~SimpleMetricSummary() {}
+
+	void observe(double value) override
+	{
+		MutexAutoLock lock(m_mutex);
+		if (m_window.size() < WINDOW_SIZE)
+			m_window.push_back(value);
+		else
+			m_window[m_count % WINDOW_SIZE] = value;
+		m_count++;
+		m_sum += value;
+	}
+
+	void writeText(std::ostream &os, const std::string &name,
+			const std::string &labels) const override
+	{
+		std::vector<double> values;
+		double sum;
+		u64 count;
+		{
+			MutexAutoLock lock(m_mutex);
+			values = m_window;
+			sum = m_sum;
+			count = m_count;
+		}
+		for (double q : m_quantiles) {
+			double value = NAN;
+			if (!values.empty()) {
+				size_t i = std::min<size_t>(q * values.size(), values.size() - 1);
+				std::nth_element(values.begin(), values.begin() + i, values.end());
+				value = values[i];
+			}
+			write_sample(os, name,
+					add_label(labels, "quantile=\"" + format_bound(q) + "\""), value);
+		}
+		write_sample(os, name + "_sum", labels, sum);
+		write_sample(os, name + "_count", labels, count);
+	}
+
+private:
+	std::vector<double> m_quantiles;
+	mutable std::mutex m_mutex;
+	std::vector<double> m_window;
+	u64 m_count = 0;
+	double m_sum = 0.0;
+};
+
 MetricCounterPtr MetricsBackend::addCounter(
 		const std::string &name, const std::string &help_str, Labels labels)
 {
@@ -84,6 +260,195 @@ MetricGaugePtr MetricsBackend::addGauge(
 	return std::make_shared<SimpleMetricGauge>();
 }
 
+MetricHistogramPtr MetricsBackend::addHistogram(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &buckets, Labels labels)
+{
+	return std::make_shared<SimpleMetricHistogram>(buckets);
+}
+
+MetricSummaryPtr MetricsBackend::addSummary(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &quantiles, Labels labels)
+{
+	return std::make_shared<SimpleMetricSummary>(quantiles);
+}
+
+std::vector<double> MetricsBackend::exponentialBuckets(double start, double factor,
+		size_t count)
+{
+	std::vector<double> ret;
+	ret.reserve(count);
+	for (size_t i = 0; i < count; i++, start *= factor)
+		ret.push_back(start);
+	return ret;
+}
+
+const std::vector<double> &MetricsBackend::durationBuckets()
+{
+	static const std::vector<double> buckets = exponentialBuckets(0.0001, 2, 18);
+	return buckets;
+}
+
+ScopeMetricTimer::ScopeMetricTimer(MetricHistogram *histogram) :
+	m_histogram(histogram),
+	m_start_us(porting::getTimeUs())
+{
+}
+
+ScopeMetricTimer::~ScopeMetricTimer()
+{
+	m_histogram->observe((porting::getTimeUs() - m_start_us) / 1e6);
+}
+
+/* Prometheus text format */
+
+struct TextMetricsBackend::Family
+{
+	std::string help;
+	const char *type;
+	// inner part of the label set and the metric
+	std::vector<std::pair<std::string, std::shared_ptr<TextMetric>>> metrics;
+};
+
+static std::string escape_label_value(const std::string &s)
+{
+	std::string ret;
+	ret.reserve(s.size());
+	for (char c : s) {
+		if (c == '\\' || c == '"')
+			ret.push_back('\\');
+		if (c == '\n')
+			ret.append("\\n");
+		else
+			ret.push_back(c);
+	}
+	return ret;
+}
+
+static std::string format_labels(MetricsBackend::Labels labels)
+{
+	std::string ret;
+	for (const auto &label : labels) {
+		if (!ret.empty())
+			ret.push_back(',');
+		ret.append(label.first).append("=\"")
+			.append(escape_label_value(label.second)).append("\"");
+	}
+	return ret;
+}
+
+TextMetricsBackend::TextMetricsBackend() = default;
+
+TextMetricsBackend::~TextMetricsBackend() = default;
+
+TextMetricsBackend::Family &TextMetricsBackend::getFamily(const std::string &name,
+		const std::string &help_str, const char *type)
+{
+	auto &family = m_families[name];
+	if (!family) {
+		family = std::make_unique<Family>();
+		family->help = help_str;
+		family->type = type;
+	}
+	// a name can only be used for one type of metric
+	assert(strcmp(family->type, type) == 0);
+	return *family;
+}
+
+MetricCounterPtr TextMetricsBackend::addCounter(
+		const std::string &name, const std::string &help_str, Labels labels)
+{
+	auto metric = std::make_shared<SimpleMetricCounter>();
+	MutexAutoLock lock(m_mutex);
+	getFamily(name, help_str, "counter").metrics.emplace_back(
+			format_labels(labels), metric);
+	return metric;
+}
+
+MetricGaugePtr TextMetricsBackend::addGauge(
+		const std::string &name, const std::string &help_str, Labels labels)
+{
+	auto metric = std::make_shared<SimpleMetricGauge>();
+	MutexAutoLock lock(m_mutex);
+	getFamily(name, help_str, "gauge").metrics.emplace_back(
+			format_labels(labels), metric);
+	return metric;
+}
+
+MetricHistogramPtr TextMetricsBackend::addHistogram(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &buckets, Labels labels)
+{
+	auto metric = std::make_shared<SimpleMetricHistogram>(buckets);
+	MutexAutoLock lock(m_mutex);
+	getFamily(name, help_str, "histogram").metrics.emplace_back(
+			format_labels(labels), metric);
+	return metric;
+}
+
+MetricSummaryPtr TextMetricsBackend::addSummary(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &quantiles, Labels labels)
+{
+	auto metric = std::make_shared<SimpleMetricSummary>(quantiles);
+	MutexAutoLock lock(m_mutex);
+	getFamily(name, help_str, "summary").metrics.emplace_back(
+			format_labels(labels), metric);
+	return metric;
+}
+
+void TextMetricsBackend::writeText(std::ostream &os) const
+{
+	MutexAutoLock lock(m_mutex);
+	for (const auto &it : m_families) {
+		const Family &family = *it.second;
+		std::string help;
+		for (char c : family.help) {
+			if (c == '\\')
+				help.append("\\\\");
+			else if (c == '\n')
+				help.append("\\n");
+			else
+				help.push_back(c);
+		}
+		os << "# HELP " << it.first << ' ' << help << '\n';
+		os << "# TYPE " << it.first << ' ' << family.type << '\n';
+		for (const auto &metric : family.metrics)
+			metric.second->writeText(os, it.first, metric.first);
+	}
+}
+
+void TextMetricsBackend::listen(const std::string &address)
+{
+	m_server = std::make_unique<MetricsHttpServer>(address, [this] () {
+		std::ostringstream os;
+		writeText(os);
+		return os.str();
+	});
+	m_server->start();
+}
+
+MetricsBackend *createBuiltinMetricsBackend()
+{
+	if (!g_settings->getBool("prometheus_builtin_exporter"))
+		return nullptr;
+	std::string addr = g_settings->get("prometheus_listener_address");
+	if (addr.empty())
+		return nullptr;
+
+	infostream << "Starting built-in Prometheus metrics on " << addr << std::endl;
+	auto backend = std::make_unique<TextMetricsBackend>();
+	try {
+		backend->listen(addr);
+	} catch (std::exception &e) {
+		errorstream << "Error while starting Prometheus metrics on " << addr
+			<< ": " << e.what() << std::endl;
+		return nullptr;
+	}
+	return backend.release();
+}
+
 /* Prometheus backend */
 
 #if USE_PROMETHEUS
@@ -144,6 +509,67 @@ class PrometheusMetricGauge : public MetricGauge
 	prometheus::Gauge &m_gauge;
 };
 
+class PrometheusMetricHistogram : public MetricHistogram
+{
+public:
+	PrometheusMetricHistogram() = delete;
+
+	PrometheusMetricHistogram(const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, MetricsBackend::Labels labels,
+			std::shared_ptr<prometheus::Registry> registry) :
+			MetricHistogram(),
+			m_family(prometheus::BuildHistogram()
+							.Name(name)
+							.Help(help_str)
+							.Register(*registry)),
+			m_histogram(m_family.Add(labels,
+					prometheus::Histogram::BucketBoundaries(buckets)))
+	{
+	}
+
+	virtual ~PrometheusMetricHistogram() {}
+
+	virtual void observe(double value) { m_histogram.Observe(value); }
+
+private:
+	prometheus::Family<prometheus::Histogram> &m_family;
+	prometheus::Histogram &m_histogram;
+};
+
+class PrometheusMetricSummary : public MetricSummary
+{
+public:
+	PrometheusMetricSummary() = delete;
+
+	PrometheusMetricSummary(const std::string &name, const std::string &help_str,
+			const std::vector<double> &quantiles, MetricsBackend::Labels labels,
+			std::shared_ptr<prometheus::Registry> registry) :
+			MetricSummary(),
+			m_family(prometheus::BuildSummary()
+							.Name(name)
+							.Help(help_str)
+							.Register(*registry)),
+			m_summary(m_family.Add(labels, toQuantiles(quantiles)))
+	{
+	}
+
+	virtual ~PrometheusMetricSummary() {}
+
+	virtual void observe(double value) { m_summary.Observe(value); }
+
+private:
+	static prometheus::Summary::Quantiles toQuantiles(const std::vector<double> &quantiles)
+	{
+		prometheus::Summary::Quantiles ret;
+		for (double q : quantiles)
+			ret.push_back({q, 0.01});
+		return ret;
+	}
+
+	prometheus::Family<prometheus::Summary> &m_family;
+	prometheus::Summary &m_summary;
+};
+
 class PrometheusMetricsBackend : public MetricsBackend
 {
 public:
@@ -156,12 +582,20 @@ class PrometheusMetricsBackend : public MetricsBackend
 
 	virtual ~PrometheusMetricsBackend() {}
 
+	bool isEnabled() const override { return true; }
+
 	MetricCounterPtr addCounter(
 			const std::string &name, const std::string &help_str,
 			Labels labels = {}) override;
 	MetricGaugePtr addGauge(
 			const std::string &name, const std::string &help_str,
 			Labels labels = {}) override;
+	MetricHistogramPtr addHistogram(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, Labels labels = {}) override;
+	MetricSummaryPtr addSummary(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &quantiles, Labels labels = {}) override;
 
 private:
 	std::unique_ptr<prometheus::Exposer> m_exposer;
@@ -180,6 +614,22 @@ MetricGaugePtr PrometheusMetricsBackend::addGauge(
 	return std::make_shared<PrometheusMetricGauge>(name, help_str, labels, m_registry);
 }
 
+MetricHistogramPtr PrometheusMetricsBackend::addHistogram(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &buckets, Labels labels)
+{
+	return std::make_shared<PrometheusMetricHistogram>(name, help_str, buckets,
+			labels, m_registry);
+}
+
+MetricSummaryPtr PrometheusMetricsBackend::addSummary(
+		const std::string &name, const std::string &help_str,
+		const std::vector<double> &quantiles, Labels labels)
+{
+	return std::make_shared<PrometheusMetricSummary>(name, help_str, quantiles,
+			labels, m_registry);
+}
+
 MetricsBackend *createPrometheusMetricsBackend()
 {
 	std::string addr;
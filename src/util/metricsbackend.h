@@ -3,10 +3,15 @@
 // Copyright (C) 2013-2020 Minetest core developers team
 
 #pragma once
+#include <map>
 #include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 #include "config.h"
+#include "irrlichttypes.h"
 
 class MetricCounter
 {
@@ -35,6 +40,28 @@ class MetricGauge
 
 typedef std::shared_ptr<MetricGauge> MetricGaugePtr;
 
+class MetricHistogram
+{
+public:
+	MetricHistogram() = default;
+	virtual ~MetricHistogram() {}
+
+	virtual void observe(double value) = 0;
+};
+
+typedef std::shared_ptr<MetricHistogram> MetricHistogramPtr;
+
+class MetricSummary
+{
+public:
+	MetricSummary() = default;
+	virtual ~MetricSummary() {}
+
+	virtual void observe(double value) = 0;
+};
+
+typedef std::shared_ptr<MetricSummary> MetricSummaryPtr;
+
 class MetricsBackend
 {
 public:
@@ -42,6 +69,9 @@ class MetricsBackend
 
 	virtual ~MetricsBackend() {}
 
+	/// False if metrics are thrown away, as this class does
+	virtual bool isEnabled() const { return false; }
+
 	typedef std::initializer_list<std::pair<const std::string, std::string>> Labels;
 
 	virtual MetricCounterPtr addCounter(
@@ -50,8 +80,80 @@ class MetricsBackend
 	virtual MetricGaugePtr addGauge(
 			const std::string &name, const std::string &help_str,
 			Labels labels = {});
+	/// @param buckets upper bounds of the buckets, ascending
+	virtual MetricHistogramPtr addHistogram(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, Labels labels = {});
+	/// @param quantiles e.g. 0.5 for the median
+	virtual MetricSummaryPtr addSummary(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &quantiles, Labels labels = {});
+
+	/// Bucket bounds start, start * factor, ... (count in total)
+	static std::vector<double> exponentialBuckets(double start, double factor,
+			size_t count);
+	/// Buckets for durations in seconds, from 100 µs to ~13 s
+	static const std::vector<double> &durationBuckets();
+};
+
+// Observes the lifetime of this object in seconds
+class ScopeMetricTimer
+{
+public:
+	ScopeMetricTimer(MetricHistogram *histogram);
+	~ScopeMetricTimer();
+
+private:
+	MetricHistogram *m_histogram;
+	u64 m_start_us;
+};
+
+class MetricsHttpServer;
+
+/*
+	Keeps all metrics and writes them in the Prometheus text exposition format,
+	without depending on prometheus-cpp
+*/
+class TextMetricsBackend : public MetricsBackend
+{
+public:
+	TextMetricsBackend();
+	virtual ~TextMetricsBackend();
+
+	bool isEnabled() const override { return true; }
+
+	MetricCounterPtr addCounter(
+			const std::string &name, const std::string &help_str,
+			Labels labels = {}) override;
+	MetricGaugePtr addGauge(
+			const std::string &name, const std::string &help_str,
+			Labels labels = {}) override;
+	MetricHistogramPtr addHistogram(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &buckets, Labels labels = {}) override;
+	MetricSummaryPtr addSummary(
+			const std::string &name, const std::string &help_str,
+			const std::vector<double> &quantiles, Labels labels = {}) override;
+
+	void writeText(std::ostream &os) const;
+
+	/// Serve the metrics over HTTP, may throw SocketException
+	void listen(const std::string &address);
+
+private:
+	struct Family;
+
+	Family &getFamily(const std::string &name, const std::string &help_str,
+			const char *type);
+
+	mutable std::mutex m_mutex;
+	// sorted by name, so that the output is stable
+	std::map<std::string, std::unique_ptr<Family>> m_families;
+	std::unique_ptr<MetricsHttpServer> m_server;
 };
 
 #if USE_PROMETHEUS
 MetricsBackend *createPrometheusMetricsBackend();
 #endif
+// Returns null if disabled or the listener could not be started
+MetricsBackend *createBuiltinMetricsBackend();